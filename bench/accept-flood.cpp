@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Connections pending in the backlog of a listener are accepted by an
+ * event loop, with various accept budgets, while a task deferred again
+ * and again notes the longest round of the loop, i.e. how long other
+ * channels of the loop starve. The baseline accepts until EAGAIN by
+ * `accept` and sets each connection non-blocking by `fcntl`.
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace
+{
+  /** @brief Connections in a flood, within the default `somaxconn` */
+  constexpr std::size_t connections = 4000;
+
+  using std::chrono::steady_clock;
+
+  std::uint16_t port_of(int fd)
+  {
+    sockaddr_in in{};
+    socklen_t length = sizeof(in);
+    if (::getsockname(fd, reinterpret_cast<sockaddr *>(&in), &length) != 0)
+      std::abort();
+    return ntohs(in.sin_port);
+  }
+
+  /** @brief Fill the backlog, connections are established once returned */
+  std::vector<int> flood(std::uint16_t port)
+  {
+    sockaddr_in in{};
+    in.sin_family = AF_INET;
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    in.sin_port = htons(port);
+    std::vector<int> clients;
+    for (std::size_t i = 0; i < connections; i++)
+    {
+      int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd == -1 || ::connect(fd, reinterpret_cast<sockaddr *>(&in),
+                                sizeof(in)) != 0)
+        std::abort();
+      clients.push_back(fd);
+    }
+    return clients;
+  }
+
+  /** @brief Accept like the listener of applism does */
+  class accept_all : private lanxc::linuxy::event_channel
+  {
+  public:
+    accept_all(lanxc::linuxy::event_loop &loop, int fd,
+               lanxc::buffer_manager &bm,
+               std::function<void(lanxc::connection_endpoint::pointer)> cb)
+      : event_channel(loop, fd)
+      , _fd(fd)
+      , _bm(bm)
+      , _callback(std::move(cb))
+    {
+      set_events(readable);
+    }
+
+  private:
+    void on_readable() override
+    {
+      int fd;
+      while ((fd = ::accept(_fd, nullptr, nullptr)) != -1)
+        _callback(std::make_shared<lanxc::linuxy::socket_endpoint>(
+            loop(), lanxc::unixy::file_descriptor{fd}, _bm));
+    }
+
+    void on_writable() override
+    { }
+
+    int _fd;
+    lanxc::buffer_manager &_bm;
+    std::function<void(lanxc::connection_endpoint::pointer)> _callback;
+  };
+
+  void run(const char *name, std::size_t budget)
+  {
+    lanxc::slab_buffer_manager bm;
+    lanxc::linuxy::event_loop loop;
+    std::size_t accepted = 0;
+    auto on_accepted = [&](lanxc::connection_endpoint::pointer e)
+    {
+      bench::keep(e);
+      if (++accepted == connections)
+        loop.stop();
+    };
+
+    // A budget of 0 for the baseline
+    std::shared_ptr<lanxc::connection_listener> listener;
+    std::unique_ptr<accept_all> baseline;
+    int fd;
+    if (budget != 0)
+    {
+      auto builder =
+          std::make_shared<lanxc::linuxy::socket_listener_builder>(loop, bm);
+      builder->set_accept_budget(budget);
+      listener = builder->bind("127.0.0.1", 0)->build(on_accepted);
+      fd = std::dynamic_pointer_cast<lanxc::linuxy::socket_listener>(
+          listener)->native_handle();
+    }
+    else
+    {
+      sockaddr_in in{};
+      in.sin_family = AF_INET;
+      in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    0);
+      if (fd == -1
+          || ::bind(fd, reinterpret_cast<sockaddr *>(&in), sizeof(in)) != 0
+          || ::listen(fd, SOMAXCONN) != 0)
+        std::abort();
+      baseline.reset(new accept_all(loop, fd, bm, on_accepted));
+    }
+    auto clients = flood(port_of(fd));
+
+    auto last = steady_clock::now();
+    steady_clock::duration longest{};
+    std::function<void()> tick = [&]
+    {
+      auto now = steady_clock::now();
+      longest = std::max(longest, now - last);
+      last = now;
+      if (accepted < connections)
+        loop.defer([&] { tick(); });
+    };
+    auto task = loop.defer([&] { tick(); });
+
+    double ns = bench::measure(name, connections, [&]
+    {
+      loop.run();
+      // The last round is stopped once all are accepted
+      longest = std::max(longest, steady_clock::now() - last);
+    });
+    std::printf("%-40s %12.0f conn/s %8.3f ms longest round\n", "",
+                1e9 * double(connections) / ns,
+                double(std::chrono::duration_cast<std::chrono::microseconds>(
+                    longest).count()) / 1e3);
+
+    for (int c : clients)
+      ::close(c);
+    if (baseline)
+    {
+      baseline.reset();
+      ::close(fd);
+    }
+  }
+}
+
+int main()
+{
+  std::printf("%zu connections pending in the backlog over loopback TCP\n",
+              connections);
+  run("accept and fcntl until EAGAIN", 0);
+  run("accept4, budget of 1", 1);
+  run("accept4, budget of 16", 16);
+  run("accept4, budget of 64", 64);
+  run("accept4, unlimited budget", std::numeric_limits<std::size_t>::max());
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Lookup of adaptive radix tree compared with rbtree, with random 64-bit
+ * connection ids, string keys, and longest prefix match of IPv4 routes
+ * compared with probing a hash table per prefix length
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/link/art.hpp>
+#include <lanxc/link/rbtree.hpp>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace lanxc::link;
+
+namespace
+{
+  template<typename Key>
+  struct art_entry : art_node<Key, art_entry<Key>>
+  {
+    art_entry(Key k)
+        : art_node<Key, art_entry<Key>>(std::move(k))
+    { }
+  };
+
+  template<typename Key>
+  struct rbtree_entry : rbtree_node<Key, rbtree_entry<Key>>
+  {
+    rbtree_entry(Key k)
+        : rbtree_node<Key, rbtree_entry<Key>>(std::move(k))
+    { }
+  };
+
+  template<typename Key>
+  void run(const char *title, const std::vector<Key> &keys,
+           std::size_t lookups)
+  {
+    std::vector<art_entry<Key>> anodes(keys.begin(), keys.end());
+    std::vector<rbtree_entry<Key>> rnodes(keys.begin(), keys.end());
+    art<Key, art_entry<Key>> atree;
+    rbtree<Key, rbtree_entry<Key>> rtree;
+    for (auto &x : anodes) atree.insert(x);
+    for (auto &x : rnodes) rtree.insert(x);
+
+    std::mt19937 engine(7);
+    std::uniform_int_distribution<std::size_t> dist(0, keys.size() - 1);
+    std::vector<std::size_t> order(lookups);
+    for (auto &i : order)
+      i = dist(engine);
+
+    std::printf("%s, %zu nodes, %zu lookups\n", title, keys.size(), lookups);
+
+    std::size_t found = 0;
+    bench::measure("rbtree", lookups, [&]
+    {
+      for (auto i : order)
+        found += rtree.find(keys[i]) != rtree.end();
+    });
+    bench::keep(found);
+
+    found = 0;
+    bench::measure("art", lookups, [&]
+    {
+      for (auto i : order)
+        found += atree.find(keys[i]) != nullptr;
+    });
+    bench::keep(found);
+  }
+
+  void run_ids(std::size_t n)
+  {
+    std::mt19937_64 engine(42);
+    std::vector<std::uint64_t> keys(n);
+    for (auto &k : keys)
+      k = engine();
+    run("connection ids", keys, 2000000);
+  }
+
+  void run_strings(std::size_t n)
+  {
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<int> dist('a', 'z');
+    std::vector<std::string> keys(n);
+    for (auto &k : keys)
+    {
+      k = "/api/v1/";
+      while (k.size() < 24)
+        k.push_back(static_cast<char>(dist(engine)));
+    }
+    run("strings", keys, 2000000);
+  }
+
+  using route = art_prefix<4>;
+
+  struct route_entry : art_node<route, route_entry>
+  {
+    route_entry(const route &r)
+        : art_node(r)
+    { }
+  };
+
+  /** Probe one hash table per prefix length, from the longest one */
+  struct hashed_routes
+  {
+    std::unordered_map<std::uint32_t, const route *> table[33];
+
+    void insert(const route &r)
+    {
+      std::uint32_t a = 0;
+      for (auto b : r.address)
+        a = a << 8 | b;
+      table[r.length][mask(a, r.length)] = &r;
+    }
+
+    const route *match(std::uint32_t a) const
+    {
+      for (std::size_t len = 33; len-- > 0; )
+      {
+        if (table[len].empty())
+          continue;
+        auto i = table[len].find(mask(a, len));
+        if (i != table[len].end())
+          return i->second;
+      }
+      return nullptr;
+    }
+
+    static std::uint32_t mask(std::uint32_t a, std::size_t len)
+    { return len == 0 ? 0 : a & ~std::uint32_t(0) << (32 - len); }
+  };
+
+  void run_routes(std::size_t n, std::size_t lookups)
+  {
+    std::mt19937 engine(42);
+    std::vector<route> routes(n);
+    for (auto &r : routes)
+    {
+      std::uint32_t a = engine();
+      r.length = 8 + engine() % 25;
+      for (std::size_t i = 0; i < 4; i++)
+        r.address[i] = static_cast<std::uint8_t>(a >> (24 - 8 * i));
+    }
+
+    std::vector<route_entry> nodes(routes.begin(), routes.end());
+    art<route, route_entry> tree;
+    hashed_routes hashed;
+    for (auto &x : nodes) tree.insert(x);
+    for (auto &r : routes) hashed.insert(r);
+
+    // Addresses inside of random routes
+    std::vector<std::uint32_t> addresses(lookups);
+    for (auto &a : addresses)
+    {
+      auto &r = routes[engine() % n];
+      a = 0;
+      for (auto b : r.address)
+        a = a << 8 | b;
+      a |= engine() >> r.length;
+    }
+
+    std::printf("IPv4 routes, %zu routes, %zu lookups\n", n, lookups);
+
+    std::size_t found = 0;
+    bench::measure("hash table per prefix length", lookups, [&]
+    {
+      for (auto a : addresses)
+        found += hashed.match(a) != nullptr;
+    });
+    bench::keep(found);
+
+    found = 0;
+    bench::measure("art longest_prefix_match", lookups, [&]
+    {
+      for (auto a : addresses)
+        found += tree.longest_prefix_match(a) != nullptr;
+    });
+    bench::keep(found);
+  }
+}
+
+int main()
+{
+  run_ids(1000);
+  run_ids(1000000);
+  run_strings(1000);
+  run_strings(1000000);
+  run_routes(1000, 2000000);
+  run_routes(500000, 2000000);
+}
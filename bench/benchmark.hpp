@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/task_context.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <deque>
+#include <memory>
+
+namespace bench
+{
+  /**
+   * @brief Run @p routine once and report the elapsed time
+   * @param name Name of the case
+   * @param operations Number of operations the routine performs, used to
+   *                   report the cost of each operation
+   * @returns Elapsed time in nanoseconds
+   */
+  template<typename Routine>
+  double measure(const char *name, std::size_t operations, Routine &&routine)
+  {
+    auto start = std::chrono::steady_clock::now();
+    routine();
+    auto stop = std::chrono::steady_clock::now();
+    double ns = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+            .count());
+    std::printf("%-40s %12.3f ms %10.2f ns/op\n", name, ns / 1e6,
+                operations ? ns / double(operations) : 0.0);
+    return ns;
+  }
+
+  /**
+   * @brief Run deferred routines in order on the calling thread, to wait
+   * for futures of streams reading synchronously
+   */
+  class executor : public lanxc::task_context
+  {
+    struct task : lanxc::deferred
+    {
+      explicit task(lanxc::function<void()> f)
+        : routine(std::move(f))
+        , cancelled(false)
+      { }
+
+      void cancel() override
+      { cancelled = true; }
+
+      void execute() override
+      { routine(); }
+
+      lanxc::function<void()> routine;
+      bool cancelled;
+    };
+
+    std::deque<std::shared_ptr<task>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<task>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+
+  /** @brief Prevent the compiler from optimizing away @p value */
+  template<typename T>
+  inline void keep(const T &value)
+  {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Cost of sending a message made of a small header and a body over a pipe,
+ * comparing copying both into one buffer, writing them separately, and
+ * gathering them with a buffer chain, reporting system calls per message
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+#include <lanxc-unixy/stream.hpp>
+
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+  constexpr std::size_t messages = 200000;
+  constexpr std::size_t header_size = 16;
+
+  /** @brief Read a counter of this process from /proc/self/io */
+  unsigned long long io_counter(const char *name)
+  {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    unsigned long long value = 0;
+    while (io >> key >> value)
+      if (key == std::string(name) + ":")
+        return value;
+    return 0;
+  }
+
+  template<typename Send>
+  void run(const char *name, std::size_t body_size, Send &&send)
+  {
+    lanxc::slab_buffer_manager bm;
+    int fds[2];
+    if (::pipe(fds) != 0)
+      return;
+    lanxc::unixy::stream reader({fds[0]}, bm), writer({fds[1]}, bm);
+    std::size_t total = messages * (header_size + body_size);
+
+    std::thread drain([&]
+    {
+      bench::executor executor;
+      std::size_t n = 0;
+      while (n < total)
+      {
+        lanxc::buffer_chain chain;
+        for (int i = 0; i < 4; i++)
+        {
+          lanxc::writable_buffer b(bm, 16384);
+          b.resize(0);
+          chain.push_back(std::move(b));
+        }
+        auto task = reader.read(std::move(chain))
+            .then([&](std::size_t r, lanxc::buffer_chain) { n += r; })
+            .start(executor);
+        executor.run();
+      }
+    });
+
+    auto writes = io_counter("syscw");
+    bench::measure(name, messages, [&]
+    {
+      for (std::size_t i = 0; i < messages; i++)
+        send(bm, writer, body_size);
+    });
+    writes = io_counter("syscw") - writes;
+    drain.join();
+    std::printf("%-40s %12.2f writes/op\n", "",
+                double(writes) / double(messages));
+  }
+
+  void fill_header(std::uint8_t *p, std::size_t body_size)
+  {
+    std::memset(p, 0, header_size);
+    std::memcpy(p, &body_size, sizeof(body_size));
+  }
+
+  void copy(lanxc::buffer_manager &bm, lanxc::unixy::stream &s,
+            std::size_t body_size)
+  {
+    lanxc::writable_buffer body(bm, body_size);
+    body.data()[0] = 1;
+    lanxc::writable_buffer b(bm, header_size + body_size);
+    fill_header(b.data(), body_size);
+    std::memcpy(b.data() + header_size, body.data(), body_size);
+    s.write(std::move(b));
+  }
+
+  void separate(lanxc::buffer_manager &bm, lanxc::unixy::stream &s,
+                std::size_t body_size)
+  {
+    lanxc::writable_buffer body(bm, body_size);
+    body.data()[0] = 1;
+    lanxc::writable_buffer header(bm, header_size);
+    fill_header(header.data(), body_size);
+    s.write(std::move(header));
+    s.write(std::move(body));
+  }
+
+  void gather(lanxc::buffer_manager &bm, lanxc::unixy::stream &s,
+              std::size_t body_size)
+  {
+    lanxc::writable_buffer body(bm, body_size);
+    body.data()[0] = 1;
+    lanxc::writable_buffer header(bm, header_size);
+    fill_header(header.data(), body_size);
+    lanxc::buffer_chain chain;
+    chain.push_back(std::move(header));
+    chain.push_back(std::move(body));
+    s.write(std::move(chain));
+  }
+}
+
+int main()
+{
+  std::printf("%zu messages with %zu bytes header over a pipe\n",
+              messages, header_size);
+  for (std::size_t body_size : { 64u, 1024u, 16384u })
+  {
+    std::printf("%zu bytes body\n", body_size);
+    run("copy into one buffer", body_size, copy);
+    run("write header and body", body_size, separate);
+    run("writev buffer chain", body_size, gather);
+  }
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Throughput of acquiring and releasing buffers from 1 to 64 threads,
+ * comparing slab_buffer_manager against malloc and free
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  struct malloc_buffer_manager : lanxc::buffer_manager
+  {
+    std::uint8_t *acquire(std::size_t size) override
+    { return static_cast<std::uint8_t *>(std::malloc(size)); }
+
+    void release(std::uint8_t *data, std::size_t) noexcept override
+    { std::free(data); }
+  };
+
+  constexpr std::size_t operations = 4000000;
+
+  /**
+   * Each thread holds a window of 32 buffers of typical socket buffer
+   * sizes, releasing the oldest one for every buffer acquired
+   */
+  void work(lanxc::buffer_manager &bm, std::size_t count, unsigned seed)
+  {
+    static const std::size_t sizes[] = { 256, 1500, 4096, 16384, 65536 };
+    std::minstd_rand engine(seed);
+    constexpr std::size_t window = 32;
+    std::uint8_t *held[window] = {};
+    std::size_t held_size[window] = {};
+    for (std::size_t i = 0; i < count; i++)
+    {
+      std::size_t slot = i % window;
+      bm.release(held[slot], held_size[slot]);
+      held_size[slot] = sizes[engine() % 5];
+      held[slot] = bm.acquire(held_size[slot]);
+      held[slot][0] = 1;
+    }
+    for (std::size_t slot = 0; slot < window; slot++)
+      bm.release(held[slot], held_size[slot]);
+  }
+
+  void run(const char *name, lanxc::buffer_manager &bm, unsigned threads)
+  {
+    bench::measure(name, operations, [&]
+    {
+      std::vector<std::thread> workers;
+      for (unsigned t = 0; t < threads; t++)
+        workers.emplace_back(work, std::ref(bm), operations / threads, t);
+      for (auto &w : workers)
+        w.join();
+    });
+  }
+}
+
+int main()
+{
+  std::printf("%zu acquire/release pairs in total, %u hardware threads\n",
+              operations, std::thread::hardware_concurrency());
+  for (unsigned threads : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+  {
+    std::printf("%u threads\n", threads);
+    malloc_buffer_manager m;
+    lanxc::slab_buffer_manager s;
+    run("malloc/free", m, threads);
+    run("slab_buffer_manager", s, threads);
+  }
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Serializing records of varints and a string, into a temporary string
+ * copied to a buffer afterwards versus straight into buffers with
+ * buffer_writer, and encoding varints byte by byte versus varint::encode
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/core/buffer_writer.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t records = 1 << 20;
+
+  lanxc::slab_buffer_manager bm;
+
+  /** @brief Drop bytes written */
+  class null_stream : public lanxc::writable_stream
+  {
+  public:
+    lanxc::writable_buffer allocate_buffer(std::size_t size) override
+    { return lanxc::writable_buffer(bm, size); }
+
+    std::size_t write(lanxc::writable_buffer b) override
+    {
+      bytes += b.size();
+      return b.size();
+    }
+
+    std::size_t write(lanxc::buffer_chain chain) override
+    {
+      bytes += chain.size();
+      return chain.size();
+    }
+
+    void close() override
+    { }
+
+    lanxc::future<> flush() override
+    { return lanxc::future<>::resolve(); }
+
+    std::size_t bytes = 0;
+  };
+
+  struct record
+  {
+    std::uint64_t id;
+    std::int64_t delta;
+    std::uint32_t flags;
+    std::string name;
+  };
+
+  std::vector<record> generate()
+  {
+    std::mt19937_64 random(1);
+    std::vector<record> v(records);
+    for (auto &r : v)
+    {
+      // Magnitudes spread over all lengths of varint
+      r.id = random() >> (random() % 64);
+      r.delta = std::int64_t(random() >> (random() % 64)) / 2
+                * (random() % 2 ? 1 : -1);
+      r.flags = std::uint32_t(random());
+      r.name.assign(random() % 32, 'n');
+    }
+    return v;
+  }
+
+  void put_varint_bytewise(std::string &s, std::uint64_t v)
+  {
+    while (v >= 0x80)
+    {
+      s.push_back(char(v | 0x80));
+      v >>= 7;
+    }
+    s.push_back(char(v));
+  }
+
+  void via_string(const std::vector<record> &v)
+  {
+    null_stream out;
+    bench::measure("std::string then copied", records, [&]
+    {
+      std::string s;
+      for (auto &r : v)
+      {
+        put_varint_bytewise(s, r.id);
+        put_varint_bytewise(s, lanxc::varint::zigzag(r.delta));
+        for (int i = 0; i < 4; i++)
+          s.push_back(char(r.flags >> (8 * i)));
+        put_varint_bytewise(s, r.name.size());
+        s.append(r.name);
+        if (s.size() >= 4096)
+        {
+          auto b = out.allocate_buffer(s.size());
+          std::memcpy(b.data(), s.data(), s.size());
+          out.write(std::move(b));
+          s.clear();
+        }
+      }
+    });
+    bench::keep(out.bytes);
+  }
+
+  void via_writer(const std::vector<record> &v)
+  {
+    null_stream out;
+    bench::measure("buffer_writer", records, [&]
+    {
+      lanxc::buffer_writer w(out);
+      for (auto &r : v)
+      {
+        w.put_varint(r.id);
+        w.put_zigzag(r.delta);
+        w.put_little_endian(r.flags);
+        w.put_string(r.name.data(), r.name.size());
+        if (w.size() >= 64 << 10)
+          w.commit();
+      }
+      w.commit();
+    });
+    bench::keep(out.bytes);
+  }
+
+  void varints(const std::vector<record> &v)
+  {
+    std::vector<std::uint8_t> out(records * lanxc::varint::max_size);
+    bench::measure("varint byte by byte", records, [&]
+    {
+      std::uint8_t *p = out.data();
+      for (auto &r : v)
+      {
+        std::uint64_t x = r.id;
+        while (x >= 0x80)
+        {
+          *p++ = std::uint8_t(x | 0x80);
+          x >>= 7;
+        }
+        *p++ = std::uint8_t(x);
+      }
+      bench::keep(p);
+    });
+    bench::measure("varint::encode", records, [&]
+    {
+      std::uint8_t *p = out.data();
+      for (auto &r : v)
+        p = lanxc::varint::encode(p, r.id);
+      bench::keep(p);
+    });
+  }
+}
+
+int main()
+{
+  auto v = generate();
+  std::printf("%zu records\n", records);
+  via_string(v);
+  via_writer(v);
+  varints(v);
+}
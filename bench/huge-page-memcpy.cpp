@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Stream 10 GB through memcpy between two buffers of huge_page_buffer_manager,
+ * with arenas backed by hugetlbfs, transparent huge pages and normal pages.
+ * Buffers larger than the last level cache make TLB misses matter.
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/huge_page_buffer_manager.hpp>
+
+#include <cstring>
+
+using lanxc::linuxy::huge_page_buffer_manager;
+using page_mode = huge_page_buffer_manager::page_mode;
+
+namespace
+{
+  void run(page_mode preferred)
+  {
+    constexpr std::size_t buffer_size = 256 << 20;
+    constexpr std::size_t total = std::size_t(10) << 30;
+    huge_page_buffer_manager bm(2 * buffer_size, preferred);
+    auto *src = bm.acquire(buffer_size);
+    auto *dst = bm.acquire(buffer_size);
+    std::memset(src, 1, buffer_size);
+    std::memset(dst, 2, buffer_size);
+
+    std::printf("preferred %s, got %s\n",
+                huge_page_buffer_manager::to_string(preferred),
+                huge_page_buffer_manager::to_string(bm.mode()));
+    // Copy in chunks of 1MiB, one operation per chunk
+    constexpr std::size_t chunk = 1 << 20;
+    double ns = bench::measure("memcpy 10GB in 1MiB chunks", total / chunk, [&]
+    {
+      std::size_t offset = 0;
+      for (std::size_t copied = 0; copied < total; copied += chunk)
+      {
+        std::memcpy(dst + offset, src + offset, chunk);
+        offset = (offset + chunk) % buffer_size;
+      }
+    });
+    bench::keep(dst[buffer_size - 1]);
+    std::printf("%-40s %12.2f GB/s\n", "throughput", double(total) / ns);
+
+    bm.release(src, buffer_size);
+    bm.release(dst, buffer_size);
+  }
+}
+
+int main()
+{
+  run(page_mode::huge_tlb);
+  run(page_mode::transparent);
+  run(page_mode::normal);
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Receiving small frames prefixed by their length over a socket, reading
+ * prefix and payload of each frame separately, versus reading 64 KiB at
+ * once and decoding frames in batches
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-unixy/stream.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/length_prefixed.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t frames = 1 << 20;
+
+  lanxc::slab_buffer_manager bm;
+  bench::executor executor;
+
+  /** @brief Write @p frames frames of @p size bytes prefixed by fixed32 */
+  void produce(int fd, std::size_t size)
+  {
+    std::vector<std::uint8_t> block;
+    for (std::size_t i = 0; i < 1024; i++)
+    {
+      std::uint8_t prefix[4] = { 0, 0, std::uint8_t(size >> 8),
+                                 std::uint8_t(size) };
+      block.insert(block.end(), prefix, prefix + 4);
+      block.insert(block.end(), size, std::uint8_t(i));
+    }
+    for (std::size_t i = 0; i < frames / 1024; i++)
+      for (std::size_t n = 0; n < block.size(); )
+      {
+        ssize_t w = ::write(fd, block.data() + n, block.size() - n);
+        if (w <= 0)
+          std::abort();
+        n += std::size_t(w);
+      }
+    ::close(fd);
+  }
+
+  /** @brief Read exactly @p size bytes into @p out */
+  std::size_t read_exactly(lanxc::unixy::stream &in, std::uint8_t *out,
+                           std::size_t size)
+  {
+    std::size_t reads = 0;
+    for (std::size_t n = 0; n < size; reads++)
+    {
+      lanxc::buffer_chain chain;
+      lanxc::writable_buffer b(bm, size - n);
+      b.resize(0);
+      chain.push_back(std::move(b));
+      auto task = in.read(std::move(chain))
+          .then([&](std::size_t r, lanxc::buffer_chain c)
+                {
+                  if (r == 0)
+                    std::abort();
+                  c.for_each([&](const std::uint8_t *data, std::size_t s)
+                             { std::memcpy(out + n, data, s); });
+                  n += r;
+                })
+          .start(executor);
+      executor.run();
+    }
+    return reads;
+  }
+
+  void each(std::size_t size)
+  {
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::thread producer(produce, fds[1], size);
+    std::size_t reads = 0;
+    std::uint64_t sum = 0;
+    bench::measure("a frame per read", frames, [&]
+    {
+      lanxc::unixy::stream in({fds[0]}, bm);
+      std::vector<std::uint8_t> payload(size);
+      for (std::size_t i = 0; i < frames; i++)
+      {
+        std::uint8_t prefix[4];
+        reads += read_exactly(in, prefix, 4);
+        std::size_t length = std::size_t(prefix[2]) << 8 | prefix[3];
+        reads += read_exactly(in, payload.data(), length);
+        sum += payload[0];
+      }
+    });
+    producer.join();
+    bench::keep(sum);
+    std::printf("%-40s %12.3f reads/frame\n", "", double(reads) / frames);
+  }
+
+  void batched(std::size_t size)
+  {
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::thread producer(produce, fds[1], size);
+    std::size_t reads = 0;
+    std::uint64_t sum = 0;
+    bench::measure("batches per read", frames, [&]
+    {
+      lanxc::unixy::stream in({fds[0]}, bm);
+      lanxc::length_prefixed_decoder d(bm, lanxc::length_prefix::fixed32);
+      std::vector<lanxc::buffer_slice> batch;
+      for (;;)
+      {
+        lanxc::buffer_chain chain;
+        lanxc::writable_buffer b(bm, 64 << 10);
+        b.resize(0);
+        chain.push_back(std::move(b));
+        reads++;
+        bool end = false;
+        auto task = in.read(std::move(chain))
+            .then([&](std::size_t r, lanxc::buffer_chain c)
+                  {
+                    end = r == 0;
+                    if (!end)
+                      d.feed(lanxc::readable_buffer(c.pop_front()));
+                  })
+            .start(executor);
+        executor.run();
+        if (end)
+          break;
+        d.decode(batch);
+        for (auto &f : batch)
+          sum += f[0];
+        batch.clear();
+      }
+    });
+    producer.join();
+    bench::keep(sum);
+    std::printf("%-40s %12.3f reads/frame\n", "", double(reads) / frames);
+  }
+}
+
+int main()
+{
+  std::printf("%zu frames over a unix socket\n", frames);
+  for (std::size_t size : { 32u, 512u })
+  {
+    std::printf("%zu bytes of payload\n", size);
+    each(size);
+    batched(size);
+  }
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Splitting text into lines, with find_byte against memchr and a naive
+ * loop, and with delimited_framer over buffers of 64 KiB
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/core/framing.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t total = 64 << 20;
+
+  /** @brief Lines of length uniformly distributed up to twice @p average */
+  std::vector<std::uint8_t> text(std::size_t average)
+  {
+    std::vector<std::uint8_t> t(total);
+    std::mt19937 random(1);
+    std::uniform_int_distribution<std::size_t> length(0, average * 2);
+    for (std::size_t i = 0; i < total; )
+    {
+      std::size_t n = std::min(length(random), total - i - 1);
+      std::memset(&t[i], 'a' + int(n % 26), n);
+      t[i + n] = '\n';
+      i += n + 1;
+    }
+    return t;
+  }
+
+  const std::uint8_t *naive(const std::uint8_t *data, std::size_t size,
+                            std::uint8_t byte) noexcept
+  {
+    for (std::size_t i = 0; i < size; i++)
+      if (data[i] == byte)
+        return data + i;
+    return nullptr;
+  }
+
+  const std::uint8_t *libc(const std::uint8_t *data, std::size_t size,
+                           std::uint8_t byte) noexcept
+  {
+    return static_cast<const std::uint8_t *>(std::memchr(data, byte, size));
+  }
+
+  template<typename Finder>
+  void split(const char *name, const std::vector<std::uint8_t> &t,
+             Finder find)
+  {
+    std::size_t lines = 0;
+    double ns = bench::measure(name, total, [&]
+    {
+      const std::uint8_t *p = t.data();
+      const std::uint8_t *end = p + t.size();
+      while (const std::uint8_t *q = find(p, std::size_t(end - p), '\n'))
+      {
+        lines++;
+        p = q + 1;
+      }
+    });
+    bench::keep(lines);
+    std::printf("%-40s %12.2f GB/s\n", "", double(total) / ns);
+  }
+
+  void frame(const std::vector<std::uint8_t> &t)
+  {
+    lanxc::slab_buffer_manager bm;
+    std::size_t lines = 0;
+    double ns = bench::measure("delimited_framer", total, [&]
+    {
+      lanxc::delimited_framer f(bm, "\n", 1 << 20);
+      lanxc::buffer_slice frame;
+      for (std::size_t i = 0; i < t.size(); i += 64 << 10)
+      {
+        std::size_t n = std::min<std::size_t>(64 << 10, t.size() - i);
+        lanxc::writable_buffer b(bm, n);
+        std::memcpy(b.data(), &t[i], n);
+        f.feed(lanxc::readable_buffer(std::move(b)));
+        while (f.next(frame))
+          lines++;
+      }
+    });
+    bench::keep(lines);
+    std::printf("%-40s %12.2f GB/s\n", "", double(total) / ns);
+  }
+}
+
+int main()
+{
+  std::printf("%zu MiB of text\n", total >> 20);
+  for (std::size_t average : { 16u, 80u, 1024u })
+  {
+    std::printf("lines of %zu bytes in average\n", average);
+    auto t = text(average);
+    split("naive", t, naive);
+    split("memchr", t, libc);
+    split("find_byte", t, lanxc::find_byte);
+    frame(t);
+  }
+}
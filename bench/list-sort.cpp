@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Sorting a long intrusive list, comparing link::list::sort against
+ * std::list::sort, and against copying pointers of nodes into a vector to
+ * be sorted by std::sort
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/link/list.hpp>
+
+#include <algorithm>
+#include <list>
+#include <random>
+#include <vector>
+
+namespace
+{
+  struct node : lanxc::link::list_node<node>
+  {
+    std::uint64_t key;
+    char payload[48];
+  };
+
+  struct by_key
+  {
+    bool operator () (const node &l, const node &r) const noexcept
+    { return l.key < r.key; }
+  };
+
+  using list_type = lanxc::link::list<node>;
+
+  /**
+   * Link nodes in the order of @p order, which makes them either adjacent
+   * in memory or scattered around
+   */
+  void link(std::vector<node> &nodes, const std::vector<std::size_t> &order,
+            list_type &l)
+  {
+    l.clear();
+    for (auto i : order)
+      l.push_back(nodes[i]);
+  }
+
+  void run(const char *title, std::size_t n, bool scattered)
+  {
+    std::mt19937_64 engine(42);
+    std::vector<node> nodes(n);
+    for (auto &x : nodes)
+      x.key = engine();
+
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; i++)
+      order[i] = i;
+    if (scattered)
+      std::shuffle(order.begin(), order.end(), engine);
+
+    std::printf("%s, %zu nodes\n", title, n);
+
+    list_type l;
+    link(nodes, order, l);
+    bench::measure("link::list::sort", n, [&] { l.sort(by_key()); });
+
+    link(nodes, order, l);
+    bench::measure("vector + std::sort", n, [&]
+    {
+      std::vector<node *> v;
+      v.reserve(n);
+      for (auto &x : l)
+        v.push_back(&x);
+      std::sort(v.begin(), v.end(), [](const node *a, const node *b)
+      { return a->key < b->key; });
+      l.clear();
+      for (auto *p : v)
+        l.push_back(*p);
+    });
+    bench::keep(l.front().key);
+    l.clear();
+
+    // std::list allocates its own nodes, which are adjacent in memory
+    // unless the allocation order is scattered as well
+    std::list<node> s;
+    std::vector<std::list<node>::iterator> positions(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      s.emplace_back();
+      s.back().key = nodes[i].key;
+      positions[i] = --s.end();
+    }
+    for (auto i : order)
+      s.splice(s.end(), s, positions[i]);
+    bench::measure("std::list::sort", n, [&] { s.sort(by_key()); });
+    bench::keep(s.front().key);
+  }
+}
+
+int main()
+{
+  run("adjacent", 1 << 16, false);
+  run("adjacent", 1 << 20, false);
+  run("scattered", 1 << 16, true);
+  run("scattered", 1 << 20, true);
+}
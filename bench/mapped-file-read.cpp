@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Streaming a file from page cache and summing its bytes, through
+ * read(2) into a buffer chain versus buffers mapped from the file
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/event_loop.hpp>
+#include <lanxc-unixy/mapped_file.hpp>
+#include <lanxc-unixy/stream.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t total = std::size_t(512) << 20;
+
+  std::uint64_t sum(const std::uint8_t *data, std::size_t size)
+  {
+    std::uint64_t s = 0;
+    for (std::size_t i = 0; i + 8 <= size; i += 8)
+    {
+      std::uint64_t v;
+      std::memcpy(&v, data + i, 8);
+      s += v;
+    }
+    return s;
+  }
+
+  lanxc::unixy::file_descriptor open_file(const char *path)
+  {
+    lanxc::unixy::file_descriptor fd(::open(path, O_RDONLY | O_CLOEXEC));
+    if (!fd)
+      std::abort();
+    return fd;
+  }
+
+  void copying(const char *path, std::size_t chunk)
+  {
+    lanxc::slab_buffer_manager bm(chunk * 4, chunk);
+    std::uint64_t s = 0;
+    bench::executor executor;
+    bench::measure("read(2)", total / chunk, [&]
+    {
+      lanxc::unixy::stream in(open_file(path), bm);
+      for (bool done = false; !done; )
+      {
+        lanxc::buffer_chain chain;
+        lanxc::writable_buffer b(bm, chunk);
+        b.resize(0);
+        chain.push_back(std::move(b));
+        auto task = in.read(std::move(chain))
+            .then([&](std::size_t n, lanxc::buffer_chain c)
+                  {
+                    c.for_each([&](const std::uint8_t *data, std::size_t size)
+                               { s += sum(data, size); });
+                    done = n == 0;
+                  })
+            .start(executor);
+        executor.run();
+      }
+    });
+    bench::keep(s);
+  }
+
+  void mapping(const char *path, std::size_t chunk, std::size_t window)
+  {
+    std::uint64_t s = 0;
+    lanxc::linuxy::event_loop loop;
+    char name[64];
+    std::snprintf(name, sizeof(name), "mapped, %zu MiB window",
+                  window >> 20);
+    bench::measure(name, total / chunk, [&]
+    {
+      lanxc::unixy::mapped_file_stream in(open_file(path), window);
+      for (bool done = false; !done; )
+      {
+        auto task = in.read(chunk, 1)
+            .then([&](std::size_t n, lanxc::readable_buffer b)
+                  {
+                    s += sum(b.data(), n);
+                    done = n == 0;
+                  })
+            .start(loop);
+        loop.run();
+      }
+    });
+    bench::keep(s);
+  }
+}
+
+int main()
+{
+  char path[] = "/tmp/lanxc-mapped-file-XXXXXX";
+  int fd = ::mkstemp(path);
+  std::vector<std::uint8_t> block(1 << 20);
+  for (std::size_t i = 0; i < block.size(); i++)
+    block[i] = std::uint8_t(i * 131);
+  for (std::size_t n = 0; n < total; n += block.size())
+    if (::write(fd, block.data(), block.size()) != ssize_t(block.size()))
+      std::abort();
+  ::close(fd);
+
+  std::printf("%zu MiB file in page cache\n", total >> 20);
+  for (std::size_t chunk : { 64u << 10, 1u << 20 })
+  {
+    std::printf("%zu KiB per read\n", chunk >> 10);
+    copying(path, chunk);
+    mapping(path, chunk, 16 << 20);
+    mapping(path, chunk, 256 << 20);
+  }
+  ::unlink(path);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Throughput of parsing length prefixed messages out of a ring buffer,
+ * comparing the mirrored ring, where every message is contiguous, against
+ * a plain ring, where messages wrapping around the end are copied out
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/mirrored_ring.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t messages = 20000000;
+  constexpr std::size_t header_size = 2;
+  constexpr std::size_t chunk_size = 1500;
+
+  /** @brief Messages of random sizes, each prefixed by its length */
+  std::vector<std::uint8_t> make_source(std::size_t min, std::size_t max)
+  {
+    std::minstd_rand engine(1);
+    std::vector<std::uint8_t> source;
+    while (source.size() < (1 << 20))
+    {
+      std::size_t n = min + engine() % (max - min + 1);
+      source.push_back(static_cast<std::uint8_t>(n >> 8));
+      source.push_back(static_cast<std::uint8_t>(n));
+      for (std::size_t i = 0; i < n; i++)
+        source.push_back(static_cast<std::uint8_t>(engine()));
+    }
+    return source;
+  }
+
+  std::uint32_t checksum(const std::uint8_t *p, std::size_t n)
+  {
+    std::uint32_t sum = 0;
+    for (std::size_t i = 0; i < n; i++)
+      sum += p[i];
+    return sum;
+  }
+
+  /** @brief Feed the source cyclically in chunks like packets received */
+  struct feeder
+  {
+    const std::vector<std::uint8_t> &source;
+    std::size_t offset;
+
+    std::size_t next(std::size_t room) const
+    {
+      std::size_t n = room < chunk_size ? room : chunk_size;
+      return n < source.size() - offset ? n : source.size() - offset;
+    }
+
+    const std::uint8_t *data() const
+    { return source.data() + offset; }
+
+    void advance(std::size_t n)
+    {
+      offset += n;
+      if (offset == source.size())
+        offset = 0;
+    }
+  };
+
+  class plain_ring
+  {
+  public:
+    explicit plain_ring(std::size_t capacity)
+      : _data(capacity), _mask(capacity - 1), _head(0), _tail(0)
+    { }
+
+    std::size_t readable() const { return _tail - _head; }
+    std::size_t writable() const { return _data.size() - readable(); }
+
+    void write(const std::uint8_t *p, std::size_t n)
+    {
+      std::size_t offset = _tail & _mask;
+      std::size_t first = n < _data.size() - offset
+                          ? n : _data.size() - offset;
+      std::memcpy(&_data[offset], p, first);
+      std::memcpy(&_data[0], p + first, n - first);
+      _tail += n;
+    }
+
+    std::uint8_t at(std::size_t i) const
+    { return _data[(_head + i) & _mask]; }
+
+    /**
+     * @brief Contiguous pointer to @p n bytes from @p i, copying them to
+     * @p scratch if they wrap around
+     */
+    const std::uint8_t *view(std::size_t i, std::size_t n,
+                             std::uint8_t *scratch) const
+    {
+      std::size_t offset = (_head + i) & _mask;
+      if (offset + n <= _data.size())
+        return &_data[offset];
+      std::size_t first = _data.size() - offset;
+      std::memcpy(scratch, &_data[offset], first);
+      std::memcpy(scratch + first, &_data[0], n - first);
+      return scratch;
+    }
+
+    void consume(std::size_t n) { _head += n; }
+
+  private:
+    std::vector<std::uint8_t> _data;
+    std::size_t _mask;
+    std::size_t _head;
+    std::size_t _tail;
+  };
+
+  std::uint32_t parse_mirrored(const std::vector<std::uint8_t> &source,
+                               std::size_t capacity)
+  {
+    lanxc::linuxy::mirrored_ring ring(capacity);
+    feeder f{source, 0};
+    std::uint32_t sum = 0;
+    for (std::size_t parsed = 0; parsed < messages; )
+    {
+      while (ring.writable() != 0)
+      {
+        std::size_t n = f.next(ring.writable());
+        std::memcpy(ring.write_region(), f.data(), n);
+        ring.commit(n);
+        f.advance(n);
+      }
+      const std::uint8_t *p = ring.read_region();
+      std::size_t available = ring.readable(), used = 0;
+      while (available - used >= header_size)
+      {
+        std::size_t n = std::size_t(p[used]) << 8 | p[used + 1];
+        if (available - used < header_size + n)
+          break;
+        sum += checksum(p + used + header_size, n);
+        used += header_size + n;
+        parsed++;
+      }
+      ring.consume(used);
+    }
+    return sum;
+  }
+
+  std::uint32_t parse_plain(const std::vector<std::uint8_t> &source,
+                            std::size_t capacity)
+  {
+    plain_ring ring(capacity);
+    feeder f{source, 0};
+    std::vector<std::uint8_t> scratch(1 << 16);
+    std::uint32_t sum = 0;
+    for (std::size_t parsed = 0; parsed < messages; )
+    {
+      while (ring.writable() != 0)
+      {
+        std::size_t n = f.next(ring.writable());
+        ring.write(f.data(), n);
+        f.advance(n);
+      }
+      std::size_t available = ring.readable(), used = 0;
+      while (available - used >= header_size)
+      {
+        std::size_t n = std::size_t(ring.at(used)) << 8 | ring.at(used + 1);
+        if (available - used < header_size + n)
+          break;
+        sum += checksum(ring.view(used + header_size, n, scratch.data()), n);
+        used += header_size + n;
+        parsed++;
+      }
+      ring.consume(used);
+    }
+    return sum;
+  }
+}
+
+int main()
+{
+  std::printf("%zu messages parsed\n", messages);
+  struct { std::size_t min, max, capacity; } cases[] = {
+      { 8, 64, 4096 }, { 8, 64, 1 << 16 },
+      { 64, 512, 4096 }, { 64, 512, 1 << 16 },
+  };
+  for (auto &c : cases)
+  {
+    auto source = make_source(c.min, c.max);
+    std::printf("%zu-%zu bytes messages, %zu bytes ring\n",
+                c.min, c.max, c.capacity);
+    std::uint32_t a = 0, b = 0;
+    bench::measure("plain ring", messages,
+                   [&] { a = parse_plain(source, c.capacity); });
+    bench::measure("mirrored_ring", messages,
+                   [&] { b = parse_mirrored(source, c.capacity); });
+    bench::keep(a);
+    bench::keep(b);
+    if (a != b)
+      std::printf("checksum mismatched\n");
+  }
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * CPU time of a proxy moving bytes between two loopback TCP connections,
+ * and from a file to a connection, comparing lanxc::pipe copying through
+ * user space against linuxy::pipe moving bytes inside of kernel
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/pipe.hpp>
+#include <lanxc-unixy/stream.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t total = std::size_t(2) << 30;
+  constexpr std::size_t file_size = 256 << 20;
+
+  double thread_cpu_ns()
+  {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+  }
+
+  /** @brief A connected pair of loopback TCP sockets */
+  void tcp_pair(int fds[2])
+  {
+    int l = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(l, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(l, 1) != 0
+        || ::getsockname(l, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+      std::abort();
+    fds[0] = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fds[0], reinterpret_cast<sockaddr *>(&addr), len) != 0)
+      std::abort();
+    fds[1] = ::accept(l, nullptr, nullptr);
+    ::close(l);
+  }
+
+  void sink(int fd)
+  {
+    std::vector<char> buffer(1 << 18);
+    while (::read(fd, buffer.data(), buffer.size()) > 0)
+      ;
+    ::close(fd);
+  }
+
+  template<typename Pipe>
+  void run(const char *name, int source_fd, std::size_t bytes, Pipe &&pipe,
+           std::thread producer)
+  {
+    lanxc::slab_buffer_manager bm;
+    int out[2];
+    tcp_pair(out);
+    std::thread consumer(sink, out[1]);
+    lanxc::unixy::stream from({source_fd}, bm);
+    double cpu = 0;
+    {
+      lanxc::unixy::stream to({out[0]}, bm);
+      double ns = bench::measure(name, bytes >> 20, [&]
+      {
+        cpu = thread_cpu_ns();
+        if (pipe(from, to) != bytes)
+          std::abort();
+        cpu = thread_cpu_ns() - cpu;
+      });
+      std::printf("%-40s %12.2f GB/s %8.1f ms CPU/GB\n", "",
+                  double(bytes) / ns, cpu / 1e6 / (double(bytes) / 1e9));
+    }
+    if (producer.joinable())
+      producer.join();
+    consumer.join();
+  }
+
+  std::size_t wait(lanxc::future<std::size_t> f)
+  {
+    bench::executor executor;
+    std::size_t bytes = 0;
+    auto task = f.then([&](std::size_t n) { bytes = n; }).start(executor);
+    executor.run();
+    return bytes;
+  }
+
+  std::size_t copy(lanxc::readable_stream &from, lanxc::writable_stream &to)
+  { return wait(lanxc::pipe(from, to)); }
+
+  std::size_t move(lanxc::readable_stream &from, lanxc::writable_stream &to)
+  { return wait(lanxc::linuxy::pipe(from, to)); }
+
+  std::thread produce(int fd)
+  {
+    return std::thread([fd]
+    {
+      std::vector<char> buffer(1 << 16, 'x');
+      for (std::size_t n = 0; n < total; n += buffer.size())
+        if (::write(fd, buffer.data(), buffer.size()) < 0)
+          std::abort();
+      ::close(fd);
+    });
+  }
+
+  int make_file()
+  {
+    char name[] = "/tmp/lanxc-pipe-XXXXXX";
+    int fd = ::mkstemp(name);
+    ::unlink(name);
+    std::vector<char> buffer(1 << 20, 'x');
+    for (std::size_t n = 0; n < file_size; n += buffer.size())
+      if (::write(fd, buffer.data(), buffer.size()) < 0)
+        std::abort();
+    return fd;
+  }
+}
+
+int main()
+{
+  std::printf("socket to socket, %zu MiB, ns/op per MiB\n", total >> 20);
+  int in[2];
+  tcp_pair(in);
+  run("lanxc::pipe", in[1], total, copy, produce(in[0]));
+  tcp_pair(in);
+  run("linuxy::pipe (splice)", in[1], total, move, produce(in[0]));
+
+  std::printf("file to socket, %zu MiB, ns/op per MiB\n", file_size >> 20);
+  int fd = make_file();
+  ::lseek(fd, 0, SEEK_SET);
+  run("lanxc::pipe", ::dup(fd), file_size, copy, std::thread());
+  ::lseek(fd, 0, SEEK_SET);
+  run("linuxy::pipe (sendfile)", ::dup(fd), file_size, move, std::thread());
+  ::close(fd);
+}
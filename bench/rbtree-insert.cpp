@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Insertion into rbtree with monotonic, mostly monotonic and random indexes,
+ * comparing searching from root against rbtree_config::insert_from_back
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/link/rbtree.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+struct from_back;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<>
+    struct rbtree_config<from_back> : rbtree_config<void>
+    {
+      static constexpr bool insert_from_back = true;
+    };
+  }
+}
+
+using namespace lanxc::link;
+
+namespace
+{
+  template<typename Tag>
+  struct node : rbtree_node<std::uint64_t, node<Tag>, Tag>
+  {
+    node(std::uint64_t x = 0)
+        : rbtree_node<std::uint64_t, node<Tag>, Tag>(x)
+    { }
+  };
+
+  template<typename Tag>
+  void run(const char *name, const std::vector<std::uint64_t> &indexes)
+  {
+    std::vector<node<Tag>> nodes(indexes.begin(), indexes.end());
+    rbtree<std::uint64_t, node<Tag>, Tag> tree;
+
+    bench::measure(name, nodes.size(), [&]
+    {
+      for (auto &n : nodes)
+        tree.insert(n, index_policy::back());
+    });
+    bench::keep(tree.size());
+  }
+
+  void run_both(const char *title, const std::vector<std::uint64_t> &indexes)
+  {
+    std::printf("%s, %zu nodes\n", title, indexes.size());
+    run<void>("search from root", indexes);
+    run<from_back>("insert_from_back", indexes);
+  }
+}
+
+int main()
+{
+  constexpr std::size_t N = 2000000;
+  std::mt19937_64 engine(42);
+  std::vector<std::uint64_t> monotonic, mostly_monotonic, random;
+
+  std::uint64_t now = 1000000;
+  for (std::size_t i = 0; i < N; i++)
+  {
+    now += engine() % 16;
+    monotonic.push_back(now);
+    // One out of ten is scheduled a little bit earlier than the latest one
+    mostly_monotonic.push_back(i % 10 == 0 ? now - engine() % 1024 : now);
+    random.push_back(engine());
+  }
+
+  run_both("monotonic", monotonic);
+  run_both("mostly monotonic", mostly_monotonic);
+  run_both("random", random);
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Lookup of string indexed rbtree with keys parsed out of a network buffer,
+ * comparing heterogeneous lookup against constructing a temporary string
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/link/rbtree.hpp>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct transparent;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<>
+    struct rbtree_config<transparent> : rbtree_config<void>
+    {
+      template<typename T> using comparator = less<>;
+    };
+  }
+}
+
+using namespace lanxc::link;
+
+namespace
+{
+  /** A view of key inside the received buffer */
+  struct key_view
+  {
+    const char *data;
+    std::size_t size;
+
+    int compare(const std::string &s) const noexcept
+    {
+      auto n = std::min(size, s.size());
+      int ret = std::memcmp(data, s.data(), n);
+      if (ret != 0) return ret;
+      return size < s.size() ? -1 : size > s.size() ? 1 : 0;
+    }
+
+    friend bool operator < (const key_view &l, const std::string &r) noexcept
+    { return l.compare(r) < 0; }
+
+    friend bool operator < (const std::string &l, const key_view &r) noexcept
+    { return r.compare(l) > 0; }
+  };
+
+  struct transparent_node
+      : rbtree_node<std::string, transparent_node, transparent>
+  {
+    transparent_node(std::string s)
+        : rbtree_node(std::move(s))
+    { }
+  };
+
+  struct plain_node : rbtree_node<std::string, plain_node>
+  {
+    plain_node(std::string s)
+        : rbtree_node(std::move(s))
+    { }
+  };
+
+  std::vector<std::string> make_keys(std::size_t n, std::size_t length)
+  {
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<int> dist('a', 'z');
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      std::string s = "/api/v1/";
+      while (s.size() < length)
+        s.push_back(static_cast<char>(dist(engine)));
+      keys.push_back(std::move(s));
+    }
+    return keys;
+  }
+
+  /** Simulate a received buffer consists of CRLF terminated keys */
+  std::string make_buffer(const std::vector<std::string> &keys,
+                          std::size_t lookups)
+  {
+    std::mt19937 engine(7);
+    std::uniform_int_distribution<std::size_t> dist(0, keys.size() - 1);
+    std::string buffer;
+    for (std::size_t i = 0; i < lookups; i++)
+    {
+      buffer += keys[dist(engine)];
+      buffer += "\r\n";
+    }
+    return buffer;
+  }
+
+  template<typename Consumer>
+  void parse(const std::string &buffer, Consumer &&consumer)
+  {
+    const char *p = buffer.data();
+    const char *e = p + buffer.size();
+    while (p != e)
+    {
+      auto *q = static_cast<const char *>(std::memchr(p, '\r', e - p));
+      consumer(key_view { p, std::size_t(q - p) });
+      p = q + 2;
+    }
+  }
+
+  void run(std::size_t n, std::size_t length, std::size_t lookups)
+  {
+    auto keys = make_keys(n, length);
+    auto buffer = make_buffer(keys, lookups);
+
+    std::vector<transparent_node> tnodes(keys.begin(), keys.end());
+    std::vector<plain_node> pnodes(keys.begin(), keys.end());
+    rbtree<std::string, transparent_node, transparent> ttree;
+    rbtree<std::string, plain_node> ptree;
+    for (auto &x : tnodes) ttree.insert(x, index_policy::back());
+    for (auto &x : pnodes) ptree.insert(x, index_policy::back());
+
+    std::printf("%zu nodes, key length %zu, %zu lookups\n",
+                n, length, lookups);
+
+    std::size_t found = 0;
+    bench::measure("temporary std::string", lookups, [&]
+    {
+      parse(buffer, [&](key_view k)
+      {
+        found += ptree.find(std::string(k.data, k.size)) != ptree.end();
+      });
+    });
+    bench::keep(found);
+
+    found = 0;
+    bench::measure("transparent lookup", lookups, [&]
+    {
+      parse(buffer, [&](key_view k)
+      {
+        found += ttree.find(k) != ttree.end();
+      });
+    });
+    bench::keep(found);
+  }
+}
+
+int main()
+{
+  run(1000, 12, 2000000);
+  run(1000, 48, 2000000);
+  run(100000, 48, 2000000);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Lookup of URL-like string indexes, comparing rbtree nodes without prefix
+ * against nodes caching 8 or 16 leading bytes of their index
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc/link/rbtree.hpp>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+template<std::size_t Size>
+struct prefixed;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<std::size_t Size>
+    struct rbtree_config<prefixed<Size>> : rbtree_config<void>
+    {
+      static constexpr std::size_t index_prefix_size = Size;
+    };
+  }
+}
+
+using namespace lanxc::link;
+
+namespace
+{
+  template<typename Tag>
+  struct node : rbtree_node<std::string, node<Tag>, Tag>
+  {
+    node(std::string s)
+        : rbtree_node<std::string, node<Tag>, Tag>(std::move(s))
+    { }
+  };
+
+  std::vector<std::string> make_keys(std::size_t n, const std::string &scheme)
+  {
+    static const char *const tlds[] = { ".com", ".org", ".net", ".io" };
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+      std::string s = scheme;
+      for (auto k = 4 + engine() % 12; k != 0; k--)
+        s.push_back(static_cast<char>(letter(engine)));
+      s += tlds[engine() % 4];
+      s += "/static/";
+      for (auto k = 8 + engine() % 24; k != 0; k--)
+        s.push_back(static_cast<char>(letter(engine)));
+      keys.push_back(std::move(s));
+    }
+    return keys;
+  }
+
+  template<typename Tag>
+  void run(const char *name, const std::vector<std::string> &keys,
+           const std::vector<std::size_t> &lookups)
+  {
+    // Nodes are allocated apart from each other as they would be in real
+    // world, rather than packed in a vector
+    std::vector<std::unique_ptr<node<Tag>>> nodes;
+    rbtree<std::string, node<Tag>, Tag> tree;
+    for (auto &k : keys)
+    {
+      nodes.emplace_back(new node<Tag>(k));
+      tree.insert(*nodes.back());
+    }
+
+    std::size_t found = 0;
+    bench::measure(name, lookups.size(), [&]
+    {
+      for (auto i : lookups)
+        found += tree.find(keys[i]) != tree.end();
+    });
+    bench::keep(found);
+  }
+
+  void run_all(const char *title, std::size_t n, const std::string &scheme)
+  {
+    auto keys = make_keys(n, scheme);
+    std::mt19937 engine(7);
+    std::uniform_int_distribution<std::size_t> dist(0, n - 1);
+    std::vector<std::size_t> lookups(2000000);
+    for (auto &i : lookups)
+      i = dist(engine);
+
+    std::printf("%s, %zu nodes\n", title, n);
+    run<void>("no prefix", keys, lookups);
+    run<prefixed<8>>("8-byte prefix", keys, lookups);
+    run<prefixed<16>>("16-byte prefix", keys, lookups);
+  }
+}
+
+int main()
+{
+  run_all("host/path", 1000, "");
+  run_all("host/path", 1000000, "");
+  run_all("scheme://host/path", 1000000, "https://");
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Datagrams of 64 bytes over loopback UDP, received and sent in batches
+ * of various sizes, or as super-buffers split and coalesced by GSO and GRO
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/udp_endpoint.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t datagrams = 1 << 20;
+  constexpr std::size_t size = 64;
+
+  /** @brief Datagrams in flight, within the socket buffer of receiver */
+  constexpr std::size_t burst = 64;
+
+  std::uint16_t local_port(const lanxc::datagram_endpoint::pointer &e)
+  {
+    auto u = std::dynamic_pointer_cast<lanxc::linuxy::udp_endpoint>(e);
+    sockaddr_in in{};
+    socklen_t length = sizeof(in);
+    if (::getsockname(u->native_handle(), reinterpret_cast<sockaddr *>(&in),
+                      &length) != 0)
+      std::abort();
+    return ntohs(in.sin_port);
+  }
+
+  void run(const char *name, std::size_t batch, bool offload)
+  {
+    lanxc::slab_buffer_manager bm;
+    lanxc::linuxy::event_loop loop;
+    auto receiver = std::make_shared<lanxc::linuxy::udp_endpoint_builder>(
+        loop, bm)->bind("127.0.0.1", 0)->set_batch_size(batch)
+        ->set_receive_offload(offload)->build();
+    auto sender = std::make_shared<lanxc::linuxy::udp_endpoint_builder>(
+        loop, bm)->connect("127.0.0.1", local_port(receiver))
+        ->set_batch_size(batch)->build();
+
+    // A burst is sent as a single super-buffer with offloading
+    std::size_t length = offload ? size * burst : size;
+    lanxc::writable_buffer b(bm, length);
+    std::memset(b.data(), 'x', length);
+    lanxc::buffer_slice payload(lanxc::readable_buffer(std::move(b)));
+
+    std::size_t received = 0;
+    double ns = bench::measure(name, datagrams, [&]
+    {
+      std::vector<lanxc::datagram> in;
+      in.reserve(burst + batch);
+      for (std::size_t sent = 0; sent < datagrams; sent += burst)
+      {
+        std::vector<lanxc::datagram> out(
+            offload ? 1 : burst,
+            lanxc::datagram{payload, {0, {}},
+                            std::uint16_t(offload ? size : 0)});
+        sender->send(std::move(out));
+        std::size_t expected = received + burst;
+        while (received < expected)
+        {
+          in.clear();
+          std::size_t n = receiver->receive(in);
+          if (n == 0)
+            std::abort();
+          received += n;
+          bench::keep(in);
+        }
+      }
+    });
+    auto &rs = std::dynamic_pointer_cast<lanxc::linuxy::udp_endpoint>(
+        receiver)->statistics();
+    auto &ss = std::dynamic_pointer_cast<lanxc::linuxy::udp_endpoint>(
+        sender)->statistics();
+    std::printf("%-40s %12.2f Mpps %8.3f syscalls/datagram\n", "",
+                1e3 * double(datagrams) / ns,
+                double(rs.syscalls + ss.syscalls) / double(datagrams));
+  }
+}
+
+int main()
+{
+  std::printf("%zu datagrams of %zu bytes over loopback UDP\n", datagrams,
+              size);
+  run("1 datagram per syscall", 1, false);
+  run("8 datagrams per syscall", 8, false);
+  run("64 datagrams per syscall", 64, false);
+  run("GSO and GRO, 8 payloads per syscall", 8, true);
+}
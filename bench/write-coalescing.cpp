@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Small messages written in batches per loop iteration to a loopback TCP
+ * connection, with and without coalescing
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/socket_stream.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t messages = 1 << 20;
+  constexpr std::size_t size = 64;
+
+  void tcp_pair(int fds[2])
+  {
+    int l = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(l, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(l, 1) != 0
+        || ::getsockname(l, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+      std::abort();
+    fds[0] = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fds[0], reinterpret_cast<sockaddr *>(&addr), len) != 0)
+      std::abort();
+    fds[1] = ::accept(l, nullptr, nullptr);
+    ::close(l);
+  }
+
+  void sink(int fd)
+  {
+    std::vector<char> buffer(1 << 18);
+    while (::read(fd, buffer.data(), buffer.size()) > 0)
+      ;
+    ::close(fd);
+  }
+
+  void run(const char *name, std::size_t batch, bool coalescing)
+  {
+    lanxc::slab_buffer_manager bm;
+    int fds[2];
+    tcp_pair(fds);
+    std::thread consumer(sink, fds[1]);
+    lanxc::linuxy::socket_stream::sending_statistics stat{};
+    double ns = bench::measure(name, messages, [&]
+    {
+      lanxc::linuxy::event_loop loop;
+      lanxc::linuxy::socket_stream s(loop, {fds[0]}, bm);
+      if (coalescing)
+        s.coalesce({64 << 10, std::chrono::nanoseconds::zero()});
+      std::size_t written = 0;
+      std::shared_ptr<lanxc::deferred> flushing;
+      lanxc::function<void()> produce = [&]
+      {
+        for (std::size_t i = 0; i < batch && written < messages; i++)
+        {
+          lanxc::writable_buffer b(bm, size);
+          std::memset(b.data(), 'x', size);
+          s.write(std::move(b));
+          written++;
+        }
+        if (written < messages)
+          loop.defer([&] { produce(); });
+        else
+          flushing = s.flush().then([&] { loop.stop(); }).start(loop);
+      };
+      loop.defer([&] { produce(); });
+      loop.run();
+      stat = s.statistics();
+    });
+    ::shutdown(fds[0], SHUT_WR);
+    consumer.join();
+    ::close(fds[0]);
+    std::printf("%-40s %12.1f ns/message %8.3f syscalls/message\n", "",
+                ns / double(messages),
+                double(stat.syscalls) / double(stat.messages));
+  }
+}
+
+int main()
+{
+  std::printf("%zu messages of %zu bytes over loopback TCP\n", messages,
+              size);
+  for (std::size_t batch : { 1u, 8u, 64u })
+  {
+    std::printf("%zu messages per iteration\n", batch);
+    run("write through", batch, false);
+    run("coalescing", batch, true);
+  }
+}
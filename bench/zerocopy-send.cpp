@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Sender CPU time of writing buffers of several sizes to a loopback TCP
+ * connection, comparing copying writes against MSG_ZEROCOPY
+ */
+
+#include "benchmark.hpp"
+
+#include <lanxc-linux/zerocopy_stream.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  constexpr std::size_t total = std::size_t(1) << 30;
+
+  double thread_cpu_ns()
+  {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+  }
+
+  void tcp_pair(int fds[2])
+  {
+    int l = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(l, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(l, 1) != 0
+        || ::getsockname(l, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+      std::abort();
+    fds[0] = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fds[0], reinterpret_cast<sockaddr *>(&addr), len) != 0)
+      std::abort();
+    fds[1] = ::accept(l, nullptr, nullptr);
+    ::close(l);
+  }
+
+  void sink(int fd)
+  {
+    std::vector<char> buffer(1 << 18);
+    while (::read(fd, buffer.data(), buffer.size()) > 0)
+      ;
+    ::close(fd);
+  }
+
+  /** @param threshold Threshold of zerocopy_stream, or 0 for unixy::stream */
+  void run(const char *name, std::size_t size, std::size_t threshold)
+  {
+    lanxc::slab_buffer_manager bm(256 << 20, 1 << 20);
+    int fds[2];
+    tcp_pair(fds);
+    std::thread consumer(sink, fds[1]);
+    std::size_t copied = 0;
+    double cpu = 0;
+    double ns = bench::measure(name, total / size, [&]
+    {
+      cpu = thread_cpu_ns();
+      std::unique_ptr<lanxc::unixy::stream> s;
+      if (threshold)
+        s.reset(new lanxc::linuxy::zerocopy_stream({fds[0]}, bm, threshold));
+      else
+        s.reset(new lanxc::unixy::stream({fds[0]}, bm));
+      for (std::size_t n = 0; n < total; n += size)
+      {
+        lanxc::writable_buffer b(bm, size);
+        std::memset(b.data(), 'x', 64);
+        s->write(std::move(b));
+      }
+      if (threshold)
+        copied = static_cast<lanxc::linuxy::zerocopy_stream &>(*s).copied();
+      s.reset();
+      cpu = thread_cpu_ns() - cpu;
+    });
+    consumer.join();
+    std::printf("%-40s %12.2f GB/s %8.1f ms CPU/GB %zu copied\n", "",
+                double(total) / ns, cpu / 1e6 / (double(total) / 1e9),
+                copied);
+  }
+}
+
+int main()
+{
+  std::printf("%zu MiB written over loopback TCP\n", total >> 20);
+  for (std::size_t size : { 4u << 10, 16u << 10, 64u << 10, 256u << 10,
+                            1u << 20 })
+  {
+    std::printf("%zu KiB buffers\n", size >> 10);
+    run("unixy::stream", size, 0);
+    run("zerocopy_stream", size, 1);
+  }
+}
@@ -42,6 +42,7 @@ namespace lanxc
     struct rbtree_config<applism::event_loop> : rbtree_config<void>
     {
       using default_lookup_policy = index_policy::back;
+      static constexpr bool insert_from_back = true;
     };
 
   }
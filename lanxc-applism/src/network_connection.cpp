@@ -18,13 +18,17 @@
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/event.h>
 #include <sys/fcntl.h>
 #include <sys/un.h>
 
 #include <cerrno>
+#include <climits>
 #include <cstring>
+#include <memory>
+#include <system_error>
 
 #include <lanxc-applism/network_connection.hpp>
 
@@ -33,6 +37,67 @@ namespace
   using namespace lanxc;
   using namespace lanxc::applism;
 
+  std::system_error make_system_error(int e)
+  {
+    return std::system_error(std::error_code(e, std::system_category()));
+  }
+
+  /** @return Bytes of the address parsed, or 0 if it's not numeric */
+  socklen_t parse_socket_address(const std::string &address,
+                                 std::uint16_t port,
+                                 sockaddr_storage &out) noexcept
+  {
+    std::memset(&out, 0, sizeof(out));
+    auto in = reinterpret_cast<sockaddr_in *>(&out);
+    if (::inet_pton(AF_INET, address.c_str(), &in->sin_addr) == 1)
+    {
+      in->sin_len = sizeof(sockaddr_in);
+      in->sin_family = AF_INET;
+      in->sin_port = htons(port);
+      return sizeof(sockaddr_in);
+    }
+    auto in6 = reinterpret_cast<sockaddr_in6 *>(&out);
+    if (::inet_pton(AF_INET6, address.c_str(), &in6->sin6_addr) == 1)
+    {
+      in6->sin6_len = sizeof(sockaddr_in6);
+      in6->sin6_family = AF_INET6;
+      in6->sin6_port = htons(port);
+      return sizeof(sockaddr_in6);
+    }
+    return 0;
+  }
+
+  void set_option(int fd, int level, int name, int value)
+  {
+    if (::setsockopt(fd, level, name, &value, sizeof(value)) == -1)
+      unixy::throw_system_error();
+  }
+
+  /** @brief Whole seconds no shorter than @p d, for options in seconds */
+  int round_up_seconds(std::chrono::nanoseconds d) noexcept
+  {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+        d + std::chrono::seconds(1) - std::chrono::nanoseconds(1));
+    return seconds.count() > INT_MAX ? INT_MAX : int(seconds.count());
+  }
+
+  /** @brief Set options of stream sockets, where 0 keeps the default */
+  void set_socket_options(int fd, int family, bool no_delay,
+                          std::size_t send_buffer_size,
+                          std::size_t receive_buffer_size)
+  {
+    if (send_buffer_size != 0)
+      set_option(fd, SOL_SOCKET, SO_SNDBUF,
+                 send_buffer_size > INT_MAX
+                 ? INT_MAX : int(send_buffer_size));
+    if (receive_buffer_size != 0)
+      set_option(fd, SOL_SOCKET, SO_RCVBUF,
+                 receive_buffer_size > INT_MAX
+                 ? INT_MAX : int(receive_buffer_size));
+    if (no_delay && family != PF_UNIX)
+      set_option(fd, IPPROTO_TCP, TCP_NODELAY, 1);
+  }
+
   class macos_connection_endpoint
       : public concrete_event_source
         , public lanxc::connection_endpoint
@@ -44,6 +109,12 @@ namespace
     macos_connection_endpoint(event_service &es,
                               unixy::file_descriptor descriptor);
 
+    /**
+     * @brief Wait for the connection in progress being established, with
+     * @p self kept alive until it's established or failed
+     */
+    void wait(std::shared_ptr<macos_connection_endpoint> self,
+              promise<connection_endpoint::pointer> &reply);
 
     void on_readable(ssize_t) override
     {
@@ -51,16 +122,45 @@ namespace
 
     void on_writable(ssize_t) override
     {
+      if (!_connecting)
+        return;
+      int e = 0;
+      socklen_t length = sizeof(e);
+      if (::getsockopt(get_file_descriptor(), SOL_SOCKET, SO_ERROR,
+                       &e, &length) == -1)
+        e = errno;
+      complete(e);
     }
+
     void on_reading_error(std::uint32_t) override
     {
     }
 
-    void on_writing_error(std::uint32_t) override
+    void on_writing_error(std::uint32_t e) override
     {
+      // The socket error, which is only known to be a failure if the
+      // connection is still in progress
+      if (_connecting)
+        complete(e == 0 ? ECONNREFUSED : int(e));
     }
 
   private:
+    struct connecting
+    {
+      std::shared_ptr<macos_connection_endpoint> self;
+      promise<connection_endpoint::pointer> reply;
+    };
+
+    void complete(int e)
+    {
+      std::unique_ptr<connecting> c = std::move(_connecting);
+      if (e == 0)
+        c->reply.fulfill(std::move(c->self));
+      else
+        c->reply.reject(make_system_error(e));
+    }
+
+    std::unique_ptr<connecting> _connecting;
   };
 
   class macos_connection_endpoint::builder
@@ -75,58 +175,162 @@ namespace
 
 
     std::shared_ptr<connection_endpoint_builder>
-    bind(std::string address, std::uint16_t port)
+    bind(std::string address, std::uint16_t port) override
     {
-      _specify_source_address = true;
-      // TODO: IPv6 support
-      int ret = inet_pton(AF_INET, address.data(),
-                          reinterpret_cast<sockaddr_in*>(&_source_address));
-      if (ret == -1)
-        unixy::throw_system_error();
+      _source_length = parse_socket_address(address, port, _source_address);
+      if (_source_length == 0)
+        unixy::throw_system_error(EINVAL);
       return shared_from_this();
     }
 
-    std::shared_ptr<connection_endpoint>
-    connect(std::string address, std::uint16_t port)
+    /**
+     * The event service has no timers, so the system drops the connection
+     * not established in time, as far as seconds are precise.
+     */
+    std::shared_ptr<connection_endpoint_builder>
+    set_connect_timeout(std::chrono::nanoseconds timeout) override
     {
-      int ret = inet_pton(AF_INET, address.data(),
-                          reinterpret_cast<sockaddr_in*>(&_target_address));
-      if (ret == -1)
-        unixy::throw_system_error();
+      _connect_timeout = timeout;
+      return shared_from_this();
+    }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_no_delay(bool enabled) override
+    {
+      _no_delay = enabled;
+      return shared_from_this();
+    }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_send_buffer_size(std::size_t bytes) override
+    {
+      _send_buffer_size = bytes;
+      return shared_from_this();
+    }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_receive_buffer_size(std::size_t bytes) override
+    {
+      _receive_buffer_size = bytes;
+      return shared_from_this();
+    }
 
-      unixy::file_descriptor fd { ::socket(PF_INET, SOCK_STREAM, 0) };
+    /** Connecting by `connectx`, resumed once it's read or written */
+    std::shared_ptr<connection_endpoint_builder>
+    set_fast_open(bool enabled) override
+    {
+      _fast_open = enabled;
+      return shared_from_this();
+    }
+
+    /** @throw std::system_error with `ENOPROTOOPT` unless it's 0 */
+    std::shared_ptr<connection_endpoint_builder>
+    set_busy_poll(std::chrono::microseconds duration) override
+    {
+      if (duration.count() != 0)
+        unixy::throw_system_error(ENOPROTOOPT);
+      return shared_from_this();
+    }
+
+    /** By `TCP_RXT_CONNDROPTIME`, rounded up to seconds */
+    std::shared_ptr<connection_endpoint_builder>
+    set_user_timeout(std::chrono::milliseconds timeout) override
+    {
+      _user_timeout = timeout;
+      return shared_from_this();
+    }
+
+    future<connection_endpoint::pointer>
+    connect(std::string address, std::uint16_t port) override
+    {
+      auto self = shared_from_this();
+      return future<connection_endpoint::pointer>(
+          [self, address, port](promise<connection_endpoint::pointer> p)
+          {
+            try
+            {
+              self->start_connecting(address, port, p);
+            }
+            catch (...)
+            {
+              p.reject_by_exception_ptr(std::current_exception());
+            }
+          });
+    }
+
+  private:
+    void start_connecting(const std::string &address, std::uint16_t port,
+                          promise<connection_endpoint::pointer> &p)
+    {
+      sockaddr_storage target;
+      socklen_t length = parse_socket_address(address, port, target);
+      if (length == 0)
+        unixy::throw_system_error(EINVAL);
+
+      unixy::file_descriptor fd { ::socket(target.ss_family, SOCK_STREAM, 0) };
 
       if (!fd) unixy::throw_system_error();
 
-      socklen_t length = sizeof(sockaddr_storage);
+      int ret = ::fcntl(fd, F_GETFL);
+      if (ret == -1 || ::fcntl(fd, F_SETFL, ret | O_NONBLOCK) == -1)
+        unixy::throw_system_error();
+
+      set_socket_options(fd, target.ss_family, _no_delay, _send_buffer_size,
+                         _receive_buffer_size);
 
+      // Rounded up, so the connection is never dropped earlier
+      if (_connect_timeout.count() > 0)
+        set_option(fd, IPPROTO_TCP, TCP_CONNECTIONTIMEOUT,
+                   round_up_seconds(_connect_timeout));
+      if (_user_timeout.count() > 0)
+        set_option(fd, IPPROTO_TCP, TCP_RXT_CONNDROPTIME,
+                   round_up_seconds(_user_timeout));
 
-      if (_specify_source_address)
+      if (_source_length != 0)
       {
         ret = ::bind(fd,
                      reinterpret_cast<sockaddr*>(&_source_address),
-                     length);
+                     _source_length);
         if (ret == -1)
           unixy::throw_system_error();
       }
 
-      ret = ::connect(fd,
-                      reinterpret_cast<sockaddr*>(&_target_address),
-                      length);
-      if (ret == -1)
+      if (_fast_open)
+      {
+        // Bytes written first are carried in the SYN, which is sent once
+        // they are
+        sa_endpoints_t endpoints{};
+        endpoints.sae_dstaddr = reinterpret_cast<sockaddr*>(&target);
+        endpoints.sae_dstaddrlen = length;
+        ret = ::connectx(fd, &endpoints, SAE_ASSOCID_ANY,
+                         CONNECT_RESUME_ON_READ_WRITE
+                         | CONNECT_DATA_IDEMPOTENT,
+                         nullptr, 0, nullptr, nullptr);
+      }
+      else
+        ret = ::connect(fd,
+                        reinterpret_cast<sockaddr*>(&target),
+                        length);
+      if (ret == -1 && errno != EINPROGRESS)
         unixy::throw_system_error();
 
-      return std::make_shared<macos_connection_endpoint>(_event_service,
-                                                         std::move(fd));
+      auto endpoint = std::make_shared<macos_connection_endpoint>(
+          _event_service, std::move(fd));
+      if (ret == 0)
+        p.fulfill(std::move(endpoint));
+      else
+        endpoint->wait(endpoint, p);
     }
 
-
-
-  private:
     event_service &_event_service;
-    sockaddr_storage _target_address;
     sockaddr_storage _source_address;
-    bool _specify_source_address { false };
+    socklen_t _source_length { 0 };
+    std::chrono::nanoseconds _connect_timeout { 0 };
+    std::chrono::milliseconds _user_timeout { 0 };
+    bool _no_delay { false };
+    bool _fast_open { false };
+    std::size_t _send_buffer_size { 0 };
+    std::size_t _receive_buffer_size { 0 };
   };
 
   class macos_connection_listener
@@ -163,6 +367,40 @@ namespace
 
       std::shared_ptr<connection_listener_builder> set_reuse_address(bool enabled) override;
 
+      std::shared_ptr<connection_listener_builder>
+      set_no_delay(bool enabled) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_send_buffer_size(std::size_t bytes) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_receive_buffer_size(std::size_t bytes) override;
+
+      /**
+       * By `TCP_FASTOPEN`, where the system bounds connections pending
+       * itself, so @p pending only enables it
+       */
+      std::shared_ptr<connection_listener_builder>
+      set_fast_open(std::size_t pending) override;
+
+      /** @throw std::system_error with `ENOPROTOOPT` unless it's 0 */
+      std::shared_ptr<connection_listener_builder>
+      set_defer_accept(std::chrono::seconds timeout) override;
+
+      /** @throw std::system_error with `ENOPROTOOPT` unless it's 0 */
+      std::shared_ptr<connection_listener_builder>
+      set_busy_poll(std::chrono::microseconds duration) override;
+
+      /**
+       * By `TCP_RXT_CONNDROPTIME` of each connection accepted, rounded up
+       * to seconds
+       */
+      std::shared_ptr<connection_listener_builder>
+      set_user_timeout(std::chrono::milliseconds timeout) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_backlog(int connections) override;
+
     private:
 
       unixy::file_descriptor create_socket_descriptor();
@@ -170,6 +408,12 @@ namespace
       lanxc::applism::event_service &_event_service;
       struct sockaddr_storage  _address;
       int                      _protocol_family;
+      bool                     _no_delay { false };
+      std::size_t              _send_buffer_size { 0 };
+      std::size_t              _receive_buffer_size { 0 };
+      bool                     _fast_open { false };
+      std::chrono::milliseconds _user_timeout { 0 };
+      int                      _backlog { SOMAXCONN };
 
     };
 
@@ -192,6 +436,8 @@ namespace
   private:
     lanxc::applism::event_service &_event_service;
     lanxc::function<void(lanxc::connection_endpoint::pointer)> _callback;
+    int _protocol_family;
+    std::chrono::milliseconds _user_timeout;
     bool _stopped { false };
 
   };
@@ -204,6 +450,15 @@ namespace
   {
   }
 
+  void macos_connection_endpoint::
+  wait(std::shared_ptr<macos_connection_endpoint> self,
+       promise<connection_endpoint::pointer> &reply)
+  {
+    // Writable, or failed, once the connection is no longer in progress,
+    // which is reported through the channel registered on construction
+    _connecting.reset(new connecting{std::move(self), std::move(reply)});
+  }
+
 
   macos_connection_listener::
   macos_connection_listener(builder &builder,
@@ -212,6 +467,8 @@ namespace
       , readable_event_channel(get_file_descriptor(), builder._event_service)
       , _event_service(builder._event_service)
       , _callback {std::move(r)}
+      , _protocol_family(builder._protocol_family)
+      , _user_timeout(builder._user_timeout)
   { }
 
   void macos_connection_listener::listen(
@@ -257,6 +514,10 @@ namespace
         }
         lanxc::unixy::throw_system_error(e);
       }
+      // Not inherited from the listening socket
+      if (_user_timeout.count() > 0 && _protocol_family != PF_UNIX)
+        set_option(endpoint, IPPROTO_TCP, TCP_RXT_CONNDROPTIME,
+                   round_up_seconds(_user_timeout));
       _callback(std::make_shared<macos_connection_endpoint>(_event_service, std::move(endpoint)));
     }
   }
@@ -269,6 +530,10 @@ namespace
     if (!fd)
       lanxc::unixy::throw_system_error();
 
+    // Inherited by connections accepted
+    set_socket_options(fd, _protocol_family, _no_delay, _send_buffer_size,
+                       _receive_buffer_size);
+
     int value = 1;
     int ret = ::bind(fd,
                      reinterpret_cast<const sockaddr *>(&_address),
@@ -281,14 +546,17 @@ namespace
                      &value, sizeof(value));
     if (ret == -1) lanxc::unixy::throw_system_error();
 
+    if (_fast_open && _protocol_family != PF_UNIX)
+      set_option(fd, IPPROTO_TCP, TCP_FASTOPEN, 1);
+
     ret = fcntl(fd, F_GETFL);
     if (ret == -1) lanxc::unixy::throw_system_error();
 
-    ret = fcntl(fd, F_SETFD, ret|O_NONBLOCK);
+    ret = fcntl(fd, F_SETFL, ret|O_NONBLOCK);
 
     if (ret == -1) lanxc::unixy::throw_system_error();
 
-    ret = ::listen(fd, SOMAXCONN);
+    ret = ::listen(fd, _backlog);
     if (ret == -1) lanxc::unixy::throw_system_error();
     return fd;
   }
@@ -356,6 +624,68 @@ namespace
     return shared_from_this();
   }
 
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::set_no_delay(bool enabled)
+  {
+    _no_delay = enabled;
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::set_send_buffer_size(std::size_t bytes)
+  {
+    _send_buffer_size = bytes;
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::
+  set_receive_buffer_size(std::size_t bytes)
+  {
+    _receive_buffer_size = bytes;
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::set_fast_open(std::size_t pending)
+  {
+    _fast_open = pending != 0;
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::
+  set_defer_accept(std::chrono::seconds timeout)
+  {
+    if (timeout.count() != 0)
+      unixy::throw_system_error(ENOPROTOOPT);
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::
+  set_busy_poll(std::chrono::microseconds duration)
+  {
+    if (duration.count() != 0)
+      unixy::throw_system_error(ENOPROTOOPT);
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::
+  set_user_timeout(std::chrono::milliseconds timeout)
+  {
+    _user_timeout = timeout;
+    return shared_from_this();
+  }
+
+  std::shared_ptr<connection_listener_builder>
+  macos_connection_listener::builder::set_backlog(int connections)
+  {
+    _backlog = connections;
+    return shared_from_this();
+  }
+
 }
 
 namespace lanxc
@@ -21,7 +21,10 @@
 #include <lanxc/core/future.hpp>
 #include <lanxc/config.hpp>
 
+#include <cassert>
 #include <cstdint>
+#include <new>
+#include <utility>
 
 namespace lanxc
 {
@@ -48,6 +51,7 @@ namespace lanxc
   };
 
   class writable_stream;
+  class buffer_chain;
 
   class LANXC_CORE_EXPORT buffer_manager
   {
@@ -58,13 +62,22 @@ namespace lanxc
 
   };
 
+  class writable_buffer;
+
+  class buffer_slice;
+
   class readable_buffer
   {
     friend class buffer_manager;
+    friend class buffer_slice;
   public:
+    /** @brief Take over content of @p b, which has been filled */
+    explicit readable_buffer(writable_buffer &&b) noexcept;
+
     ~readable_buffer()
     {
-      _bm.release(_data, _size);
+      if (_data)
+        _bm.release(_data, _capacity);
     }
 
 
@@ -72,9 +85,11 @@ namespace lanxc
       : _bm(other._bm)
       , _data{}
       , _size{}
+      , _capacity{}
     {
       std::swap(_data, other._data);
       std::swap(_size, other._size);
+      std::swap(_capacity, other._capacity);
     }
 
     readable_buffer &operator = (readable_buffer &&other) noexcept
@@ -84,10 +99,17 @@ namespace lanxc
       return *this;
     }
 
+    const std::uint8_t *data() const noexcept
+    { return _data; }
+
+    std::size_t size() const noexcept
+    { return _size; }
+
   private:
     buffer_manager &_bm;
     std::uint8_t *_data;
     std::size_t _size;
+    std::size_t _capacity;
 
 
   };
@@ -95,10 +117,24 @@ namespace lanxc
   class writable_buffer
   {
     friend class buffer_manager;
+    friend class readable_buffer;
   public:
+    /**
+     * @brief Acquire a buffer of @p size bytes from @p bm
+     * @note Size of the buffer is initially its capacity, @ref resize it to
+     * the bytes actually filled before writing it
+     */
+    writable_buffer(buffer_manager &bm, std::size_t size)
+      : _bm(bm)
+      , _data{bm.acquire(size)}
+      , _size{size}
+      , _capacity{size}
+    { }
+
     ~writable_buffer()
     {
-      _bm.release(_data, _size);
+      if (_data)
+        _bm.release(_data, _capacity);
     }
 
 
@@ -106,9 +142,11 @@ namespace lanxc
       : _bm(other._bm)
       , _data{}
       , _size{}
+      , _capacity{}
     {
       std::swap(_data, other._data);
       std::swap(_size, other._size);
+      std::swap(_capacity, other._capacity);
     }
 
     writable_buffer &operator = (writable_buffer &&other) noexcept
@@ -118,40 +156,135 @@ namespace lanxc
       return *this;
     }
 
+    std::uint8_t *data() noexcept
+    { return _data; }
+
+    const std::uint8_t *data() const noexcept
+    { return _data; }
+
+    /** @brief Bytes of content */
+    std::size_t size() const noexcept
+    { return _size; }
+
+    /** @brief Bytes acquired */
+    std::size_t capacity() const noexcept
+    { return _capacity; }
+
+    /** @brief Set bytes of content, which must not exceed the capacity */
+    void resize(std::size_t size) noexcept
+    {
+      assert(size <= _capacity);
+      _size = size;
+    }
+
   private:
     buffer_manager &_bm;
     std::uint8_t *_data;
     std::size_t _size;
+    std::size_t _capacity;
   };
 
+  inline readable_buffer::readable_buffer(writable_buffer &&b) noexcept
+    : _bm(b._bm)
+    , _data{}
+    , _size{}
+    , _capacity{}
+  {
+    std::swap(_data, b._data);
+    std::swap(_size, b._size);
+    std::swap(_capacity, b._capacity);
+  }
+
   class buffer_factory
   {
 
   };
 
-  class readable_stream
+  /**
+   * @brief Thresholds of bytes buffered by a stream for flow control
+   *
+   * Once bytes buffered exceed @ref high, the stream stops taking more,
+   * e.g. stops polling its descriptor for reading, or asks the writer to
+   * wait, and resumes once they drop below @ref low.
+   */
+  struct watermark
+  {
+    std::size_t low;
+    std::size_t high;
+  };
+
+  class LANXC_CORE_EXPORT readable_stream
   {
   public:
+    virtual ~readable_stream() = 0;
+
+    /**
+     * @brief Read at most @p size bytes once at least @p watermark bytes
+     * are available
+     *
+     * The future resolves early with fewer bytes at the end of stream, and
+     * with 0 bytes only at the end of stream.
+     */
     virtual future<size_t, readable_buffer>
     read(std::size_t size, std::size_t watermark) = 0;
 
+    /**
+     * @brief Read bytes available into free capacity of segments of
+     * @p chain in order, with one system call where possible
+     *
+     * The future resolves once some bytes are available, with bytes read
+     * and the chain filled, or with 0 bytes only at the end of stream.
+     * @see buffer_chain::fill
+     */
+    virtual future<std::size_t, buffer_chain> read(buffer_chain chain) = 0;
+
     virtual void discard() = 0;
 
   };
 
 
-  class writable_stream
+  class LANXC_CORE_EXPORT writable_stream
   {
   public:
+    virtual ~writable_stream() = 0;
 
     virtual writable_buffer allocate_buffer(std::size_t size) = 0;
 
+    /**
+     * @brief Write @p b, or queue it if it can't be written right now
+     *
+     * Writes are never refused for flow control. A writer producing faster
+     * than the stream drains is expected to stop once @ref queued exceeds
+     * the high watermark of stream, and resume when @ref drain resolves.
+     * @returns Bytes accepted, which is size of @p b
+     */
     virtual std::size_t write(writable_buffer b) = 0;
 
+    /**
+     * @brief Write all segments of @p chain
+     *
+     * Implementations should gather segments into as few system calls as
+     * possible, e.g. `writev` or `sendmsg`, while the default one writes
+     * them one by one.
+     */
+    virtual std::size_t write(buffer_chain chain);
+
     virtual void close() = 0;
 
     virtual future<> flush() = 0;
 
+    /**
+     * @brief Bytes accepted but not yet handed to the underlying device
+     * @note Streams writing synchronously never queue bytes
+     */
+    virtual std::size_t queued() const noexcept;
+
+    /**
+     * @brief A future resolved once bytes queued drop below the low
+     * watermark of stream
+     */
+    virtual future<> drain();
+
   };
 
 
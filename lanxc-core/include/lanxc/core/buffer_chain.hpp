@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc/link/list.hpp>
+
+#include <cstring>
+
+namespace lanxc
+{
+
+  /**
+   * @brief An ordered chain of buffers, to be written or read by a stream
+   * in one vectored system call
+   *
+   * Each segment holds a writable buffer, whose content is the bytes to
+   * write, and whose free capacity beyond the content is room to read into.
+   * Bytes written are consumed from the front of the chain, so that a
+   * partial write is resumed without copying. Segments released are kept
+   * by the thread for chains built later, so that a chain doesn't
+   * allocate memory for its segments once the thread is warmed up.
+   */
+  class buffer_chain
+  {
+    struct segment : link::list_node<segment>
+    {
+      explicit segment(writable_buffer b) noexcept
+        : buffer(std::move(b))
+        , offset{}
+      { }
+
+      static void *operator new(std::size_t size)
+      {
+        auto &p = pool();
+        if (p.head == nullptr)
+          return ::operator new(size);
+        auto *n = p.head;
+        p.head = n->next;
+        p.count--;
+        return n;
+      }
+
+      static void operator delete(void *storage) noexcept
+      {
+        auto &p = pool();
+        if (p.count == segment_pool::capacity)
+        {
+          ::operator delete(storage);
+          return;
+        }
+        auto *n = static_cast<segment_pool::node *>(storage);
+        n->next = p.head;
+        p.head = n;
+        p.count++;
+      }
+
+      writable_buffer buffer;
+      std::size_t offset;
+    };
+
+    /** @brief Storage of segments released by a thread */
+    struct segment_pool
+    {
+      /** @brief Most segments kept by a thread */
+      static constexpr std::size_t capacity = 256;
+
+      struct node
+      {
+        node *next;
+      };
+
+      ~segment_pool()
+      {
+        while (head != nullptr)
+        {
+          auto *n = head;
+          head = n->next;
+          ::operator delete(n);
+        }
+        count = 0;
+      }
+
+      node *head;
+      std::size_t count;
+    };
+
+    static segment_pool &pool() noexcept
+    {
+      static thread_local segment_pool p{nullptr, 0};
+      return p;
+    }
+  public:
+    buffer_chain() noexcept
+      : _segments{}
+      , _size{}
+    { }
+
+    buffer_chain(buffer_chain &&other) noexcept
+      : _segments{std::move(other._segments)}
+      , _size{other._size}
+    { other._size = 0; }
+
+    buffer_chain &operator = (buffer_chain &&other) noexcept
+    {
+      clear();
+      _segments.swap(other._segments);
+      std::swap(_size, other._size);
+      return *this;
+    }
+
+    buffer_chain(const buffer_chain &) = delete;
+    buffer_chain &operator = (const buffer_chain &) = delete;
+
+    ~buffer_chain()
+    { clear(); }
+
+    /** @brief Append @p b to the back of chain */
+    void push_back(writable_buffer b)
+    {
+      _size += b.size();
+      _segments.push_back(*new segment(std::move(b)));
+    }
+
+    /** @brief Prepend @p b to the front of chain, e.g. a header */
+    void push_front(writable_buffer b)
+    {
+      _size += b.size();
+      _segments.push_front(*new segment(std::move(b)));
+    }
+
+    /**
+     * @brief Detach the first segment
+     * @note Bytes consumed from the segment are dropped, by moving rest of
+     * its content to the front of buffer
+     */
+    writable_buffer pop_front()
+    {
+      assert(!empty());
+      segment *s = &_segments.front();
+      _segments.pop_front();
+      writable_buffer b(std::move(s->buffer));
+      std::size_t rest = b.size() - s->offset;
+      delete s;
+      if (rest != b.size())
+      {
+        std::memmove(b.data(), b.data() + b.size() - rest, rest);
+        b.resize(rest);
+      }
+      _size -= rest;
+      return b;
+    }
+
+    bool empty() const noexcept
+    { return _segments.empty(); }
+
+    /** @brief Bytes of content not consumed yet */
+    std::size_t size() const noexcept
+    { return _size; }
+
+    /** @brief Number of segments */
+    std::size_t segments() const noexcept
+    { return _segments.size(); }
+
+    /**
+     * @brief Consume @p n bytes from the front, e.g. bytes written, and
+     * release segments drained
+     */
+    void consume(std::size_t n)
+    {
+      assert(n <= _size);
+      _size -= n;
+      while (n != 0)
+      {
+        segment &s = _segments.front();
+        std::size_t rest = s.buffer.size() - s.offset;
+        if (n < rest)
+        {
+          s.offset += n;
+          return;
+        }
+        n -= rest;
+        _segments.pop_front();
+        delete &s;
+      }
+    }
+
+    /**
+     * @brief Grow content of segments in order by @p n bytes, e.g. bytes
+     * read into their free capacity
+     */
+    void fill(std::size_t n) noexcept
+    {
+      _size += n;
+      for (auto &s : _segments)
+      {
+        if (n == 0)
+          break;
+        std::size_t room = s.buffer.capacity() - s.buffer.size();
+        std::size_t grow = n < room ? n : room;
+        s.buffer.resize(s.buffer.size() + grow);
+        n -= grow;
+      }
+      assert(n == 0);
+    }
+
+    /**
+     * @brief Call @p f with `(const std::uint8_t *, std::size_t)` for each
+     * range of content not consumed yet
+     */
+    template<typename F>
+    void for_each(F &&f) const
+    {
+      for (auto &s : _segments)
+        if (s.buffer.size() != s.offset)
+          f(s.buffer.data() + s.offset, s.buffer.size() - s.offset);
+    }
+
+    /**
+     * @brief Call @p f with `(std::uint8_t *, std::size_t)` for the free
+     * capacity of each segment
+     */
+    template<typename F>
+    void for_each_capacity(F &&f)
+    {
+      for (auto &s : _segments)
+        if (s.buffer.capacity() != s.buffer.size())
+          f(s.buffer.data() + s.buffer.size(),
+            s.buffer.capacity() - s.buffer.size());
+    }
+
+    /** @brief Release all segments */
+    void clear() noexcept
+    {
+      while (!_segments.empty())
+      {
+        segment &s = _segments.front();
+        _segments.pop_front();
+        delete &s;
+      }
+      _size = 0;
+    }
+
+  private:
+    link::list<segment> _segments;
+    std::size_t _size;
+  };
+
+  /**
+   * @brief Copy all bytes of @p from to @p to until the end of @p from
+   *
+   * Bytes are read into buffers allocated by @p to of @p chunk bytes, then
+   * written to it, waiting for it to drain whenever it queues bytes
+   * written. Streams backed by file descriptors may be piped without
+   * copying through user space by threads outside of event loops, see
+   * `linuxy::pipe`.
+   * @returns A future resolved with bytes copied
+   */
+  LANXC_CORE_EXPORT future<std::size_t>
+  pipe(readable_stream &from, writable_stream &to,
+       std::size_t chunk = 64 << 10);
+
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer_slice.hpp>
+#include <lanxc/core/varint.hpp>
+
+#include <type_traits>
+
+namespace lanxc
+{
+
+  /**
+   * @brief Bytes being read are fewer than needed, or malformed
+   */
+  class buffer_underflow_exception : public io_exception
+  {
+
+  };
+
+  /**
+   * @brief Deserialize integers and bytes from a slice, counterpart of
+   * @ref buffer_writer
+   *
+   * Bytes are returned as sub-slices of the slice read, without copying.
+   * @throws buffer_underflow_exception from each getter if bytes remaining
+   * are too few, or a varint is malformed, in which case nothing is
+   * consumed
+   */
+  class buffer_reader
+  {
+  public:
+    explicit buffer_reader(buffer_slice s) noexcept
+      : _slice(std::move(s))
+    { }
+
+    std::uint8_t get_u8()
+    {
+      need(1);
+      std::uint8_t v = _slice[0];
+      _slice.remove_prefix(1);
+      return v;
+    }
+
+    std::uint64_t get_varint()
+    {
+      std::uint64_t v;
+      const std::uint8_t *end = varint::decode(_slice.data(), _slice.size(),
+                                               v);
+      if (!end)
+        throw buffer_underflow_exception();
+      _slice.remove_prefix(static_cast<std::size_t>(end - _slice.data()));
+      return v;
+    }
+
+    std::int64_t get_zigzag()
+    { return varint::unzigzag(get_varint()); }
+
+    template<typename T>
+    T get_little_endian()
+    {
+      static_assert(std::is_integral<T>::value, "integers only");
+      using U = typename std::make_unsigned<T>::type;
+      need(sizeof(T));
+      U u = 0;
+      for (std::size_t i = 0; i < sizeof(T); i++)
+        u = static_cast<U>(u | static_cast<U>(_slice[i]) << (8 * i));
+      _slice.remove_prefix(sizeof(T));
+      return static_cast<T>(u);
+    }
+
+    template<typename T>
+    T get_big_endian()
+    {
+      static_assert(std::is_integral<T>::value, "integers only");
+      using U = typename std::make_unsigned<T>::type;
+      need(sizeof(T));
+      U u = 0;
+      for (std::size_t i = 0; i < sizeof(T); i++)
+        u = static_cast<U>(u << 8 | _slice[i]);
+      _slice.remove_prefix(sizeof(T));
+      return static_cast<T>(u);
+    }
+
+    /** @brief Get @p size bytes as a slice sharing the buffer */
+    buffer_slice get_bytes(std::size_t size)
+    {
+      need(size);
+      buffer_slice s = _slice.slice(0, size);
+      _slice.remove_prefix(size);
+      return s;
+    }
+
+    /** @brief Get bytes prefixed by their size as varint */
+    buffer_slice get_string()
+    {
+      std::uint64_t size;
+      const std::uint8_t *end = varint::decode(_slice.data(), _slice.size(),
+                                               size);
+      if (!end)
+        throw buffer_underflow_exception();
+      auto prefix = static_cast<std::size_t>(end - _slice.data());
+      if (size > _slice.size() - prefix)
+        throw buffer_underflow_exception();
+      _slice.remove_prefix(prefix);
+      return get_bytes(static_cast<std::size_t>(size));
+    }
+
+    /** @brief Bytes not read yet */
+    std::size_t remaining() const noexcept
+    { return _slice.size(); }
+
+  private:
+    void need(std::size_t n) const
+    {
+      if (_slice.size() < n)
+        throw buffer_underflow_exception();
+    }
+
+    buffer_slice _slice;
+  };
+
+}
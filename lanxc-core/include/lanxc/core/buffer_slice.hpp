@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+
+#include <atomic>
+
+namespace lanxc
+{
+
+  /**
+   * @brief A shared view of a region of a readable buffer
+   *
+   * Slices of the same buffer share a reference counted block, so copying
+   * a slice or taking a sub-slice costs O(1) without copying any byte. The
+   * buffer is released to its manager when the last slice is destroyed.
+   * Counting is atomic, so slices may be handed to other threads, while the
+   * bytes viewed must not be modified.
+   */
+  class buffer_slice
+  {
+    struct block
+    {
+      block(buffer_manager &bm, std::uint8_t *data,
+            std::size_t capacity) noexcept
+        : bm(bm)
+        , data{data}
+        , capacity{capacity}
+        , references{1}
+      { }
+
+      ~block()
+      { bm.release(data, capacity); }
+
+      buffer_manager &bm;
+      std::uint8_t *data;
+      std::size_t capacity;
+      std::atomic<std::size_t> references;
+    };
+  public:
+    /** @brief An empty slice */
+    buffer_slice() noexcept
+      : _block{}
+      , _data{}
+      , _size{}
+    { }
+
+    /** @brief Take over content of @p b to share it among slices */
+    explicit buffer_slice(readable_buffer &&b)
+      : _block{}
+      , _data{}
+      , _size{}
+    {
+      if (!b._data)
+        return;
+      _block = new block(b._bm, b._data, b._capacity);
+      _data = b._data;
+      _size = b._size;
+      b._data = nullptr;
+      b._size = 0;
+      b._capacity = 0;
+    }
+
+    buffer_slice(const buffer_slice &other) noexcept
+      : _block{other._block}
+      , _data{other._data}
+      , _size{other._size}
+    {
+      if (_block)
+        _block->references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    buffer_slice(buffer_slice &&other) noexcept
+      : _block{other._block}
+      , _data{other._data}
+      , _size{other._size}
+    {
+      other._block = nullptr;
+      other._data = nullptr;
+      other._size = 0;
+    }
+
+    buffer_slice &operator = (const buffer_slice &other) noexcept
+    {
+      if (this != &other)
+      {
+        this->~buffer_slice();
+        new (this) buffer_slice(other);
+      }
+      return *this;
+    }
+
+    buffer_slice &operator = (buffer_slice &&other) noexcept
+    {
+      if (this != &other)
+      {
+        this->~buffer_slice();
+        new (this) buffer_slice(std::move(other));
+      }
+      return *this;
+    }
+
+    ~buffer_slice()
+    {
+      if (_block
+          && _block->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete _block;
+    }
+
+    const std::uint8_t *data() const noexcept
+    { return _data; }
+
+    std::size_t size() const noexcept
+    { return _size; }
+
+    bool empty() const noexcept
+    { return _size == 0; }
+
+    const std::uint8_t &operator [] (std::size_t i) const noexcept
+    {
+      assert(i < _size);
+      return _data[i];
+    }
+
+    /**
+     * @brief A slice of @p length bytes from @p offset of this one
+     * @note The length is truncated to bytes available
+     */
+    buffer_slice slice(std::size_t offset,
+                       std::size_t length = std::size_t(-1)) const noexcept
+    {
+      assert(offset <= _size);
+      buffer_slice s(*this);
+      s._data += offset;
+      s._size = length < _size - offset ? length : _size - offset;
+      return s;
+    }
+
+    /** @brief Drop @p n bytes from the front */
+    void remove_prefix(std::size_t n) noexcept
+    {
+      assert(n <= _size);
+      _data += n;
+      _size -= n;
+    }
+
+    /** @brief Drop @p n bytes from the back */
+    void remove_suffix(std::size_t n) noexcept
+    {
+      assert(n <= _size);
+      _size -= n;
+    }
+
+    /** @brief Number of slices sharing the buffer */
+    std::size_t use_count() const noexcept
+    {
+      return _block ? _block->references.load(std::memory_order_relaxed) : 0;
+    }
+
+  private:
+    block *_block;
+    const std::uint8_t *_data;
+    std::size_t _size;
+  };
+
+}
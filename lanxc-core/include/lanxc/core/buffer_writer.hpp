@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/varint.hpp>
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace lanxc
+{
+
+  /**
+   * @brief Serialize integers and bytes straight into buffers allocated
+   * from a writable stream
+   *
+   * Bytes are encoded into the buffer being filled, and once it's full,
+   * another one is allocated from the stream, so nothing is copied again.
+   * Buffers filled are handed to the stream together by @ref commit, with
+   * a single `write` of a buffer chain. Bytes not committed are dropped on
+   * destruction.
+   */
+  class LANXC_CORE_EXPORT buffer_writer
+  {
+  public:
+    /** @param chunk Bytes of each buffer allocated from @p out */
+    explicit buffer_writer(writable_stream &out, std::size_t chunk = 4096);
+
+    ~buffer_writer();
+
+    buffer_writer(const buffer_writer &) = delete;
+    buffer_writer &operator = (const buffer_writer &) = delete;
+
+    void put_u8(std::uint8_t v)
+    {
+      std::uint8_t *p = room(1);
+      *p = v;
+      _cursor = p + 1;
+    }
+
+    /** @brief Put @p v as unsigned LEB128 */
+    void put_varint(std::uint64_t v)
+    { _cursor = varint::encode(room(varint::max_size), v); }
+
+    /** @brief Put @p v zigzag mapped as unsigned LEB128 */
+    void put_zigzag(std::int64_t v)
+    { put_varint(varint::zigzag(v)); }
+
+    template<typename T>
+    void put_little_endian(T v)
+    {
+      static_assert(std::is_integral<T>::value, "integers only");
+      using U = typename std::make_unsigned<T>::type;
+      std::uint8_t *p = room(sizeof(T));
+      auto u = static_cast<U>(v);
+      for (std::size_t i = 0; i < sizeof(T); i++)
+        p[i] = static_cast<std::uint8_t>(u >> (8 * i));
+      _cursor = p + sizeof(T);
+    }
+
+    template<typename T>
+    void put_big_endian(T v)
+    {
+      static_assert(std::is_integral<T>::value, "integers only");
+      using U = typename std::make_unsigned<T>::type;
+      std::uint8_t *p = room(sizeof(T));
+      auto u = static_cast<U>(v);
+      for (std::size_t i = 0; i < sizeof(T); i++)
+        p[i] = static_cast<std::uint8_t>(u >> (8 * (sizeof(T) - 1 - i)));
+      _cursor = p + sizeof(T);
+    }
+
+    /** @brief Put @p size bytes, split among buffers if needed */
+    void put_bytes(const void *data, std::size_t size);
+
+    /** @brief Put @p size bytes prefixed by @p size as varint */
+    void put_string(const void *data, std::size_t size)
+    {
+      put_varint(size);
+      put_bytes(data, size);
+    }
+
+    /** @brief Bytes put but not committed yet */
+    std::size_t size() const noexcept;
+
+    /**
+     * @brief Write bytes put to the stream
+     * @returns Bytes written
+     */
+    std::size_t commit();
+
+  private:
+    /** @brief Room of @p n bytes contiguous at least, at the cursor */
+    std::uint8_t *room(std::size_t n)
+    {
+      if (static_cast<std::size_t>(_end - _cursor) < n)
+        grow(n);
+      return _cursor;
+    }
+
+    /** @brief Seal the buffer being filled and allocate another one */
+    void grow(std::size_t n);
+
+    void seal();
+
+    writable_stream &_out;
+    const std::size_t _chunk;
+    buffer_chain _filled;
+    std::unique_ptr<writable_buffer> _current;
+    std::uint8_t *_cursor;
+    std::uint8_t *_end;
+  };
+
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/network_context.hpp>
+#include <lanxc/core/task_context.hpp>
+#include <lanxc/core/future.hpp>
+#include <lanxc/link/list.hpp>
+#include <lanxc/config.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace lanxc
+{
+
+  /**
+   * @brief Connections kept alive to be reused, keyed by destination
+   *
+   * Connections released are kept idle in a list for each destination,
+   * the most recently used one is checked out first, and each of them is
+   * closed once being idle longer than the idle timeout. A connection is
+   * checked by @ref connection_endpoint::is_healthy before being checked
+   * out, and dropped if the peer has closed it in the meantime.
+   *
+   * At most a limited number of connections, idle, in use or being
+   * established, are made to each destination, and acquisitions beyond
+   * that wait for a connection to be released.
+   *
+   * @note The pool must be held by `std::shared_ptr`, and used within its
+   * task context only
+   */
+  class LANXC_CORE_EXPORT connection_pool
+      : public std::enable_shared_from_this<connection_pool>
+  {
+  public:
+    struct pooling_statistics
+    {
+      std::uint64_t created;
+      std::uint64_t reused;
+      std::uint64_t expired;
+
+      /** @brief Connections dropped for failing the health check */
+      std::uint64_t unhealthy;
+    };
+
+    /**
+     * @param builder Builder connecting to destinations
+     * @param limit Connections to each destination at most
+     * @param idle_timeout Time an idle connection is kept for
+     */
+    connection_pool(task_context &tc,
+                    std::shared_ptr<connection_endpoint_builder> builder,
+                    std::size_t limit = 8,
+                    std::chrono::nanoseconds idle_timeout
+                        = std::chrono::seconds(60));
+
+    ~connection_pool();
+
+    connection_pool(const connection_pool &) = delete;
+    connection_pool &operator = (const connection_pool &) = delete;
+
+    /**
+     * @brief Check out an idle connection to @p address and @p port, or
+     * connect if none
+     *
+     * The future is rejected as the builder does if it fails to connect.
+     */
+    future<connection_endpoint::pointer>
+    acquire(std::string address, std::uint16_t port);
+
+    /**
+     * @brief Return a connection acquired to the pool, to be reused
+     * unless @p reusable is false, e.g. a response is left unread
+     * @note Connections not acquired from the pool are ignored
+     */
+    void release(const connection_endpoint::pointer &endpoint,
+                 bool reusable = true);
+
+    /** @brief Number of idle connections to all destinations */
+    std::size_t idle() const noexcept;
+
+    const pooling_statistics &statistics() const noexcept
+    { return _statistics; }
+
+  private:
+    struct connection;
+    struct destination;
+
+    void checkout(destination &d, promise<connection_endpoint::pointer> p);
+    void connect(destination &d, promise<connection_endpoint::pointer> p);
+    void drop(connection &c);
+    void settle(destination &d);
+
+    task_context &_tc;
+    std::shared_ptr<connection_endpoint_builder> _builder;
+    const std::size_t _limit;
+    const std::chrono::nanoseconds _idle_timeout;
+    std::map<std::pair<std::string, std::uint16_t>,
+             std::unique_ptr<destination>> _destinations;
+    /** @brief All connections, idle or in use, by their endpoints */
+    std::unordered_map<const connection_endpoint *,
+                       std::unique_ptr<connection>> _connections;
+    pooling_statistics _statistics;
+  };
+
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc/core/buffer_slice.hpp>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace lanxc
+{
+
+  /**
+   * @brief A frame exceeds the maximum length of framer
+   */
+  class frame_length_exception : public io_exception
+  {
+
+  };
+
+  /**
+   * @brief Find the first @p byte among @p size bytes from @p data
+   * @returns Pointer to the byte found, or nullptr if not found
+   *
+   * On x86, 16 or 32 bytes are compared at once with SSE2 or AVX2,
+   * whichever is supported by the processor, otherwise `memchr` is used.
+   */
+  LANXC_CORE_EXPORT const std::uint8_t *
+  find_byte(const std::uint8_t *data, std::size_t size,
+            std::uint8_t byte) noexcept;
+
+  /**
+   * @brief Split bytes fed into frames terminated by a delimiter, e.g.
+   * lines of a text protocol terminated by `"\n"` or `"\r\n"`
+   *
+   * Frames are slices of buffers fed, without copying, unless they span
+   * several buffers, in which case they are joined into a buffer acquired
+   * from the buffer manager. The delimiter is searched by its last byte
+   * with @ref find_byte, and bytes already searched are never searched
+   * again.
+   */
+  class LANXC_CORE_EXPORT delimited_framer
+  {
+  public:
+    /**
+     * @param bm Buffer manager to join frames spanning buffers
+     * @param delimiter Bytes terminating a frame, must not be empty
+     * @param max_length Bytes of a frame at most, excluding the delimiter
+     */
+    explicit delimited_framer(buffer_manager &bm,
+                              std::string delimiter = "\n",
+                              std::size_t max_length = 64 << 10);
+
+    /** @brief Feed bytes following those fed before */
+    void feed(readable_buffer b);
+
+    /** @brief Feed bytes following those fed before */
+    void feed(buffer_slice s);
+
+    /**
+     * @brief Mark the end of bytes, so the bytes after the last delimiter
+     * make the last frame, if any
+     */
+    void finish() noexcept
+    { _finished = true; }
+
+    bool finished() const noexcept
+    { return _finished; }
+
+    /**
+     * @brief Take the next complete frame, excluding its delimiter
+     * @returns false if more bytes are needed, or at the end
+     * @throws frame_length_exception if the frame exceeds the maximum
+     * length, after which the framer keeps throwing it
+     */
+    bool next(buffer_slice &frame);
+
+    /** @brief Bytes fed but not taken as frames yet */
+    std::size_t buffered() const noexcept;
+
+  private:
+    /**
+     * @brief Search the delimiter in @p in following bytes carried
+     * @param end Set to the index past the delimiter found in @p in
+     */
+    bool search(const buffer_slice &in, std::size_t &end) const noexcept;
+
+    /** @brief Whether the delimiter ends at index @p j of @p in */
+    bool matches(const buffer_slice &in, std::size_t j) const noexcept;
+
+    buffer_slice join(const buffer_slice &in, std::size_t length);
+
+    [[noreturn]] void fail();
+
+    buffer_manager &_bm;
+    const std::string _delimiter;
+    const std::size_t _max_length;
+    std::deque<buffer_slice> _input;
+    /** @brief Bytes of an incomplete frame carried from buffers before */
+    std::vector<std::uint8_t> _carried;
+    bool _finished;
+    bool _failed;
+  };
+
+  /**
+   * @brief Read frames terminated by a delimiter from a stream
+   * @see delimited_framer
+   */
+  class LANXC_CORE_EXPORT frame_reader
+  {
+  public:
+    /** @param chunk Bytes to read from @p in at once */
+    frame_reader(readable_stream &in, buffer_manager &bm,
+                 std::string delimiter = "\n",
+                 std::size_t max_length = 64 << 10,
+                 std::size_t chunk = 16 << 10);
+
+    /**
+     * @brief Read the next frame
+     *
+     * The future resolves with false and an empty slice at the end of
+     * stream, or is rejected by @ref frame_length_exception.
+     */
+    future<bool, buffer_slice> read();
+
+    delimited_framer &framer() noexcept
+    { return _framer; }
+
+  private:
+    future<bool, buffer_slice> step();
+
+    readable_stream &_in;
+    delimited_framer _framer;
+    const std::size_t _chunk;
+  };
+
+}
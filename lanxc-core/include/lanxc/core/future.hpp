@@ -23,6 +23,7 @@
 #include <lanxc/config.hpp>
 
 #include <exception>
+#include <tuple>
 
 namespace lanxc
 {
@@ -139,6 +140,18 @@ namespace lanxc
     {
       reject_by_exception_ptr(std::make_exception_ptr(e));
     }
+
+    /**
+     * @brief The task context which the future is started with
+     *
+     * Futures that the promise waits for are started with it, e.g. by a
+     * loop which keeps its state on the heap rather than chaining a
+     * future for each round.
+     */
+    task_context &context() const noexcept
+    {
+      return *_detail->_task_context;
+    }
   private:
 
     using defer_task_type
@@ -168,13 +181,35 @@ namespace lanxc
           , _task_context{nullptr}
       { }
 
-      ~detail() = default;
+      ~detail()
+      {
+        // The delivery refers to this detail, which is gone along with
+        // the chain of futures, e.g. once the task started is dropped
+        if (_next)
+          _next->cancel();
+      }
+
+      /**
+       * @brief Staged result, which is moved rather than copied when it's
+       * delivered, so that values can be move-only
+       */
+      struct result_delivery
+      {
+        detail *_self;
+        std::tuple<Value...> _values;
+
+        void operator () ()
+        { deliver(make_index_sequence<sizeof...(Value)>()); }
+
+        template<std::size_t ...Index>
+        void deliver(index_sequence<Index...>)
+        { _self->_fulfill(std::move(std::get<Index>(_values))...); }
+      };
 
       void set_result(Value ...result)
       {
-        _delivery = std::bind([this](Value ...value)
-                            { _fulfill(std::move(value)...);},
-                            std::move(result)...);
+        _delivery = result_delivery{this,
+                                    std::tuple<Value...>(std::move(result)...)};
         _exception_ptr = nullptr;
       }
 
@@ -262,6 +297,15 @@ namespace lanxc
     template<typename E>
     using caught_void_routine = function<void(E&)>;
 
+    /** @brief Rethrow @p e to be caught as @p E */
+    template<typename E>
+    static void rethrow(std::exception_ptr e, E *)
+    { std::rethrow_exception(std::move(e)); }
+
+    /** @brief Throw @p e itself, so every exception is caught */
+    static void rethrow(std::exception_ptr e, std::exception_ptr *)
+    { throw e; }
+
 
     struct base
     {
@@ -628,7 +672,8 @@ namespace lanxc
 
     /**
      * @brief Setup an error handler for this future
-     * @tparam E The type of exception to catch
+     * @tparam E The type of exception to catch, or `std::exception_ptr`
+     * to catch every exception, e.g. to release resources whatever it is
      * @tparam R The type of error handler
      * @param f The instance of error handler function
      * @return A new @a future
@@ -651,6 +696,13 @@ namespace lanxc
     /**
      * @brief Resolve this future within an executor
      * @param ctx The executor
+     * @returns The task owning the chain of futures, which must be kept
+     * until the chain completes
+     *
+     * Dropping the task returned destroys the chain, and cancels the
+     * delivery of its pending result, even if a promise outlives it,
+     * since the delivery refers to the chain gone. Routines of the chain
+     * are never called afterwards.
      */
     std::shared_ptr<deferred> start(task_context &ctx)
     {
@@ -1033,7 +1085,7 @@ namespace lanxc
   {
     try
     {
-      std::rethrow_exception(std::move(e));
+      rethrow(std::move(e), static_cast<E *>(nullptr));
     }
     catch(E &e)
     {
@@ -1112,7 +1164,7 @@ namespace lanxc
   {
     try
     {
-      std::rethrow_exception(std::move(e));
+      rethrow(std::move(e), static_cast<E *>(nullptr));
     }
     catch(E &e)
     {
@@ -1185,7 +1237,7 @@ namespace lanxc
   {
     try
     {
-      std::rethrow_exception(std::move(e));
+      rethrow(std::move(e), static_cast<E *>(nullptr));
     }
     catch(E &e)
     {
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/framing.hpp>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace lanxc
+{
+
+  /**
+   * @brief The stream ends in the middle of a frame
+   */
+  class frame_truncated_exception : public io_exception
+  {
+
+  };
+
+  /** @brief Encoding of the length prefixed to each frame */
+  enum class length_prefix
+  {
+    /** @brief 2 bytes in big endian */
+    fixed16,
+    /** @brief 4 bytes in big endian */
+    fixed32,
+    /** @brief Unsigned LEB128, as varint of protocol buffers */
+    varint
+  };
+
+  /**
+   * @brief Split bytes fed into frames prefixed by their length
+   *
+   * Frames are slices of buffers fed, without copying, unless they span
+   * several buffers, in which case the payload is copied once into a
+   * buffer of its length. Non-minimal varints, e.g. padded by @ref
+   * length_prefixed_writer, are accepted.
+   */
+  class LANXC_CORE_EXPORT length_prefixed_decoder
+  {
+  public:
+    /**
+     * @param bm Buffer manager to join frames spanning buffers
+     * @param max_length Bytes of a payload at most
+     */
+    length_prefixed_decoder(buffer_manager &bm, length_prefix prefix,
+                            std::size_t max_length = 16 << 20);
+
+    /** @brief Feed bytes following those fed before */
+    void feed(readable_buffer b);
+
+    /** @brief Feed bytes following those fed before */
+    void feed(buffer_slice s);
+
+    /**
+     * @brief Decode all complete frames in one pass
+     * @param batch Payloads of frames decoded are appended to it
+     * @returns Number of frames decoded
+     * @throws frame_length_exception if a frame exceeds the maximum
+     * length, or its varint is malformed, after which the decoder keeps
+     * throwing it
+     */
+    std::size_t decode(std::vector<buffer_slice> &batch);
+
+    /** @brief Bytes fed but not decoded as frames yet */
+    std::size_t buffered() const noexcept;
+
+  private:
+    /**
+     * @brief Parse the prefix from bytes carried followed by @p data
+     * @param used Set to bytes of @p data used
+     * @returns Whether the prefix is complete
+     */
+    bool parse(const std::uint8_t *data, std::size_t size, std::size_t &used);
+
+    [[noreturn]] void fail();
+
+    buffer_manager &_bm;
+    const length_prefix _prefix;
+    const std::size_t _max_length;
+    std::deque<buffer_slice> _input;
+    /** @brief Bytes of an incomplete prefix */
+    std::uint8_t _header[10];
+    std::size_t _header_size;
+    std::uint64_t _length;
+    /** @brief Payload spanning buffers being copied, if any */
+    std::unique_ptr<writable_buffer> _payload;
+    std::size_t _filled;
+    bool _failed;
+  };
+
+  /**
+   * @brief Read frames prefixed by their length from a stream in batches
+   * @see length_prefixed_decoder
+   */
+  class LANXC_CORE_EXPORT length_prefixed_reader
+  {
+  public:
+    /** @param chunk Bytes to read from @p in at once */
+    length_prefixed_reader(readable_stream &in, buffer_manager &bm,
+                           length_prefix prefix,
+                           std::size_t max_length = 16 << 20,
+                           std::size_t chunk = 64 << 10);
+
+    /**
+     * @brief Read all frames complete, at least one, with a single read of
+     * the stream for as many frames as it returns
+     *
+     * The future resolves with an empty batch at the end of stream, or is
+     * rejected by @ref frame_truncated_exception if the stream ends in the
+     * middle of a frame.
+     */
+    future<std::vector<buffer_slice>> read();
+
+    length_prefixed_decoder &decoder() noexcept
+    { return _decoder; }
+
+  private:
+    future<std::vector<buffer_slice>> step();
+
+    readable_stream &_in;
+    length_prefixed_decoder _decoder;
+    const std::size_t _chunk;
+    bool _eof;
+  };
+
+  /**
+   * @brief Write frames prefixed by their length to a stream
+   *
+   * Room of the prefix is reserved ahead of the payload in the same buffer,
+   * so the payload is written straight into the buffer allocated from the
+   * stream, and each frame is written as a single buffer.
+   */
+  class LANXC_CORE_EXPORT length_prefixed_writer
+  {
+  public:
+    /** @brief A buffer with room of prefix reserved ahead of the payload */
+    class frame
+    {
+      friend class length_prefixed_writer;
+    public:
+      std::uint8_t *data() noexcept
+      { return _buffer.data() + _header; }
+
+      /** @brief Bytes of payload at most */
+      std::size_t capacity() const noexcept
+      { return _buffer.capacity() - _header; }
+
+    private:
+      frame(writable_buffer b, std::size_t header) noexcept
+        : _buffer(std::move(b))
+        , _header{header}
+      { }
+
+      writable_buffer _buffer;
+      std::size_t _header;
+    };
+
+    length_prefixed_writer(writable_stream &out, length_prefix prefix);
+
+    /**
+     * @brief Allocate a frame of @p capacity bytes of payload
+     * @throws frame_length_exception if @p capacity can't be encoded by
+     * the prefix
+     */
+    frame allocate(std::size_t capacity);
+
+    /**
+     * @brief Prefix @p f with @p size, bytes of payload filled, and write
+     * it
+     *
+     * A varint prefix keeps the room reserved for the capacity, padded
+     * with continuation bytes, so the payload never moves.
+     * @returns Bytes written, including the prefix
+     */
+    std::size_t write(frame f, std::size_t size);
+
+    /** @brief Copy @p size bytes from @p payload into a frame and write it */
+    std::size_t write(const void *payload, std::size_t size);
+
+  private:
+    writable_stream &_out;
+    const length_prefix _prefix;
+  };
+
+}
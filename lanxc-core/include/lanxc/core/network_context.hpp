@@ -17,31 +17,101 @@
 
 #pragma once
 
+#include <lanxc/core/buffer_slice.hpp>
+#include <lanxc/core/future.hpp>
 #include <lanxc/function.hpp>
 #include <lanxc/config.hpp>
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 
 namespace lanxc
 {
 
-  class connection_endpoint
+  class LANXC_CORE_EXPORT connection_endpoint
   {
   public:
     using pointer = std::shared_ptr<connection_endpoint>;
+
+    virtual ~connection_endpoint() = 0;
+
+    /**
+     * @brief Whether the connection is still open with nothing pending,
+     * so it may be reused for another request, which is assumed unless
+     * the implementation is able to tell
+     */
+    virtual bool is_healthy() const noexcept
+    { return true; }
   };
 
-  class connection_endpoint_builder
+  class LANXC_CORE_EXPORT connection_endpoint_builder
   {
   public:
 
-    std::shared_ptr<connection_endpoint_builder>
-    bind(std::string address, std::uint16_t port);
+    virtual ~connection_endpoint_builder() = 0;
+
+    virtual std::shared_ptr<connection_endpoint_builder>
+    bind(std::string address, std::uint16_t port) = 0;
+
+    /**
+     * @brief Time to wait for the connection being established, or 0 to
+     * wait as long as the system does, which is minutes on SYN loss
+     */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_connect_timeout(std::chrono::nanoseconds timeout) = 0;
+
+    /** @brief Send small writes right away, disabling Nagle's algorithm */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_no_delay(bool enabled) = 0;
 
+    /** @brief Bytes of the socket send buffer, or 0 for the default */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_send_buffer_size(std::size_t bytes) = 0;
+
+    /** @brief Bytes of the socket receive buffer, or 0 for the default */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_receive_buffer_size(std::size_t bytes) = 0;
+
+    /**
+     * @brief Carry bytes written first in the SYN, saving a round trip
+     * with servers accepting TCP Fast Open
+     *
+     * The connection is considered established right away, and failing
+     * to connect is reported once it's read or written.
+     */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_fast_open(bool enabled) = 0;
+
+    /**
+     * @brief Time to busy poll the device for receiving while blocking,
+     * or 0 to sleep right away
+     * @throw std::system_error with `ENOPROTOOPT` if it's not 0 and the
+     * system is unable to
+     */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_busy_poll(std::chrono::microseconds duration) = 0;
 
-    std::shared_ptr<connection_endpoint> connect(std::string address, std::uint16_t port);
+    /**
+     * @brief Time bytes sent may remain unacknowledged before the
+     * connection is dropped, or 0 for the default
+     */
+    virtual std::shared_ptr<connection_endpoint_builder>
+    set_user_timeout(std::chrono::milliseconds timeout) = 0;
+
+    /**
+     * @brief Connect to @p address and @p port without blocking the task
+     * context
+     *
+     * The future is rejected once the connection is refused, or not
+     * established before the connect timeout.
+     */
+    virtual future<connection_endpoint::pointer>
+    connect(std::string address, std::uint16_t port) = 0;
 
   };
 
@@ -72,6 +142,63 @@ namespace lanxc
     virtual std::shared_ptr<connection_listener_builder>
     set_reuse_address(bool enabled) = 0;
 
+    /**
+     * @brief Send small writes of connections accepted right away,
+     * disabling Nagle's algorithm
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_no_delay(bool enabled) = 0;
+
+    /**
+     * @brief Bytes of send buffers of connections accepted, or 0 for the
+     * default
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_send_buffer_size(std::size_t bytes) = 0;
+
+    /**
+     * @brief Bytes of receive buffers of connections accepted, or 0 for
+     * the default
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_receive_buffer_size(std::size_t bytes) = 0;
+
+    /**
+     * @brief Accept bytes carried in SYNs by TCP Fast Open, for at most
+     * @p pending connections not established yet, or 0 to disable it
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_fast_open(std::size_t pending) = 0;
+
+    /**
+     * @brief Accept connections only once their first bytes arrive, or
+     * after @p timeout
+     * @throw std::system_error with `ENOPROTOOPT` if it's not 0 and the
+     * system is unable to
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_defer_accept(std::chrono::seconds timeout) = 0;
+
+    /**
+     * @brief Time to busy poll the device for receiving while blocking,
+     * or 0 to sleep right away
+     * @throw std::system_error with `ENOPROTOOPT` if it's not 0 and the
+     * system is unable to
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_busy_poll(std::chrono::microseconds duration) = 0;
+
+    /**
+     * @brief Time bytes sent may remain unacknowledged before a
+     * connection accepted is dropped, or 0 for the default
+     */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_user_timeout(std::chrono::milliseconds timeout) = 0;
+
+    /** @brief Connections pending to be accepted at most */
+    virtual std::shared_ptr<connection_listener_builder>
+    set_backlog(int connections) = 0;
+
     virtual ~connection_listener_builder() = 0;
     
     virtual std::shared_ptr<connection_listener>
@@ -79,14 +206,116 @@ namespace lanxc
   };
 
 
-  class datagram_endpoint
+  /** @brief Socket address of the peer of a datagram */
+  struct datagram_address
+  {
+    /** @brief Bytes of @ref storage used, or 0 for the connected peer */
+    std::uint32_t length;
+
+    /** @brief The address, large enough for IPv4 and IPv6 */
+    alignas(8) std::uint8_t storage[28];
+  };
+
+  /** @brief A datagram received from or to be sent to a peer */
+  struct datagram
   {
+    buffer_slice payload;
+    datagram_address peer;
+
+    /**
+     * @brief Bytes of each datagram the payload is split into on sending,
+     * or 0 to send the payload as a single datagram
+     *
+     * A payload of many datagrams to the same peer is passed down to the
+     * system as a whole, which splits it as late as possible, e.g. by
+     * generic segmentation offload. Datagrams received are never split.
+     */
+    std::uint16_t segment_size;
+  };
 
+  /**
+   * @brief A datagram socket, receiving and sending datagrams in batches
+   *
+   * Payloads received in a batch are slices of a buffer shared among them,
+   * and the buffer is released once all of them are destroyed. They are
+   * not copied, unless the implementation copies a batch much smaller
+   * than the buffer it's received into, so it's not pinned by the batch.
+   */
+  class LANXC_CORE_EXPORT datagram_endpoint
+  {
+  public:
+    using pointer = std::shared_ptr<datagram_endpoint>;
+
+    virtual ~datagram_endpoint() = 0;
+
+    /**
+     * @brief Receive a batch of datagrams, resolved once some arrive
+     * @note Only one receiving may be pending at a time
+     */
+    virtual future<std::vector<datagram>> receive() = 0;
+
+    /**
+     * @brief Receive a batch of datagrams without waiting
+     * @return Number of datagrams appended to @p datagrams, 0 if none
+     */
+    virtual std::size_t receive(std::vector<datagram> &datagrams) = 0;
+
+    /**
+     * @brief Send datagrams right away as far as the socket buffer allows,
+     * and queue the rest until the socket is writable again
+     * @return Number of datagrams sent right away, including those queued
+     * earlier, and counting each segment of a payload
+     */
+    virtual std::size_t send(std::vector<datagram> datagrams) = 0;
+
+    /** @brief Number of datagrams queued to send */
+    virtual std::size_t queued() const noexcept = 0;
+
+    /** @brief A future resolved once datagrams queued are all sent */
+    virtual future<> flush() = 0;
+
+    /**
+     * @brief Parse a numeric address to send datagrams to
+     * @throw std::system_error if @p address is invalid
+     */
+    virtual datagram_address resolve(std::string address,
+                                     std::uint16_t port) const = 0;
   };
 
-  class datagram_endpoint_builder
+  class LANXC_CORE_EXPORT datagram_endpoint_builder
   {
+  public:
+    virtual ~datagram_endpoint_builder() = 0;
+
+    virtual std::shared_ptr<datagram_endpoint_builder>
+    bind(std::string address, std::uint16_t port) = 0;
+
+    /** @brief Set the peer of datagrams with an empty address */
+    virtual std::shared_ptr<datagram_endpoint_builder>
+    connect(std::string address, std::uint16_t port) = 0;
+
+    /** @brief Set the maximal number of datagrams per batch */
+    virtual std::shared_ptr<datagram_endpoint_builder>
+    set_batch_size(std::size_t datagrams) = 0;
+
+    /**
+     * @brief Set the maximal size of datagrams received, larger ones are
+     * dropped
+     */
+    virtual std::shared_ptr<datagram_endpoint_builder>
+    set_datagram_size(std::size_t bytes) = 0;
+
+    /**
+     * @brief Let the system coalesce datagrams received from the same
+     * peer, e.g. by generic receive offload, which are split back into
+     * datagrams without copying
+     * @note Each datagram received then takes a slot of 64KiB of the
+     * buffer received into, so a smaller batch size is preferred
+     */
+    virtual std::shared_ptr<datagram_endpoint_builder>
+    set_receive_offload(bool enabled) = 0;
 
+    virtual datagram_endpoint::pointer build() = 0;
   };
 
   class LANXC_CORE_EXPORT network_connection_context
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace lanxc
+{
+
+  /**
+   * @brief Buffer manager carving power-of-two size classes from slabs
+   *
+   * Buffers are rounded up to a power of two no less than 64 bytes, and
+   * carved from slabs mapped for their class, which are 64KiB at least and
+   * aligned to their sizes. Each thread keeps a magazine of released buffers
+   * per size class, so that most acquisitions and releases are served
+   * without any lock. A magazine exchanges half of its capacity with a
+   * shared depot when it runs empty or full. Buffers returned to the depot
+   * go back to their slabs, and a slab becoming empty is unmapped once the
+   * bytes free in the depot exceed the high watermark.
+   *
+   * Buffers larger than the maximum size class are allocated and freed
+   * directly. Magazines of a thread are moved to the depot when the thread
+   * exits, and every slab is unmapped once the manager has been destroyed
+   * and no thread caches buffers for it any more.
+   */
+  class LANXC_CORE_EXPORT slab_buffer_manager : public buffer_manager
+  {
+  public:
+    /**
+     * @param high_watermark Bytes free in the depot above which empty slabs
+     *                       are unmapped
+     * @param max_block_size Size of the largest class, rounded up to a
+     *                       power of two
+     * @param magazine_bytes Maximum bytes of each per-thread magazine,
+     *                       buffers larger than that are not cached per
+     *                       thread
+     */
+    explicit slab_buffer_manager(std::size_t high_watermark = 64 << 20,
+                                 std::size_t max_block_size = 1 << 20,
+                                 std::size_t magazine_bytes = 64 << 10);
+
+    ~slab_buffer_manager() override;
+
+    slab_buffer_manager(const slab_buffer_manager &) = delete;
+    slab_buffer_manager &operator = (const slab_buffer_manager &) = delete;
+
+    /**
+     * @brief Acquire a buffer of at least @p size bytes
+     * @throws std::bad_alloc if there is no memory
+     */
+    std::uint8_t *acquire(std::size_t size) override;
+
+    /**
+     * @brief Release a buffer acquired with the same @p size
+     * @note Releasing nullptr is a no-op
+     */
+    void release(std::uint8_t *data, std::size_t size) noexcept override;
+
+    /**
+     * @brief Bytes free in slabs of the depot, not including per-thread
+     * magazines
+     * @note The value is approximate while other threads are running
+     */
+    std::size_t cached_bytes() const noexcept;
+
+    /**
+     * @brief Bytes of slabs mapped, whether their buffers are in use or not
+     * @note The value is approximate while other threads are running
+     */
+    std::size_t mapped_bytes() const noexcept;
+
+    /**
+     * @brief Move magazines of the calling thread to the depot, and unmap
+     * every empty slab
+     */
+    void trim() noexcept;
+
+    /** @brief Size of the buffer actually acquired for @p size bytes */
+    std::size_t block_size(std::size_t size) const noexcept;
+
+  private:
+    struct state;
+    struct thread_cache;
+    struct registry;
+
+    static thread_cache &get_cache(const std::shared_ptr<state> &s);
+
+    std::shared_ptr<state> _state;
+  };
+
+}
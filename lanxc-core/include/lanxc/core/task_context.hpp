@@ -37,7 +37,7 @@ namespace lanxc
     virtual void execute() = 0;
   };
 
-  class LANXC_CORE_EXPORT alarm : protected virtual deferred
+  class LANXC_CORE_EXPORT alarm : public virtual deferred
   {
     friend class task_context;
   public:
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lanxc
+{
+
+  /**
+   * @brief Encoding of integers as unsigned LEB128, i.e. varint of
+   * protocol buffers, and zigzag mapping of signed integers
+   */
+  struct varint
+  {
+    /** @brief Bytes of a varint at most */
+    static constexpr std::size_t max_size = 10;
+
+    /** @brief Bytes of the minimal encoding of @p v */
+    static std::size_t size(std::uint64_t v) noexcept
+    {
+      // 7 bits per byte, ceil(bits / 7) without division
+      unsigned bits = 64 - static_cast<unsigned>(__builtin_clzll(v | 1));
+      return (bits * 9 + 64) / 64;
+    }
+
+    /**
+     * @brief Encode @p v to @p out, which has room of @ref max_size bytes
+     * at least
+     * @returns The end of bytes encoded
+     *
+     * Apart from small values, all @ref max_size bytes are written with
+     * continuation bits regardless of the length, which is then marked by
+     * clearing the bit of the last byte, so no branch depends on the
+     * length of varint.
+     */
+    static std::uint8_t *encode(std::uint8_t *out, std::uint64_t v) noexcept
+    {
+      if (v < 0x80)
+      {
+        *out = static_cast<std::uint8_t>(v);
+        return out + 1;
+      }
+      for (std::size_t i = 0; i < max_size; i++)
+        out[i] = static_cast<std::uint8_t>((v >> (7 * i)) | 0x80);
+      std::size_t n = size(v);
+      out[n - 1] &= 0x7f;
+      return out + n;
+    }
+
+    /**
+     * @brief Decode a varint from @p size bytes at @p data
+     * @returns The end of bytes decoded, or nullptr if the bytes are
+     * incomplete, or the varint is malformed, i.e. longer than @ref
+     * max_size bytes or beyond 64 bits
+     */
+    static const std::uint8_t *
+    decode(const std::uint8_t *data, std::size_t size,
+           std::uint64_t &v) noexcept
+    {
+      if (size != 0 && data[0] < 0x80)
+      {
+        v = data[0];
+        return data + 1;
+      }
+      std::uint64_t result = 0;
+      std::size_t limit = size < max_size ? size : max_size;
+      for (std::size_t i = 0; i < limit; i++)
+      {
+        std::uint64_t byte = data[i];
+        result |= (byte & 0x7f) << (7 * i);
+        if (byte < 0x80)
+        {
+          if (i == max_size - 1 && byte > 1)
+            return nullptr;
+          v = result;
+          return data + i + 1;
+        }
+      }
+      return nullptr;
+    }
+
+    /** @brief Map signed integers to unsigned ones, small magnitude first */
+    static std::uint64_t zigzag(std::int64_t v) noexcept
+    {
+      return (static_cast<std::uint64_t>(v) << 1)
+             ^ static_cast<std::uint64_t>(v >> 63);
+    }
+
+    static std::int64_t unzigzag(std::uint64_t v) noexcept
+    {
+      return static_cast<std::int64_t>(v >> 1)
+             ^ -static_cast<std::int64_t>(v & 1);
+    }
+  };
+
+}
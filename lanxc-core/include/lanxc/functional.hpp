@@ -48,6 +48,8 @@ namespace lanxc
   template<>
     struct less<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr bool operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs < rhs))
@@ -65,6 +67,8 @@ namespace lanxc
   template<>
     struct greater<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr bool operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs > rhs))
@@ -82,6 +86,8 @@ namespace lanxc
   template<>
     struct less_equal<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr bool operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs <= rhs))
@@ -99,6 +105,8 @@ namespace lanxc
   template<>
     struct greater_equal<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr bool operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs >= rhs))
@@ -116,6 +124,8 @@ namespace lanxc
   template<>
     struct equals_to<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr bool operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs == rhs))
@@ -133,6 +143,8 @@ namespace lanxc
   template<>
     struct not_equals_to<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr bool operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs != rhs))
@@ -150,6 +162,8 @@ namespace lanxc
   template<>
     struct plus<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs + rhs))
@@ -169,6 +183,8 @@ namespace lanxc
   template<>
     struct minus<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs - rhs))
@@ -187,6 +203,8 @@ namespace lanxc
   template<>
     struct multiplies<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs * rhs))
@@ -205,6 +223,8 @@ namespace lanxc
   template<>
     struct devides<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs / rhs))
@@ -223,6 +243,8 @@ namespace lanxc
   template<>
     struct modules<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs % rhs))
@@ -241,6 +263,8 @@ namespace lanxc
   template<>
     struct negate<void>
     {
+      using is_transparent = void;
+
       template<typename T>
       constexpr auto operator () (const T &x)
         const noexcept(noexcept(-x))
@@ -260,6 +284,8 @@ namespace lanxc
   template<>
     struct logical_and<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs && rhs))
@@ -278,6 +304,8 @@ namespace lanxc
   template<>
     struct logical_or<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs || rhs))
@@ -296,6 +324,8 @@ namespace lanxc
   template<>
     struct logical_not<void>
     {
+      using is_transparent = void;
+
       template<typename T>
       constexpr auto operator () (const T &x)
         const noexcept(noexcept(!x))
@@ -314,6 +344,8 @@ namespace lanxc
   template<>
     struct bit_and<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs & rhs))
@@ -332,6 +364,8 @@ namespace lanxc
   template<>
     struct bit_or<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs | rhs))
@@ -350,6 +384,8 @@ namespace lanxc
   template<>
     struct bit_xor<void>
     {
+      using is_transparent = void;
+
       template<typename LeftType, typename RightType>
       constexpr auto operator () (const LeftType &lhs, const RightType &rhs)
         const noexcept(noexcept(lhs ^ rhs))
@@ -20,5 +20,6 @@
  * @defgroup intrusive_data_structure Intrusive Data Structure
  */
 
+#include <lanxc/link/art.hpp>
 #include <lanxc/link/list.hpp>
 #include <lanxc/link/rbtree.hpp>
@@ -0,0 +1,848 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include "art_node.hpp"
+
+#include <new>
+
+namespace lanxc
+{
+  namespace link
+  {
+
+    /**
+     * @brief Intrusive adaptive radix tree
+     * @tparam Key Type of key, which must have a specialization of @ref
+     * art_key
+     * @tparam Node Type of node, which should derive from @ref art_node
+     * @tparam Tag Tag for the tree
+     * @ingroup intrusive_art
+     *
+     * Keys are unique in the tree, and lookup costs time proportional to the
+     * length of key instead of the logarithm of the size of tree. Inner
+     * nodes adapt their fan-out to the number of children as Node4, Node16,
+     * Node48 and Node256, and are allocated via the allocator of @ref
+     * art_config.
+     *
+     * Besides exact matching, @ref longest_prefix_match finds the node whose
+     * key is the longest prefix of a given key, such as the route of an IP
+     * address, where routes are keyed by @ref art_prefix.
+     */
+    template<typename Key, typename Node, typename Tag>
+    class art
+    {
+      template<typename, typename, typename>
+      friend class art_node;
+
+      using detail = art_node<void, void>;
+      using hook = art_node<Key, Node, Tag>;
+      using config = art_config<Tag>;
+      using entry = detail::entry;
+      using leaf_entry = detail::leaf_entry;
+      using inner = detail::inner;
+
+    public:
+      using key_type = Key;
+      using value_type = Node;
+      using size_type = std::size_t;
+      using reference = Node &;
+      using const_reference = const Node &;
+      using pointer = Node *;
+      using const_pointer = const Node *;
+
+      art() noexcept = default;
+
+      ~art() noexcept
+      { clear(); }
+
+      art(art &&other) noexcept
+      { swap(other); }
+
+      art &operator = (art &&other) noexcept
+      {
+        swap(other);
+        return *this;
+      }
+
+      art(const art &) = delete;
+      art &operator = (const art &) = delete;
+
+      bool empty() const noexcept
+      { return m_container.m_root == nullptr; }
+
+      size_type size() const noexcept
+      { return m_container.m_size; }
+
+      /** @brief Swap content with another tree */
+      void swap(art &other) noexcept
+      {
+        std::swap(m_container.m_root, other.m_container.m_root);
+        std::swap(m_container.m_size, other.m_container.m_size);
+        if (m_container.m_root)
+          m_container.m_root->m_parent = &m_container;
+        if (other.m_container.m_root)
+          other.m_container.m_root->m_parent = &other.m_container;
+      }
+
+      /**
+       * @brief Insert @p node with default insert policy
+       * @see insert(reference, Policy)
+       */
+      pointer insert(reference node)
+      { return insert(node, typename config::default_insert_policy()); }
+
+      /**
+       * @brief Insert @p node, the node with the same key, if any, is
+       * unlinked and replaced by @p node
+       * @returns pointer to @p node
+       * @throws Anything the allocator throws, @p node is left unlinked
+       */
+      pointer insert(reference node, index_policy::unique)
+      {
+        auto *conflict = insert_leaf(node);
+        if (conflict != nullptr)
+          detail::replace(conflict, static_cast<hook *>(&node));
+        return &node;
+      }
+
+      /**
+       * @brief Insert @p node, unless there is a node with the same key
+       * @returns pointer to @p node if it's inserted, otherwise pointer to
+       * the node which has the same key
+       * @throws Anything the allocator throws, @p node is left unlinked
+       */
+      pointer insert(reference node, index_policy::conflict)
+      {
+        auto *conflict = insert_leaf(node);
+        if (conflict != nullptr)
+          return get_node(conflict);
+        return &node;
+      }
+
+      /**
+       * @brief Find the node whose key equals to @p key
+       * @param key The key, whose type may differ from @p Key as long as
+       * they're represented consistently by @ref art_key
+       * @returns pointer to the node found, or nullptr if not found
+       */
+      template<typename K>
+      pointer find(const K &key) noexcept
+      { return get_node(find_leaf(make_key(key))); }
+
+      template<typename K>
+      const_pointer find(const K &key) const noexcept
+      { return get_node(find_leaf(make_key(key))); }
+
+      /**
+       * @brief Find the node whose key is the longest prefix of @p key,
+       * including the key itself
+       * @returns pointer to the node found, or nullptr if not found
+       */
+      template<typename K>
+      pointer longest_prefix_match(const K &key) noexcept
+      { return get_node(match_leaf(make_key(key))); }
+
+      template<typename K>
+      const_pointer longest_prefix_match(const K &key) const noexcept
+      { return get_node(match_leaf(make_key(key))); }
+
+      /**
+       * @brief Unlink the node whose key equals to @p key
+       * @returns whether such a node was found
+       */
+      template<typename K>
+      bool erase(const K &key) noexcept
+      {
+        auto *p = find(key);
+        if (p == nullptr)
+          return false;
+        p->hook::unlink();
+        return true;
+      }
+
+      /** @brief Unlink @p node from this tree */
+      void erase(reference node) noexcept
+      { node.hook::unlink(); }
+
+      /** @brief Unlink all nodes and release inner nodes */
+      void clear() noexcept
+      {
+        if (m_container.m_root)
+          destroy(m_container.m_root);
+        m_container.m_root = nullptr;
+        m_container.m_count = 0;
+        m_container.m_size = 0;
+      }
+
+      /**
+       * @brief Call @p f with each node in this tree
+       *
+       * Integer and byte string keys are visited in ascending order. Among
+       * @ref art_prefix keys, each prefix is visited before the longer ones
+       * that it covers.
+       * @note @p f must not link or unlink nodes of this tree
+       */
+      template<typename F>
+      void for_each(F &&f)
+      {
+        if (m_container.m_root)
+          visit(m_container.m_root, f);
+      }
+
+    private:
+
+      /**
+       * @brief Integers are looked up as @p Key if it's also an integer, so
+       * that their representations are of the same width
+       */
+      template<typename K, typename T = typename std::decay<K>::type>
+      using key_of_type = art_key<typename std::conditional<
+          std::is_integral<T>::value && std::is_integral<Key>::value,
+          Key, T>::type>;
+
+      template<typename K>
+      static key_of_type<K> make_key(const K &key) noexcept
+      { return key_of_type<K>(key_cast(key)); }
+
+      template<typename K>
+      static auto key_cast(const K &key) noexcept
+      -> typename std::enable_if<std::is_integral<K>::value
+                                 && std::is_integral<Key>::value, Key>::type
+      { return static_cast<Key>(key); }
+
+      template<typename K>
+      static auto key_cast(const K &key) noexcept
+      -> typename std::enable_if<!std::is_integral<K>::value
+                                 || !std::is_integral<Key>::value,
+                                 const K &>::type
+      { return key; }
+
+      static art_key<Key> key_of(const leaf_entry *l) noexcept
+      { return art_key<Key>(static_cast<const hook *>(l)->m_key); }
+
+      static pointer get_node(leaf_entry *l) noexcept
+      {
+        if (l == nullptr) return nullptr;
+        return static_cast<pointer>(static_cast<hook *>(l));
+      }
+
+      static const_pointer get_node(const leaf_entry *l) noexcept
+      {
+        if (l == nullptr) return nullptr;
+        return static_cast<const_pointer>(static_cast<const hook *>(l));
+      }
+
+      template<typename T>
+      static inner *allocate()
+      {
+        typename config::template allocator<T> a;
+        T *p = a.allocate(1);
+        return new (p) T();
+      }
+
+      template<typename T>
+      static void deallocate(inner *n) noexcept
+      {
+        typename config::template allocator<T> a;
+        T *p = static_cast<T *>(n);
+        p->~T();
+        a.deallocate(p, 1);
+      }
+
+      static void deallocate(inner *n) noexcept
+      {
+        switch (n->m_type)
+        {
+        case detail::type_node4: deallocate<detail::node4>(n); break;
+        case detail::type_node16: deallocate<detail::node16>(n); break;
+        case detail::type_node48: deallocate<detail::node48>(n); break;
+        default: deallocate<detail::node256>(n); break;
+        }
+      }
+
+      /** @brief Allocate an inner node of @p type */
+      static inner *allocate(std::uint8_t type)
+      {
+        switch (type)
+        {
+        case detail::type_node4: return allocate<detail::node4>();
+        case detail::type_node16: return allocate<detail::node16>();
+        case detail::type_node48: return allocate<detail::node48>();
+        default: return allocate<detail::node256>();
+        }
+      }
+
+      template<std::uint16_t N>
+      static detail::chain *allocate_chain()
+      {
+        typename config::template allocator<detail::chain_of<N>> a;
+        auto *p = a.allocate(1);
+        return new (p) detail::chain_of<N>();
+      }
+
+      template<std::uint16_t N>
+      static void deallocate_chain(detail::chain *c) noexcept
+      {
+        typename config::template allocator<detail::chain_of<N>> a;
+        auto *p = static_cast<detail::chain_of<N> *>(c);
+        p->~chain_of();
+        a.deallocate(p, 1);
+      }
+
+      /** @brief Allocate a chain of one of capacities 2, 8, 32 and 255 */
+      static detail::chain *allocate_chain(std::uint16_t capacity)
+      {
+        switch (capacity)
+        {
+        case 2: return allocate_chain<2>();
+        case 8: return allocate_chain<8>();
+        case 32: return allocate_chain<32>();
+        default: return allocate_chain<255>();
+        }
+      }
+
+      static void deallocate_chain(detail::chain *c) noexcept
+      {
+        switch (c->m_capacity)
+        {
+        case 2: deallocate_chain<2>(c); break;
+        case 8: deallocate_chain<8>(c); break;
+        case 32: deallocate_chain<32>(c); break;
+        default: deallocate_chain<255>(c); break;
+        }
+      }
+
+      /** @brief Replace chain of @p n with a new one of @p capacity */
+      static void resize_chain(inner *n, std::uint16_t capacity)
+      {
+        detail::chain *c = allocate_chain(capacity);
+        if (n->m_chain)
+        {
+          detail::chain_copy(c, n->m_chain);
+          deallocate_chain(n->m_chain);
+        }
+        n->m_chain = c;
+      }
+
+      /** @brief Ensure that chain of @p n has room for another key */
+      static void reserve_chain(inner *n)
+      {
+        if (n->m_chain == nullptr)
+          resize_chain(n, 2);
+        else if (n->m_chain->m_count == n->m_chain->m_capacity)
+          resize_chain(n, n->m_chain->m_capacity == 2 ? 8
+                          : n->m_chain->m_capacity == 8 ? 32 : 255);
+      }
+
+      /** @brief Release chain of @p n if it's empty, or shrink it */
+      static void trim_chain(inner *n) noexcept
+      {
+        detail::chain *c = n->m_chain;
+        if (c->m_count == 0)
+        {
+          deallocate_chain(c);
+          n->m_chain = nullptr;
+          return;
+        }
+        std::uint16_t smaller = c->m_capacity == 255 ? 32
+                              : c->m_capacity == 32 ? 8 : 2;
+        if (c->m_count <= smaller / 2)
+        {
+          try
+          {
+            resize_chain(n, smaller);
+          }
+          catch (...)
+          {
+            // Keep the larger chain if there is no memory for a smaller one
+          }
+        }
+      }
+
+      /** @brief Move header and children of @p n to @p to, then free @p n */
+      static void move_node(inner *n, inner *to) noexcept
+      {
+        detail::copy_header(to, n);
+        detail::for_each_child(n, [to](std::uint8_t c, entry *e)
+        { detail::add_child(to, c, e); });
+        n->m_count = 0;
+        n->m_chain = nullptr;
+        detail::replace(n, to);
+        deallocate(n);
+      }
+
+      /**
+       * @brief Initialize a new inner node @p m which dispatches on byte
+       * @p depth, with the path since byte @p start taken from @p key
+       */
+      template<typename K>
+      static void init_node(inner *m, std::size_t start, std::size_t depth,
+                            const K &key) noexcept
+      {
+        m->m_depth = static_cast<std::uint32_t>(depth);
+        set_prefix(m, start, key.data());
+      }
+
+      static void set_prefix(inner *m, std::size_t start,
+                             const std::uint8_t *bytes) noexcept
+      {
+        std::size_t len = m->m_depth - start;
+        m->m_prefix_len = static_cast<std::uint32_t>(len);
+        std::memcpy(m->m_prefix, bytes + start,
+                    len < detail::max_prefix ? len : detail::max_prefix);
+      }
+
+      /** @brief Reload the stored path of @p n from a leaf under it */
+      static void reload_prefix(inner *n) noexcept
+      {
+        auto key = key_of(detail::any_leaf(n));
+        set_prefix(n, detail::child_depth(n->m_parent), key.data());
+      }
+
+      /** @brief Link @p l into chain of @p n as index @p i */
+      static void link_chain(inner *n, leaf_entry *l, std::uint8_t i) noexcept
+      {
+        detail::chain_add(n->m_chain, i, l);
+        l->m_parent = n;
+        l->m_byte = i;
+        l->m_position = detail::in_chain;
+      }
+
+      /** @brief Test if @p key ends inside the dispatching byte of @p n */
+      template<typename K>
+      static bool ends_in(const inner *n, const K &key) noexcept
+      { return key.bits() < 8 * (n->m_depth + 1); }
+
+      /**
+       * @brief Link leaf @p l to inner node @p n, which is ensured to have
+       * room for it and has no key equals to @p key
+       */
+      template<typename K>
+      static void place(inner *n, leaf_entry *l, const K &key) noexcept
+      {
+        if (ends_in(n, key))
+          link_chain(n, l, detail::chain_index(key.data(), key.bits(),
+                                               n->m_depth));
+        else
+          detail::add_child(n, key.data()[n->m_depth], l);
+      }
+
+      /**
+       * @brief Allocate a node4 dispatching on byte @p depth, which has room
+       * in chain for keys ending there
+       */
+      template<typename K>
+      static inner *allocate_split(std::size_t start, std::size_t depth,
+                                   const K &key, bool need_chain)
+      {
+        inner *m = allocate(detail::type_node4);
+        init_node(m, start, depth, key);
+        if (need_chain)
+        {
+          try
+          {
+            resize_chain(m, 2);
+          }
+          catch (...)
+          {
+            deallocate(m);
+            throw;
+          }
+        }
+        return m;
+      }
+
+      /**
+       * @brief Count bytes of path to @p n matched by @p key since byte
+       * @p depth
+       */
+      template<typename K>
+      static std::size_t match_prefix(inner *n, const K &key,
+                                      std::size_t depth) noexcept
+      {
+        std::size_t avail = key.bits() / 8;
+        std::size_t len = n->m_prefix_len;
+        std::size_t i = 0;
+        std::size_t stored = len < detail::max_prefix
+                           ? len : detail::max_prefix;
+        for ( ; i < stored; i++)
+          if (depth + i >= avail || n->m_prefix[i] != key.data()[depth + i])
+            return i;
+        if (i < len)
+        {
+          auto lk = key_of(detail::any_leaf(n));
+          for ( ; i < len; i++)
+            if (depth + i >= avail
+                || lk.data()[depth + i] != key.data()[depth + i])
+              return i;
+        }
+        return len;
+      }
+
+      /**
+       * @brief Link @p node into this tree
+       * @returns the leaf with the same key which is left untouched, or
+       * nullptr if @p node is linked
+       */
+      leaf_entry *insert_leaf(hook &node)
+      {
+        node.unlink();
+        leaf_entry *l = &node;
+        auto key = key_of(l);
+        const std::uint8_t *bytes = key.data();
+        const std::size_t bits = key.bits();
+
+        std::size_t depth = 0;
+        entry *p = m_container.m_root;
+
+        if (p == nullptr)
+        {
+          detail::add_child(&m_container, 0, l);
+          ++m_container.m_size;
+          return nullptr;
+        }
+
+        for ( ; ; )
+        {
+          if (p->m_type == detail::type_leaf)
+          {
+            auto *x = static_cast<leaf_entry *>(p);
+            auto xk = key_of(x);
+            if (art_key<void>::equals(xk.data(), xk.bits(), bytes, bits))
+              return x;
+
+            // Split the leaf with a new node dispatching on the first
+            // byte where the two keys differ or either key ends
+            std::size_t limit = (xk.bits() < bits ? xk.bits() : bits) / 8;
+            std::size_t d = depth;
+            while (d < limit && xk.data()[d] == bytes[d]) d++;
+            bool need_chain = xk.bits() < 8 * (d + 1) || bits < 8 * (d + 1);
+            inner *m = allocate_split(depth, d, key, need_chain);
+            detail::replace(x, m);
+            place(m, x, xk);
+            place(m, l, key);
+            break;
+          }
+
+          auto *n = static_cast<inner *>(p);
+          std::size_t matched = match_prefix(n, key, depth);
+          if (matched < n->m_prefix_len)
+          {
+            // Split the path with a new node at the first mismatched byte
+            std::uint8_t c = matched < detail::max_prefix
+                ? n->m_prefix[matched]
+                : key_of(detail::any_leaf(n)).data()[depth + matched];
+            std::size_t d = depth + matched;
+            inner *m = allocate_split(depth, d, key, bits < 8 * (d + 1));
+            detail::replace(n, m);
+            detail::add_child(m, c, n);
+            reload_prefix(n);
+            place(m, l, key);
+            break;
+          }
+
+          depth = n->m_depth;
+          if (bits < 8 * (depth + 1))
+          {
+            // The path is verified, so keys of the same index are equal
+            std::uint8_t i = detail::chain_index(bytes, bits, depth);
+            if (n->m_chain && detail::chain_test(n->m_chain, i))
+              return *detail::chain_find(n->m_chain, i);
+            reserve_chain(n);
+            link_chain(n, l, i);
+            break;
+          }
+
+          entry **slot = detail::find_child(n, bytes[depth]);
+          if (slot == nullptr)
+          {
+            if (detail::is_full(n))
+            {
+              inner *g = allocate(static_cast<std::uint8_t>(n->m_type + 1));
+              move_node(n, g);
+              n = g;
+            }
+            detail::add_child(n, bytes[depth], l);
+            break;
+          }
+
+          p = *slot;
+          depth++;
+        }
+        ++m_container.m_size;
+        return nullptr;
+      }
+
+      template<typename K>
+      const leaf_entry *find_leaf(const K &key) const noexcept
+      {
+        const std::uint8_t *bytes = key.data();
+        const std::size_t bits = key.bits();
+        const std::size_t avail = bits / 8;
+        const entry *p = m_container.m_root;
+        std::size_t depth = 0;
+
+        while (p != nullptr)
+        {
+          if (p->m_type == detail::type_leaf)
+          {
+            auto *l = static_cast<const leaf_entry *>(p);
+            auto lk = key_of(l);
+            return art_key<void>::equals(lk.data(), lk.bits(), bytes, bits)
+                   ? l : nullptr;
+          }
+
+          auto *n = static_cast<const inner *>(p);
+          std::size_t len = n->m_prefix_len;
+          if (depth + len > avail)
+            return nullptr;
+          std::size_t stored = len < detail::max_prefix
+                             ? len : detail::max_prefix;
+          for (std::size_t i = 0; i < stored; i++)
+            if (n->m_prefix[i] != bytes[depth + i])
+              return nullptr;
+
+          depth = n->m_depth;
+          if (bits < 8 * (depth + 1))
+          {
+            if (n->m_chain == nullptr)
+              return nullptr;
+            auto *slot = detail::chain_find(
+                n->m_chain, detail::chain_index(bytes, bits, depth));
+            if (slot == nullptr)
+              return nullptr;
+            auto lk = key_of(*slot);
+            return art_key<void>::equals(lk.data(), lk.bits(), bytes, bits)
+                   ? *slot : nullptr;
+          }
+
+          auto *slot = detail::find_child(n, bytes[depth]);
+          if (slot == nullptr)
+            return nullptr;
+          p = *slot;
+          depth++;
+        }
+        return nullptr;
+      }
+
+      template<typename K>
+      leaf_entry *find_leaf(const K &key) noexcept
+      {
+        const art *self = this;
+        return const_cast<leaf_entry *>(self->find_leaf(key));
+      }
+
+      template<typename K>
+      const leaf_entry *match_leaf(const K &key) const noexcept
+      {
+        const std::uint8_t *bytes = key.data();
+        const std::size_t bits = key.bits();
+        const std::size_t avail = bits / 8;
+        const entry *p = m_container.m_root;
+        const leaf_entry *best = nullptr;
+        std::size_t depth = 0;
+
+        while (p != nullptr)
+        {
+          if (p->m_type == detail::type_leaf)
+          {
+            auto *l = static_cast<const leaf_entry *>(p);
+            auto lk = key_of(l);
+            if (art_key<void>::is_prefix(lk.data(), lk.bits(), bytes, bits))
+              best = l;
+            break;
+          }
+
+          auto *n = static_cast<const inner *>(p);
+          std::size_t len = n->m_prefix_len;
+          if (depth + len > avail)
+            break;
+          std::size_t stored = len < detail::max_prefix
+                             ? len : detail::max_prefix;
+          std::size_t i = 0;
+          while (i < stored && n->m_prefix[i] == bytes[depth + i]) i++;
+          if (i < stored)
+            break;
+
+          depth = n->m_depth;
+          if (n->m_chain)
+          {
+            // Probe prefixes of the dispatching byte from the longest one,
+            // and verify it entirely as the path beyond stored prefix is
+            // skipped, a mismatch there fails shorter ones as well
+            std::size_t r = bits - 8 * depth < 7 ? bits - 8 * depth : 7;
+            unsigned c = r == 0 ? 0 : bytes[depth];
+            for (std::size_t k = r + 1; k-- > 0; )
+            {
+              auto i = static_cast<std::uint8_t>((1u << k) | (c >> (8 - k)));
+              if (!detail::chain_test(n->m_chain, i))
+                continue;
+              auto *l = *detail::chain_find(n->m_chain, i);
+              auto lk = key_of(l);
+              if (art_key<void>::is_prefix(lk.data(), lk.bits(), bytes, bits))
+                best = l;
+              break;
+            }
+          }
+
+          if (bits < 8 * (depth + 1))
+            break;
+          auto *slot = detail::find_child(n, bytes[depth]);
+          if (slot == nullptr)
+            break;
+          p = *slot;
+          depth++;
+        }
+        return best;
+      }
+
+      template<typename K>
+      leaf_entry *match_leaf(const K &key) noexcept
+      {
+        const art *self = this;
+        return const_cast<leaf_entry *>(self->match_leaf(key));
+      }
+
+      /** @brief Unlink leaf @p l and compact the tree */
+      static void unlink(hook *h) noexcept
+      {
+        leaf_entry *l = h;
+        inner *n = l->m_parent;
+        auto *c = detail::get_container(n);
+
+        if (l->m_position == detail::in_chain)
+        {
+          detail::chain_remove(n->m_chain, l->m_byte);
+          trim_chain(n);
+        }
+        else
+          detail::remove_child(n, l->m_byte);
+        l->m_parent = nullptr;
+        --c->m_size;
+
+        compact(n);
+      }
+
+      /**
+       * @brief Restore invariants of @p n after a key is removed from it:
+       * remove it if it is empty, merge it with its only child, or shrink it
+       * to a smaller type
+       */
+      static void compact(inner *n) noexcept
+      {
+        while (n->m_type != detail::type_container)
+        {
+          inner *parent = n->m_parent;
+
+          if (n->m_count == 0 && n->m_chain == nullptr)
+          {
+            detail::remove_child(parent, n->m_byte);
+            deallocate(n);
+            n = parent;
+            continue;
+          }
+
+          entry *only = nullptr;
+          if (n->m_count == 0 && n->m_chain->m_count == 1)
+          {
+            only = detail::chain_leaves(n->m_chain)[0];
+            deallocate_chain(n->m_chain);
+            n->m_chain = nullptr;
+          }
+          else if (n->m_count == 1 && n->m_chain == nullptr)
+          {
+            only = detail::any_child(n);
+            detail::remove_child(n, only->m_byte);
+          }
+
+          if (only != nullptr)
+          {
+            // The only key of the subtree takes place of n, either as a
+            // leaf in slot, or as an inner node with longer path
+            detail::replace(n, only);
+            if (only->m_type != detail::type_leaf)
+              reload_prefix(static_cast<inner *>(only));
+            deallocate(n);
+            return;
+          }
+
+          std::uint8_t type = n->m_type;
+          if ((type == detail::type_node16 && n->m_count <= 3)
+              || (type == detail::type_node48 && n->m_count <= 12)
+              || (type == detail::type_node256 && n->m_count <= 37))
+          {
+            try
+            {
+              inner *s = allocate(static_cast<std::uint8_t>(type - 1));
+              move_node(n, s);
+            }
+            catch (...)
+            {
+              // Keep the larger node if there is no memory for a smaller one
+            }
+          }
+          return;
+        }
+      }
+
+      /** @brief Unlink all leaves under @p e and free inner nodes */
+      static void destroy(entry *e) noexcept
+      {
+        if (e->m_type == detail::type_leaf)
+        {
+          auto *l = static_cast<leaf_entry *>(e);
+          l->m_parent = nullptr;
+          return;
+        }
+        auto *n = static_cast<inner *>(e);
+        if (n->m_chain)
+        {
+          leaf_entry **leaves = detail::chain_leaves(n->m_chain);
+          for (std::size_t i = 0; i < n->m_chain->m_count; i++)
+            leaves[i]->m_parent = nullptr;
+          deallocate_chain(n->m_chain);
+        }
+        detail::for_each_child(n, [](std::uint8_t, entry *c)
+        { destroy(c); });
+        deallocate(n);
+      }
+
+      template<typename F>
+      static void visit(entry *e, F &f)
+      {
+        if (e->m_type == detail::type_leaf)
+        {
+          f(*get_node(static_cast<leaf_entry *>(e)));
+          return;
+        }
+        auto *n = static_cast<inner *>(e);
+        if (n->m_chain)
+        {
+          leaf_entry **leaves = detail::chain_leaves(n->m_chain);
+          for (std::size_t i = 0; i < n->m_chain->m_count; i++)
+            f(*get_node(leaves[i]));
+        }
+        detail::for_each_child(n, [&f](std::uint8_t, entry *c)
+        { visit(c, f); });
+      }
+
+      detail::container m_container;
+    };
+
+  }
+}
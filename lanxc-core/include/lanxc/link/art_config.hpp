@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include "art_define.hpp"
+#include "rbtree_define.hpp"
+
+#include <memory>
+
+namespace lanxc
+{
+  namespace link
+  {
+
+    /**
+     * @brief Adaptive radix tree default configuration
+     * @ingroup intrusive_art
+     */
+    template<>
+    class art_config<void>
+    {
+    public:
+      /**
+       * @brief Allocator adapter for inner nodes
+       * @note Unlike rbtree, inner nodes of an adaptive radix tree are not
+       *       embedded in user's nodes, and they are allocated via this
+       *       allocator when the tree grows
+       */
+      template<typename T> using allocator = std::allocator<T>;
+
+      /**
+       * @brief Default policy for insert, either index_policy::unique or
+       * index_policy::conflict, since keys in the tree are always unique
+       */
+      using default_insert_policy = index_policy::unique;
+    };
+
+    template<typename Tag>
+    class art_config : public art_config<void>
+    { };
+
+  }
+}
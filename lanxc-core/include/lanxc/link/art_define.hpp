@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+/**
+ *  @defgroup intrusive_art Intrusive Adaptive Radix Tree
+ *  @ingroup intrusive_data_structure
+ */
+
+#include <cstddef>
+
+namespace lanxc
+{
+  namespace link
+  {
+
+    template<typename Tag>
+    class art_config;
+
+    template<typename Key, typename = void>
+    class art_key;
+
+    template<std::size_t Size>
+    struct art_prefix;
+
+    template<typename Key, typename Node, typename Tag = void>
+    class art_node;
+
+    template<typename Key, typename Node, typename Tag = void>
+    class art;
+
+  }
+}
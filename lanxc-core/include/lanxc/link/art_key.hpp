@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include "art_define.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace lanxc
+{
+  namespace link
+  {
+
+    /**
+     * @brief A prefix of @p Size bytes address, e.g. an IPv4 or IPv6 route
+     * @ingroup intrusive_art
+     *
+     * Bits of address beyond @ref length are ignored.
+     */
+    template<std::size_t Size>
+    struct art_prefix
+    {
+      /** @brief The address in network byte order */
+      std::uint8_t address[Size];
+
+      /** @brief Length of prefix in bits */
+      std::size_t length;
+    };
+
+    /**
+     * @brief Binary comparable representation of keys of type @p Key
+     * @ingroup intrusive_art
+     *
+     * A key is represented as a sequence of bits, exposed via `data()` and
+     * `bits()`, where bits in the last byte beyond `bits()` must be zero.
+     * Specialize it to use other types as key of @ref art, and keys of
+     * different types may be used to lookup each other as long as their
+     * representations are consistent.
+     */
+    template<>
+    class art_key<void>
+    {
+    public:
+      /** @brief Test if @p Key is a sequence of bytes like `std::string` */
+      template<typename Key, typename = void>
+      struct is_byte_sequence : std::false_type
+      { };
+
+      template<typename Key>
+      struct is_byte_sequence<Key, decltype(void(
+          std::declval<const Key &>().size()), void(
+          std::declval<const Key &>().data()))>
+      {
+        static constexpr bool value =
+            sizeof(*std::declval<const Key &>().data()) == 1;
+      };
+
+      /** @brief Test if first @p lbits of @p l equals @p r */
+      static bool equals(const std::uint8_t *l, std::size_t lbits,
+                         const std::uint8_t *r, std::size_t rbits) noexcept
+      {
+        return lbits == rbits && std::memcmp(l, r, (lbits + 7) / 8) == 0;
+      }
+
+      /** @brief Test if key @p p is a prefix of key @p k */
+      static bool is_prefix(const std::uint8_t *p, std::size_t pbits,
+                            const std::uint8_t *k, std::size_t kbits) noexcept
+      {
+        if (pbits > kbits || std::memcmp(p, k, pbits / 8) != 0)
+          return false;
+        if (pbits % 8 == 0)
+          return true;
+        unsigned mask = (0xff00u >> (pbits % 8)) & 0xffu;
+        return ((p[pbits / 8] ^ k[pbits / 8]) & mask) == 0;
+      }
+    };
+
+    /**
+     * @brief Integers are represented in big-endian, with the sign bit of
+     * signed integers flipped, so that they are ordered as numbers
+     */
+    template<typename Key>
+    class art_key<Key,
+        typename std::enable_if<std::is_integral<Key>::value>::type>
+    {
+      using unsigned_type = typename std::make_unsigned<Key>::type;
+    public:
+      explicit art_key(Key key) noexcept
+      {
+        auto v = static_cast<unsigned_type>(key);
+        if (std::is_signed<Key>::value)
+          v ^= static_cast<unsigned_type>(
+              static_cast<unsigned_type>(1) << (sizeof(Key) * 8 - 1));
+        for (std::size_t i = sizeof(Key); i-- > 0; )
+        {
+          m_bytes[i] = static_cast<std::uint8_t>(v);
+          v = static_cast<unsigned_type>(v >> 4 >> 4);
+        }
+      }
+
+      const std::uint8_t *data() const noexcept
+      { return m_bytes; }
+
+      std::size_t bits() const noexcept
+      { return sizeof(Key) * 8; }
+
+    private:
+      std::uint8_t m_bytes[sizeof(Key)];
+    };
+
+    /**
+     * @brief Byte sequences like `std::string` are represented as is
+     * @note The key refers to the storage of the byte sequence rather than
+     * copying it
+     */
+    template<typename Key>
+    class art_key<Key, typename std::enable_if<
+        art_key<void>::is_byte_sequence<Key>::value>::type>
+    {
+    public:
+      explicit art_key(const Key &key) noexcept
+          : m_data(reinterpret_cast<const std::uint8_t *>(key.data()))
+          , m_size(key.size())
+      { }
+
+      const std::uint8_t *data() const noexcept
+      { return m_data; }
+
+      std::size_t bits() const noexcept
+      { return m_size * 8; }
+
+    private:
+      const std::uint8_t *m_data;
+      std::size_t m_size;
+    };
+
+    /** @brief Null-terminated strings are represented without terminator */
+    template<>
+    class art_key<const char *>
+    {
+    public:
+      explicit art_key(const char *key) noexcept
+          : m_data(reinterpret_cast<const std::uint8_t *>(key))
+          , m_size(std::strlen(key))
+      { }
+
+      const std::uint8_t *data() const noexcept
+      { return m_data; }
+
+      std::size_t bits() const noexcept
+      { return m_size * 8; }
+
+    private:
+      const std::uint8_t *m_data;
+      std::size_t m_size;
+    };
+
+    template<>
+    class art_key<char *> : public art_key<const char *>
+    {
+    public:
+      using art_key<const char *>::art_key;
+    };
+
+    /**
+     * @brief Prefixes are represented by their leading @ref
+     * art_prefix::length bits
+     */
+    template<std::size_t Size>
+    class art_key<art_prefix<Size>>
+    {
+    public:
+      explicit art_key(const art_prefix<Size> &key) noexcept
+          : m_bits(key.length < Size * 8 ? key.length : Size * 8)
+      {
+        std::memcpy(m_bytes, key.address, Size);
+        if (m_bits % 8 != 0)
+          m_bytes[m_bits / 8] &= static_cast<std::uint8_t>(
+              0xff00u >> (m_bits % 8));
+        for (std::size_t i = (m_bits + 7) / 8; i < Size; i++)
+          m_bytes[i] = 0;
+      }
+
+      const std::uint8_t *data() const noexcept
+      { return m_bytes; }
+
+      std::size_t bits() const noexcept
+      { return m_bits; }
+
+    private:
+      std::uint8_t m_bytes[Size];
+      std::size_t m_bits;
+    };
+
+  }
+}
@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include "art_define.hpp"
+#include "art_config.hpp"
+#include "art_key.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define LANXC_ART_SSE2
+#endif
+
+namespace lanxc
+{
+  namespace link
+  {
+
+    template<>
+    class art_node<void, void>
+    {
+      template<typename, typename, typename>
+      friend class art_node;
+
+      template<typename, typename, typename>
+      friend class art;
+
+      enum : std::uint8_t
+      {
+        type_leaf, type_node4, type_node16, type_node48, type_node256,
+        type_container
+      };
+
+      /** @brief Where a leaf is linked in its parent */
+      enum : std::uint8_t
+      {
+        in_slot,  /**< In a child slot, as the only key of that subtree */
+        in_chain  /**< In the chain of parent, m_byte is the index */
+      };
+
+      /** @brief Bytes of compressed path stored in each inner node */
+      static constexpr std::size_t max_prefix = 8;
+
+      struct inner;
+
+      struct entry
+      {
+        inner *m_parent;          /**< @brief Parent, nullptr if unlinked */
+        std::uint8_t m_type;      /**< @brief Type of this entry */
+        std::uint8_t m_byte;      /**< @brief Byte of the slot in parent */
+        std::uint8_t m_position;  /**< @brief in_slot or in_chain */
+
+        explicit entry(std::uint8_t type) noexcept
+            : m_parent(nullptr), m_type(type), m_byte(0)
+            , m_position(in_slot)
+        { }
+      };
+
+      struct leaf_entry : entry
+      {
+        leaf_entry() noexcept
+            : entry(type_leaf)
+        { }
+      };
+
+      /**
+       * @brief Keys ending inside the dispatching byte of an inner node
+       *
+       * A key with `8 * depth + r` bits, where `r < 8`, is indexed by
+       * `(1 << r) | (byte >> (8 - r))` as in a complete binary tree, whose
+       * presence is marked in @ref m_bitmap, and leaves are stored in the
+       * order of index, so that every prefix of a byte is found by at most
+       * 8 probes of bitmap.
+       */
+      struct chain
+      {
+        std::uint64_t m_bitmap[4];
+        std::uint16_t m_count;
+        std::uint16_t m_capacity;
+
+        explicit chain(std::uint16_t capacity) noexcept
+            : m_bitmap(), m_count(0), m_capacity(capacity)
+        { }
+      };
+
+      template<std::uint16_t N>
+      struct chain_of : chain
+      {
+        leaf_entry *m_leaves[N];
+
+        chain_of() noexcept : chain(N), m_leaves() { }
+      };
+
+      /**
+       * @brief Common header of inner nodes
+       *
+       * An inner node dispatches on the key byte at @ref m_depth, after the
+       * @ref m_prefix_len bytes of compressed path leading to it. Only the
+       * first @ref max_prefix bytes of the path are stored, the rest are
+       * skipped while searching and verified against the key of leaf.
+       *
+       * Keys ending before the dispatching byte is complete, i.e. whose
+       * length in bits is in `[8 * m_depth, 8 * m_depth + 8)`, are stored
+       * in @ref m_chain.
+       */
+      struct inner : entry
+      {
+        std::uint16_t m_count;            /**< @brief Number of children */
+        std::uint32_t m_prefix_len;       /**< @brief Length of path */
+        std::uint32_t m_depth;            /**< @brief Dispatching byte */
+        std::uint8_t m_prefix[max_prefix];/**< @brief Leading bytes of path */
+        chain *m_chain;                   /**< @brief Keys ending here */
+
+        explicit inner(std::uint8_t type) noexcept
+            : entry(type), m_count(0), m_prefix_len(0), m_depth(0)
+            , m_prefix(), m_chain(nullptr)
+        { }
+      };
+
+      struct node4 : inner
+      {
+        std::uint8_t m_keys[4];
+        entry *m_children[4];
+
+        node4() noexcept : inner(type_node4), m_keys(), m_children() { }
+      };
+
+      struct node16 : inner
+      {
+        std::uint8_t m_keys[16];
+        entry *m_children[16];
+
+        node16() noexcept : inner(type_node16), m_keys(), m_children() { }
+      };
+
+      struct node48 : inner
+      {
+        std::uint8_t m_index[256];  /**< @brief Slot plus one, 0 for none */
+        entry *m_children[48];
+
+        node48() noexcept : inner(type_node48), m_index(), m_children() { }
+      };
+
+      struct node256 : inner
+      {
+        entry *m_children[256];
+
+        node256() noexcept : inner(type_node256), m_children() { }
+      };
+
+      /** @brief Holder of the root, at the top of each tree */
+      struct container : inner
+      {
+        entry *m_root;
+        std::size_t m_size;
+
+        container() noexcept
+            : inner(type_container), m_root(nullptr), m_size(0)
+        { }
+      };
+
+      /** @brief Index of the first key byte in the path to children of @p n */
+      static std::size_t child_depth(const inner *n) noexcept
+      { return n->m_type == type_container ? 0 : n->m_depth + 1; }
+
+      static container *get_container(inner *n) noexcept
+      {
+        while (n->m_type != type_container) n = n->m_parent;
+        return static_cast<container *>(n);
+      }
+
+      static unsigned popcount(std::uint64_t x) noexcept
+      {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+        unsigned n = 0;
+        for ( ; x != 0; x &= x - 1) n++;
+        return n;
+#endif
+      }
+
+      /**
+       * @brief Index in chain of a key of @p bits bits, which ends inside
+       * the byte at @p depth
+       */
+      static std::uint8_t chain_index(const std::uint8_t *data,
+                                      std::size_t bits,
+                                      std::size_t depth) noexcept
+      {
+        std::size_t r = bits - 8 * depth;
+        if (r == 0)
+          return 1;
+        return static_cast<std::uint8_t>((1u << r) | (data[depth] >> (8 - r)));
+      }
+
+      static leaf_entry **chain_leaves(chain *c) noexcept
+      {
+        switch (c->m_capacity)
+        {
+        case 2: return static_cast<chain_of<2> *>(c)->m_leaves;
+        case 8: return static_cast<chain_of<8> *>(c)->m_leaves;
+        case 32: return static_cast<chain_of<32> *>(c)->m_leaves;
+        default: return static_cast<chain_of<255> *>(c)->m_leaves;
+        }
+      }
+
+      static leaf_entry *const *chain_leaves(const chain *c) noexcept
+      { return chain_leaves(const_cast<chain *>(c)); }
+
+      static bool chain_test(const chain *c, std::uint8_t i) noexcept
+      { return (c->m_bitmap[i >> 6] >> (i & 63)) & 1; }
+
+      /** @brief Number of indexes less than @p i in @p c */
+      static std::size_t chain_rank(const chain *c, std::uint8_t i) noexcept
+      {
+        std::size_t rank = 0;
+        for (std::size_t w = 0; w < std::size_t(i >> 6); w++)
+          rank += popcount(c->m_bitmap[w]);
+        std::uint64_t below = (std::uint64_t(1) << (i & 63)) - 1;
+        return rank + popcount(c->m_bitmap[i >> 6] & below);
+      }
+
+      /** @brief Find the leaf of index @p i in @p c, nullptr if not found */
+      static leaf_entry *const *chain_find(const chain *c, std::uint8_t i)
+      noexcept
+      {
+        if (!chain_test(c, i))
+          return nullptr;
+        return &chain_leaves(c)[chain_rank(c, i)];
+      }
+
+      static leaf_entry **chain_find(chain *c, std::uint8_t i) noexcept
+      {
+        return const_cast<leaf_entry **>(
+            chain_find(static_cast<const chain *>(c), i));
+      }
+
+      /**
+       * @brief Add @p l as index @p i to @p c
+       * @note User is responsible to ensure @p c is not full and index @p i
+       * is absent
+       */
+      static void chain_add(chain *c, std::uint8_t i, leaf_entry *l) noexcept
+      {
+        leaf_entry **leaves = chain_leaves(c);
+        std::size_t rank = chain_rank(c, i);
+        std::memmove(leaves + rank + 1, leaves + rank,
+                     (c->m_count - rank) * sizeof(leaf_entry *));
+        leaves[rank] = l;
+        c->m_bitmap[i >> 6] |= std::uint64_t(1) << (i & 63);
+        c->m_count++;
+      }
+
+      static void chain_remove(chain *c, std::uint8_t i) noexcept
+      {
+        leaf_entry **leaves = chain_leaves(c);
+        std::size_t rank = chain_rank(c, i);
+        std::memmove(leaves + rank, leaves + rank + 1,
+                     (c->m_count - rank - 1) * sizeof(leaf_entry *));
+        c->m_bitmap[i >> 6] &= ~(std::uint64_t(1) << (i & 63));
+        c->m_count--;
+      }
+
+      /** @brief Copy content of chain @p src to @p dst */
+      static void chain_copy(chain *dst, const chain *src) noexcept
+      {
+        std::memcpy(dst->m_bitmap, src->m_bitmap, sizeof(dst->m_bitmap));
+        dst->m_count = src->m_count;
+        std::memcpy(chain_leaves(dst), chain_leaves(src),
+                    src->m_count * sizeof(leaf_entry *));
+      }
+
+      template<typename N>
+      static entry *const *find_sorted(const N *n, std::uint8_t c) noexcept
+      {
+        for (std::size_t i = 0; i < n->m_count; i++)
+          if (n->m_keys[i] == c)
+            return &n->m_children[i];
+        return nullptr;
+      }
+
+      static entry *const *find_child(const node16 *n, std::uint8_t c) noexcept
+      {
+#ifdef LANXC_ART_SSE2
+        __m128i keys = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(n->m_keys));
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(c)),
+                                     keys);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp))
+            & ((1u << n->m_count) - 1);
+        if (mask == 0)
+          return nullptr;
+        return &n->m_children[__builtin_ctz(mask)];
+#else
+        return find_sorted(n, c);
+#endif
+      }
+
+      /** @brief Find the slot for byte @p c in @p n, nullptr if not found */
+      static entry *const *find_child(const inner *n, std::uint8_t c) noexcept
+      {
+        switch (n->m_type)
+        {
+        case type_node4:
+          return find_sorted(static_cast<const node4 *>(n), c);
+        case type_node16:
+          return find_child(static_cast<const node16 *>(n), c);
+        case type_node48:
+        {
+          auto *x = static_cast<const node48 *>(n);
+          auto i = x->m_index[c];
+          return i == 0 ? nullptr : &x->m_children[i - 1];
+        }
+        case type_node256:
+        {
+          auto *x = static_cast<const node256 *>(n);
+          return x->m_children[c] == nullptr ? nullptr : &x->m_children[c];
+        }
+        default:
+        {
+          auto *x = static_cast<const container *>(n);
+          return x->m_root == nullptr ? nullptr : &x->m_root;
+        }
+        }
+      }
+
+      static entry **find_child(inner *n, std::uint8_t c) noexcept
+      {
+        return const_cast<entry **>(
+            find_child(static_cast<const inner *>(n), c));
+      }
+
+      static bool is_full(const inner *n) noexcept
+      {
+        switch (n->m_type)
+        {
+        case type_node4: return n->m_count == 4;
+        case type_node16: return n->m_count == 16;
+        case type_node48: return n->m_count == 48;
+        case type_node256: return false;
+        default: return n->m_count == 1;
+        }
+      }
+
+      /** @brief Set @p child as the child of @p n in slot @p c */
+      static void attach(inner *n, std::uint8_t c, entry *child) noexcept
+      {
+        child->m_parent = n;
+        child->m_byte = c;
+        child->m_position = in_slot;
+      }
+
+      template<typename N>
+      static void add_sorted(N *n, std::uint8_t c, entry *child) noexcept
+      {
+        std::size_t i = 0;
+        while (i < n->m_count && n->m_keys[i] < c) i++;
+        std::memmove(n->m_keys + i + 1, n->m_keys + i, n->m_count - i);
+        std::memmove(n->m_children + i + 1, n->m_children + i,
+                     (n->m_count - i) * sizeof(entry *));
+        n->m_keys[i] = c;
+        n->m_children[i] = child;
+      }
+
+      template<typename N>
+      static void remove_sorted(N *n, std::uint8_t c) noexcept
+      {
+        std::size_t i = 0;
+        while (n->m_keys[i] != c) i++;
+        std::memmove(n->m_keys + i, n->m_keys + i + 1, n->m_count - i - 1);
+        std::memmove(n->m_children + i, n->m_children + i + 1,
+                     (n->m_count - i - 1) * sizeof(entry *));
+      }
+
+      /**
+       * @brief Add @p child to slot @p c of @p n
+       * @note User is responsible to ensure @p n is not full and slot @p c
+       * is empty
+       */
+      static void add_child(inner *n, std::uint8_t c, entry *child) noexcept
+      {
+        attach(n, c, child);
+        switch (n->m_type)
+        {
+        case type_node4:
+          add_sorted(static_cast<node4 *>(n), c, child);
+          break;
+        case type_node16:
+          add_sorted(static_cast<node16 *>(n), c, child);
+          break;
+        case type_node48:
+        {
+          auto *x = static_cast<node48 *>(n);
+          std::uint8_t i = 0;
+          while (x->m_children[i] != nullptr) i++;
+          x->m_children[i] = child;
+          x->m_index[c] = static_cast<std::uint8_t>(i + 1);
+          break;
+        }
+        case type_node256:
+          static_cast<node256 *>(n)->m_children[c] = child;
+          break;
+        default:
+          static_cast<container *>(n)->m_root = child;
+          break;
+        }
+        n->m_count++;
+      }
+
+      /** @brief Remove the child in slot @p c of @p n */
+      static void remove_child(inner *n, std::uint8_t c) noexcept
+      {
+        switch (n->m_type)
+        {
+        case type_node4:
+          remove_sorted(static_cast<node4 *>(n), c);
+          break;
+        case type_node16:
+          remove_sorted(static_cast<node16 *>(n), c);
+          break;
+        case type_node48:
+        {
+          auto *x = static_cast<node48 *>(n);
+          x->m_children[x->m_index[c] - 1] = nullptr;
+          x->m_index[c] = 0;
+          break;
+        }
+        case type_node256:
+          static_cast<node256 *>(n)->m_children[c] = nullptr;
+          break;
+        default:
+          static_cast<container *>(n)->m_root = nullptr;
+          break;
+        }
+        n->m_count--;
+      }
+
+      /** @brief Let @p with take the place of @p old in its parent */
+      static void replace(entry *old, entry *with) noexcept
+      {
+        inner *p = old->m_parent;
+        if (old->m_position == in_chain)
+        {
+          *chain_find(p->m_chain, old->m_byte)
+              = static_cast<leaf_entry *>(with);
+          with->m_parent = p;
+          with->m_byte = old->m_byte;
+          with->m_position = in_chain;
+        }
+        else
+        {
+          *find_child(p, old->m_byte) = with;
+          attach(p, old->m_byte, with);
+        }
+        old->m_parent = nullptr;
+      }
+
+      /** @brief Call @p f with each byte and child of @p n in order */
+      template<typename F>
+      static void for_each_child(inner *n, F &&f)
+      {
+        switch (n->m_type)
+        {
+        case type_node4:
+        {
+          auto *x = static_cast<node4 *>(n);
+          for (std::size_t i = 0; i < x->m_count; i++)
+            f(x->m_keys[i], x->m_children[i]);
+          break;
+        }
+        case type_node16:
+        {
+          auto *x = static_cast<node16 *>(n);
+          for (std::size_t i = 0; i < x->m_count; i++)
+            f(x->m_keys[i], x->m_children[i]);
+          break;
+        }
+        case type_node48:
+        {
+          auto *x = static_cast<node48 *>(n);
+          for (unsigned c = 0; c < 256; c++)
+            if (x->m_index[c] != 0)
+              f(static_cast<std::uint8_t>(c), x->m_children[x->m_index[c] - 1]);
+          break;
+        }
+        case type_node256:
+        {
+          auto *x = static_cast<node256 *>(n);
+          for (unsigned c = 0; c < 256; c++)
+            if (x->m_children[c] != nullptr)
+              f(static_cast<std::uint8_t>(c), x->m_children[c]);
+          break;
+        }
+        default:
+        {
+          auto *x = static_cast<container *>(n);
+          if (x->m_root)
+            f(std::uint8_t(0), x->m_root);
+          break;
+        }
+        }
+      }
+
+      /** @brief Get any child of @p n */
+      static entry *any_child(inner *n) noexcept
+      {
+        switch (n->m_type)
+        {
+        case type_node4:
+          return static_cast<node4 *>(n)->m_children[0];
+        case type_node16:
+          return static_cast<node16 *>(n)->m_children[0];
+        default:
+        {
+          entry *ret = nullptr;
+          for_each_child(n, [&ret](std::uint8_t, entry *e)
+          { if (ret == nullptr) ret = e; });
+          return ret;
+        }
+        }
+      }
+
+      /**
+       * @brief Get a leaf under @p e, whose key shares the whole path to
+       * @p e
+       */
+      static leaf_entry *any_leaf(entry *e) noexcept
+      {
+        while (e->m_type != type_leaf)
+        {
+          auto *n = static_cast<inner *>(e);
+          if (n->m_chain)
+            return chain_leaves(n->m_chain)[0];
+          e = any_child(n);
+        }
+        return static_cast<leaf_entry *>(e);
+      }
+
+      /**
+       * @brief Copy header of @p src to @p dst, which takes the chain of
+       * @p src but not children
+       */
+      static void copy_header(inner *dst, const inner *src) noexcept
+      {
+        dst->m_prefix_len = src->m_prefix_len;
+        dst->m_depth = src->m_depth;
+        std::memcpy(dst->m_prefix, src->m_prefix, max_prefix);
+        dst->m_chain = src->m_chain;
+        if (dst->m_chain)
+        {
+          leaf_entry **leaves = chain_leaves(dst->m_chain);
+          for (std::size_t i = 0; i < dst->m_chain->m_count; i++)
+            leaves[i]->m_parent = dst;
+        }
+      }
+    };
+
+    /**
+     * @brief Hook of nodes linked into an adaptive radix tree
+     * @tparam Key Type of key, which must have a specialization of @ref
+     * art_key
+     * @tparam Node Type of node, which should derive from this class
+     * @tparam Tag Tag for the tree
+     * @ingroup intrusive_art
+     *
+     * Like @ref rbtree_node, the node carries its key and unlinks itself
+     * from the tree when destroyed. A key must not be changed while the
+     * node is linked.
+     */
+    template<typename Key, typename Node, typename Tag>
+    class art_node : private art_node<void, void>::leaf_entry
+    {
+      template<typename, typename, typename>
+      friend class art;
+
+      using detail = art_node<void, void>;
+      using tree = art<Key, Node, Tag>;
+    public:
+
+      template<typename ...Arguments>
+      art_node(Arguments && ...arguments)
+        noexcept(noexcept(Key(std::forward<Arguments>(arguments)...)))
+        : m_key(std::forward<Arguments>(arguments)...)
+      { }
+
+      ~art_node() noexcept
+      { unlink(); }
+
+      /** @brief Move constructor, the node takes the place of @p n */
+      art_node(art_node &&n)
+        noexcept(std::is_nothrow_move_constructible<Key>::value)
+        : m_key(std::move(n.m_key))
+      {
+        if (n.is_linked())
+          detail::replace(&n, this);
+      }
+
+      /** @brief Move assignment, the node takes the place of @p n */
+      art_node &operator = (art_node &&n)
+        noexcept(std::is_nothrow_move_assignable<Key>::value)
+      {
+        if (this != &n)
+        {
+          unlink();
+          m_key = std::move(n.m_key);
+          if (n.is_linked())
+            detail::replace(&n, this);
+        }
+        return *this;
+      }
+
+      art_node(const art_node &) = delete;
+      art_node &operator = (const art_node &) = delete;
+
+      const Key &get_key() const noexcept
+      { return m_key; }
+
+      /** @brief Test if this node is linked into a tree */
+      bool is_linked() const noexcept
+      { return this->m_parent != nullptr; }
+
+      /**
+       * @brief Unlink this node from the tree
+       * @returns whether this node was linked
+       */
+      bool unlink() noexcept
+      {
+        if (!is_linked())
+          return false;
+        tree::unlink(this);
+        return true;
+      }
+
+    private:
+      Key m_key;
+    };
+
+  }
+}
@@ -534,6 +534,9 @@ namespace lanxc
       /**
        * @brief Sort this list with specified comparator
        * @param comp The comparator
+       *
+       * If @p comp throws, all nodes are kept in this list but in
+       * unspecified order.
        */
       template<typename Comparator=less<Node>>
       void sort(Comparator &&comp = Comparator())
@@ -547,28 +550,40 @@ namespace lanxc
         list *fill = &tmp[0];
         list *counter;
 
-        do
+        try
         {
-          auto &n = *begin();
-          pop_front();
-          carry.insert(carry.begin(), n);
-
-          for (counter = &tmp[0];
-              counter != fill && !counter->empty();
-              ++counter)
+          do
           {
-            counter->merge(carry, std::forward<Comparator>(comp));
-            counter->swap(carry);
+            auto &n = *begin();
+            pop_front();
+            carry.insert(carry.begin(), n);
+
+            for (counter = &tmp[0];
+                counter != fill && !counter->empty();
+                ++counter)
+            {
+              counter->merge(carry, std::forward<Comparator>(comp));
+              counter->swap(carry);
+            }
+
+            carry.swap(*counter);
+            if (counter == fill)
+              ++fill;
           }
+          while(!empty());
 
-          carry.swap(*counter);
-          if (counter == fill)
-            ++fill;
+          for (counter = &tmp[1]; counter != fill; ++counter)
+            counter->merge(*(counter-1), std::forward<Comparator>(comp));
+        }
+        catch (...)
+        {
+          // Merging never drops a node, so they are all in temporary
+          // lists, which would unlink them once destroyed
+          splice(end(), carry);
+          for (auto &t : tmp)
+            splice(end(), t);
+          throw;
         }
-        while(!empty());
-
-        for (counter = &tmp[1]; counter != fill; ++counter)
-          counter->merge(*(counter-1), std::forward<Comparator>(comp));
         swap(*(fill - 1));
       }
 
@@ -62,6 +62,24 @@ namespace lanxc
       using insert_policy_sfinae
           = typename detail::insert_policy_sfinae<Policy, Result>;
 
+      /**
+       * @brief SFINAE check for lookup key
+       * @tparam Key Type of lookup key, which should be either convertible to
+       *             @p Index, or comparable with @p Index by a transparent
+       *             comparator
+       * @tparam Result SFINAE Result
+       */
+      template<typename Key, typename Result = void>
+      using key_sfinae = typename std::enable_if<
+          node_type::template is_lookup_key<Key>::value, Result>::type;
+
+      template<typename Key>
+      using key_reference = typename node_type::template key_reference<Key>;
+
+      template<typename Key>
+      using lookup_noexcept
+          = typename node_type::template is_lookup_noexcept<Key>;
+
     public:
 
       using iterator               = rbtree_iterator<Index, Node, Tag>;
@@ -195,10 +213,11 @@ namespace lanxc
        *        the nearest one (first touched) will be return. if not found,
        *        @a end() will be returned.
        */
-      template<typename LookupPolicy = default_lookup_policy>
-      lookup_policy_sfinae<LookupPolicy, iterator>
-      find(const Index &val, LookupPolicy p = LookupPolicy())
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index,
+               typename LookupPolicy = default_lookup_policy>
+      key_sfinae<Key, lookup_policy_sfinae<LookupPolicy, iterator>>
+      find(const Key &val, LookupPolicy p = LookupPolicy())
+          noexcept(lookup_noexcept<Key>::value)
       { return find(end(), val, p); }
 
       /**
@@ -216,13 +235,15 @@ namespace lanxc
        *        the nearest one (first touched) will be return. if not found,
        *        @a end() will be returned.
        */
-      template<typename LookupPolicy = default_lookup_policy>
-      lookup_policy_sfinae<LookupPolicy, iterator>
-      find(iterator hint, const Index &val, LookupPolicy p = LookupPolicy())
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index,
+               typename LookupPolicy = default_lookup_policy>
+      key_sfinae<Key, lookup_policy_sfinae<LookupPolicy, iterator>>
+      find(iterator hint, const Key &val, LookupPolicy p = LookupPolicy())
+          noexcept(lookup_noexcept<Key>::value)
       {
         node_type &ref = *hint;
-        auto *result = node_type::find(ref, val, p);
+        key_reference<Key> key = val;
+        auto *result = node_type::find(ref, key, p);
         if (result == nullptr) return end();
         else return iterator(result);
       }
@@ -238,10 +259,11 @@ namespace lanxc
        *        index, the one element (first touched) will be return. if not
        *        found, @a end() will be returned.
        */
-      template<typename LookupPolicy = default_lookup_policy>
-      lookup_policy_sfinae<LookupPolicy, const_iterator>
-      find(const Index &val, LookupPolicy p = LookupPolicy()) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index,
+               typename LookupPolicy = default_lookup_policy>
+      key_sfinae<Key, lookup_policy_sfinae<LookupPolicy, const_iterator>>
+      find(const Key &val, LookupPolicy p = LookupPolicy()) const
+          noexcept(lookup_noexcept<Key>::value)
       { return find(end(), val, p); }
 
       /**
@@ -258,13 +280,15 @@ namespace lanxc
        *        index, the nearest one (first touched) will be return. if not
        *        found, @a end() will be returned.
        */
-      template<typename LookupPolicy = default_lookup_policy>
-      lookup_policy_sfinae<LookupPolicy, const_iterator>
-      find(const_iterator hint, const Index &val, LookupPolicy p = LookupPolicy()) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index,
+               typename LookupPolicy = default_lookup_policy>
+      key_sfinae<Key, lookup_policy_sfinae<LookupPolicy, const_iterator>>
+      find(const_iterator hint, const Key &val, LookupPolicy p = LookupPolicy()) const
+          noexcept(lookup_noexcept<Key>::value)
       {
         const node_type &ref = *hint;
-        auto *result = node_type::find(ref, val, p);
+        key_reference<Key> key = val;
+        auto *result = node_type::find(ref, key, p);
         if (result == nullptr) return end();
         else return const_iterator(result);
       }
@@ -275,8 +299,10 @@ namespace lanxc
        * @returns An iterator point to the first element that is not less than
        *          @p val, or @a end() if there is no such element
        */
-      iterator lower_bound(const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, iterator>
+      lower_bound(const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       {
         return lower_bound(end(), val);
       }
@@ -287,8 +313,10 @@ namespace lanxc
        * @returns A const iterator point to the first element that is not less
        *          than @p val, or @a end() if there is no such element
        */
-      const_iterator lower_bound(const Index &val) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, const_iterator>
+      lower_bound(const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       { return lower_bound(end(), val); }
 
       /**
@@ -300,11 +328,14 @@ namespace lanxc
        * @returns An iterator point to the first element that is not less than
        *          @p val, or @a end() if there is no such element
        */
-      iterator lower_bound(iterator hint, const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, iterator>
+      lower_bound(iterator hint, const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       {
         node_type &ref = *hint;
-        return iterator(node_type::lower_bound(ref, val));
+        key_reference<Key> key = val;
+        return iterator(node_type::lower_bound(ref, key));
       }
 
       /**
@@ -316,11 +347,14 @@ namespace lanxc
        * @returns A const iterator point to the first element that is not less
        *          than @p val, or @a end() if there is no such element
        */
-      const_iterator lower_bound(const_iterator hint, const Index &val) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, const_iterator>
+      lower_bound(const_iterator hint, const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       {
         const node_type &ref = *hint;
-        return const_iterator(node_type::lower_bound(ref, val));
+        key_reference<Key> key = val;
+        return const_iterator(node_type::lower_bound(ref, key));
       }
 
       /**
@@ -329,8 +363,10 @@ namespace lanxc
        * @returns An iterator point to the first element that is greater than
        *          @p val, or @a end() if there is no such element
        */
-      iterator upper_bound(const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, iterator>
+      upper_bound(const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       { return upper_bound(end(), val); }
 
       /**
@@ -339,8 +375,10 @@ namespace lanxc
        * @returns A const iterator point to the first element that is greater than
        *          @p val, or @a end() if there is no such element
        */
-      const_iterator upper_bound(const Index &val) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, const_iterator>
+      upper_bound(const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       { return upper_bound(end(), val); }
 
       /**
@@ -352,11 +390,14 @@ namespace lanxc
        * @returns An iterator point to the first element that is greater than
        *          @p val, or @a end() if there is no such element
        */
-      iterator upper_bound(iterator hint, const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, iterator>
+      upper_bound(iterator hint, const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       {
         node_type &ref = *hint;
-        return iterator(node_type::upper_bound(ref, val));
+        key_reference<Key> key = val;
+        return iterator(node_type::upper_bound(ref, key));
       }
 
       /**
@@ -368,11 +409,14 @@ namespace lanxc
        * @returns A const iterator point to the first element that is greater than
        *          @p val, or @a end() if there is no such element
        */
-      const_iterator upper_bound(const_iterator hint, const Index &val) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, const_iterator>
+      upper_bound(const_iterator hint, const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       {
         const node_type &ref = *hint;
-        return const_iterator(node_type::upper_bound(ref, val));
+        key_reference<Key> key = val;
+        return const_iterator(node_type::upper_bound(ref, key));
       }
 
       /**
@@ -382,8 +426,10 @@ namespace lanxc
        *          first iterator is the lower bound, the second iterator
        *          is the upper bound
        */
-      std::pair<iterator, iterator> equals_range(const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, std::pair<iterator, iterator>>
+      equals_range(const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       { return equals_range(end(), val); }
 
       /**
@@ -396,11 +442,14 @@ namespace lanxc
        *          first iterator is the lower bound, the second iterator
        *          is the upper bound
        */
-      std::pair<iterator, iterator> equals_range(iterator hint, const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, std::pair<iterator, iterator>>
+      equals_range(iterator hint, const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       {
-        iterator l = lower_bound(hint, val);
-        iterator u = upper_bound(l, val);
+        key_reference<Key> key = val;
+        iterator l = lower_bound(hint, key);
+        iterator u = upper_bound(l, key);
         return std::make_pair(std::move(l), std::move(u));
       }
 
@@ -411,9 +460,10 @@ namespace lanxc
        *          The first iterator is the lower bound, the second iterator
        *          is the upper bound
        */
-      std::pair<const_iterator, const_iterator>
-      equals_range(const Index &val) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, std::pair<const_iterator, const_iterator>>
+      equals_range(const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       { return equals_range(end(), val); }
 
       /**
@@ -426,12 +476,14 @@ namespace lanxc
        *          The first iterator is the lower bound, the second iterator
        *          is the upper bound
        */
-      std::pair<const_iterator, const_iterator>
-      equals_range(const_iterator hint, const Index &val) const
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key, std::pair<const_iterator, const_iterator>>
+      equals_range(const_iterator hint, const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       {
-        const_iterator l = lower_bound(hint, val);
-        const_iterator u = upper_bound(l, val);
+        key_reference<Key> key = val;
+        const_iterator l = lower_bound(hint, key);
+        const_iterator u = upper_bound(l, key);
         return std::make_pair(std::move(l), std::move(u));
       }
 
@@ -449,7 +501,7 @@ namespace lanxc
       insert_policy_sfinae<InsertPolicy, iterator>
       insert(value_type &val, InsertPolicy p = InsertPolicy())
           noexcept(node_type::is_comparator_noexcept)
-      { return insert(end(), val, p); }
+      { return insert(insert_entry(), val, p); }
 
       /**
        * @brief Insert an element into this tree
@@ -536,16 +588,22 @@ namespace lanxc
        *        this tree
        * @param val The value of index for searching elements
        */
-      void erase(const Index &val)
-          noexcept(node_type::is_comparator_noexcept)
+      template<typename Key = Index>
+      key_sfinae<Key>
+      erase(const Key &val)
+          noexcept(lookup_noexcept<Key>::value)
       {
-        auto b = lower_bound(end(), val);
-        auto e = upper_bound(b, val);
+        key_reference<Key> key = val;
+        auto b = lower_bound(end(), key);
+        auto e = upper_bound(b, key);
         erase(b, e);
       }
 
       /** @brief Count the number of node has given index value */
-      size_type count(const Index &val) const noexcept
+      template<typename Key = Index>
+      key_sfinae<Key, size_type>
+      count(const Key &val) const
+          noexcept(lookup_noexcept<Key>::value)
       {
         auto p = equals_range(val);
         size_type ret = 0;
@@ -570,6 +628,19 @@ namespace lanxc
       { m_container_node.unlink_container(); }
 
     private:
+
+      /**
+       * @brief Get the node where searching for insertion position starts
+       * when no hint is given
+       * @see rbtree_config::insert_from_back
+       */
+      iterator insert_entry() noexcept
+      {
+        if (config::insert_from_back)
+          return iterator(m_container_node.back_of_container());
+        return end();
+      }
+
       rbtree_node<void, void>::container<Index, Node, Tag> m_container_node;
     };
 
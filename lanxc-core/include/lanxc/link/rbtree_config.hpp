@@ -17,6 +17,7 @@
 
 #pragma once
 #include "rbtree_define.hpp"
+#include "rbtree_prefix.hpp"
 #include <lanxc/functional.hpp>
 
 #include <type_traits>
@@ -36,7 +37,12 @@ namespace lanxc
     {
     public:
       /** @brief Comparator adapter, must meets requirement of strict weak
-       * ordering binary predicate */
+       * ordering binary predicate
+       * @note Alias it to a transparent comparator such as `less<>` to
+       *       enable heterogeneous lookup, e.g. search a tree indexed by
+       *       `std::string` with `const char *` without constructing a
+       *       temporary string for every lookup
+       */
       template<typename T> using comparator = less<T>;
 
       /**
@@ -56,6 +62,32 @@ namespace lanxc
 
       /** @brief Default policy for insert */
       using default_insert_policy = index_policy::unique;
+
+      /**
+       * @brief Whether insertion without a hint searches from the last node
+       * rather than the root of tree
+       *
+       * Enable it for trees whose indexes are generated almost monotonically,
+       * e.g. deadlines or sequence numbers. A node whose index is not less
+       * than the last one is then appended in amortized constant time, and a
+       * node slightly out of order is located by climbing up from the last
+       * node, in time logarithmic to its distance to the back. Trees with
+       * randomly distributed indexes should leave it disabled.
+       */
+      static constexpr bool insert_from_back = false;
+
+      /**
+       * @brief Number of leading bytes of index cached inside of each node,
+       * either 0, 8 or 16
+       *
+       * Enable it for trees indexed by strings or byte arrays, so that most
+       * comparisons during lookup are done between integers stored inline,
+       * and the index itself is only touched when the leading bytes are the
+       * same. The comparator must order indexes lexicographically by bytes
+       * as unsigned char, like `less<std::string>` does.
+       * @see index_prefix
+       */
+      static constexpr std::size_t index_prefix_size = 0;
     };
 
     template<typename Tag>
@@ -92,17 +92,63 @@ namespace lanxc
         using config = rbtree_config<Tag>;
         using comparator_type = typename config::template comparator<Index>;
         using node_pointer = typename config::template node_pointer<node>;
+        using prefix_type = index_prefix<config::index_prefix_size>;
+        using prefix_value = typename prefix_type::value_type;
 
         static constexpr bool is_comparator_noexcept =
             noexcept(std::declval<typename config::template comparator<Index>>()
                 (std::declval<Index>(), std::declval<Index>()));
 
+        /**
+         * @brief Whether the comparator is transparent, so that lookup can be
+         * done with any type comparable with @p Index directly
+         */
+        static constexpr bool is_transparent =
+            lanxc::is_transparent<comparator_type>::value;
+
+        /**
+         * @brief Type of the reference to key passed to lookup functions.
+         *
+         * With a transparent comparator, the key is used as is; otherwise it
+         * is converted to @p Index once before searching, rather than on
+         * every comparison.
+         */
+        template<typename Key>
+        using key_reference = typename std::conditional<is_transparent,
+            const Key &, const Index &>::type;
+
+        /**
+         * @brief Test if @p Key can be used as lookup key
+         */
+        template<typename Key>
+        struct is_lookup_key
+        {
+          static constexpr bool value
+              = (is_transparent || std::is_convertible<Key, Index>::value);
+        };
+
+        /**
+         * @brief Test if looking up with a key of type @p Key never throws,
+         * including the conversion to @p Index when it is required
+         */
+        template<typename Key>
+        struct is_lookup_noexcept
+        {
+          static constexpr bool value = is_transparent
+              ? noexcept(std::declval<comparator_type>()
+                  (std::declval<const Index &>(), std::declval<const Key &>()))
+                && noexcept(std::declval<comparator_type>()
+                  (std::declval<const Key &>(), std::declval<const Index &>()))
+              : is_comparator_noexcept
+                && (std::is_same<Key, Index>::value
+                    || std::is_nothrow_constructible<Index, const Key &>::value);
+        };
 
 
         constexpr node() noexcept
             : m_p(nullptr), m_l(nullptr), m_r(nullptr)
             , m_is_red(false), m_is_container(false)
-            , m_has_l(false), m_has_r(false)
+            , m_has_l(false), m_has_r(false), m_prefix()
         { }
 
         ~node() noexcept
@@ -116,7 +162,7 @@ namespace lanxc
         node(node &&n) noexcept
             : m_p(nullptr), m_l(nullptr), m_r(nullptr)
             , m_is_red(false), m_is_container(false)
-            , m_has_l(false), m_has_r(false)
+            , m_has_l(false), m_has_r(false), m_prefix(n.m_prefix)
         { move(*this, n); }
 
         node &operator = (node &&n) noexcept
@@ -151,8 +197,9 @@ namespace lanxc
 
         struct cr_comparator_type
         {
-          bool operator ()(const Index &lhs, const Index &rhs) const
-          noexcept(is_comparator_noexcept)
+          template<typename L, typename R>
+          bool operator ()(const L &lhs, const R &rhs) const
+          noexcept(noexcept(std::declval<comparator_type>()(rhs, lhs)))
           {
             comparator_type c;
             return !c(rhs, lhs);
@@ -160,7 +207,8 @@ namespace lanxc
         };
 
 
-        static bool equal_test(const Index &lhs, const Index &rhs)
+        template<typename Key>
+        static bool equal_test(const Index &lhs, const Key &rhs)
         {
           comparator_type c;
           cr_comparator_type crc;
@@ -170,7 +218,7 @@ namespace lanxc
         constexpr node(container_tag) noexcept
             : m_p(this), m_l(this), m_r(this)
             , m_is_red(true), m_is_container(true)
-            , m_has_l(false), m_has_r(false)
+            , m_has_l(false), m_has_r(false), m_prefix()
         {}
 
         const Index &internal_get_index() const noexcept
@@ -179,6 +227,30 @@ namespace lanxc
           return n.index<Index>::m_index;
         }
 
+        /** @brief Cache the prefix of index, before this node is linked */
+        void update_prefix() noexcept
+        { m_prefix = prefix_type::make(internal_get_index()); }
+
+        /**
+         * @brief Compare index of @p n with @p key via @p comparator, unless
+         * the order is already determined by their prefixes
+         * @param prefix The prefix of @p key
+         */
+        template<typename Key, typename Comparator>
+        static bool prefixed_compare(const node &n, const Key &key,
+                                     const prefix_value &prefix,
+                                     const Comparator &comparator)
+        noexcept(is_lookup_noexcept<Key>::value)
+        {
+          // If prefixes differ, both "less" and "not greater" follow them
+          if (prefix_type::size != 0)
+          {
+            int r = prefix_type::compare(n.m_prefix, prefix);
+            if (r != 0) return r < 0;
+          }
+          return comparator(n.internal_get_index(), key);
+        }
+
 
         /** @brief test if a node is container node or root node */
         bool is_container_or_root() const noexcept
@@ -349,11 +421,14 @@ namespace lanxc
          */
         static void move(reference dst, reference src) noexcept
         {
+          // The prefix belongs to the index of dst rather than its position
+          prefix_value prefix = dst.m_prefix;
           dst.~node();
 
           if (src.m_is_container)
           {
             new (&dst) node(construct_container);
+            dst.m_prefix = prefix;
             if (src.is_empty_container_node())
             {
               src.unlink_cleanup();
@@ -363,6 +438,7 @@ namespace lanxc
           else
           {
             new (&dst) node();
+            dst.m_prefix = prefix;
           }
 
           if (src.is_linked())
@@ -459,9 +535,15 @@ namespace lanxc
           m_p = y;
         }
 
-        /** @brief Rebalance a node after insertion */
+        /**
+         * @brief Rebalance a node after insertion
+         * @param node The node just inserted
+         * @param container The container node if it is already known by
+         * caller, or nullptr to find it out by climbing up from the root
+         */
         static void
-        rebalance_for_insertion(pointer node) noexcept
+        rebalance_for_insertion(pointer node,
+                                pointer container = nullptr) noexcept
         {
           while(node->m_p->m_is_red && !node->is_container_or_root())
             // Check node is not root of node and its parent are red
@@ -522,8 +604,10 @@ namespace lanxc
 
           if (node->is_container_or_root())
             node->m_is_red = false;
-          node = node->get_container_node();
-          static_cast<container<Index, Node, Tag>*>(node)->m_size++;
+          if (container == nullptr)
+            container = node->get_container_node();
+          static_cast<rbtree_node<void, void>::container<Index, Node, Tag>*>
+            (container)->m_size++;
         }
 
         /**
@@ -640,15 +724,18 @@ namespace lanxc
          */
         void insert_as_left_child(pointer node) noexcept
         {
+          // Inserting to the front, the container is known without climbing
+          pointer container = m_l->m_is_container ? m_l : nullptr;
+          node->update_prefix();
           node->m_l = m_l;
-          if (m_l->m_is_container)
-            m_l->m_l = node;
+          if (container)
+            container->m_l = node;
           node->m_r = this;
           node->m_p = this;
           m_l = node;
           m_has_l = true;
           node->m_is_red = true;
-          rebalance_for_insertion(node);
+          rebalance_for_insertion(node, container);
         }
 
         /**
@@ -658,15 +745,18 @@ namespace lanxc
          */
         void insert_as_right_child(pointer node) noexcept
         {
+          // Appending to the back, the container is known without climbing
+          pointer container = m_r->m_is_container ? m_r : nullptr;
+          node->update_prefix();
           node->m_r = m_r;
-          if (m_r->m_is_container)
-            m_r->m_r = node;
+          if (container)
+            container->m_r = node;
           node->m_l = this;
           node->m_p = this;
           m_r = node;
           m_has_r = true;
           node->m_is_red = true;
-          rebalance_for_insertion(node);
+          rebalance_for_insertion(node, container);
         }
 
         /**
@@ -675,9 +765,10 @@ namespace lanxc
          */
         void insert_root_node(pointer node) noexcept
         {
+          node->update_prefix();
           m_p = m_l = m_r = node;
           node->m_p = node->m_l = node->m_r = this;
-          rebalance_for_insertion(node);
+          rebalance_for_insertion(node, this);
         }
 
         /** @brief Insert a node as predecessor of this node */
@@ -928,9 +1019,9 @@ namespace lanxc
          * be true, while compare the second pointer in the pair with the
          * index is ensured to be false.
          */
-        template<typename Reference>
-        static auto search(Reference &entry, const Index &index)
-        noexcept(is_comparator_noexcept)
+        template<typename Reference, typename Key>
+        static auto search(Reference &entry, const Key &index)
+        noexcept(is_lookup_noexcept<Key>::value)
         -> std::pair<decltype(std::addressof(entry)),
             decltype(std::addressof(entry))>
         {
@@ -944,15 +1035,17 @@ namespace lanxc
               p = p->get_root_node_from_container_node();
           }
 
-          auto cmp = [&index] (Reference &node) noexcept -> bool
+          const prefix_value prefix = prefix_type::make(index);
+
+          auto cmp = [&index, &prefix] (Reference &node) noexcept -> bool
           {
-            return comparator_type()(node.internal_get_index(), index);
+            return prefixed_compare(node, index, prefix, comparator_type());
           };
 
 
-          auto cr_cmp = [&index] (Reference &node) noexcept -> bool
+          auto cr_cmp = [&index, &prefix] (Reference &node) noexcept -> bool
           {
-            return cr_comparator_type()(node.internal_get_index(), index);
+            return prefixed_compare(node, index, prefix, cr_comparator_type());
           };
 
           auto result = cmp(*p);
@@ -1063,10 +1156,10 @@ namespace lanxc
          * each node in right part has index value `v` where
          * `comparator(v, * index)` is `false`
          */
-        template<typename Reference, typename Comparator>
-        static auto boundary(Reference &entry, const Index &index,
+        template<typename Reference, typename Key, typename Comparator>
+        static auto boundary(Reference &entry, const Key &index,
                             const Comparator &comparator)
-            noexcept(is_comparator_noexcept)
+            noexcept(is_lookup_noexcept<Key>::value)
             -> std::pair<decltype(std::addressof(entry)),
                          decltype(std::addressof(entry))>
         {
@@ -1080,9 +1173,12 @@ namespace lanxc
               p = p->get_root_node_from_container_node();
           }
 
-          auto cmp = [&index, &comparator] (Reference &node) noexcept -> bool
+          const prefix_value prefix = prefix_type::make(index);
+
+          auto cmp = [&index, &prefix, &comparator]
+              (Reference &node) noexcept -> bool
           {
-            return comparator(node.internal_get_index(), index);
+            return prefixed_compare(node, index, prefix, comparator);
           };
 
           bool hint_result = cmp(*p);
@@ -1152,9 +1248,10 @@ namespace lanxc
           }
         }
 
+        template<typename Key>
         static const_pointer
-        find(const_reference e, const Index &i, index_policy::back)
-        noexcept(is_comparator_noexcept)
+        find(const_reference e, const Key &i, index_policy::back)
+        noexcept(is_lookup_noexcept<Key>::value)
         {
           auto *p = boundary(e, i, cr_comparator_type()).first;
 
@@ -1164,9 +1261,10 @@ namespace lanxc
             return nullptr;
         }
 
+        template<typename Key>
         static const_pointer
-        find(const_reference e, const Index &i, index_policy::front)
-        noexcept(is_comparator_noexcept)
+        find(const_reference e, const Key &i, index_policy::front)
+        noexcept(is_lookup_noexcept<Key>::value)
         {
           auto *p = boundary(e, i, comparator_type()).second;
 
@@ -1176,9 +1274,10 @@ namespace lanxc
             return nullptr;
         }
 
+        template<typename Key>
         static const_pointer
-        find(const_reference e,const Index &i, index_policy::nearest)
-        noexcept(is_comparator_noexcept)
+        find(const_reference e, const Key &i, index_policy::nearest)
+        noexcept(is_lookup_noexcept<Key>::value)
         {
           auto p = search(e, i);
 
@@ -1188,9 +1287,10 @@ namespace lanxc
             return nullptr;
         }
 
+        template<typename Key>
         static pointer
-        find(reference e, const Index &i, index_policy::back)
-        noexcept(is_comparator_noexcept)
+        find(reference e, const Key &i, index_policy::back)
+        noexcept(is_lookup_noexcept<Key>::value)
         {
           auto *p = boundary(e, i, cr_comparator_type()).first;
 
@@ -1200,9 +1300,10 @@ namespace lanxc
             return nullptr;
         }
 
+        template<typename Key>
         static pointer
-        find(reference e, const Index &i, index_policy::front)
-        noexcept(is_comparator_noexcept)
+        find(reference e, const Key &i, index_policy::front)
+        noexcept(is_lookup_noexcept<Key>::value)
         {
           auto *p = boundary(e, i, comparator_type()).second;
 
@@ -1212,9 +1313,10 @@ namespace lanxc
             return nullptr;
         }
 
+        template<typename Key>
         static pointer
-        find(reference e, const Index &i, index_policy::nearest)
-        noexcept(is_comparator_noexcept)
+        find(reference e, const Key &i, index_policy::nearest)
+        noexcept(is_lookup_noexcept<Key>::value)
         {
           auto p = search(e, i);
 
@@ -1230,9 +1332,10 @@ namespace lanxc
          * @param entry Entry node where search begins
          * @param index The specified value for searching the lower boundary
          */
+        template<typename Key>
         static pointer
-        lower_bound(reference entry, const Index &index)
-        noexcept(is_comparator_noexcept)
+        lower_bound(reference entry, const Key &index)
+        noexcept(is_lookup_noexcept<Key>::value)
         { return boundary(entry, index, comparator_type()).second; }
 
         /**
@@ -1241,9 +1344,10 @@ namespace lanxc
          * @param entry Entry node where search begins
          * @param index The specified value for searching the lower boundary
          */
+        template<typename Key>
         static const_pointer
-        lower_bound(const_reference entry, const Index &index)
-        noexcept(is_comparator_noexcept)
+        lower_bound(const_reference entry, const Key &index)
+        noexcept(is_lookup_noexcept<Key>::value)
         { return boundary(entry, index, comparator_type()).second; }
 
         /**
@@ -1252,9 +1356,10 @@ namespace lanxc
          * @param entry Entry node where search begins
          * @param index The specified value for searching the upper boundary
          */
+        template<typename Key>
         static pointer
-        upper_bound(reference &entry, const Index &index)
-        noexcept(is_comparator_noexcept)
+        upper_bound(reference entry, const Key &index)
+        noexcept(is_lookup_noexcept<Key>::value)
         { return boundary(entry, index, cr_comparator_type()).second; }
 
         /**
@@ -1263,9 +1368,10 @@ namespace lanxc
          * @param entry Entry node where search begins
          * @param index The specified value for searching the upper boundary
          */
+        template<typename Key>
         static const_pointer
-        upper_bound(const_reference entry, const Index &index)
-        noexcept(is_comparator_noexcept)
+        upper_bound(const_reference entry, const Key &index)
+        noexcept(is_lookup_noexcept<Key>::value)
         { return boundary(entry, index, cr_comparator_type()).second; }
 
         /**
@@ -1364,7 +1470,9 @@ namespace lanxc
         noexcept(is_comparator_noexcept)
         {
           auto l = lower_bound(e, n.internal_get_index());
-          auto u = upper_bound(*l, n.internal_get_index());
+          // Nothing could be greater than index of n if l is the end
+          auto u = l->m_is_container ? l
+                                     : upper_bound(*l, n.internal_get_index());
           auto p = l->m_is_container ? l->m_r : l->prev();
           bool found = false;
 
@@ -1403,6 +1511,7 @@ namespace lanxc
         const bool m_is_container;  /** < @brief Is container node */
         bool m_has_l;               /** < @brief If this node has left child */
         bool m_has_r;               /** < @brief If this node has right child */
+        prefix_value m_prefix;      /** < @brief Cached prefix of index */
       };
 
       template<typename Index, typename Node, typename Tag>
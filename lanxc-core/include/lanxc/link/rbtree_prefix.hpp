@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include "rbtree_define.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace lanxc
+{
+  namespace link
+  {
+
+    /**
+     * @brief Leading bytes of an index cached inside of each rbtree node
+     * @tparam Size Number of bytes cached, must be a multiple of 8
+     * @ingroup intrusive_rbtree
+     *
+     * The bytes are packed into big-endian integers, padded with zero, so
+     * that comparing two prefixes as integers gives the same order as
+     * comparing the leading bytes of two indexes lexicographically as
+     * unsigned char. Only when two prefixes are equal the indexes have to be
+     * compared via comparator, which saves a cache miss on the out-of-line
+     * storage of most string index.
+     *
+     * An index, as well as any key for heterogeneous lookup, is required to
+     * be either a `const char *` pointing to a null-terminated string or an
+     * object providing `data()` and `size()` like `std::string`.
+     */
+    template<std::size_t Size>
+    class index_prefix
+    {
+      static_assert(Size % 8 == 0, "Size of prefix must be multiple of 8");
+      static constexpr std::size_t words = Size / 8;
+    public:
+      static constexpr std::size_t size = Size;
+
+      struct value_type
+      {
+        std::uint64_t word[words];
+      };
+
+      /** @brief Make prefix for first @p length bytes started at @p data */
+      static value_type make(const void *data, std::size_t length) noexcept
+      {
+        unsigned char bytes[Size] = {};
+        std::memcpy(bytes, data, length < Size ? length : Size);
+        value_type v;
+        for (std::size_t i = 0; i < words; i++)
+        {
+          std::uint64_t w = 0;
+          for (std::size_t j = 0; j < 8; j++)
+            w = (w << 8) | bytes[i * 8 + j];
+          v.word[i] = w;
+        }
+        return v;
+      }
+
+      /** @brief Make prefix for a null-terminated string */
+      static value_type make(const char *s) noexcept
+      { return make(s, std::strlen(s)); }
+
+      /** @brief Make prefix for a byte sequence like `std::string` */
+      template<typename T>
+      static auto make(const T &s) noexcept
+      -> decltype(s.data(), s.size(), value_type())
+      { return make(s.data(), s.size()); }
+
+      /**
+       * @brief Three-way comparison of two prefixes
+       * @returns negative if @p lhs is less than @p rhs, positive if @p lhs
+       * is greater than @p rhs, or zero if they're equal
+       */
+      static int compare(const value_type &lhs, const value_type &rhs) noexcept
+      {
+        for (std::size_t i = 0; i < words; i++)
+          if (lhs.word[i] != rhs.word[i])
+            return lhs.word[i] < rhs.word[i] ? -1 : 1;
+        return 0;
+      }
+    };
+
+    /**
+     * @brief No prefix cached, indexes are always compared via comparator
+     */
+    template<>
+    class index_prefix<0>
+    {
+    public:
+      static constexpr std::size_t size = 0;
+
+      struct value_type {};
+
+      template<typename T>
+      static value_type make(const T &) noexcept
+      { return value_type(); }
+
+      static int compare(const value_type &, const value_type &) noexcept
+      { return 0; }
+    };
+
+  }
+}
@@ -97,4 +97,44 @@ namespace lanxc
   public:
     static constexpr bool value = sfinae<T>(nullptr);
   };
+
+  /**
+   * @brief Test if a comparator is a transparent one (N3421), i.e. it
+   * declares a member type named `is_transparent`
+   */
+  template<typename Comparator>
+  struct is_transparent
+  {
+  private:
+    template<typename U>
+    static constexpr bool
+    sfinae(typename U::is_transparent *)
+    { return true; }
+
+    template<typename U>
+    static constexpr bool sfinae(...)
+    { return false; }
+
+  public:
+    static constexpr bool value = sfinae<Comparator>(nullptr);
+  };
+
+  /** @brief Compile-time sequence of indexes, like C++14 one */
+  template<std::size_t ...Index>
+  struct index_sequence
+  { };
+
+  template<std::size_t N, std::size_t ...Index>
+  struct make_index_sequence_helper
+      : make_index_sequence_helper<N - 1, N - 1, Index...>
+  { };
+
+  template<std::size_t ...Index>
+  struct make_index_sequence_helper<0, Index...>
+  {
+    using type = index_sequence<Index...>;
+  };
+
+  template<std::size_t N>
+  using make_index_sequence = typename make_index_sequence_helper<N>::type;
 }
@@ -15,4 +15,159 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
-#include <lanxc/core/buffer.hpp>
\ No newline at end of file
+#include <lanxc/core/buffer_chain.hpp>
+
+lanxc::buffer_manager::~buffer_manager() = default;
+
+lanxc::readable_stream::~readable_stream() = default;
+
+lanxc::writable_stream::~writable_stream() = default;
+
+std::size_t lanxc::writable_stream::queued() const noexcept
+{
+  return 0;
+}
+
+lanxc::future<> lanxc::writable_stream::drain()
+{
+  return future<>::resolve();
+}
+
+std::size_t lanxc::writable_stream::write(buffer_chain chain)
+{
+  std::size_t written = 0;
+  while (!chain.empty())
+    written += write(chain.pop_front());
+  return written;
+}
+
+namespace
+{
+  /**
+   * @brief State of a pipe, which starts the read or drain of each round
+   * once the previous one is done, rather than chaining a future for each
+   * chunk, so that neither memory nor the stack grows with bytes copied
+   */
+  class pipe_loop : public std::enable_shared_from_this<pipe_loop>
+  {
+  public:
+    pipe_loop(lanxc::readable_stream &from, lanxc::writable_stream &to,
+              std::size_t chunk, lanxc::promise<std::size_t> done)
+      : _from(from)
+      , _to(to)
+      , _chunk(chunk)
+      , _total(0)
+      , _tc(done.context())
+      , _done(std::move(done))
+    { }
+
+    /** @brief Start the next round, waiting for @p to to drain first */
+    void step()
+    {
+      std::weak_ptr<pipe_loop> self = shared_from_this();
+      try
+      {
+        // Replacing the chain of the last round cancels only deliveries
+        // left in it, which pass its result through
+        _task = (_to.queued() == 0 ? read() : drain())
+            .caught<std::exception_ptr>([self](std::exception_ptr &e)
+                                        {
+                                          if (auto l = self.lock())
+                                            l->fail(e);
+                                        })
+            .start(_tc);
+      }
+      catch (...)
+      {
+        fail(std::current_exception());
+      }
+    }
+
+  private:
+    lanxc::future<> read()
+    {
+      lanxc::buffer_chain chain;
+      lanxc::writable_buffer b = _to.allocate_buffer(_chunk);
+      b.resize(0);
+      chain.push_back(std::move(b));
+      std::weak_ptr<pipe_loop> self = shared_from_this();
+      return _from.read(std::move(chain))
+          .then([self](std::size_t n, lanxc::buffer_chain c)
+                {
+                  if (auto l = self.lock())
+                    l->written(n, std::move(c));
+                });
+    }
+
+    lanxc::future<> drain()
+    {
+      std::weak_ptr<pipe_loop> self = shared_from_this();
+      return _to.drain().then([self]
+                              {
+                                if (auto l = self.lock())
+                                  l->resume();
+                              });
+    }
+
+    void written(std::size_t n, lanxc::buffer_chain c)
+    {
+      if (n == 0)
+      {
+        lanxc::promise<std::size_t> done(std::move(_done));
+        done.fulfill(_total);
+        return;
+      }
+      _to.write(std::move(c));
+      _total += n;
+      resume();
+    }
+
+    /** @brief Start the next round once the chain of this one is left */
+    void resume()
+    {
+      std::weak_ptr<pipe_loop> self = shared_from_this();
+      _resume = _tc.defer([self]
+                          {
+                            if (auto l = self.lock())
+                              l->step();
+                          });
+    }
+
+    void fail(std::exception_ptr e)
+    {
+      lanxc::promise<std::size_t> done(std::move(_done));
+      done.reject_by_exception_ptr(std::move(e));
+    }
+
+    lanxc::readable_stream &_from;
+    lanxc::writable_stream &_to;
+    std::size_t _chunk;
+    std::size_t _total;
+    lanxc::task_context &_tc;
+    lanxc::promise<std::size_t> _done;
+    std::shared_ptr<lanxc::deferred> _task;
+    std::shared_ptr<lanxc::deferred> _resume;
+  };
+
+  /** @brief Initiator of a pipe, which owns its state along with the future */
+  struct pipe_initiator
+  {
+    lanxc::readable_stream &from;
+    lanxc::writable_stream &to;
+    std::size_t chunk;
+    std::shared_ptr<pipe_loop> loop;
+
+    void operator () (lanxc::promise<std::size_t> p)
+    {
+      loop = std::make_shared<pipe_loop>(from, to, chunk, std::move(p));
+      loop->step();
+    }
+  };
+}
+
+lanxc::future<std::size_t>
+lanxc::pipe(readable_stream &from, writable_stream &to, std::size_t chunk)
+{
+  // The first chunk is allocated only once the future is started
+  return future<std::size_t>(pipe_initiator{from, to, chunk, nullptr});
+}
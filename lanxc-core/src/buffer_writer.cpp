@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/buffer_writer.hpp>
+
+#include <algorithm>
+
+lanxc::buffer_writer::buffer_writer(writable_stream &out, std::size_t chunk)
+  : _out(out)
+  , _chunk{chunk}
+  , _filled{}
+  , _current{}
+  , _cursor{}
+  , _end{}
+{ }
+
+lanxc::buffer_writer::~buffer_writer() = default;
+
+void lanxc::buffer_writer::seal()
+{
+  if (!_current)
+    return;
+  _current->resize(static_cast<std::size_t>(_cursor - _current->data()));
+  if (_current->size() != 0)
+    _filled.push_back(std::move(*_current));
+  _current.reset();
+  _cursor = _end = nullptr;
+}
+
+void lanxc::buffer_writer::grow(std::size_t n)
+{
+  seal();
+  _current.reset(new writable_buffer(
+      _out.allocate_buffer(std::max(_chunk, n))));
+  _cursor = _current->data();
+  _end = _cursor + _current->capacity();
+}
+
+void lanxc::buffer_writer::put_bytes(const void *data, std::size_t size)
+{
+  auto p = static_cast<const std::uint8_t *>(data);
+  while (size != 0)
+  {
+    // Fill the rest of current buffer before allocating another
+    if (_cursor == _end)
+      grow(1);
+    std::size_t n = std::min(size, static_cast<std::size_t>(_end - _cursor));
+    std::memcpy(_cursor, p, n);
+    _cursor += n;
+    p += n;
+    size -= n;
+  }
+}
+
+std::size_t lanxc::buffer_writer::size() const noexcept
+{
+  std::size_t n = _filled.size();
+  if (_current)
+    n += static_cast<std::size_t>(_cursor - _current->data());
+  return n;
+}
+
+std::size_t lanxc::buffer_writer::commit()
+{
+  seal();
+  if (_filled.empty())
+    return 0;
+  return _out.write(std::move(_filled));
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/connection_pool.hpp>
+
+#include <exception>
+
+struct lanxc::connection_pool::connection
+    : link::list_node<connection>
+{
+  connection_endpoint::pointer endpoint;
+  destination *owner;
+  /** @brief Alarm closing it, while it's idle */
+  std::shared_ptr<alarm> expiry;
+
+  connection(connection_endpoint::pointer e, destination *d) noexcept
+    : endpoint(std::move(e))
+    , owner{d}
+    , expiry{}
+  { }
+
+  ~connection()
+  {
+    if (expiry)
+      expiry->cancel();
+  }
+};
+
+struct lanxc::connection_pool::destination
+{
+  const std::string address;
+  const std::uint16_t port;
+  /** @brief Idle connections, the least recently used one first */
+  link::list<connection> idle;
+  /** @brief Connections idle, in use or being established */
+  std::size_t connections;
+  /** @brief Acquisitions waiting for a connection being released */
+  std::deque<promise<connection_endpoint::pointer>> waiting;
+
+  destination(std::string a, std::uint16_t p)
+    : address(std::move(a))
+    , port{p}
+    , idle{}
+    , connections{0}
+    , waiting{}
+  { }
+};
+
+lanxc::connection_pool::
+connection_pool(task_context &tc,
+                std::shared_ptr<connection_endpoint_builder> builder,
+                std::size_t limit,
+                std::chrono::nanoseconds idle_timeout)
+  : _tc(tc)
+  , _builder(std::move(builder))
+  , _limit{limit == 0 ? 1 : limit}
+  , _idle_timeout{idle_timeout}
+  , _destinations{}
+  , _connections{}
+  , _statistics{0, 0, 0, 0}
+{ }
+
+lanxc::connection_pool::~connection_pool() = default;
+
+lanxc::future<lanxc::connection_endpoint::pointer>
+lanxc::connection_pool::acquire(std::string address, std::uint16_t port)
+{
+  auto self = shared_from_this();
+  return future<connection_endpoint::pointer>(
+      [self, address, port](promise<connection_endpoint::pointer> p)
+      {
+        auto &d = self->_destinations[std::make_pair(address, port)];
+        if (!d)
+          d.reset(new destination(address, port));
+        self->checkout(*d, std::move(p));
+      });
+}
+
+void
+lanxc::connection_pool::release(const connection_endpoint::pointer &endpoint,
+                                bool reusable)
+{
+  auto it = _connections.find(endpoint.get());
+  if (it == _connections.end() || it->second->is_linked())
+    return;
+  auto &c = *it->second;
+  auto &d = *c.owner;
+
+  if (!reusable || !endpoint->is_healthy())
+  {
+    drop(c);
+    settle(d);
+    return;
+  }
+
+  if (!d.waiting.empty())
+  {
+    auto p = std::move(d.waiting.front());
+    d.waiting.pop_front();
+    _statistics.reused++;
+    p.fulfill(endpoint);
+    return;
+  }
+
+  d.idle.push_back(c);
+  auto pc = &c;
+  c.expiry = _tc.schedule(std::chrono::steady_clock::now() + _idle_timeout,
+                          [this, pc]
+                          {
+                            // Being executed, nothing to cancel
+                            pc->expiry.reset();
+                            _statistics.expired++;
+                            auto &d = *pc->owner;
+                            drop(*pc);
+                            settle(d);
+                          });
+}
+
+std::size_t lanxc::connection_pool::idle() const noexcept
+{
+  std::size_t n = 0;
+  for (auto &d : _destinations)
+    n += d.second->idle.size();
+  return n;
+}
+
+void
+lanxc::connection_pool::checkout(destination &d,
+                                 promise<connection_endpoint::pointer> p)
+{
+  while (!d.idle.empty())
+  {
+    auto &c = d.idle.back();
+    d.idle.pop_back();
+    if (c.expiry)
+    {
+      c.expiry->cancel();
+      c.expiry.reset();
+    }
+    if (c.endpoint->is_healthy())
+    {
+      _statistics.reused++;
+      p.fulfill(c.endpoint);
+      return;
+    }
+    _statistics.unhealthy++;
+    drop(c);
+  }
+
+  if (d.connections < _limit)
+    connect(d, std::move(p));
+  else
+    d.waiting.push_back(std::move(p));
+}
+
+void
+lanxc::connection_pool::connect(destination &d,
+                                promise<connection_endpoint::pointer> p)
+{
+  d.connections++;
+  auto self = shared_from_this();
+  auto pd = &d;
+  auto reply = std::make_shared<promise<connection_endpoint::pointer>>(
+      std::move(p));
+
+  // The task is kept by its own routines until either of them is done,
+  // then released once they return
+  auto task = std::make_shared<std::shared_ptr<deferred>>();
+  auto finish = [self, task]
+  {
+    auto t = std::move(*task);
+    self->_tc.defer([t] { });
+  };
+
+  *task = _builder->connect(d.address, d.port)
+      .then([self, pd, reply, finish](connection_endpoint::pointer e)
+            {
+              self->_statistics.created++;
+              std::unique_ptr<connection> c{new connection(e, pd)};
+              self->_connections[e.get()] = std::move(c);
+              auto p = std::move(*reply);
+              p.fulfill(std::move(e));
+              finish();
+            })
+      // Whatever is thrown, the connection is not counted any longer
+      .caught<std::exception_ptr>([self, pd, reply, finish]
+                                  (std::exception_ptr &e)
+                                  {
+                                    auto p = std::move(*reply);
+                                    p.reject_by_exception_ptr(e);
+                                    pd->connections--;
+                                    self->settle(*pd);
+                                    finish();
+                                  })
+      .start(_tc);
+}
+
+void lanxc::connection_pool::drop(connection &c)
+{
+  c.owner->connections--;
+  _connections.erase(c.endpoint.get());
+}
+
+void lanxc::connection_pool::settle(destination &d)
+{
+  if (!d.waiting.empty())
+  {
+    if (d.connections < _limit)
+    {
+      auto p = std::move(d.waiting.front());
+      d.waiting.pop_front();
+      checkout(d, std::move(p));
+    }
+  }
+  else if (d.connections == 0)
+    _destinations.erase(std::make_pair(d.address, d.port));
+}
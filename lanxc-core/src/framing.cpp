@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/framing.hpp>
+
+#include <cassert>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define LANXC_FIND_BYTE_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+  const std::uint8_t *find_fallback(const std::uint8_t *data, std::size_t size,
+                                    std::uint8_t byte) noexcept
+  {
+    return static_cast<const std::uint8_t *>(std::memchr(data, byte, size));
+  }
+
+#ifdef LANXC_FIND_BYTE_X86
+  __attribute__((target("sse2")))
+  const std::uint8_t *find_sse2(const std::uint8_t *data, std::size_t size,
+                                std::uint8_t byte) noexcept
+  {
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(byte));
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(data + i));
+      int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+      if (mask != 0)
+        return data + i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+    for (; i < size; i++)
+      if (data[i] == byte)
+        return data + i;
+    return nullptr;
+  }
+
+  __attribute__((target("avx2")))
+  const std::uint8_t *find_avx2(const std::uint8_t *data, std::size_t size,
+                                std::uint8_t byte) noexcept
+  {
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(byte));
+    std::size_t i = 0;
+    // Delimiters are often near, e.g. short lines, so check a vector first
+    if (size >= 32)
+    {
+      __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(data)), needle);
+      auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(a));
+      if (mask != 0)
+        return data + __builtin_ctz(mask);
+      i = 32;
+    }
+    // Two vectors per iteration, with one branch for both
+    for (; i + 64 <= size; i += 64)
+    {
+      __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(data + i)), needle);
+      __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(data + i + 32)), needle);
+      if (_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)))
+        continue;
+      auto lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(a));
+      auto hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(b));
+      std::uint64_t mask = (std::uint64_t(hi) << 32) | lo;
+      return data + i + __builtin_ctzll(mask);
+    }
+    for (; i + 32 <= size; i += 32)
+    {
+      __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(data + i)), needle);
+      auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(a));
+      if (mask != 0)
+        return data + i + __builtin_ctz(mask);
+    }
+    return find_sse2(data + i, size - i, byte);
+  }
+
+  using finder = const std::uint8_t *(*)(const std::uint8_t *, std::size_t,
+                                         std::uint8_t) noexcept;
+
+  finder select_finder() noexcept
+  {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return find_avx2;
+    if (__builtin_cpu_supports("sse2"))
+      return find_sse2;
+    return find_fallback;
+  }
+#endif
+}
+
+const std::uint8_t *
+lanxc::find_byte(const std::uint8_t *data, std::size_t size,
+                 std::uint8_t byte) noexcept
+{
+#ifdef LANXC_FIND_BYTE_X86
+  static const finder f = select_finder();
+  return f(data, size, byte);
+#else
+  return find_fallback(data, size, byte);
+#endif
+}
+
+lanxc::delimited_framer::delimited_framer(buffer_manager &bm,
+                                          std::string delimiter,
+                                          std::size_t max_length)
+  : _bm(bm)
+  , _delimiter(std::move(delimiter))
+  , _max_length{max_length}
+  , _input{}
+  , _carried{}
+  , _finished{false}
+  , _failed{false}
+{
+  assert(!_delimiter.empty());
+}
+
+void lanxc::delimited_framer::feed(readable_buffer b)
+{
+  feed(buffer_slice(std::move(b)));
+}
+
+void lanxc::delimited_framer::feed(buffer_slice s)
+{
+  if (!s.empty())
+    _input.push_back(std::move(s));
+}
+
+std::size_t lanxc::delimited_framer::buffered() const noexcept
+{
+  std::size_t n = _carried.size();
+  for (auto &s : _input)
+    n += s.size();
+  return n;
+}
+
+void lanxc::delimited_framer::fail()
+{
+  _failed = true;
+  _input.clear();
+  _carried.clear();
+  throw frame_length_exception();
+}
+
+bool lanxc::delimited_framer::matches(const buffer_slice &in,
+                                      std::size_t j) const noexcept
+{
+  std::size_t d = _delimiter.size();
+  for (std::size_t k = 1; k < d; k++)
+  {
+    std::uint8_t c;
+    if (j >= k)
+      c = in[j - k];
+    else if (_carried.size() >= k - j)
+      c = _carried[_carried.size() - (k - j)];
+    else
+      return false;
+    if (c != static_cast<std::uint8_t>(_delimiter[d - 1 - k]))
+      return false;
+  }
+  return true;
+}
+
+bool lanxc::delimited_framer::search(const buffer_slice &in,
+                                     std::size_t &end) const noexcept
+{
+  auto last = static_cast<std::uint8_t>(_delimiter.back());
+  std::size_t from = 0;
+  while (from < in.size())
+  {
+    auto p = find_byte(in.data() + from, in.size() - from, last);
+    if (!p)
+      return false;
+    std::size_t j = static_cast<std::size_t>(p - in.data());
+    if (matches(in, j))
+    {
+      end = j + 1;
+      return true;
+    }
+    from = j + 1;
+  }
+  return false;
+}
+
+lanxc::buffer_slice
+lanxc::delimited_framer::join(const buffer_slice &in, std::size_t length)
+{
+  if (length == 0)
+  {
+    _carried.clear();
+    return buffer_slice();
+  }
+  writable_buffer b(_bm, length);
+  // The delimiter may begin among bytes carried
+  std::size_t carried = std::min(_carried.size(), length);
+  std::memcpy(b.data(), _carried.data(), carried);
+  if (length > carried)
+    std::memcpy(b.data() + carried, in.data(), length - carried);
+  _carried.clear();
+  return buffer_slice(readable_buffer(std::move(b)));
+}
+
+bool lanxc::delimited_framer::next(buffer_slice &frame)
+{
+  if (_failed)
+    throw frame_length_exception();
+  std::size_t d = _delimiter.size();
+  while (!_input.empty())
+  {
+    buffer_slice &in = _input.front();
+    std::size_t end;
+    if (search(in, end))
+    {
+      std::size_t length = _carried.size() + end - d;
+      if (length > _max_length)
+        fail();
+      if (_carried.empty())
+        frame = in.slice(0, length);
+      else
+        frame = join(in, length);
+      in.remove_prefix(end);
+      if (in.empty())
+        _input.pop_front();
+      return true;
+    }
+    // Bytes carried may end with a part of the delimiter
+    if (_carried.size() + in.size() > _max_length + d - 1)
+      fail();
+    _carried.insert(_carried.end(), in.data(), in.data() + in.size());
+    _input.pop_front();
+  }
+  if (_finished && !_carried.empty())
+  {
+    if (_carried.size() > _max_length)
+      fail();
+    frame = join(buffer_slice(), _carried.size());
+    return true;
+  }
+  return false;
+}
+
+lanxc::frame_reader::frame_reader(readable_stream &in, buffer_manager &bm,
+                                  std::string delimiter,
+                                  std::size_t max_length, std::size_t chunk)
+  : _in(in)
+  , _framer(bm, std::move(delimiter), max_length)
+  , _chunk{chunk}
+{ }
+
+lanxc::future<bool, lanxc::buffer_slice> lanxc::frame_reader::read()
+{
+  // Look for frames only once the future is started
+  return future<>::resolve().then([this] () -> future<bool, buffer_slice>
+                                  { return step(); });
+}
+
+lanxc::future<bool, lanxc::buffer_slice> lanxc::frame_reader::step()
+{
+  buffer_slice frame;
+  if (_framer.next(frame))
+    return future<bool, buffer_slice>::resolve(true, std::move(frame));
+  if (_framer.finished())
+    return future<bool, buffer_slice>::resolve(false, buffer_slice());
+  return _in.read(_chunk, 1)
+      .then([this](std::size_t n, readable_buffer b)
+                -> future<bool, buffer_slice>
+            {
+              if (n == 0)
+                _framer.finish();
+              else
+                _framer.feed(std::move(b));
+              return step();
+            });
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/length_prefixed.hpp>
+#include <lanxc/core/varint.hpp>
+
+#include <cstring>
+
+namespace
+{
+  /** @brief Bytes of prefix reserved for payload of @p capacity bytes */
+  std::size_t prefix_size(lanxc::length_prefix prefix, std::size_t capacity)
+  {
+    switch (prefix)
+    {
+    case lanxc::length_prefix::fixed16:
+      if (capacity > 0xffff)
+        throw lanxc::frame_length_exception();
+      return 2;
+    case lanxc::length_prefix::fixed32:
+      if (capacity > 0xffffffff)
+        throw lanxc::frame_length_exception();
+      return 4;
+    case lanxc::length_prefix::varint:
+      return lanxc::varint::size(capacity);
+    }
+    return 0;
+  }
+
+  /** @brief Encode @p length into exactly @p size bytes at @p out */
+  void encode(lanxc::length_prefix prefix, std::uint8_t *out,
+              std::size_t size, std::uint64_t length) noexcept
+  {
+    if (prefix == lanxc::length_prefix::varint)
+    {
+      // Pad with continuation bytes to fill the room reserved
+      for (std::size_t i = 0; i + 1 < size; i++)
+      {
+        out[i] = static_cast<std::uint8_t>((length & 0x7f) | 0x80);
+        length >>= 7;
+      }
+      out[size - 1] = static_cast<std::uint8_t>(length);
+      return;
+    }
+    for (std::size_t i = size; i-- > 0; )
+    {
+      out[i] = static_cast<std::uint8_t>(length);
+      length >>= 8;
+    }
+  }
+}
+
+lanxc::length_prefixed_decoder::length_prefixed_decoder(buffer_manager &bm,
+                                                        length_prefix prefix,
+                                                        std::size_t max_length)
+  : _bm(bm)
+  , _prefix{prefix}
+  , _max_length{max_length}
+  , _input{}
+  , _header{}
+  , _header_size{0}
+  , _length{0}
+  , _payload{}
+  , _filled{0}
+  , _failed{false}
+{ }
+
+void lanxc::length_prefixed_decoder::feed(readable_buffer b)
+{
+  feed(buffer_slice(std::move(b)));
+}
+
+void lanxc::length_prefixed_decoder::feed(buffer_slice s)
+{
+  if (!s.empty())
+    _input.push_back(std::move(s));
+}
+
+std::size_t lanxc::length_prefixed_decoder::buffered() const noexcept
+{
+  std::size_t n = _header_size + _filled;
+  for (auto &s : _input)
+    n += s.size();
+  return n;
+}
+
+void lanxc::length_prefixed_decoder::fail()
+{
+  _failed = true;
+  _input.clear();
+  _payload.reset();
+  throw frame_length_exception();
+}
+
+bool lanxc::length_prefixed_decoder::parse(const std::uint8_t *data,
+                                           std::size_t size,
+                                           std::size_t &used)
+{
+  used = 0;
+  if (_prefix == length_prefix::varint)
+  {
+    while (used < size)
+    {
+      std::uint8_t byte = data[used++];
+      if (_header_size == sizeof(_header))
+        fail();
+      _header[_header_size++] = byte;
+      if (byte < 0x80)
+        break;
+    }
+    if (_header[_header_size - 1] >= 0x80)
+      return false;
+    std::uint64_t length = 0;
+    for (std::size_t i = _header_size; i-- > 0; )
+    {
+      // Bits beyond 64 are malformed
+      if (i == 9 && _header[i] > 1)
+        fail();
+      length = (length << 7) | (_header[i] & 0x7f);
+    }
+    _length = length;
+  }
+  else
+  {
+    std::size_t width = _prefix == length_prefix::fixed16 ? 2 : 4;
+    used = std::min(width - _header_size, size);
+    std::memcpy(_header + _header_size, data, used);
+    _header_size += used;
+    if (_header_size < width)
+      return false;
+    _length = 0;
+    for (std::size_t i = 0; i < width; i++)
+      _length = (_length << 8) | _header[i];
+  }
+  _header_size = 0;
+  if (_length > _max_length)
+    fail();
+  return true;
+}
+
+std::size_t
+lanxc::length_prefixed_decoder::decode(std::vector<buffer_slice> &batch)
+{
+  if (_failed)
+    throw frame_length_exception();
+  std::size_t count = 0;
+  while (!_input.empty())
+  {
+    buffer_slice &in = _input.front();
+    if (_payload)
+    {
+      // Continue copying a payload spanning buffers
+      std::size_t n = std::min(in.size(), _payload->size() - _filled);
+      std::memcpy(_payload->data() + _filled, in.data(), n);
+      _filled += n;
+      in.remove_prefix(n);
+      if (_filled == _payload->size())
+      {
+        batch.emplace_back(readable_buffer(std::move(*_payload)));
+        _payload.reset();
+        _filled = 0;
+        count++;
+      }
+    }
+    else
+    {
+      std::size_t used;
+      bool complete = parse(in.data(), in.size(), used);
+      in.remove_prefix(used);
+      if (complete)
+      {
+        auto length = static_cast<std::size_t>(_length);
+        if (in.size() >= length)
+        {
+          batch.push_back(in.slice(0, length));
+          in.remove_prefix(length);
+          count++;
+        }
+        else
+          _payload.reset(new writable_buffer(_bm, length));
+      }
+    }
+    if (in.empty())
+      _input.pop_front();
+  }
+  return count;
+}
+
+lanxc::length_prefixed_reader::length_prefixed_reader(readable_stream &in,
+                                                      buffer_manager &bm,
+                                                      length_prefix prefix,
+                                                      std::size_t max_length,
+                                                      std::size_t chunk)
+  : _in(in)
+  , _decoder(bm, prefix, max_length)
+  , _chunk{chunk}
+  , _eof{false}
+{ }
+
+lanxc::future<std::vector<lanxc::buffer_slice>>
+lanxc::length_prefixed_reader::read()
+{
+  // Decode only once the future is started
+  return future<>::resolve()
+      .then([this] () -> future<std::vector<buffer_slice>>
+            { return step(); });
+}
+
+lanxc::future<std::vector<lanxc::buffer_slice>>
+lanxc::length_prefixed_reader::step()
+{
+  std::vector<buffer_slice> batch;
+  if (_decoder.decode(batch) != 0 || _eof)
+  {
+    if (batch.empty() && _decoder.buffered() != 0)
+      throw frame_truncated_exception();
+    return future<std::vector<buffer_slice>>::resolve(std::move(batch));
+  }
+  return _in.read(_chunk, 1)
+      .then([this](std::size_t n, readable_buffer b)
+                -> future<std::vector<buffer_slice>>
+            {
+              if (n == 0)
+                _eof = true;
+              else
+                _decoder.feed(std::move(b));
+              return step();
+            });
+}
+
+lanxc::length_prefixed_writer::length_prefixed_writer(writable_stream &out,
+                                                      length_prefix prefix)
+  : _out(out)
+  , _prefix{prefix}
+{ }
+
+lanxc::length_prefixed_writer::frame
+lanxc::length_prefixed_writer::allocate(std::size_t capacity)
+{
+  std::size_t header = prefix_size(_prefix, capacity);
+  return frame(_out.allocate_buffer(header + capacity), header);
+}
+
+std::size_t lanxc::length_prefixed_writer::write(frame f, std::size_t size)
+{
+  assert(size <= f.capacity());
+  encode(_prefix, f._buffer.data(), f._header, size);
+  f._buffer.resize(f._header + size);
+  return _out.write(std::move(f._buffer));
+}
+
+std::size_t lanxc::length_prefixed_writer::write(const void *payload,
+                                                 std::size_t size)
+{
+  frame f = allocate(size);
+  std::memcpy(f.data(), payload, size);
+  return write(std::move(f), size);
+}
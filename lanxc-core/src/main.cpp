@@ -38,7 +38,15 @@ lanxc::network_datagram_context::~network_datagram_context() = default;
 
 lanxc::network_context::~network_context() = default;
 
+lanxc::connection_endpoint::~connection_endpoint() = default;
+
+lanxc::connection_endpoint_builder::~connection_endpoint_builder() = default;
+
 lanxc::connection_listener::~connection_listener() = default;
 
+lanxc::datagram_endpoint::~datagram_endpoint() = default;
+
+lanxc::datagram_endpoint_builder::~datagram_endpoint_builder() = default;
+
 lanxc::connection_listener_builder::~connection_listener_builder() = default;
 
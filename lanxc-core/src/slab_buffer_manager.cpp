@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <lanxc/link/list.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace
+{
+  /** @brief Free blocks in a slab are linked through themselves */
+  struct free_block
+  {
+    free_block *next;
+  };
+
+  /** @brief The smallest class is 64 bytes */
+  constexpr std::size_t min_shift = 6;
+
+  /** @brief Slabs are at least 64KiB, and hold one block at least */
+  constexpr std::size_t min_slab_shift = 16;
+
+  /** @brief Most buffers a magazine holds */
+  constexpr std::size_t max_magazine = 64;
+
+  std::size_t ceil_log2(std::size_t n) noexcept
+  {
+    if (n <= 1)
+      return 0;
+#if defined(__GNUC__) || defined(__clang__)
+    return std::size_t(64 - __builtin_clzll(
+        static_cast<unsigned long long>(n - 1)));
+#else
+    std::size_t r = 0;
+    for (n -= 1; n != 0; n >>= 1) r++;
+    return r;
+#endif
+  }
+
+  std::uint8_t *allocate(std::size_t size)
+  {
+    void *p = std::malloc(size);
+    if (p == nullptr)
+      throw std::bad_alloc();
+    return static_cast<std::uint8_t *>(p);
+  }
+
+  void deallocate(std::uint8_t *data) noexcept
+  { std::free(data); }
+
+  /**
+   * @brief Map @p size bytes aligned to @p size, which is a power of two
+   * no less than a page, so that the slab of a block is found by masking
+   */
+  std::uint8_t *map_slab(std::size_t size)
+  {
+    void *p = ::mmap(nullptr, size * 2, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc();
+    auto begin = reinterpret_cast<std::uintptr_t>(p);
+    auto aligned = (begin + size - 1) & ~std::uintptr_t(size - 1);
+    if (aligned != begin)
+      ::munmap(p, aligned - begin);
+    if (aligned + size != begin + size * 2)
+      ::munmap(reinterpret_cast<void *>(aligned + size),
+               begin + size - aligned);
+    return reinterpret_cast<std::uint8_t *>(aligned);
+  }
+
+  void unmap_slab(std::uint8_t *base, std::size_t size) noexcept
+  { ::munmap(base, size); }
+
+  /** @brief A slab of blocks of the same class */
+  struct slab : lanxc::link::list_node<slab>
+  {
+    std::uint8_t *const base;
+    /** @brief Blocks released to the slab */
+    free_block *free;
+    /** @brief Blocks carved out of the slab so far, in address order */
+    std::size_t carved;
+    /** @brief Blocks taken out of the depot */
+    std::size_t used;
+
+    explicit slab(std::uint8_t *b) noexcept
+      : base(b)
+      , free(nullptr)
+      , carved(0)
+      , used(0)
+    { }
+  };
+}
+
+namespace lanxc
+{
+  struct slab_buffer_manager::state
+  {
+    using slab_map = std::unordered_map<std::uintptr_t, std::unique_ptr<slab>>;
+
+    struct depot
+    {
+      std::mutex lock;
+      /** @brief Slabs having blocks not taken out */
+      link::list<slab> available;
+      /** @brief All slabs of the class, by their base addresses */
+      slab_map slabs;
+    };
+
+    state(std::size_t high_watermark, std::size_t max_block_size,
+          std::size_t magazine_bytes)
+        : high_watermark(high_watermark)
+        , classes(ceil_log2(std::max(max_block_size,
+                                     std::size_t(1) << min_shift))
+                  - min_shift + 1)
+        , magazine_bytes(magazine_bytes)
+        , cached(0)
+        , mapped(0)
+        , closed(false)
+        , depots(new depot[classes])
+    { }
+
+    ~state()
+    {
+      // Blocks still in use are gone with the manager
+      for (std::size_t c = 0; c < classes; c++)
+        for (auto &e : depots[c].slabs)
+          unmap_slab(e.second->base, slab_size(c));
+    }
+
+    std::size_t class_size(std::size_t c) const noexcept
+    { return std::size_t(1) << (c + min_shift); }
+
+    std::size_t slab_size(std::size_t c) const noexcept
+    { return std::size_t(1) << std::max(c + min_shift, min_slab_shift); }
+
+    std::size_t slab_blocks(std::size_t c) const noexcept
+    { return slab_size(c) / class_size(c); }
+
+    std::size_t max_size() const noexcept
+    { return class_size(classes - 1); }
+
+    std::size_t class_of(std::size_t size) const noexcept
+    {
+      std::size_t shift = ceil_log2(size);
+      return shift <= min_shift ? 0 : shift - min_shift;
+    }
+
+    std::size_t capacity(std::size_t c) const noexcept
+    { return std::min(magazine_bytes / class_size(c), max_magazine); }
+
+    /**
+     * @brief Unmap an empty slab of class @p c, with the depot locked
+     * @return Iterator following the slab
+     */
+    slab_map::iterator unmap(std::size_t c, slab_map::iterator it) noexcept
+    {
+      auto &s = *it->second;
+      s.unlink();
+      cached.fetch_sub(slab_size(c), std::memory_order_relaxed);
+      mapped.fetch_sub(slab_size(c), std::memory_order_relaxed);
+      unmap_slab(s.base, slab_size(c));
+      return depots[c].slabs.erase(it);
+    }
+
+    /**
+     * @brief Put @p count blocks of class @p c back to their slabs, and
+     * unmap slabs becoming empty while the depot exceeds the high watermark
+     */
+    void put(std::size_t c, std::uint8_t **blocks, std::size_t count) noexcept
+    {
+      if (count == 0)
+        return;
+      auto &d = depots[c];
+      auto mask = ~std::uintptr_t(slab_size(c) - 1);
+      std::lock_guard<std::mutex> guard(d.lock);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        auto address = reinterpret_cast<std::uintptr_t>(blocks[i]);
+        auto it = d.slabs.find(address & mask);
+        auto &s = *it->second;
+        auto *b = reinterpret_cast<free_block *>(blocks[i]);
+        b->next = s.free;
+        s.free = b;
+        s.used--;
+        if (!s.is_linked())
+          d.available.push_back(s);
+        auto bytes = cached.fetch_add(class_size(c), std::memory_order_relaxed)
+                     + class_size(c);
+        if (s.used == 0 && bytes > high_watermark)
+          unmap(c, it);
+      }
+    }
+
+    /**
+     * @brief Take at most @p count blocks of class @p c from depot, mapping
+     * a new slab if there is none available
+     * @throws std::bad_alloc if a slab can't be mapped
+     */
+    std::size_t take(std::size_t c, std::uint8_t **blocks, std::size_t count)
+    {
+      auto &d = depots[c];
+      std::lock_guard<std::mutex> guard(d.lock);
+      if (d.available.empty())
+      {
+        auto base = map_slab(slab_size(c));
+        try
+        {
+          std::unique_ptr<slab> s(new slab(base));
+          d.available.push_back(*s);
+          d.slabs[reinterpret_cast<std::uintptr_t>(base)] = std::move(s);
+        }
+        catch (...)
+        {
+          unmap_slab(base, slab_size(c));
+          throw;
+        }
+        cached.fetch_add(slab_size(c), std::memory_order_relaxed);
+        mapped.fetch_add(slab_size(c), std::memory_order_relaxed);
+      }
+
+      std::size_t n = 0;
+      while (n < count && !d.available.empty())
+      {
+        auto &s = d.available.front();
+        while (n < count && s.free != nullptr)
+        {
+          blocks[n++] = reinterpret_cast<std::uint8_t *>(s.free);
+          s.free = s.free->next;
+          s.used++;
+        }
+        while (n < count && s.carved < slab_blocks(c))
+        {
+          blocks[n++] = s.base + s.carved++ * class_size(c);
+          s.used++;
+        }
+        if (s.free == nullptr && s.carved == slab_blocks(c))
+          s.unlink();
+      }
+      cached.fetch_sub(n * class_size(c), std::memory_order_relaxed);
+      return n;
+    }
+
+    /** @brief Unmap every empty slab */
+    void clear() noexcept
+    {
+      for (std::size_t c = 0; c < classes; c++)
+      {
+        std::lock_guard<std::mutex> guard(depots[c].lock);
+        auto it = depots[c].slabs.begin();
+        while (it != depots[c].slabs.end())
+          it = it->second->used == 0 ? unmap(c, it) : std::next(it);
+      }
+    }
+
+    const std::size_t high_watermark;
+    const std::size_t classes;
+    const std::size_t magazine_bytes;
+    std::atomic<std::size_t> cached;
+    std::atomic<std::size_t> mapped;
+    std::atomic<bool> closed;
+    std::unique_ptr<depot[]> depots;
+  };
+
+  /** @brief Magazines of a thread for a manager */
+  struct slab_buffer_manager::thread_cache
+  {
+    struct magazine
+    {
+      std::unique_ptr<std::uint8_t *[]> items;
+      std::size_t count = 0;
+      std::size_t capacity = 0;
+    };
+
+    explicit thread_cache(std::shared_ptr<state> s)
+        : owner(std::move(s))
+        , magazines(new magazine[owner->classes])
+    {
+      for (std::size_t c = 0; c < owner->classes; c++)
+      {
+        auto &m = magazines[c];
+        m.capacity = owner->capacity(c);
+        if (m.capacity != 0)
+          m.items.reset(new std::uint8_t *[m.capacity]);
+      }
+    }
+
+    ~thread_cache()
+    { flush(); }
+
+    void flush() noexcept
+    {
+      for (std::size_t c = 0; c < owner->classes; c++)
+      {
+        auto &m = magazines[c];
+        owner->put(c, m.items.get(), m.count);
+        m.count = 0;
+      }
+    }
+
+    std::shared_ptr<state> owner;
+    std::unique_ptr<magazine[]> magazines;
+  };
+
+  /** @brief Caches of a thread for all managers it has used */
+  struct slab_buffer_manager::registry
+  {
+    std::vector<std::unique_ptr<thread_cache>> caches;
+    const state *last = nullptr;
+    thread_cache *last_cache = nullptr;
+  };
+
+  slab_buffer_manager::thread_cache &
+  slab_buffer_manager::get_cache(const std::shared_ptr<state> &s)
+  {
+    static thread_local registry r;
+    if (r.last == s.get())
+      return *r.last_cache;
+
+    // Caches of destroyed managers are dropped lazily, while states of them
+    // are kept alive by the caches, so that their addresses are not reused
+    r.last = nullptr;
+    r.last_cache = nullptr;
+    r.caches.erase(std::remove_if(r.caches.begin(), r.caches.end(),
+                                  [](const std::unique_ptr<thread_cache> &c)
+                                  { return c->owner->closed.load(); }),
+                   r.caches.end());
+
+    thread_cache *found = nullptr;
+    for (auto &c : r.caches)
+      if (c->owner == s)
+        found = c.get();
+    if (found == nullptr)
+    {
+      std::unique_ptr<thread_cache> c(new thread_cache(s));
+      r.caches.push_back(std::move(c));
+      found = r.caches.back().get();
+    }
+    r.last = s.get();
+    r.last_cache = found;
+    return *found;
+  }
+
+  slab_buffer_manager::slab_buffer_manager(std::size_t high_watermark,
+                                           std::size_t max_block_size,
+                                           std::size_t magazine_bytes)
+      : _state(std::make_shared<state>(high_watermark, max_block_size,
+                                       magazine_bytes))
+  { }
+
+  slab_buffer_manager::~slab_buffer_manager()
+  {
+    _state->closed.store(true);
+    _state->clear();
+  }
+
+  std::uint8_t *slab_buffer_manager::acquire(std::size_t size)
+  {
+    state &s = *_state;
+    if (size > s.max_size())
+      return allocate(size);
+
+    std::size_t c = s.class_of(size);
+    auto &m = get_cache(_state).magazines[c];
+    if (m.count != 0)
+      return m.items[--m.count];
+
+    if (m.capacity != 0)
+    {
+      m.count = s.take(c, m.items.get(), std::max<std::size_t>(m.capacity / 2, 1));
+      return m.items[--m.count];
+    }
+    std::uint8_t *block;
+    s.take(c, &block, 1);
+    return block;
+  }
+
+  void slab_buffer_manager::release(std::uint8_t *data, std::size_t size)
+  noexcept
+  {
+    if (data == nullptr)
+      return;
+
+    state &s = *_state;
+    if (size > s.max_size())
+    {
+      deallocate(data);
+      return;
+    }
+
+    std::size_t c = s.class_of(size);
+    thread_cache *cache;
+    try
+    {
+      cache = &get_cache(_state);
+    }
+    catch (...)
+    {
+      s.put(c, &data, 1);
+      return;
+    }
+
+    auto &m = cache->magazines[c];
+    if (m.count == m.capacity)
+    {
+      if (m.capacity == 0)
+      {
+        s.put(c, &data, 1);
+        return;
+      }
+      std::size_t half = std::max<std::size_t>(m.capacity / 2, 1);
+      m.count -= half;
+      s.put(c, m.items.get() + m.count, half);
+    }
+    m.items[m.count++] = data;
+  }
+
+  std::size_t slab_buffer_manager::cached_bytes() const noexcept
+  { return _state->cached.load(std::memory_order_relaxed); }
+
+  std::size_t slab_buffer_manager::mapped_bytes() const noexcept
+  { return _state->mapped.load(std::memory_order_relaxed); }
+
+  void slab_buffer_manager::trim() noexcept
+  {
+    try
+    {
+      get_cache(_state).flush();
+    }
+    catch (...)
+    {
+      // Nothing cached by this thread if its cache can't be created
+    }
+    _state->clear();
+  }
+
+  std::size_t slab_buffer_manager::block_size(std::size_t size) const noexcept
+  {
+    if (size > _state->max_size())
+      return size;
+    return _state->class_size(_state->class_of(size));
+  }
+}
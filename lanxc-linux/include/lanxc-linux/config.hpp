@@ -0,0 +1,12 @@
+
+
+#pragma once
+
+
+#if defined(LANXC_LINUX_SHARED_LIBRARY)
+  #define LANXC_LINUX_EXPORT __attribute__((visibility("default")))
+  #define LANXC_LINUX_HIDDEN __attribute__((visibility("hidden")))
+#else
+  #define LANXC_LINUX_EXPORT
+  #define LANXC_LINUX_HIDDEN
+#endif
\ No newline at end of file
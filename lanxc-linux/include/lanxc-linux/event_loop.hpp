@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/task_context.hpp>
+#include <lanxc-linux/config.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+    class event_channel;
+
+    /**
+     * @brief Task context dispatching events of file descriptors by epoll
+     *
+     * Each round runs alarms due, then tasks deferred, and then waits for
+     * events of channels until the next alarm. @ref run returns once there
+     * is nothing to wait for, i.e. no task, no alarm and no channel
+     * interested in any event, or @ref stop has been called.
+     *
+     * Like `applism::event_loop`, it must be used from a single thread.
+     */
+    class LANXC_LINUX_EXPORT event_loop : public virtual task_context
+    {
+      friend class event_channel;
+    public:
+      event_loop();
+
+      ~event_loop() override;
+
+      event_loop(const event_loop &) = delete;
+      event_loop &operator = (const event_loop &) = delete;
+
+      void run() override;
+
+      /** @brief Make @ref run return after the current round */
+      void stop() noexcept;
+
+      std::shared_ptr<deferred> defer(function<void()> routine) override;
+
+      std::shared_ptr<alarm> schedule(time_point t,
+                                      function<void()> routine) override;
+
+    private:
+      struct detail;
+      std::unique_ptr<detail> _detail;
+    };
+
+    /**
+     * @brief A file descriptor watched by an event loop
+     *
+     * Events are level triggered, so a handler that leaves the descriptor
+     * readable or writable is called again in the next round. A channel
+     * interested in no event is removed from epoll, e.g. to stop reading
+     * from a peer while the data received is not consumed yet. Errors and
+     * hang up are reported as the events the channel is interested in, and
+     * detected by the handlers from the result of their system calls.
+     */
+    class LANXC_LINUX_EXPORT event_channel
+    {
+      friend class event_loop;
+    public:
+      static constexpr std::uint32_t readable = 1;
+      static constexpr std::uint32_t writable = 2;
+
+      /** @note The channel is interested in no event initially */
+      event_channel(event_loop &loop, int fd) noexcept;
+
+      virtual ~event_channel();
+
+      event_channel(const event_channel &) = delete;
+      event_channel &operator = (const event_channel &) = delete;
+
+      /**
+       * @brief Set events interested, a combination of @ref readable and
+       * @ref writable
+       */
+      void set_events(std::uint32_t events);
+
+      std::uint32_t events() const noexcept
+      { return _events; }
+
+      event_loop &loop() const noexcept
+      { return _loop; }
+
+    protected:
+      virtual void on_readable() = 0;
+      virtual void on_writable() = 0;
+
+    private:
+      event_loop &_loop;
+      int _fd;
+      std::uint32_t _events;
+    };
+
+  }
+}
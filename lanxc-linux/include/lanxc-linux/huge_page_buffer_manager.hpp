@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc-linux/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief Buffer manager carving buffers out of arenas backed by huge
+     * pages, to reduce TLB misses when large buffers are streamed through
+     *
+     * Arenas are mapped with `MAP_HUGETLB` first, which requires huge pages
+     * reserved by administrator, then with `madvise(MADV_HUGEPAGE)` if
+     * transparent huge pages are enabled, and with normal pages otherwise.
+     * Buffers are rounded up to 64KiB, and placed in arenas by first fit
+     * over a bitmap of used granules. Arenas are kept until the manager is
+     * destroyed, except for those mapped for a single buffer larger than an
+     * arena, which are unmapped once the buffer is released.
+     */
+    class LANXC_LINUX_EXPORT huge_page_buffer_manager : public buffer_manager
+    {
+    public:
+      /** @brief Pages backing arenas */
+      enum class page_mode
+      {
+        huge_tlb,     /**< Huge pages reserved via hugetlbfs */
+        transparent,  /**< Normal mapping advised to use huge pages */
+        normal        /**< Normal pages */
+      };
+
+      /** @brief Granularity of buffers */
+      static constexpr std::size_t granularity = 64 << 10;
+
+      /** @brief Size of huge pages assumed for alignment of arenas */
+      static constexpr std::size_t huge_page_size = 2 << 20;
+
+      /**
+       * @param arena_size Size of each arena, rounded up to huge page size
+       * @param preferred The most preferred mode, modes after it are tried
+       *                  when it's not available
+       * @throws std::system_error if the first arena can't be mapped at all
+       */
+      explicit huge_page_buffer_manager(std::size_t arena_size = 64 << 20,
+                                        page_mode preferred
+                                            = page_mode::huge_tlb);
+
+      ~huge_page_buffer_manager() override;
+
+      huge_page_buffer_manager(const huge_page_buffer_manager &) = delete;
+      huge_page_buffer_manager &
+      operator = (const huge_page_buffer_manager &) = delete;
+
+      /**
+       * @brief Acquire a buffer of at least @p size bytes
+       * @throws std::system_error if a new arena can't be mapped
+       */
+      std::uint8_t *acquire(std::size_t size) override;
+
+      void release(std::uint8_t *data, std::size_t size) noexcept override;
+
+      /** @brief Mode of the most recently mapped arena */
+      page_mode mode() const noexcept;
+
+      /** @brief Total bytes mapped for arenas */
+      std::size_t mapped_bytes() const noexcept;
+
+      static const char *to_string(page_mode mode) noexcept;
+
+    private:
+      struct arena
+      {
+        std::uint8_t *base;
+        std::size_t size;
+        page_mode mode;
+        bool dedicated;
+        std::vector<std::uint64_t> used;  /**< Bitmap of used granules */
+      };
+
+      arena &map_arena(std::size_t size, bool dedicated);
+      static void unmap_arena(arena &a) noexcept;
+      static std::uint8_t *carve(arena &a, std::size_t granules) noexcept;
+
+      mutable std::mutex _lock;
+      std::vector<std::unique_ptr<arena>> _arenas;
+      const std::size_t _arena_size;
+      const page_mode _preferred;
+      page_mode _mode;
+      std::size_t _mapped;
+    };
+
+  }
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc-linux/config.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief A single producer single consumer ring buffer whose memory is
+     * mapped twice back to back
+     *
+     * The same pages of a `memfd` are mapped at `[base, base + capacity)`
+     * and `[base + capacity, base + 2 * capacity)`, so bytes readable, as
+     * well as room writable, always form one contiguous region, even when
+     * they wrap around the end of ring. Parsers may then read a message in
+     * place without checking for the wrap or copying it out.
+     *
+     * Regions are accessed without locking, by one producer thread and one
+     * consumer thread, either directly or via the @ref reader and
+     * @ref writer streams returned by input() and output(), which block
+     * until bytes or room are available.
+     */
+    class LANXC_LINUX_EXPORT mirrored_ring
+    {
+    public:
+      /**
+       * @brief The consumer side
+       *
+       * Buffers read by `read(size, watermark)` are views into the ring
+       * rather than copies, whose bytes are consumed when the buffers are
+       * released, so they must be released in the order they are read.
+       */
+      class LANXC_LINUX_EXPORT reader
+          : public readable_stream
+          , private buffer_manager
+      {
+        friend class mirrored_ring;
+      public:
+        future<size_t, readable_buffer>
+        read(std::size_t size, std::size_t watermark) override;
+
+        future<std::size_t, buffer_chain> read(buffer_chain chain) override;
+
+        void discard() override;
+
+      private:
+        explicit reader(mirrored_ring &ring) noexcept;
+        std::uint8_t *acquire(std::size_t size) override;
+        void release(std::uint8_t *data, std::size_t size) noexcept override;
+
+        mirrored_ring &_ring;
+        std::size_t _viewed;
+      };
+
+      /**
+       * @brief The producer side
+       *
+       * Buffers allocated are room inside of the ring, so writing them
+       * commits bytes without copying, while other buffers are copied in.
+       */
+      class LANXC_LINUX_EXPORT writer
+          : public writable_stream
+          , private buffer_manager
+      {
+        friend class mirrored_ring;
+      public:
+        /**
+         * @note @p size must not exceed capacity of ring
+         * @note Buffers allocated are all the room at the front of the
+         * ring until one is written, so they would alias each other: only
+         * one may be held at a time, which is asserted
+         */
+        writable_buffer allocate_buffer(std::size_t size) override;
+
+        std::size_t write(writable_buffer b) override;
+
+        std::size_t write(buffer_chain chain) override;
+
+        void close() override;
+
+        future<> flush() override;
+
+      private:
+        explicit writer(mirrored_ring &ring) noexcept;
+        std::uint8_t *acquire(std::size_t size) override;
+        void release(std::uint8_t *data, std::size_t size) noexcept override;
+        void copy(const std::uint8_t *data, std::size_t size);
+
+        mirrored_ring &_ring;
+        bool _allocated;
+      };
+
+      /**
+       * @param capacity Bytes of ring, rounded up to a power of two no less
+       *                 than page size
+       * @throws std::system_error if the memory can't be mapped
+       */
+      explicit mirrored_ring(std::size_t capacity);
+
+      ~mirrored_ring();
+
+      mirrored_ring(const mirrored_ring &) = delete;
+      mirrored_ring &operator = (const mirrored_ring &) = delete;
+
+      std::size_t capacity() const noexcept
+      { return _capacity; }
+
+      /** @brief Bytes readable from @ref read_region */
+      std::size_t readable() const noexcept
+      {
+        return _tail.load(std::memory_order_acquire)
+               - _head.load(std::memory_order_relaxed);
+      }
+
+      /** @brief Bytes writable to @ref write_region */
+      std::size_t writable() const noexcept
+      {
+        return _capacity - (_tail.load(std::memory_order_relaxed)
+                            - _head.load(std::memory_order_acquire));
+      }
+
+      /** @brief The contiguous region of @ref readable bytes */
+      const std::uint8_t *read_region() const noexcept
+      { return _base + (_head.load(std::memory_order_relaxed) & _mask); }
+
+      /** @brief The contiguous region of @ref writable bytes */
+      std::uint8_t *write_region() noexcept
+      { return _base + (_tail.load(std::memory_order_relaxed) & _mask); }
+
+      /** @brief Consume @p n bytes read from @ref read_region */
+      void consume(std::size_t n) noexcept
+      {
+        _head.store(_head.load(std::memory_order_relaxed) + n,
+                    std::memory_order_release);
+        wake();
+      }
+
+      /** @brief Commit @p n bytes written to @ref write_region */
+      void commit(std::size_t n) noexcept
+      {
+        _tail.store(_tail.load(std::memory_order_relaxed) + n,
+                    std::memory_order_release);
+        wake();
+      }
+
+      reader &input() noexcept
+      { return _reader; }
+
+      writer &output() noexcept
+      { return _writer; }
+
+    private:
+      void wake() noexcept
+      {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_waiters.load(std::memory_order_relaxed) != 0)
+        {
+          std::lock_guard<std::mutex> guard(_lock);
+          _changed.notify_all();
+        }
+      }
+
+      template<typename Predicate>
+      void wait(Predicate &&ready);
+
+      std::uint8_t *_base;
+      std::size_t _capacity;
+      std::size_t _mask;
+      alignas(64) std::atomic<std::uint64_t> _head;
+      alignas(64) std::atomic<std::uint64_t> _tail;
+      std::atomic<bool> _closed;
+      std::atomic<bool> _discarded;
+      std::atomic<int> _waiters;
+      std::mutex _lock;
+      std::condition_variable _changed;
+      reader _reader;
+      writer _writer;
+    };
+
+  }
+}
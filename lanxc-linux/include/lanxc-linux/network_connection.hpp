@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/network_context.hpp>
+#include <lanxc-linux/socket_stream.hpp>
+#include <lanxc-linux/config.hpp>
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief Parse a numeric IPv4 or IPv6 address
+     * @return Length of the socket address, or 0 if @p address is invalid
+     */
+    LANXC_LINUX_EXPORT socklen_t
+    parse_socket_address(const std::string &address, std::uint16_t port,
+                         sockaddr_storage &out) noexcept;
+
+    /**
+     * @brief Options set to stream sockets by builders, before they
+     * connect or listen, where 0 keeps the default of the system
+     */
+    struct LANXC_LINUX_EXPORT socket_options
+    {
+      bool no_delay;
+      std::size_t send_buffer_size;
+      std::size_t receive_buffer_size;
+      /** @brief Raising it over `net.core.busy_read` needs CAP_NET_ADMIN */
+      std::chrono::microseconds busy_poll;
+      std::chrono::milliseconds user_timeout;
+
+      /**
+       * @brief Set options to @p fd, those of TCP are skipped for Unix
+       * domain sockets
+       * @return 0, or the error number of the option failed
+       */
+      int apply(int fd, int family) const noexcept;
+    };
+
+    /** @brief A connection established, read and written as a stream */
+    class LANXC_LINUX_EXPORT socket_endpoint
+        : public connection_endpoint
+        , public socket_stream
+    {
+    public:
+      using socket_stream::socket_stream;
+
+      ~socket_endpoint() override;
+
+      /**
+       * @brief Whether the stream is open with nothing buffered or queued,
+       * and the peer hasn't closed or reset the connection since the loop
+       * last polled it
+       */
+      bool is_healthy() const noexcept override;
+    };
+
+    /**
+     * @brief Builder of @ref socket_endpoint connecting without blocking
+     * the event loop
+     *
+     * The socket is created in non-blocking mode, and the connection is
+     * established once the socket becomes writable, so that a loop may
+     * initiate many connections at once, each waiting for a round trip on
+     * its own. Addresses are numeric IPv4 or IPv6 addresses.
+     */
+    class LANXC_LINUX_EXPORT socket_endpoint_builder
+        : public connection_endpoint_builder
+        , public std::enable_shared_from_this<socket_endpoint_builder>
+    {
+    public:
+      /** @param bm Buffer manager of endpoints connected */
+      socket_endpoint_builder(event_loop &loop, buffer_manager &bm) noexcept;
+
+      ~socket_endpoint_builder() override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      bind(std::string address, std::uint16_t port) override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      set_connect_timeout(std::chrono::nanoseconds timeout) override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      set_no_delay(bool enabled) override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      set_send_buffer_size(std::size_t bytes) override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      set_receive_buffer_size(std::size_t bytes) override;
+
+      /** @note It's done by `TCP_FASTOPEN_CONNECT` */
+      std::shared_ptr<connection_endpoint_builder>
+      set_fast_open(bool enabled) override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      set_busy_poll(std::chrono::microseconds duration) override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      set_user_timeout(std::chrono::milliseconds timeout) override;
+
+      /**
+       * @note The future is rejected by `std::system_error`, of
+       * `ETIMEDOUT` if the connect timeout expires
+       */
+      future<connection_endpoint::pointer>
+      connect(std::string address, std::uint16_t port) override;
+
+    private:
+      class connecting;
+
+      event_loop &_loop;
+      buffer_manager &_bm;
+      sockaddr_storage _source;
+      socklen_t _source_length;
+      std::chrono::nanoseconds _timeout;
+      socket_options _options;
+      bool _fast_open;
+    };
+
+    /**
+     * @brief Listener accepting connections by `accept4`, which creates
+     * them in non-blocking mode without further system calls
+     *
+     * At most a budget of connections are accepted each time the socket is
+     * readable, the rest are left in the backlog until the next round of
+     * the event loop, so that a flood of connections doesn't starve other
+     * channels of the loop. A descriptor is reserved, so that once the
+     * process runs out of descriptors it's released to accept and close
+     * pending connections right away, rather than leaving them in the
+     * backlog to wake the loop up over and over. If accepting still fails,
+     * e.g. short of memory, the socket is not polled for a while, which
+     * doubles up to a second while it keeps failing.
+     */
+    class LANXC_LINUX_EXPORT socket_listener
+        : public connection_listener
+        , private event_channel
+    {
+    public:
+      struct accepting_statistics
+      {
+        std::uint64_t accepted;
+
+        /** @brief Connections closed right away without descriptors left */
+        std::uint64_t rejected;
+      };
+
+      /**
+       * @param fd A listening socket in non-blocking mode
+       * @param bm Buffer manager of endpoints accepted
+       * @param budget Connections accepted in each round of the loop at most
+       */
+      socket_listener(event_loop &loop, unixy::file_descriptor fd,
+                      buffer_manager &bm, std::size_t budget = 32);
+
+      ~socket_listener() override;
+
+      /**
+       * @brief Start accepting connections, passing them to @p cb
+       * @note The listener may be destroyed by @p cb, but @p cb must not
+       * be replaced by itself
+       */
+      void listen(function<void(connection_endpoint::pointer)> cb) override;
+
+      /** @brief The listening socket, e.g. to find the port bound */
+      int native_handle() const noexcept
+      { return _fd; }
+
+      const accepting_statistics &statistics() const noexcept
+      { return _statistics; }
+
+    private:
+      void on_readable() override;
+      void on_writable() override;
+
+      /** @brief Accept a pending connection and close it */
+      bool reject();
+
+      /** @brief Stop polling the socket, and resume after a while */
+      void back_off();
+
+      unixy::file_descriptor _fd;
+      buffer_manager &_bm;
+      const std::size_t _budget;
+      sa_family_t _family;
+      unixy::file_descriptor _spare;
+      function<void(connection_endpoint::pointer)> _callback;
+      accepting_statistics _statistics;
+      /** @brief Alarm to resume polling after accepting failed, if any */
+      std::shared_ptr<alarm> _retry;
+      std::chrono::milliseconds _back_off;
+
+      /** @brief Set once destroyed while passing connections accepted */
+      bool *_destroyed;
+    };
+
+    /**
+     * @brief Builder of @ref socket_listener, on a numeric IPv4 or IPv6
+     * address, or a path of Unix domain socket
+     */
+    class LANXC_LINUX_EXPORT socket_listener_builder
+        : public connection_listener_builder
+        , public std::enable_shared_from_this<socket_listener_builder>
+    {
+    public:
+      /** @param bm Buffer manager of endpoints accepted */
+      socket_listener_builder(event_loop &loop, buffer_manager &bm) noexcept;
+
+      ~socket_listener_builder() override;
+
+      std::shared_ptr<connection_listener_builder>
+      bind(std::string address, std::uint16_t port) override;
+
+      /** @brief Bind @p port of all IPv4 addresses */
+      std::shared_ptr<connection_listener_builder>
+      bind(std::uint16_t port) override;
+
+      std::shared_ptr<connection_listener_builder>
+      bind(std::string path) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_reuse_port(bool enabled) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_reuse_address(bool enabled) override;
+
+      /**
+       * @note Options of sockets are inherited by connections accepted,
+       * so they are set once to the listening socket
+       */
+      std::shared_ptr<connection_listener_builder>
+      set_no_delay(bool enabled) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_send_buffer_size(std::size_t bytes) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_receive_buffer_size(std::size_t bytes) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_fast_open(std::size_t pending) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_defer_accept(std::chrono::seconds timeout) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_busy_poll(std::chrono::microseconds duration) override;
+
+      std::shared_ptr<connection_listener_builder>
+      set_user_timeout(std::chrono::milliseconds timeout) override;
+
+      /** @note It's capped by `net.core.somaxconn` */
+      std::shared_ptr<connection_listener_builder>
+      set_backlog(int connections) override;
+
+      /**
+       * @brief Set connections accepted each time the listener is
+       * readable at most, before yielding to other channels of the loop
+       */
+      std::shared_ptr<socket_listener_builder>
+      set_accept_budget(std::size_t connections);
+
+      /** @throw std::system_error if the socket fails to listen */
+      std::shared_ptr<connection_listener>
+      build(function<void(connection_endpoint::pointer)> routine) override;
+
+    private:
+      event_loop &_loop;
+      buffer_manager &_bm;
+      sockaddr_storage _address;
+      socklen_t _length;
+      bool _reuse_port;
+      bool _reuse_address;
+      std::size_t _budget;
+      socket_options _options;
+      std::size_t _fast_open;
+      std::chrono::seconds _defer_accept;
+      int _backlog;
+    };
+
+  }
+}
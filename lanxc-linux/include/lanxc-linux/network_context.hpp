@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc/core/network_context.hpp>
+#include <lanxc-linux/event_loop.hpp>
+#include <lanxc-linux/config.hpp>
+
+#include <memory>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief Builders of sockets dispatched by an event loop, with buffers
+     * of streams and datagrams taken from a buffer manager
+     *
+     * Connections are @ref socket_endpoint and @ref socket_listener, and
+     * datagram endpoints are @ref udp_endpoint. Both the loop and the
+     * buffer manager must outlive the context and all it builds.
+     */
+    class LANXC_LINUX_EXPORT network_context
+        : public virtual lanxc::network_context
+    {
+    public:
+      network_context(event_loop &loop, buffer_manager &bm) noexcept;
+
+      ~network_context() override;
+
+      std::shared_ptr<connection_listener_builder>
+      build_connection_listener() override;
+
+      std::shared_ptr<connection_endpoint_builder>
+      build_connection_endpoint() override;
+
+      std::shared_ptr<datagram_endpoint_builder>
+      create_datagram_endpoint() override;
+
+    private:
+      event_loop &_loop;
+      buffer_manager &_bm;
+    };
+
+  }
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc-linux/config.hpp>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief Move all bytes of @p from to @p to until the end of @p from,
+     * inside of kernel where possible
+     *
+     * When both streams are `unixy::stream`, bytes of a regular file are
+     * sent by `sendfile`, and bytes of other descriptors are moved by
+     * `splice`, either directly if one end is a pipe or through a pipe
+     * created for the transfer. Otherwise, or if the kernel refuses the
+     * descriptors, bytes are copied by `lanxc::pipe`. Bytes moved inside
+     * of kernel are waited by `poll` like reads and writes of
+     * `unixy::stream`, so the thread starting the future blocks until the
+     * end of @p from.
+     *
+     * `socket_stream` is not moved inside of kernel, although it's backed
+     * by a descriptor: it buffers bytes received ahead of reads, and its
+     * event loop owns polling of the descriptor, so splicing behind it would
+     * reorder bytes and race with the loop. It's copied by `lanxc::pipe`
+     * through its own reads and writes, which never block the loop.
+     *
+     * @warning This is a blocking utility for threads outside of any event
+     * loop, e.g. a thread of its own which runs an executor of its own for
+     * the future. Started on the thread of an event loop, it freezes the
+     * loop until the end of @p from; such threads copy with `lanxc::pipe`
+     * between streams driven by the loop instead.
+     * @param chunk Bytes moved by each system call
+     * @returns A future resolved with bytes moved
+     */
+    LANXC_LINUX_EXPORT future<std::size_t>
+    pipe(readable_stream &from, writable_stream &to,
+         std::size_t chunk = 64 << 10);
+
+  }
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc-linux/event_loop.hpp>
+#include <lanxc-linux/config.hpp>
+#include <lanxc-unixy/unixy.hpp>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief A non-blocking stream over a socket, driven by an event loop,
+     * with watermarks bounding bytes buffered in both directions
+     *
+     * Bytes received are buffered until consumed by `read`. Once they
+     * exceed the high receiving watermark, the descriptor is no longer
+     * polled, so the peer is slowed down by TCP flow control rather than
+     * growing the buffer, and polling resumes once they drop below the low
+     * receiving watermark.
+     *
+     * Bytes written are sent right away as far as the socket buffer allows,
+     * and the rest is queued until the socket is writable again. Writers
+     * should stop once @ref queued exceeds the high sending watermark, and
+     * wait for @ref drain, resolved once it drops below the low one.
+     *
+     * With @ref coalescing enabled, small writes are held in the queue
+     * rather than sent one by one, and sent together by a single `sendmsg`
+     * at the end of the loop iteration, after a delay, once enough bytes
+     * are held, or once @ref flush, @ref drain or @ref close is called.
+     *
+     * Over a Unix domain socket, file descriptors may be passed along with
+     * bytes written, and descriptors received are kept until taken, along
+     * with the offset of the byte they arrived with.
+     */
+    class LANXC_LINUX_EXPORT socket_stream
+        : public readable_stream
+        , public writable_stream
+        , private event_channel
+    {
+    public:
+      /** @brief Thresholds of holding small writes, see @ref coalesce */
+      struct coalescing
+      {
+        /** @brief Bytes held to send right away, or 0 to disable */
+        std::size_t bytes;
+
+        /**
+         * @brief Time to hold the first write, or 0 to send at the end of
+         * the current loop iteration
+         */
+        std::chrono::nanoseconds delay;
+      };
+
+      /** @brief Counters of sending, e.g. for syscalls per message */
+      struct sending_statistics
+      {
+        /** @brief Calls of `write` */
+        std::uint64_t messages;
+
+        /** @brief Calls of `sendmsg`, including those would block */
+        std::uint64_t syscalls;
+
+        std::uint64_t bytes;
+      };
+
+      /** @brief Credentials of the peer process of a Unix domain socket */
+      struct credentials
+      {
+        pid_t pid;
+        uid_t uid;
+        gid_t gid;
+      };
+
+      /** @brief Descriptors passed along with a single byte at most */
+      static constexpr std::size_t max_descriptors = 253;
+
+      /**
+       * @brief Descriptors passed along with the byte at @ref offset, in
+       * bytes from the start of the stream
+       */
+      struct attachment
+      {
+        std::uint64_t offset;
+        std::vector<unixy::file_descriptor> descriptors;
+      };
+
+      /**
+       * @param fd The socket, which is set to non-blocking mode
+       * @param chunk Bytes of buffers to receive into
+       */
+      socket_stream(event_loop &loop, unixy::file_descriptor fd,
+                    buffer_manager &bm,
+                    watermark receiving = { 64 << 10, 256 << 10 },
+                    watermark sending = { 64 << 10, 256 << 10 },
+                    std::size_t chunk = 16 << 10);
+
+      /**
+       * @brief Wrap a socket of @p family already in non-blocking mode,
+       * e.g. one accepted by `accept4`, without further system calls
+       */
+      socket_stream(event_loop &loop, unixy::file_descriptor fd,
+                    buffer_manager &bm, sa_family_t family,
+                    watermark receiving = { 64 << 10, 256 << 10 },
+                    watermark sending = { 64 << 10, 256 << 10 },
+                    std::size_t chunk = 16 << 10);
+
+      ~socket_stream() override;
+
+      int native_handle() const noexcept
+      { return _fd; }
+
+      future<size_t, readable_buffer>
+      read(std::size_t size, std::size_t watermark) override;
+
+      /**
+       * @brief Take bytes buffered into free capacity of @p chain, once
+       * some have been received
+       */
+      future<std::size_t, buffer_chain> read(buffer_chain chain) override;
+
+      void discard() override;
+
+      writable_buffer allocate_buffer(std::size_t size) override;
+
+      std::size_t write(writable_buffer b) override;
+
+      std::size_t write(buffer_chain chain) override;
+
+      /**
+       * @brief Write bytes with file descriptors attached to the first of
+       * them, over a Unix domain socket
+       *
+       * Descriptors are passed by `SCM_RIGHTS`, as many as @ref
+       * max_descriptors along with each byte, so @p chain must have a byte
+       * for each of them at least. Each byte carrying descriptors is sent
+       * by itself, so the peer tells which byte they arrived with.
+       * Descriptors are closed here once sent, and the peer receives
+       * duplicates of them, e.g. an accepted socket, or a memfd to share a
+       * large payload without copying it.
+       */
+      std::size_t write(buffer_chain chain,
+                        std::vector<unixy::file_descriptor> descriptors);
+
+      /**
+       * @brief Take descriptors received so far, in the order they were
+       * sent, each batch with the offset of the byte it arrived with
+       *
+       * The offset is the last byte of the `recvmsg` carrying them, which
+       * is exactly the byte they're attached to if the peer sends it by
+       * itself, as @ref write does. The stream fails with `EMSGSIZE` if
+       * any of them are discarded by the system, e.g. by running out of
+       * descriptors of the process.
+       */
+      std::vector<attachment> take_descriptors();
+
+      /** @brief Credentials of the peer, taken when it's connected */
+      credentials peer_credentials() const;
+
+      /** @brief Shut down sending once bytes queued are all sent */
+      void close() override;
+
+      /** @brief A future resolved once bytes queued are all sent */
+      future<> flush() override;
+
+      std::size_t queued() const noexcept override
+      { return _queued.size(); }
+
+      future<> drain() override;
+
+      /** @brief Bytes received but not consumed yet */
+      std::size_t buffered() const noexcept
+      { return _received.size(); }
+
+      /**
+       * @brief Whether neither the end of stream nor an error has been met,
+       * and the stream is not closed
+       */
+      bool is_open() const noexcept
+      { return !_eof && !_error && !_closed; }
+
+      /** @brief Whether the socket is polled for receiving */
+      bool receiving() const noexcept
+      { return _receiving; }
+
+      /**
+       * @brief Hold small writes to send them together
+       *
+       * Disabling it sends bytes being held right away.
+       */
+      void coalesce(coalescing c);
+
+      const sending_statistics &statistics() const noexcept
+      { return _statistics; }
+
+    private:
+      struct read_request
+      {
+        std::size_t size;
+        std::size_t watermark;
+        promise<size_t, readable_buffer> reply;
+      };
+
+      /** @brief A read into free capacity of a chain */
+      struct chain_request
+      {
+        buffer_chain chain;
+        promise<std::size_t, buffer_chain> reply;
+      };
+
+      void on_readable() override;
+      void on_writable() override;
+      void receive();
+      ssize_t receive(std::uint8_t *data, std::size_t size);
+      void send();
+      void hold();
+      void uncork();
+      void update_events();
+      void reply_reader();
+      void reply_writers();
+      void fail(int e);
+
+      unixy::file_descriptor _fd;
+      buffer_manager &_bm;
+      const watermark _receiving_watermark;
+      const watermark _sending_watermark;
+      const std::size_t _chunk;
+      buffer_chain _received;
+      buffer_chain _queued;
+      std::unique_ptr<read_request> _request;
+      std::unique_ptr<chain_request> _chain_request;
+      /** @brief Writers waiting for bytes queued dropping below a limit */
+      std::vector<std::pair<std::size_t, promise<>>> _writers;
+      /** @brief Descriptors to send, by offset in bytes sent ever */
+      std::deque<attachment> _attachments;
+      /** @brief Descriptors received, by offset in bytes received ever */
+      std::vector<attachment> _descriptors;
+      std::uint64_t _received_bytes;
+      std::exception_ptr _error;
+      coalescing _coalescing;
+      /** @brief Task sending bytes held, if any */
+      std::shared_ptr<deferred> _flusher;
+      sending_statistics _statistics;
+      /** @brief Whether it's a Unix domain socket, passing descriptors */
+      bool _local;
+      bool _receiving;
+      bool _eof;
+      bool _discarded;
+      bool _closed;
+      bool _shutdown;
+    };
+
+  }
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/network_context.hpp>
+#include <lanxc-linux/event_loop.hpp>
+#include <lanxc-linux/config.hpp>
+#include <lanxc-unixy/unixy.hpp>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief A UDP socket receiving and sending batches of datagrams by
+     * `recvmmsg` and `sendmmsg`, driven by an event loop
+     *
+     * Each batch is received into a single buffer of @p batch slots, each
+     * of @p datagram_size bytes. Datagrams of a batch filling at least a
+     * quarter of it share the buffer until all of them are destroyed, and
+     * those of a smaller batch are copied into a buffer of their size
+     * instead. Datagrams larger than a slot are dropped rather than
+     * truncated.
+     *
+     * The socket is polled for receiving only while a @ref receive is
+     * pending, so datagrams not consumed are left to the socket buffer.
+     * Datagrams rejected by the system on sending, e.g. for being too
+     * large, are dropped and counted in @ref statistics.
+     *
+     * Payloads with a segment size are sent by `UDP_SEGMENT`, split into
+     * pieces of at most 64 datagrams each, or split into datagrams here
+     * once the system turns out not to support it, see @ref segmentation.
+     * Datagrams coalesced by `UDP_GRO` are split into slices of the same
+     * buffer on receiving.
+     */
+    class LANXC_LINUX_EXPORT udp_endpoint
+        : public datagram_endpoint
+        , private event_channel
+    {
+    public:
+      /** @brief Counters of datagrams, e.g. for datagrams per syscall */
+      struct datagram_statistics
+      {
+        /** @brief Datagrams received, after being split */
+        std::uint64_t received;
+
+        /** @brief Datagrams sent, counting each segment of a payload */
+        std::uint64_t sent;
+
+        std::uint64_t dropped;
+
+        /** @brief Calls of `recvmmsg` and `sendmmsg` */
+        std::uint64_t syscalls;
+      };
+
+      /**
+       * @param fd The socket, which is set to non-blocking mode
+       * @param batch Maximal number of datagrams per syscall
+       * @param datagram_size Bytes of each slot to receive into
+       */
+      udp_endpoint(event_loop &loop, unixy::file_descriptor fd,
+                   buffer_manager &bm, std::size_t batch = 64,
+                   std::size_t datagram_size = 2048);
+
+      ~udp_endpoint() override;
+
+      int native_handle() const noexcept
+      { return _fd; }
+
+      future<std::vector<datagram>> receive() override;
+
+      std::size_t receive(std::vector<datagram> &datagrams) override;
+
+      std::size_t send(std::vector<datagram> datagrams) override;
+
+      std::size_t queued() const noexcept override
+      { return _queued.size(); }
+
+      future<> flush() override;
+
+      datagram_address resolve(std::string address,
+                               std::uint16_t port) const override;
+
+      const datagram_statistics &statistics() const noexcept
+      { return _statistics; }
+
+      /** @brief Whether payloads are split by the system on sending */
+      bool segmentation() const noexcept
+      { return _segmentation; }
+
+    private:
+      /** @brief Room for a control message of an integer */
+      union control
+      {
+        struct cmsghdr header;
+        char bytes[CMSG_SPACE(sizeof(int))];
+      };
+
+      void on_readable() override;
+      void on_writable() override;
+      void enqueue(datagram d);
+      std::size_t transmit();
+      void update_events();
+      void reply_flushers();
+
+      unixy::file_descriptor _fd;
+      buffer_manager &_bm;
+      const std::size_t _batch;
+      const std::size_t _datagram_size;
+      /** @brief Buffer to receive the next batch into */
+      writable_buffer _buffer;
+      std::vector<struct mmsghdr> _headers;
+      std::vector<struct iovec> _vectors;
+      std::vector<control> _controls;
+      std::vector<datagram_address> _peers;
+      std::deque<datagram> _queued;
+      std::unique_ptr<promise<std::vector<datagram>>> _request;
+      std::vector<promise<>> _flushers;
+      datagram_statistics _statistics;
+      bool _segmentation;
+    };
+
+    /** @brief Builder of @ref udp_endpoint */
+    class LANXC_LINUX_EXPORT udp_endpoint_builder
+        : public datagram_endpoint_builder
+        , public std::enable_shared_from_this<udp_endpoint_builder>
+    {
+    public:
+      udp_endpoint_builder(event_loop &loop, buffer_manager &bm) noexcept;
+
+      ~udp_endpoint_builder() override;
+
+      std::shared_ptr<datagram_endpoint_builder>
+      bind(std::string address, std::uint16_t port) override;
+
+      std::shared_ptr<datagram_endpoint_builder>
+      connect(std::string address, std::uint16_t port) override;
+
+      std::shared_ptr<datagram_endpoint_builder>
+      set_batch_size(std::size_t datagrams) override;
+
+      std::shared_ptr<datagram_endpoint_builder>
+      set_datagram_size(std::size_t bytes) override;
+
+      std::shared_ptr<datagram_endpoint_builder>
+      set_receive_offload(bool enabled) override;
+
+      datagram_endpoint::pointer build() override;
+
+    private:
+      event_loop &_loop;
+      buffer_manager &_bm;
+      sockaddr_storage _source;
+      socklen_t _source_length;
+      sockaddr_storage _peer;
+      socklen_t _peer_length;
+      std::size_t _batch;
+      std::size_t _datagram_size;
+      bool _receive_offload;
+    };
+
+  }
+}
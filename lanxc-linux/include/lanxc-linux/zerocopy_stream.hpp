@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc-unixy/stream.hpp>
+#include <lanxc-linux/config.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+
+    /**
+     * @brief A TCP stream sending large buffers without copying them into
+     * socket buffers, by `MSG_ZEROCOPY`
+     *
+     * Writes of at least @ref threshold bytes are sent from the buffers in
+     * place, which are kept alive until the kernel reports completion on
+     * the error queue of socket, and then released to their managers.
+     * Smaller writes are copied as by `unixy::stream`, since pinning pages
+     * and handling completions costs more than copying a few pages.
+     *
+     * If the socket doesn't support `SO_ZEROCOPY`, e.g. a Unix domain
+     * socket or a kernel before 4.14, all writes are copied. Completions
+     * are reaped on each write and by @ref flush, whose future resolves
+     * once all buffers are released.
+     */
+    class LANXC_LINUX_EXPORT zerocopy_stream : public unixy::stream
+    {
+    public:
+      /** @brief Default threshold of bytes to send without copying */
+      static constexpr std::size_t default_threshold = 16 << 10;
+
+      /**
+       * @param linger Time for the destructor to wait for buffers sent to
+       * be released
+       */
+      zerocopy_stream(unixy::file_descriptor fd, buffer_manager &bm,
+                      std::size_t threshold = default_threshold,
+                      std::chrono::milliseconds linger
+                          = std::chrono::seconds(1));
+
+      /**
+       * @note Blocks until buffers sent are all released, for at most the
+       * linger time. Like `SO_LINGER` once it expires, the connection is
+       * then reset, so that the kernel drops bytes not sent yet along with
+       * the buffers holding them, e.g. when the peer stops reading.
+       */
+      ~zerocopy_stream() override;
+
+      std::size_t write(writable_buffer b) override;
+
+      std::size_t write(buffer_chain chain) override;
+
+      future<> flush() override;
+
+      /** @brief Whether `SO_ZEROCOPY` is enabled on the socket */
+      bool enabled() const noexcept
+      { return _enabled; }
+
+      std::size_t threshold() const noexcept
+      { return _threshold; }
+
+      /** @brief Number of writes whose buffers are not released yet */
+      std::size_t pending() const noexcept
+      { return _pending.size(); }
+
+      /**
+       * @brief Number of sends the kernel copied anyway, e.g. over loopback
+       * or to a device without scatter-gather support
+       */
+      std::size_t copied() const noexcept
+      { return _copied; }
+
+    private:
+      struct pending_chain
+      {
+        buffer_chain chain;
+        std::uint32_t id;  /**< Id of the last send of the chain */
+      };
+
+      std::size_t send(buffer_chain chain);
+      bool reap();
+      void reset() noexcept;
+
+      std::deque<pending_chain> _pending;
+      const std::size_t _threshold;
+      const std::chrono::milliseconds _linger;
+      std::uint32_t _next_id;
+      std::size_t _copied;
+      bool _enabled;
+    };
+
+  }
+}
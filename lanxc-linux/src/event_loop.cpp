@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/event_loop.hpp>
+#include <lanxc-unixy/unixy.hpp>
+#include <lanxc/link.hpp>
+
+#include <sys/epoll.h>
+#include <errno.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<>
+    struct rbtree_config<linuxy::event_loop> : rbtree_config<void>
+    {
+      using default_insert_policy = index_policy::back;
+      static constexpr bool insert_from_back = true;
+    };
+  }
+}
+
+namespace
+{
+  using namespace lanxc;
+  using time_point = task_context::time_point;
+
+  struct event_loop_task : virtual deferred
+  {
+    function<void()> _routine;
+    bool _cancelled;
+
+    explicit event_loop_task(function<void()> r) noexcept
+      : _routine(std::move(r))
+      , _cancelled{false}
+    { }
+
+    void cancel() override
+    { _cancelled = true; }
+
+    void execute() override
+    {
+      if (!_cancelled)
+        _routine();
+    }
+  };
+
+  struct event_loop_alarm
+      : virtual alarm
+      , event_loop_task
+      , link::rbtree_node<time_point, event_loop_alarm, linuxy::event_loop>
+  {
+    using rbtree_node = link::rbtree_node<time_point, event_loop_alarm,
+                                          linuxy::event_loop>;
+
+    /** @brief Keep the alarm alive while it's scheduled */
+    std::shared_ptr<event_loop_alarm> _self;
+
+    event_loop_alarm(time_point t, function<void()> r) noexcept
+      : event_loop_task{std::move(r)}
+      , rbtree_node{t}
+    { }
+
+    void cancel() override
+    {
+      event_loop_task::cancel();
+      rbtree_node::unlink();
+      _self.reset();
+    }
+  };
+}
+
+struct lanxc::linuxy::event_loop::detail
+{
+  unixy::file_descriptor _epoll;
+  std::deque<std::shared_ptr<event_loop_task>> _tasks;
+  link::rbtree<time_point, event_loop_alarm, event_loop> _alarms;
+  std::size_t _channels;
+  bool _stopped;
+
+  /** @brief Events being dispatched, to forget channels destroyed */
+  std::array<struct epoll_event, 256> _events;
+  int _dispatching;
+
+  detail()
+    : _epoll{::epoll_create1(EPOLL_CLOEXEC)}
+    , _tasks{}
+    , _alarms{}
+    , _channels{0}
+    , _stopped{false}
+    , _events{}
+    , _dispatching{0}
+  {
+    if (!_epoll)
+      unixy::throw_system_error();
+  }
+
+  void process_alarms(time_point now)
+  {
+    std::vector<std::shared_ptr<event_loop_alarm>> due;
+    while (!_alarms.empty() && _alarms.front().get_index() <= now)
+    {
+      auto &a = _alarms.front();
+      a.rbtree_node::unlink();
+      due.push_back(std::move(a._self));
+    }
+    for (auto &a : due)
+      a->execute();
+  }
+
+  void process_tasks()
+  {
+    auto tasks = std::move(_tasks);
+    _tasks.clear();
+    for (auto &t : tasks)
+      t->execute();
+  }
+
+  int decide_timeout(time_point now) const
+  {
+    if (!_tasks.empty())
+      return 0;
+    if (!_alarms.empty())
+    {
+      auto d = _alarms.front().get_index() - now;
+      auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d);
+      // Round up, otherwise the loop spins until the alarm is due
+      if (ms < d)
+        ++ms;
+      // An overdue alarm must not turn into an infinite wait
+      return static_cast<int>(std::max<long long>(0, ms.count()));
+    }
+    return _channels != 0 ? -1 : -2;
+  }
+
+  void dispatch(int count)
+  {
+    _dispatching = count;
+    for (int i = 0; i < count; i++)
+    {
+      auto &e = _events[std::size_t(i)];
+      auto *c = static_cast<event_channel *>(e.data.ptr);
+      bool error = e.events & (EPOLLERR | EPOLLHUP);
+      if (c && (c->_events & event_channel::readable)
+          && (error || (e.events & EPOLLIN)))
+        c->on_readable();
+      // The channel may have been destroyed by the handler
+      c = static_cast<event_channel *>(e.data.ptr);
+      if (c && (c->_events & event_channel::writable)
+          && (error || (e.events & EPOLLOUT)))
+        c->on_writable();
+    }
+    _dispatching = 0;
+  }
+
+  void run()
+  {
+    while (!_stopped)
+    {
+      auto now = std::chrono::steady_clock::now();
+      process_alarms(now);
+      process_tasks();
+      if (_stopped)
+        break;
+      int timeout = decide_timeout(std::chrono::steady_clock::now());
+      if (timeout == -2)
+        break;
+      int n = ::epoll_wait(_epoll, _events.data(),
+                           static_cast<int>(_events.size()), timeout);
+      if (n == -1)
+      {
+        if (errno == EINTR)
+          continue;
+        unixy::throw_system_error();
+      }
+      dispatch(n);
+    }
+    _stopped = false;
+  }
+};
+
+lanxc::linuxy::event_loop::event_loop()
+  : _detail{new detail}
+{ }
+
+lanxc::linuxy::event_loop::~event_loop()
+{
+  while (!_detail->_alarms.empty())
+    _detail->_alarms.front().cancel();
+}
+
+void lanxc::linuxy::event_loop::run()
+{
+  _detail->run();
+}
+
+void lanxc::linuxy::event_loop::stop() noexcept
+{
+  _detail->_stopped = true;
+}
+
+std::shared_ptr<lanxc::deferred>
+lanxc::linuxy::event_loop::defer(function<void()> routine)
+{
+  auto p = std::make_shared<event_loop_task>(std::move(routine));
+  _detail->_tasks.push_back(p);
+  return p;
+}
+
+std::shared_ptr<lanxc::alarm>
+lanxc::linuxy::event_loop::schedule(time_point t, function<void()> routine)
+{
+  auto p = std::make_shared<event_loop_alarm>(t, std::move(routine));
+  p->_self = p;
+  _detail->_alarms.insert(*p);
+  return p;
+}
+
+constexpr std::uint32_t lanxc::linuxy::event_channel::readable;
+constexpr std::uint32_t lanxc::linuxy::event_channel::writable;
+
+lanxc::linuxy::event_channel::event_channel(event_loop &loop, int fd) noexcept
+  : _loop(loop)
+  , _fd{fd}
+  , _events{0}
+{ }
+
+lanxc::linuxy::event_channel::~event_channel()
+{
+  auto &d = *_loop._detail;
+  if (_events != 0)
+  {
+    ::epoll_ctl(d._epoll, EPOLL_CTL_DEL, _fd, nullptr);
+    d._channels--;
+  }
+  for (int i = 0; i < d._dispatching; i++)
+    if (d._events[std::size_t(i)].data.ptr == this)
+      d._events[std::size_t(i)].data.ptr = nullptr;
+}
+
+void lanxc::linuxy::event_channel::set_events(std::uint32_t events)
+{
+  if (events == _events)
+    return;
+  auto &d = *_loop._detail;
+  struct epoll_event e{};
+  e.data.ptr = this;
+  if (events & readable)
+    e.events |= EPOLLIN | EPOLLRDHUP;
+  if (events & writable)
+    e.events |= EPOLLOUT;
+  int op = _events == 0 ? EPOLL_CTL_ADD
+         : events == 0 ? EPOLL_CTL_DEL
+         : EPOLL_CTL_MOD;
+  if (::epoll_ctl(d._epoll, op, _fd, &e) == -1)
+    unixy::throw_system_error();
+  if (_events == 0)
+    d._channels++;
+  else if (events == 0)
+    d._channels--;
+  _events = events;
+}
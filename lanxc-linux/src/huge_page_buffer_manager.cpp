@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/huge_page_buffer_manager.hpp>
+#include <lanxc-unixy/unixy.hpp>
+
+#include <sys/mman.h>
+#include <errno.h>
+
+#include <fstream>
+#include <string>
+
+namespace
+{
+  using lanxc::linuxy::huge_page_buffer_manager;
+  using page_mode = huge_page_buffer_manager::page_mode;
+
+  constexpr std::size_t word_bits = 64;
+
+  std::size_t round_up(std::size_t n, std::size_t unit) noexcept
+  { return (n + unit - 1) / unit * unit; }
+
+  /** @brief Test if transparent huge pages may be used by madvise */
+  bool transparent_huge_page_enabled()
+  {
+    static const bool enabled = []
+    {
+      std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+      std::string content;
+      std::getline(f, content);
+      return !content.empty()
+             && content.find("[never]") == std::string::npos;
+    }();
+    return enabled;
+  }
+
+  /** @brief Map @p size bytes aligned to @p alignment, nullptr on failure */
+  void *map_aligned(std::size_t size, std::size_t alignment) noexcept
+  {
+    void *p = ::mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      return nullptr;
+    auto begin = reinterpret_cast<std::uintptr_t>(p);
+    auto aligned = round_up(begin, alignment);
+    if (aligned != begin)
+      ::munmap(p, aligned - begin);
+    if (aligned + size != begin + size + alignment)
+      ::munmap(reinterpret_cast<void *>(aligned + size),
+               begin + alignment - aligned);
+    return reinterpret_cast<void *>(aligned);
+  }
+
+  /**
+   * @brief Map @p size bytes in @p mode
+   * @returns the mapped address, or nullptr if @p mode is not available
+   */
+  void *map_pages(std::size_t size, page_mode mode) noexcept
+  {
+    switch (mode)
+    {
+    case page_mode::huge_tlb:
+    {
+      void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      return p == MAP_FAILED ? nullptr : p;
+    }
+    case page_mode::transparent:
+    {
+      if (!transparent_huge_page_enabled())
+        return nullptr;
+      void *p = map_aligned(size, huge_page_buffer_manager::huge_page_size);
+      if (p != nullptr && ::madvise(p, size, MADV_HUGEPAGE) != 0)
+      {
+        ::munmap(p, size);
+        return nullptr;
+      }
+      return p;
+    }
+    default:
+      return map_aligned(size, huge_page_buffer_manager::huge_page_size);
+    }
+  }
+}
+
+namespace lanxc
+{
+  namespace linuxy
+  {
+    constexpr std::size_t huge_page_buffer_manager::granularity;
+    constexpr std::size_t huge_page_buffer_manager::huge_page_size;
+
+    huge_page_buffer_manager::huge_page_buffer_manager(std::size_t arena_size,
+                                                       page_mode preferred)
+        : _arena_size(round_up(arena_size == 0 ? 1 : arena_size,
+                               huge_page_size))
+        , _preferred(preferred)
+        , _mode(preferred)
+        , _mapped(0)
+    {
+      // Map the first arena eagerly, so that the mode is known up front
+      map_arena(_arena_size, false);
+    }
+
+    huge_page_buffer_manager::~huge_page_buffer_manager()
+    {
+      for (auto &a : _arenas)
+        unmap_arena(*a);
+    }
+
+    huge_page_buffer_manager::arena &
+    huge_page_buffer_manager::map_arena(std::size_t size, bool dedicated)
+    {
+      size = round_up(size, huge_page_size);
+      std::unique_ptr<arena> a(new arena());
+      if (!dedicated)
+      {
+        std::size_t granules = size / granularity;
+        a->used.assign((granules + word_bits - 1) / word_bits, 0);
+        // Granules beyond the end are marked as used
+        if (granules % word_bits != 0)
+          a->used.back() = ~std::uint64_t(0) << (granules % word_bits);
+      }
+
+      void *p = nullptr;
+      auto mode = static_cast<int>(_preferred);
+      for ( ; p == nullptr && mode <= static_cast<int>(page_mode::normal);
+           mode++)
+        p = map_pages(size, static_cast<page_mode>(mode));
+      if (p == nullptr)
+        unixy::throw_system_error();
+
+      a->base = static_cast<std::uint8_t *>(p);
+      a->size = size;
+      a->mode = static_cast<page_mode>(mode - 1);
+      a->dedicated = dedicated;
+      try
+      {
+        _arenas.push_back(std::move(a));
+      }
+      catch (...)
+      {
+        ::munmap(p, size);
+        throw;
+      }
+      _mode = _arenas.back()->mode;
+      _mapped += size;
+      return *_arenas.back();
+    }
+
+    void huge_page_buffer_manager::unmap_arena(arena &a) noexcept
+    { ::munmap(a.base, a.size); }
+
+    std::uint8_t *huge_page_buffer_manager::carve(arena &a,
+                                                  std::size_t granules)
+    noexcept
+    {
+      std::size_t total = a.used.size() * word_bits;
+      std::size_t run = 0;
+      std::size_t start = 0;
+      for (std::size_t i = 0; i < total; )
+      {
+        std::uint64_t word = a.used[i / word_bits];
+        if (i % word_bits == 0 && word == ~std::uint64_t(0))
+        {
+          run = 0;
+          i += word_bits;
+          continue;
+        }
+        if ((word >> (i % word_bits)) & 1)
+        {
+          run = 0;
+          i++;
+          continue;
+        }
+        if (run++ == 0)
+          start = i;
+        i++;
+        if (run == granules)
+        {
+          for (std::size_t j = start; j < i; j++)
+            a.used[j / word_bits] |= std::uint64_t(1) << (j % word_bits);
+          return a.base + start * granularity;
+        }
+      }
+      return nullptr;
+    }
+
+    std::uint8_t *huge_page_buffer_manager::acquire(std::size_t size)
+    {
+      std::size_t length = round_up(size == 0 ? 1 : size, granularity);
+      std::lock_guard<std::mutex> guard(_lock);
+      if (length > _arena_size)
+        return map_arena(length, true).base;
+
+      std::size_t granules = length / granularity;
+      for (auto &a : _arenas)
+      {
+        if (a->dedicated)
+          continue;
+        if (auto *p = carve(*a, granules))
+          return p;
+      }
+      return carve(map_arena(_arena_size, false), granules);
+    }
+
+    void huge_page_buffer_manager::release(std::uint8_t *data,
+                                           std::size_t size) noexcept
+    {
+      if (data == nullptr)
+        return;
+      std::size_t length = round_up(size == 0 ? 1 : size, granularity);
+      std::lock_guard<std::mutex> guard(_lock);
+      for (auto i = _arenas.begin(); i != _arenas.end(); ++i)
+      {
+        arena &a = **i;
+        if (data < a.base || data >= a.base + a.size)
+          continue;
+        if (a.dedicated)
+        {
+          _mapped -= a.size;
+          unmap_arena(a);
+          _arenas.erase(i);
+          return;
+        }
+        std::size_t start = std::size_t(data - a.base) / granularity;
+        for (std::size_t j = start; j < start + length / granularity; j++)
+          a.used[j / word_bits] &= ~(std::uint64_t(1) << (j % word_bits));
+        return;
+      }
+    }
+
+    huge_page_buffer_manager::page_mode
+    huge_page_buffer_manager::mode() const noexcept
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      return _mode;
+    }
+
+    std::size_t huge_page_buffer_manager::mapped_bytes() const noexcept
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      return _mapped;
+    }
+
+    const char *huge_page_buffer_manager::to_string(page_mode mode) noexcept
+    {
+      switch (mode)
+      {
+      case page_mode::huge_tlb: return "huge_tlb";
+      case page_mode::transparent: return "transparent";
+      default: return "normal";
+      }
+    }
+  }
+}
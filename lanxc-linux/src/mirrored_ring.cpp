@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/mirrored_ring.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc-unixy/unixy.hpp>
+
+#include <sys/mman.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace
+{
+  std::size_t round_up_capacity(std::size_t n) noexcept
+  {
+    std::size_t c = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    while (c < n)
+      c <<= 1;
+    return c;
+  }
+}
+
+lanxc::linuxy::mirrored_ring::mirrored_ring(std::size_t capacity)
+  : _base{}
+  , _capacity{round_up_capacity(capacity)}
+  , _mask{_capacity - 1}
+  , _head{0}
+  , _tail{0}
+  , _closed{false}
+  , _discarded{false}
+  , _waiters{0}
+  , _lock{}
+  , _changed{}
+  , _reader{*this}
+  , _writer{*this}
+{
+  unixy::file_descriptor fd(::memfd_create("lanxc-mirrored-ring",
+                                           MFD_CLOEXEC));
+  if (!fd || ::ftruncate(fd, static_cast<off_t>(_capacity)) == -1)
+    unixy::throw_system_error();
+
+  // Reserve address space for both mappings, then replace each half
+  void *p = ::mmap(nullptr, _capacity * 2, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    unixy::throw_system_error();
+  _base = static_cast<std::uint8_t *>(p);
+  for (int half = 0; half < 2; half++)
+  {
+    void *q = ::mmap(_base + _capacity * half, _capacity,
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (q == MAP_FAILED)
+    {
+      int e = errno;
+      ::munmap(_base, _capacity * 2);
+      unixy::throw_system_error(e);
+    }
+  }
+}
+
+lanxc::linuxy::mirrored_ring::~mirrored_ring()
+{
+  ::munmap(_base, _capacity * 2);
+}
+
+template<typename Predicate>
+void lanxc::linuxy::mirrored_ring::wait(Predicate &&ready)
+{
+  if (ready())
+    return;
+  std::unique_lock<std::mutex> guard(_lock);
+  _waiters.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (!ready())
+    _changed.wait(guard);
+  _waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+lanxc::linuxy::mirrored_ring::reader::reader(mirrored_ring &ring) noexcept
+  : _ring(ring)
+  , _viewed{0}
+{ }
+
+std::uint8_t *lanxc::linuxy::mirrored_ring::reader::acquire(std::size_t size)
+{
+  std::uint8_t *p = const_cast<std::uint8_t *>(_ring.read_region())
+                    + _viewed;
+  _viewed += size;
+  return p;
+}
+
+void lanxc::linuxy::mirrored_ring::reader::release(std::uint8_t *,
+                                                   std::size_t size) noexcept
+{
+  _viewed -= size;
+  _ring.consume(size);
+}
+
+lanxc::future<size_t, lanxc::readable_buffer>
+lanxc::linuxy::mirrored_ring::reader::read(std::size_t size,
+                                           std::size_t watermark)
+{
+  return future<size_t, readable_buffer>(
+      [this, size, watermark](promise<size_t, readable_buffer> p)
+      {
+        if (_ring._discarded.load(std::memory_order_relaxed))
+        {
+          p.reject(stream_discarded_exception());
+          return;
+        }
+        std::size_t limit = size < _ring._capacity ? size : _ring._capacity;
+        std::size_t low = watermark < limit ? watermark : limit;
+        _ring.wait([&]
+                   {
+                     return _ring.readable() - _viewed >= low
+                            || _ring._closed.load(std::memory_order_acquire);
+                   });
+        std::size_t available = _ring.readable() - _viewed;
+        std::size_t n = available < limit ? available : limit;
+        writable_buffer b(*this, n);
+        p.fulfill(n, readable_buffer(std::move(b)));
+      });
+}
+
+lanxc::future<std::size_t, lanxc::buffer_chain>
+lanxc::linuxy::mirrored_ring::reader::read(buffer_chain chain)
+{
+  auto c = std::make_shared<buffer_chain>(std::move(chain));
+  return future<std::size_t, buffer_chain>(
+      [this, c](promise<std::size_t, buffer_chain> p)
+      {
+        if (_ring._discarded.load(std::memory_order_relaxed))
+        {
+          p.reject(stream_discarded_exception());
+          return;
+        }
+        _ring.wait([&]
+                   {
+                     return _ring.readable() > _viewed
+                            || _ring._closed.load(std::memory_order_acquire);
+                   });
+        const std::uint8_t *data = _ring.read_region() + _viewed;
+        std::size_t available = _ring.readable() - _viewed;
+        std::size_t n = 0;
+        c->for_each_capacity([&](std::uint8_t *room, std::size_t size)
+                             {
+                               std::size_t copy = available - n < size
+                                                  ? available - n : size;
+                               std::memcpy(room, data + n, copy);
+                               n += copy;
+                             });
+        c->fill(n);
+        _ring.consume(n);
+        p.fulfill(n, std::move(*c));
+      });
+}
+
+void lanxc::linuxy::mirrored_ring::reader::discard()
+{
+  _ring._discarded.store(true, std::memory_order_relaxed);
+  // Bytes viewed by buffers outstanding are consumed once they're released
+  if (_viewed == 0)
+    _ring.consume(_ring.readable());
+  else
+    _ring.wake();
+}
+
+lanxc::linuxy::mirrored_ring::writer::writer(mirrored_ring &ring) noexcept
+  : _ring(ring)
+  , _allocated{false}
+{ }
+
+std::uint8_t *lanxc::linuxy::mirrored_ring::writer::acquire(std::size_t size)
+{
+  assert(size <= _ring._capacity);
+  _ring.wait([&]
+             {
+               return _ring.writable() >= size
+                      || _ring._discarded.load(std::memory_order_relaxed);
+             });
+  if (_ring._discarded.load(std::memory_order_relaxed))
+    throw stream_discarded_exception();
+  // Another buffer held would be the same region
+  assert(!_allocated);
+  _allocated = true;
+  return _ring.write_region();
+}
+
+void lanxc::linuxy::mirrored_ring::writer::release(std::uint8_t *,
+                                                   std::size_t) noexcept
+{
+  _allocated = false;
+}
+
+lanxc::writable_buffer
+lanxc::linuxy::mirrored_ring::writer::allocate_buffer(std::size_t size)
+{
+  return writable_buffer(*this, size);
+}
+
+void lanxc::linuxy::mirrored_ring::writer::copy(const std::uint8_t *data,
+                                                std::size_t size)
+{
+  while (size != 0)
+  {
+    if (_ring._discarded.load(std::memory_order_relaxed))
+      throw stream_discarded_exception();
+    _ring.wait([&]
+               {
+                 return _ring.writable() != 0
+                        || _ring._discarded.load(std::memory_order_relaxed);
+               });
+    std::size_t room = _ring.writable();
+    std::size_t n = size < room ? size : room;
+    std::memcpy(_ring.write_region(), data, n);
+    _ring.commit(n);
+    data += n;
+    size -= n;
+  }
+}
+
+std::size_t lanxc::linuxy::mirrored_ring::writer::write(writable_buffer b)
+{
+  if (_ring._closed.load(std::memory_order_relaxed))
+    throw stream_closed_exception();
+  if (_ring._discarded.load(std::memory_order_relaxed))
+    throw stream_discarded_exception();
+  std::uint8_t *data = b.data();
+  if (data >= _ring._base && data < _ring._base + _ring._capacity * 2)
+  {
+    // Allocated from the ring, content is in place already
+    assert(data == _ring.write_region());
+    _ring.commit(b.size());
+  }
+  else
+    copy(data, b.size());
+  return b.size();
+}
+
+std::size_t lanxc::linuxy::mirrored_ring::writer::write(buffer_chain chain)
+{
+  if (_ring._closed.load(std::memory_order_relaxed))
+    throw stream_closed_exception();
+  std::size_t n = chain.size();
+  chain.for_each([this](const std::uint8_t *data, std::size_t size)
+                 { copy(data, size); });
+  return n;
+}
+
+void lanxc::linuxy::mirrored_ring::writer::close()
+{
+  _ring._closed.store(true, std::memory_order_release);
+  _ring.wake();
+}
+
+lanxc::future<> lanxc::linuxy::mirrored_ring::writer::flush()
+{
+  return future<>::resolve();
+}
@@ -0,0 +1,652 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/network_connection.hpp>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+
+namespace
+{
+  std::system_error make_system_error(int e)
+  {
+    return std::system_error(std::error_code(e, std::system_category()));
+  }
+
+  /** @return 0, or the error number if failed */
+  int set_option(int fd, int level, int name, int value) noexcept
+  {
+    return ::setsockopt(fd, level, name, &value, sizeof(value)) == 0
+           ? 0 : errno;
+  }
+
+  int clamp_to_int(std::size_t value) noexcept
+  {
+    return value > INT_MAX ? INT_MAX : static_cast<int>(value);
+  }
+
+  /** @brief Time the listener stops polling after accepting failed */
+  constexpr std::chrono::milliseconds min_back_off{10};
+  constexpr std::chrono::milliseconds max_back_off{1000};
+
+  lanxc::unixy::file_descriptor open_spare_descriptor() noexcept
+  {
+    return lanxc::unixy::file_descriptor{
+        ::open("/dev/null", O_RDONLY | O_CLOEXEC)
+    };
+  }
+}
+
+/**
+ * @brief A socket waiting for the connection being established, which
+ * deletes itself once it's established, failed or timed out
+ */
+class lanxc::linuxy::socket_endpoint_builder::connecting
+    : private event_channel
+{
+public:
+  connecting(event_loop &loop, unixy::file_descriptor fd, buffer_manager &bm,
+             promise<connection_endpoint::pointer> reply) noexcept
+    : event_channel(loop, fd)
+    , _fd(std::move(fd))
+    , _bm(bm)
+    , _reply(std::move(reply))
+    , _timer{}
+  { }
+
+  void wait(std::chrono::nanoseconds timeout)
+  {
+    try
+    {
+      set_events(writable);
+    }
+    catch (...)
+    {
+      _reply.reject_by_exception_ptr(std::current_exception());
+      delete this;
+      return;
+    }
+    if (timeout > std::chrono::nanoseconds::zero())
+      _timer = loop().schedule(std::chrono::steady_clock::now() + timeout,
+                               [this]
+                               {
+                                 // Being executed, nothing to cancel
+                                 _timer.reset();
+                                 fail(ETIMEDOUT);
+                               });
+  }
+
+  void complete()
+  {
+    set_events(0);
+    try
+    {
+      _reply.fulfill(std::make_shared<socket_endpoint>(loop(),
+                                                       std::move(_fd), _bm));
+    }
+    catch (...)
+    {
+      _reply.reject_by_exception_ptr(std::current_exception());
+    }
+    delete this;
+  }
+
+  void fail(int e)
+  {
+    set_events(0);
+    _reply.reject(make_system_error(e));
+    delete this;
+  }
+
+private:
+  ~connecting() override
+  {
+    if (_timer)
+      _timer->cancel();
+  }
+
+  void on_readable() override
+  { }
+
+  void on_writable() override
+  {
+    int e = 0;
+    socklen_t length = sizeof(e);
+    if (::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &e, &length) == -1)
+      e = errno;
+    if (e == 0)
+      complete();
+    else
+      fail(e);
+  }
+
+  unixy::file_descriptor _fd;
+  buffer_manager &_bm;
+  promise<connection_endpoint::pointer> _reply;
+  std::shared_ptr<alarm> _timer;
+};
+
+socklen_t
+lanxc::linuxy::parse_socket_address(const std::string &address,
+                                    std::uint16_t port,
+                                    sockaddr_storage &out) noexcept
+{
+  std::memset(&out, 0, sizeof(out));
+  auto in = reinterpret_cast<sockaddr_in *>(&out);
+  if (::inet_pton(AF_INET, address.c_str(), &in->sin_addr) == 1)
+  {
+    in->sin_family = AF_INET;
+    in->sin_port = htons(port);
+    return sizeof(sockaddr_in);
+  }
+  auto in6 = reinterpret_cast<sockaddr_in6 *>(&out);
+  if (::inet_pton(AF_INET6, address.c_str(), &in6->sin6_addr) == 1)
+  {
+    in6->sin6_family = AF_INET6;
+    in6->sin6_port = htons(port);
+    return sizeof(sockaddr_in6);
+  }
+  return 0;
+}
+
+int lanxc::linuxy::socket_options::apply(int fd, int family) const noexcept
+{
+  int e = 0;
+  if (send_buffer_size != 0
+      && (e = set_option(fd, SOL_SOCKET, SO_SNDBUF,
+                         clamp_to_int(send_buffer_size))) != 0)
+    return e;
+  if (receive_buffer_size != 0
+      && (e = set_option(fd, SOL_SOCKET, SO_RCVBUF,
+                         clamp_to_int(receive_buffer_size))) != 0)
+    return e;
+  if (busy_poll.count() != 0
+      && (e = set_option(fd, SOL_SOCKET, SO_BUSY_POLL,
+                         static_cast<int>(busy_poll.count()))) != 0)
+    return e;
+  if (family == AF_UNIX)
+    return 0;
+  if (no_delay && (e = set_option(fd, IPPROTO_TCP, TCP_NODELAY, 1)) != 0)
+    return e;
+  if (user_timeout.count() != 0
+      && (e = set_option(fd, IPPROTO_TCP, TCP_USER_TIMEOUT,
+                         static_cast<int>(user_timeout.count()))) != 0)
+    return e;
+  return 0;
+}
+
+lanxc::linuxy::socket_endpoint::~socket_endpoint() = default;
+
+bool lanxc::linuxy::socket_endpoint::is_healthy() const noexcept
+{
+  if (!is_open() || buffered() != 0 || queued() != 0)
+    return false;
+  char b;
+  return ::recv(native_handle(), &b, 1, MSG_PEEK | MSG_DONTWAIT) == -1
+         && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+lanxc::linuxy::socket_endpoint_builder::
+socket_endpoint_builder(event_loop &loop, buffer_manager &bm) noexcept
+  : _loop(loop)
+  , _bm(bm)
+  , _source{}
+  , _source_length{0}
+  , _timeout{std::chrono::nanoseconds::zero()}
+  , _options{false, 0, 0, std::chrono::microseconds::zero(),
+             std::chrono::milliseconds::zero()}
+  , _fast_open{false}
+{ }
+
+lanxc::linuxy::socket_endpoint_builder::~socket_endpoint_builder() = default;
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::bind(std::string address,
+                                             std::uint16_t port)
+{
+  _source_length = parse_socket_address(address, port, _source);
+  if (_source_length == 0)
+    unixy::throw_system_error(EINVAL);
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::
+set_connect_timeout(std::chrono::nanoseconds timeout)
+{
+  _timeout = timeout;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::set_no_delay(bool enabled)
+{
+  _options.no_delay = enabled;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::set_send_buffer_size(std::size_t bytes)
+{
+  _options.send_buffer_size = bytes;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::
+set_receive_buffer_size(std::size_t bytes)
+{
+  _options.receive_buffer_size = bytes;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::set_fast_open(bool enabled)
+{
+  _fast_open = enabled;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::
+set_busy_poll(std::chrono::microseconds duration)
+{
+  _options.busy_poll = duration;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::socket_endpoint_builder::
+set_user_timeout(std::chrono::milliseconds timeout)
+{
+  _options.user_timeout = timeout;
+  return shared_from_this();
+}
+
+lanxc::future<lanxc::connection_endpoint::pointer>
+lanxc::linuxy::socket_endpoint_builder::connect(std::string address,
+                                                std::uint16_t port)
+{
+  auto self = shared_from_this();
+  return future<connection_endpoint::pointer>(
+      [self, address, port](promise<connection_endpoint::pointer> p)
+      {
+        sockaddr_storage target;
+        socklen_t length = parse_socket_address(address, port, target);
+        if (length == 0)
+        {
+          p.reject(make_system_error(EINVAL));
+          return;
+        }
+
+        unixy::file_descriptor fd {
+            ::socket(target.ss_family,
+                     SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)
+        };
+        if (!fd)
+        {
+          p.reject(make_system_error(errno));
+          return;
+        }
+
+        // Options are set before connecting, e.g. the window scale is
+        // decided by the receive buffer in the handshake
+        int e = self->_options.apply(fd, target.ss_family);
+        if (e == 0 && self->_fast_open)
+          e = set_option(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1);
+        if (e != 0)
+        {
+          p.reject(make_system_error(e));
+          return;
+        }
+
+        if (self->_source_length != 0
+            && ::bind(fd, reinterpret_cast<sockaddr *>(&self->_source),
+                      self->_source_length) == -1)
+        {
+          p.reject(make_system_error(errno));
+          return;
+        }
+
+        int ret = ::connect(fd, reinterpret_cast<sockaddr *>(&target),
+                            length);
+        if (ret == -1 && errno != EINPROGRESS)
+        {
+          p.reject(make_system_error(errno));
+          return;
+        }
+
+        auto c = new connecting(self->_loop, std::move(fd), self->_bm,
+                                std::move(p));
+        if (ret == 0)
+          c->complete();
+        else
+          c->wait(self->_timeout);
+      });
+}
+
+lanxc::linuxy::socket_listener::socket_listener(event_loop &loop,
+                                                unixy::file_descriptor fd,
+                                                buffer_manager &bm,
+                                                std::size_t budget)
+  : event_channel(loop, fd)
+  , _fd(std::move(fd))
+  , _bm(bm)
+  , _budget{budget == 0 ? 1 : budget}
+  , _family{AF_UNSPEC}
+  , _spare{open_spare_descriptor()}
+  , _callback{}
+  , _statistics{0, 0}
+  , _retry{}
+  , _back_off{min_back_off}
+  , _destroyed{nullptr}
+{
+  sockaddr_storage address;
+  socklen_t length = sizeof(address);
+  if (::getsockname(_fd, reinterpret_cast<sockaddr *>(&address),
+                    &length) == -1)
+    unixy::throw_system_error();
+  _family = address.ss_family;
+}
+
+lanxc::linuxy::socket_listener::~socket_listener()
+{
+  if (_destroyed)
+    *_destroyed = true;
+  if (_retry)
+    _retry->cancel();
+  set_events(0);
+}
+
+void
+lanxc::linuxy::socket_listener::
+listen(function<void(connection_endpoint::pointer)> cb)
+{
+  _callback = std::move(cb);
+  if (!_retry)
+    set_events(readable);
+}
+
+void lanxc::linuxy::socket_listener::on_readable()
+{
+  // Connections beyond the budget are left in the backlog, and the socket
+  // stays readable for the next round
+  for (std::size_t i = 0; i < _budget; i++)
+  {
+    int fd = ::accept4(_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1)
+    {
+      if (errno == EMFILE || errno == ENFILE)
+      {
+        if (reject())
+          continue;
+      }
+      // The connection is gone before being accepted
+      else if (errno == ECONNABORTED || errno == EPROTO || errno == EINTR)
+        continue;
+      else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      // Still readable, so polling would only spin until it recovers
+      back_off();
+      return;
+    }
+    _back_off = min_back_off;
+    _statistics.accepted++;
+    auto endpoint = std::make_shared<socket_endpoint>(
+        loop(), unixy::file_descriptor{fd}, _bm, _family);
+
+    bool destroyed = false;
+    _destroyed = &destroyed;
+    try
+    {
+      _callback(std::move(endpoint));
+    }
+    catch (...)
+    {
+      if (!destroyed)
+        _destroyed = nullptr;
+      throw;
+    }
+    if (destroyed)
+      return;
+    _destroyed = nullptr;
+  }
+}
+
+void lanxc::linuxy::socket_listener::on_writable()
+{ }
+
+void lanxc::linuxy::socket_listener::back_off()
+{
+  set_events(0);
+  _retry = loop().schedule(std::chrono::steady_clock::now() + _back_off,
+                           [this]
+                           {
+                             // Being executed, nothing to cancel
+                             _retry.reset();
+                             if (!_spare)
+                               _spare = open_spare_descriptor();
+                             set_events(readable);
+                           });
+  _back_off = std::min(_back_off * 2, max_back_off);
+}
+
+bool lanxc::linuxy::socket_listener::reject()
+{
+  if (!_spare)
+    return false;
+  _spare = unixy::file_descriptor{};
+  int fd = ::accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd != -1)
+  {
+    ::close(fd);
+    _statistics.rejected++;
+  }
+  _spare = open_spare_descriptor();
+  return fd != -1;
+}
+
+lanxc::linuxy::socket_listener_builder::
+socket_listener_builder(event_loop &loop, buffer_manager &bm) noexcept
+  : _loop(loop)
+  , _bm(bm)
+  , _address{}
+  , _length{0}
+  , _reuse_port{false}
+  , _reuse_address{true}
+  , _budget{32}
+  , _options{false, 0, 0, std::chrono::microseconds::zero(),
+             std::chrono::milliseconds::zero()}
+  , _fast_open{0}
+  , _defer_accept{std::chrono::seconds::zero()}
+  , _backlog{SOMAXCONN}
+{ }
+
+lanxc::linuxy::socket_listener_builder::~socket_listener_builder() = default;
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::bind(std::string address,
+                                             std::uint16_t port)
+{
+  _length = parse_socket_address(address, port, _address);
+  if (_length == 0)
+    unixy::throw_system_error(EINVAL);
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::bind(std::uint16_t port)
+{
+  std::memset(&_address, 0, sizeof(_address));
+  auto in = reinterpret_cast<sockaddr_in *>(&_address);
+  in->sin_family = AF_INET;
+  in->sin_addr.s_addr = htonl(INADDR_ANY);
+  in->sin_port = htons(port);
+  _length = sizeof(sockaddr_in);
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::bind(std::string path)
+{
+  std::memset(&_address, 0, sizeof(_address));
+  auto un = reinterpret_cast<sockaddr_un *>(&_address);
+  if (path.empty() || path.size() >= sizeof(un->sun_path))
+    unixy::throw_system_error(ENAMETOOLONG);
+  un->sun_family = AF_UNIX;
+  std::memcpy(un->sun_path, path.data(), path.size());
+  // Names in the abstract namespace, starting with '\0', are not
+  // terminated
+  _length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path)
+                                   + path.size() + (path[0] != '\0'));
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::set_reuse_port(bool enabled)
+{
+  _reuse_port = enabled;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::set_reuse_address(bool enabled)
+{
+  _reuse_address = enabled;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::set_no_delay(bool enabled)
+{
+  _options.no_delay = enabled;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::set_send_buffer_size(std::size_t bytes)
+{
+  _options.send_buffer_size = bytes;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::
+set_receive_buffer_size(std::size_t bytes)
+{
+  _options.receive_buffer_size = bytes;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::set_fast_open(std::size_t pending)
+{
+  _fast_open = pending;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::
+set_defer_accept(std::chrono::seconds timeout)
+{
+  _defer_accept = timeout;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::
+set_busy_poll(std::chrono::microseconds duration)
+{
+  _options.busy_poll = duration;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::
+set_user_timeout(std::chrono::milliseconds timeout)
+{
+  _options.user_timeout = timeout;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::socket_listener_builder::set_backlog(int connections)
+{
+  _backlog = connections;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::linuxy::socket_listener_builder>
+lanxc::linuxy::socket_listener_builder::
+set_accept_budget(std::size_t connections)
+{
+  _budget = connections;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::connection_listener>
+lanxc::linuxy::socket_listener_builder::
+build(function<void(connection_endpoint::pointer)> routine)
+{
+  if (_length == 0)
+    unixy::throw_system_error(EDESTADDRREQ);
+
+  unixy::file_descriptor fd {
+      ::socket(_address.ss_family,
+               SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)
+  };
+  if (!fd)
+    unixy::throw_system_error();
+
+  int e = _options.apply(fd, _address.ss_family);
+  if (e == 0 && _address.ss_family != AF_UNIX)
+  {
+    e = set_option(fd, SOL_SOCKET, SO_REUSEADDR, _reuse_address);
+    if (e == 0)
+      e = set_option(fd, SOL_SOCKET, SO_REUSEPORT, _reuse_port);
+    if (e == 0 && _fast_open != 0)
+      e = set_option(fd, IPPROTO_TCP, TCP_FASTOPEN,
+                     clamp_to_int(_fast_open));
+    if (e == 0 && _defer_accept.count() != 0)
+      e = set_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                     static_cast<int>(_defer_accept.count()));
+  }
+  if (e != 0)
+    unixy::throw_system_error(e);
+
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&_address), _length) == -1)
+    unixy::throw_system_error();
+  if (::listen(fd, _backlog) == -1)
+    unixy::throw_system_error();
+
+  auto listener = std::make_shared<socket_listener>(_loop, std::move(fd),
+                                                    _bm, _budget);
+  listener->listen(std::move(routine));
+  return listener;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/network_context.hpp>
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc-linux/udp_endpoint.hpp>
+
+lanxc::linuxy::network_context::network_context(event_loop &loop,
+                                                 buffer_manager &bm) noexcept
+  : _loop(loop)
+  , _bm(bm)
+{ }
+
+lanxc::linuxy::network_context::~network_context() = default;
+
+std::shared_ptr<lanxc::connection_listener_builder>
+lanxc::linuxy::network_context::build_connection_listener()
+{
+  return std::make_shared<socket_listener_builder>(_loop, _bm);
+}
+
+std::shared_ptr<lanxc::connection_endpoint_builder>
+lanxc::linuxy::network_context::build_connection_endpoint()
+{
+  return std::make_shared<socket_endpoint_builder>(_loop, _bm);
+}
+
+std::shared_ptr<lanxc::datagram_endpoint_builder>
+lanxc::linuxy::network_context::create_datagram_endpoint()
+{
+  return std::make_shared<udp_endpoint_builder>(_loop, _bm);
+}
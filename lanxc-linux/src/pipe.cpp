@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/pipe.hpp>
+#include <lanxc-unixy/stream.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace
+{
+  using lanxc::unixy::throw_system_error;
+
+  /**
+   * @brief Wait for @p events of `poll` on @p fd, blocking the thread,
+   * which is why `linuxy::pipe` is meant for threads outside of event loops
+   */
+  void wait(int fd, short events)
+  {
+    struct pollfd p = { fd, events, 0 };
+    while (::poll(&p, 1, -1) == -1)
+      if (errno != EINTR)
+        throw_system_error();
+  }
+
+  /**
+   * @brief Retry @p transfer on interruption, waiting for @p in to be
+   * readable and then @p out to be writable if it would block
+   *
+   * Either may be -1 if the transfer never waits for it, e.g. a regular
+   * file or a private pipe known to be ready. They are waited in turn
+   * rather than together, as `poll` returns once either is ready, and the
+   * transfer would fail again for the other one.
+   * @returns Bytes transferred, 0 at the end of input, or -1 with errno
+   * set to EINVAL if the kernel doesn't support the descriptors
+   */
+  template<typename Transfer>
+  ssize_t retry(int in, int out, Transfer &&transfer)
+  {
+    for (;;)
+    {
+      ssize_t n = transfer();
+      if (n >= 0)
+        return n;
+      switch (errno)
+      {
+      case EINTR:
+        break;
+      case EAGAIN:
+        if (in != -1)
+          wait(in, POLLIN);
+        if (out != -1)
+          wait(out, POLLOUT);
+        break;
+      case EINVAL:
+      case ENOSYS:
+        errno = EINVAL;
+        return -1;
+      default:
+        throw_system_error();
+      }
+    }
+  }
+
+  ssize_t send_file(int in, int out, std::size_t chunk, std::size_t &total)
+  {
+    for (;;)
+    {
+      // Reading a regular file never blocks
+      ssize_t n = retry(-1, out, [&]
+                        { return ::sendfile(out, in, nullptr, chunk); });
+      if (n <= 0)
+        return n;
+      total += static_cast<std::size_t>(n);
+    }
+  }
+
+  ssize_t splice_directly(int in, int out, std::size_t chunk,
+                          std::size_t &total)
+  {
+    for (;;)
+    {
+      ssize_t n = retry(in, out, [&]
+                        {
+                          return ::splice(in, nullptr, out, nullptr, chunk,
+                                          SPLICE_F_MOVE | SPLICE_F_MORE);
+                        });
+      if (n <= 0)
+        return n;
+      total += static_cast<std::size_t>(n);
+    }
+  }
+
+  ssize_t splice_through_pipe(int in, int out, std::size_t chunk,
+                              std::size_t &total)
+  {
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) == -1)
+      throw_system_error();
+    lanxc::unixy::file_descriptor r(fds[0]), w(fds[1]);
+    // Each round moves at most the capacity of the pipe, which stays the
+    // default if it can't grow, e.g. beyond fs.pipe-max-size without
+    // privileges
+    int capacity = ::fcntl(w, F_SETPIPE_SZ,
+                           static_cast<int>(std::min<std::size_t>(
+                               chunk, INT_MAX)));
+    if (capacity == -1)
+    {
+      if (errno != EPERM)
+        throw_system_error();
+      capacity = ::fcntl(w, F_GETPIPE_SZ);
+      if (capacity == -1)
+        throw_system_error();
+    }
+    chunk = std::min(chunk, static_cast<std::size_t>(capacity));
+    for (;;)
+    {
+      // The pipe is drained in each round, so only the input is waited
+      ssize_t n = retry(in, -1, [&]
+                        {
+                          return ::splice(in, nullptr, w, nullptr, chunk,
+                                          SPLICE_F_MOVE | SPLICE_F_MORE);
+                        });
+      if (n <= 0)
+        return n;
+      // The pipe is private, so it's drained before the next round, and
+      // it stays readable until then
+      for (ssize_t left = n; left > 0; )
+      {
+        ssize_t m = retry(-1, out, [&]
+                          {
+                            return ::splice(r, nullptr, out, nullptr,
+                                            static_cast<std::size_t>(left),
+                                            SPLICE_F_MOVE | SPLICE_F_MORE);
+                          });
+        if (m <= 0)
+          throw_system_error(m == 0 ? EPIPE : errno);
+        left -= m;
+      }
+      total += static_cast<std::size_t>(n);
+    }
+  }
+}
+
+lanxc::future<std::size_t>
+lanxc::linuxy::pipe(readable_stream &from, writable_stream &to,
+                    std::size_t chunk)
+{
+  auto *in = dynamic_cast<unixy::stream *>(&from);
+  auto *out = dynamic_cast<unixy::stream *>(&to);
+  if (!in || !out)
+    return lanxc::pipe(from, to, chunk);
+
+  // Transfer only once the future is started
+  return future<>::resolve().then([&from, &to, in, out, chunk]
+                                      () -> future<std::size_t>
+  {
+    int ifd = in->native_handle(), ofd = out->native_handle();
+    struct stat is, os;
+    if (::fstat(ifd, &is) == -1 || ::fstat(ofd, &os) == -1)
+      throw_system_error();
+
+    std::size_t total = 0;
+    ssize_t r;
+    if (S_ISREG(is.st_mode))
+      r = send_file(ifd, ofd, chunk, total);
+    else if (S_ISFIFO(is.st_mode) || S_ISFIFO(os.st_mode))
+      r = splice_directly(ifd, ofd, chunk, total);
+    else
+      r = splice_through_pipe(ifd, ofd, chunk, total);
+    if (r >= 0)
+      return future<std::size_t>::resolve(total);
+
+    // Refused by kernel, bytes transferred are never lost in between
+    return lanxc::pipe(from, to, chunk)
+        .then([total](std::size_t n) { return total + n; });
+  });
+}
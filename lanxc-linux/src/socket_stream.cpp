@@ -0,0 +1,579 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/socket_stream.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace
+{
+  /** @brief Copy first @p n bytes of @p chain to @p out and consume them */
+  void take(lanxc::buffer_chain &chain, std::uint8_t *out, std::size_t n)
+  {
+    std::size_t copied = 0;
+    chain.for_each([&](const std::uint8_t *data, std::size_t size)
+                   {
+                     std::size_t c = std::min(size, n - copied);
+                     std::memcpy(out + copied, data, c);
+                     copied += c;
+                   });
+    chain.consume(n);
+  }
+}
+
+constexpr std::size_t lanxc::linuxy::socket_stream::max_descriptors;
+
+lanxc::linuxy::socket_stream::socket_stream(event_loop &loop,
+                                            unixy::file_descriptor fd,
+                                            buffer_manager &bm,
+                                            watermark receiving,
+                                            watermark sending,
+                                            std::size_t chunk)
+  : socket_stream(loop, std::move(fd), bm, AF_UNSPEC,
+                  receiving, sending, chunk)
+{
+  int flags = ::fcntl(_fd, F_GETFL);
+  if (flags == -1 || ::fcntl(_fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    unixy::throw_system_error();
+  sockaddr_storage address;
+  socklen_t length = sizeof(address);
+  _local = ::getsockname(_fd, reinterpret_cast<sockaddr *>(&address),
+                         &length) == 0
+           && address.ss_family == AF_UNIX;
+}
+
+lanxc::linuxy::socket_stream::socket_stream(event_loop &loop,
+                                            unixy::file_descriptor fd,
+                                            buffer_manager &bm,
+                                            sa_family_t family,
+                                            watermark receiving,
+                                            watermark sending,
+                                            std::size_t chunk)
+  : event_channel(loop, fd)
+  , _fd(std::move(fd))
+  , _bm(bm)
+  , _receiving_watermark(receiving)
+  , _sending_watermark(sending)
+  , _chunk{chunk}
+  , _received{}
+  , _queued{}
+  , _request{}
+  , _chain_request{}
+  , _writers{}
+  , _attachments{}
+  , _descriptors{}
+  , _received_bytes{0}
+  , _error{}
+  , _coalescing{0, std::chrono::nanoseconds::zero()}
+  , _flusher{}
+  , _statistics{0, 0, 0}
+  , _local{family == AF_UNIX}
+  , _receiving{false}
+  , _eof{false}
+  , _discarded{false}
+  , _closed{false}
+  , _shutdown{false}
+{
+  update_events();
+}
+
+lanxc::linuxy::socket_stream::~socket_stream()
+{
+  if (_flusher)
+    _flusher->cancel();
+  set_events(0);
+}
+
+void lanxc::linuxy::socket_stream::update_events()
+{
+  // Hysteresis between watermarks, so that polling isn't toggled for
+  // every chunk received and consumed
+  std::size_t limit = _receiving ? _receiving_watermark.high
+                                 : _receiving_watermark.low;
+  // Keep receiving for a reader waiting for more than the high watermark
+  if (_request)
+    limit = std::max(limit, std::min(_request->size, _request->watermark));
+  _receiving = !_eof && !_discarded
+               && (_received.size() < limit || _received.size() == 0);
+  // Bytes held are sent by the flusher rather than once writable
+  set_events((_receiving ? readable : 0u)
+             | (_queued.size() != 0 && !_flusher ? writable : 0u));
+}
+
+void lanxc::linuxy::socket_stream::fail(int e)
+{
+  if (!_error)
+    _error = std::make_exception_ptr(
+        std::system_error(std::error_code(e, std::system_category())));
+  _eof = true;
+  _queued.clear();
+  _attachments.clear();
+}
+
+void lanxc::linuxy::socket_stream::receive()
+{
+  std::size_t limit = _receiving_watermark.high;
+  if (_request)
+    limit = std::max(limit, std::min(_request->size, _request->watermark));
+  while (_received.size() < limit)
+  {
+    writable_buffer b(_bm, _chunk);
+    ssize_t n = receive(b.data(), b.capacity());
+    if (n > 0)
+    {
+      b.resize(static_cast<std::size_t>(n));
+      _received.push_back(std::move(b));
+      _received_bytes += static_cast<std::size_t>(n);
+      continue;
+    }
+    if (n == 0)
+      _eof = true;
+    else if (errno == EINTR)
+      continue;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK)
+      fail(errno);
+    break;
+  }
+}
+
+ssize_t lanxc::linuxy::socket_stream::receive(std::uint8_t *data,
+                                              std::size_t size)
+{
+  if (!_local)
+    return ::recv(_fd, data, size, 0);
+  struct iovec iov = { data, size };
+  union
+  {
+    struct cmsghdr header;
+    char bytes[CMSG_SPACE(sizeof(int) * max_descriptors)];
+  } control;
+  struct msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = &control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n = ::recvmsg(_fd, &msg, MSG_CMSG_CLOEXEC);
+  if (n < 0)
+    return n;
+  // Linux stops reading right after the bytes descriptors are attached
+  // to, so they arrive with the last byte read
+  attachment a{_received_bytes + std::uint64_t(n) - 1, {}};
+  for (auto c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c))
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS)
+    {
+      auto fds = reinterpret_cast<const unsigned char *>(CMSG_DATA(c));
+      std::size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        int fd;
+        std::memcpy(&fd, fds + i * sizeof(int), sizeof(int));
+        a.descriptors.emplace_back(fd);
+      }
+    }
+  if (msg.msg_flags & MSG_CTRUNC)
+  {
+    // Descriptors discarded can't be told apart from those received, so
+    // the rest are closed, and the stream fails
+    errno = EMSGSIZE;
+    return -1;
+  }
+  if (!a.descriptors.empty())
+    _descriptors.push_back(std::move(a));
+  return n;
+}
+
+void lanxc::linuxy::socket_stream::send()
+{
+  while (_queued.size() != 0)
+  {
+    // Descriptors are sent with their first byte by itself, so a message
+    // stops before the next descriptors attached, or right after the byte
+    // carrying them, which the peer stops reading at
+    std::size_t limit = _queued.size();
+    attachment *a = nullptr;
+    if (!_attachments.empty())
+    {
+      auto &front = _attachments.front();
+      if (front.offset != _statistics.bytes)
+        limit = std::size_t(front.offset - _statistics.bytes);
+      else
+      {
+        a = &front;
+        limit = 1;
+      }
+    }
+
+    struct iovec iov[IOV_MAX];
+    int count = 0;
+    _queued.for_each([&](const std::uint8_t *data, std::size_t size)
+                     {
+                       if (count == IOV_MAX || limit == 0)
+                         return;
+                       size = std::min(size, limit);
+                       limit -= size;
+                       iov[count].iov_base = const_cast<std::uint8_t *>(data);
+                       iov[count].iov_len = size;
+                       count++;
+                     });
+    struct msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(count);
+
+    union
+    {
+      struct cmsghdr header;
+      char bytes[CMSG_SPACE(sizeof(int) * max_descriptors)];
+    } control;
+    std::size_t passed = 0;
+    if (a)
+    {
+      passed = std::min(a->descriptors.size(), max_descriptors);
+      msg.msg_control = &control;
+      msg.msg_controllen = CMSG_SPACE(sizeof(int) * passed);
+      auto c = CMSG_FIRSTHDR(&msg);
+      c->cmsg_level = SOL_SOCKET;
+      c->cmsg_type = SCM_RIGHTS;
+      c->cmsg_len = CMSG_LEN(sizeof(int) * passed);
+      auto fds = reinterpret_cast<unsigned char *>(CMSG_DATA(c));
+      for (std::size_t i = 0; i < passed; i++)
+      {
+        int fd = a->descriptors[i];
+        std::memcpy(fds + i * sizeof(int), &fd, sizeof(int));
+      }
+    }
+
+    ssize_t n = ::sendmsg(_fd, &msg, MSG_NOSIGNAL);
+    _statistics.syscalls++;
+    if (n >= 0)
+    {
+      _queued.consume(static_cast<std::size_t>(n));
+      _statistics.bytes += static_cast<std::size_t>(n);
+      if (a)
+      {
+        // The peer has got duplicates, and the rest go with the next byte
+        a->descriptors.erase(a->descriptors.begin(),
+                             a->descriptors.begin()
+                             + static_cast<std::ptrdiff_t>(passed));
+        if (a->descriptors.empty())
+          _attachments.pop_front();
+        else
+          a->offset = _statistics.bytes;
+      }
+      continue;
+    }
+    if (errno == EINTR)
+      continue;
+    // Connecting by TCP Fast Open without a cookie, the SYN is sent
+    // without bytes and the rest wait for the handshake
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINPROGRESS)
+      fail(errno);
+    break;
+  }
+  if (_queued.size() == 0 && _closed && !_shutdown)
+  {
+    _shutdown = true;
+    ::shutdown(_fd, SHUT_WR);
+  }
+}
+
+void lanxc::linuxy::socket_stream::hold()
+{
+  if (_flusher)
+    return;
+  auto routine = [this]
+  {
+    _flusher.reset();
+    send();
+    reply_writers();
+    update_events();
+  };
+  if (_coalescing.delay == std::chrono::nanoseconds::zero())
+    _flusher = loop().defer(routine);
+  else
+    _flusher = loop().schedule(
+        std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<task_context::time_point::duration>(
+            _coalescing.delay),
+        routine);
+}
+
+void lanxc::linuxy::socket_stream::uncork()
+{
+  if (!_flusher)
+    return;
+  _flusher->cancel();
+  _flusher.reset();
+  send();
+}
+
+void lanxc::linuxy::socket_stream::coalesce(coalescing c)
+{
+  _coalescing = c;
+  if (c.bytes == 0)
+  {
+    uncork();
+    reply_writers();
+    update_events();
+  }
+}
+
+void lanxc::linuxy::socket_stream::reply_reader()
+{
+  if (_chain_request)
+  {
+    auto &r = *_chain_request;
+    if (_discarded)
+      r.reply.reject(stream_discarded_exception());
+    else if (_received.size() == 0 && _error)
+      r.reply.reject_by_exception_ptr(_error);
+    else if (_received.size() != 0 || _eof)
+    {
+      std::size_t n = 0;
+      r.chain.for_each_capacity([&](std::uint8_t *room, std::size_t size)
+                                {
+                                  std::size_t c = std::min(size,
+                                                           _received.size());
+                                  take(_received, room, c);
+                                  n += c;
+                                });
+      r.chain.fill(n);
+      r.reply.fulfill(n, std::move(r.chain));
+    }
+    else
+      return;
+    _chain_request.reset();
+    return;
+  }
+  if (!_request)
+    return;
+  auto &r = *_request;
+  std::size_t low = std::max<std::size_t>(1, std::min(r.size, r.watermark));
+  if (_discarded)
+    r.reply.reject(stream_discarded_exception());
+  else if (_received.size() == 0 && _error)
+    r.reply.reject_by_exception_ptr(_error);
+  else if (_received.size() >= low || _eof)
+  {
+    std::size_t n = std::min(r.size, _received.size());
+    writable_buffer b(_bm, n);
+    take(_received, b.data(), n);
+    r.reply.fulfill(n, readable_buffer(std::move(b)));
+  }
+  else
+    return;
+  // Results are delivered once the promise is destroyed
+  _request.reset();
+}
+
+void lanxc::linuxy::socket_stream::reply_writers()
+{
+  auto i = std::partition(_writers.begin(), _writers.end(),
+                          [this](const std::pair<std::size_t, promise<>> &w)
+                          { return !_error && _queued.size() >= w.first; });
+  std::vector<std::pair<std::size_t, promise<>>> ready;
+  std::move(i, _writers.end(), std::back_inserter(ready));
+  _writers.erase(i, _writers.end());
+  for (auto &w : ready)
+    if (_error)
+      w.second.reject_by_exception_ptr(_error);
+    else
+      w.second.fulfill();
+}
+
+void lanxc::linuxy::socket_stream::on_readable()
+{
+  receive();
+  reply_reader();
+  reply_writers();
+  update_events();
+}
+
+void lanxc::linuxy::socket_stream::on_writable()
+{
+  send();
+  reply_writers();
+  update_events();
+}
+
+lanxc::future<size_t, lanxc::readable_buffer>
+lanxc::linuxy::socket_stream::read(std::size_t size, std::size_t watermark)
+{
+  return future<size_t, readable_buffer>(
+      [this, size, watermark](promise<size_t, readable_buffer> p)
+      {
+        if (_request || _chain_request)
+        {
+          // Only one read may be outstanding
+          p.reject(std::logic_error("socket_stream: read is pending"));
+          return;
+        }
+        _request.reset(new read_request{size, watermark, std::move(p)});
+        reply_reader();
+        update_events();
+      });
+}
+
+lanxc::future<std::size_t, lanxc::buffer_chain>
+lanxc::linuxy::socket_stream::read(buffer_chain chain)
+{
+  auto c = std::make_shared<buffer_chain>(std::move(chain));
+  return future<std::size_t, buffer_chain>(
+      [this, c](promise<std::size_t, buffer_chain> p)
+      {
+        if (_request || _chain_request)
+        {
+          p.reject(std::logic_error("socket_stream: read is pending"));
+          return;
+        }
+        _chain_request.reset(new chain_request{std::move(*c), std::move(p)});
+        reply_reader();
+        update_events();
+      });
+}
+
+void lanxc::linuxy::socket_stream::discard()
+{
+  _discarded = true;
+  _received.clear();
+  reply_reader();
+  update_events();
+}
+
+lanxc::writable_buffer
+lanxc::linuxy::socket_stream::allocate_buffer(std::size_t size)
+{
+  return writable_buffer(_bm, size);
+}
+
+std::size_t lanxc::linuxy::socket_stream::write(writable_buffer b)
+{
+  buffer_chain chain;
+  chain.push_back(std::move(b));
+  return write(std::move(chain));
+}
+
+std::size_t lanxc::linuxy::socket_stream::write(buffer_chain chain)
+{
+  if (_closed)
+    throw stream_closed_exception();
+  if (_error)
+    std::rethrow_exception(_error);
+  std::size_t n = chain.size();
+  bool idle = _queued.size() == 0 || _flusher;
+  while (!chain.empty())
+    _queued.push_back(chain.pop_front());
+  _statistics.messages++;
+  // Try sending right away, unless bytes queued are waiting for the
+  // socket to be writable, or are held to be sent together
+  if (idle)
+  {
+    if (_queued.size() < _coalescing.bytes)
+      hold();
+    else if (_flusher)
+      uncork();
+    else
+      send();
+  }
+  reply_writers();
+  update_events();
+  return n;
+}
+
+std::size_t lanxc::linuxy::socket_stream::write(
+    buffer_chain chain, std::vector<unixy::file_descriptor> descriptors)
+{
+  if (_closed)
+    throw stream_closed_exception();
+  if (_error)
+    std::rethrow_exception(_error);
+  if (!descriptors.empty())
+  {
+    if (!_local)
+      throw std::logic_error("socket_stream: not a Unix domain socket");
+    std::size_t bytes = (descriptors.size() + max_descriptors - 1)
+                        / max_descriptors;
+    if (chain.size() < bytes)
+      throw std::invalid_argument(
+          "socket_stream: too few bytes to pass descriptors");
+    _attachments.push_back(attachment{_statistics.bytes + _queued.size(),
+                                      std::move(descriptors)});
+  }
+  return write(std::move(chain));
+}
+
+std::vector<lanxc::linuxy::socket_stream::attachment>
+lanxc::linuxy::socket_stream::take_descriptors()
+{
+  auto descriptors = std::move(_descriptors);
+  _descriptors.clear();
+  return descriptors;
+}
+
+lanxc::linuxy::socket_stream::credentials
+lanxc::linuxy::socket_stream::peer_credentials() const
+{
+  struct ucred c;
+  socklen_t length = sizeof(c);
+  if (::getsockopt(_fd, SOL_SOCKET, SO_PEERCRED, &c, &length) == -1)
+    unixy::throw_system_error();
+  return credentials{c.pid, c.uid, c.gid};
+}
+
+void lanxc::linuxy::socket_stream::close()
+{
+  if (_closed)
+    return;
+  _closed = true;
+  if (_flusher)
+    uncork();
+  else
+    send();
+  update_events();
+}
+
+lanxc::future<> lanxc::linuxy::socket_stream::flush()
+{
+  return future<>([this](promise<> p)
+                  {
+                    _writers.emplace_back(1, std::move(p));
+                    uncork();
+                    reply_writers();
+                    update_events();
+                  });
+}
+
+lanxc::future<> lanxc::linuxy::socket_stream::drain()
+{
+  return future<>([this](promise<> p)
+                  {
+                    _writers.emplace_back(
+                        std::max<std::size_t>(1, _sending_watermark.low),
+                        std::move(p));
+                    uncork();
+                    reply_writers();
+                    update_events();
+                  });
+}
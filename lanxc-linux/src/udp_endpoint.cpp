@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/udp_endpoint.hpp>
+#include <lanxc-linux/network_connection.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/udp.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace
+{
+  /** @brief Segments of a payload the system splits at most, at least */
+  constexpr std::size_t max_segments = 64;
+
+  /** @brief Bytes of an UDP payload over IPv4 at most */
+  constexpr std::size_t max_payload = 65507;
+
+  /**
+   * @brief Batches filling less than this share of the buffer are copied
+   * out, so datagrams kept never pin a buffer much larger than they are
+   */
+  constexpr std::size_t copy_ratio = 4;
+
+  std::size_t segments(const lanxc::datagram &d) noexcept
+  {
+    if (d.segment_size == 0)
+      return 1;
+    return (d.payload.size() + d.segment_size - 1) / d.segment_size;
+  }
+}
+
+lanxc::linuxy::udp_endpoint::udp_endpoint(event_loop &loop,
+                                          unixy::file_descriptor fd,
+                                          buffer_manager &bm,
+                                          std::size_t batch,
+                                          std::size_t datagram_size)
+  : event_channel(loop, fd)
+  , _fd(std::move(fd))
+  , _bm(bm)
+  , _batch{batch}
+  , _datagram_size{datagram_size}
+  , _buffer(bm, batch * datagram_size)
+  , _headers(batch)
+  , _vectors(batch)
+  , _controls(batch)
+  , _peers(batch)
+  , _queued{}
+  , _request{}
+  , _flushers{}
+  , _statistics{0, 0, 0, 0}
+  , _segmentation{true}
+{
+  int flags = ::fcntl(_fd, F_GETFL);
+  if (flags == -1 || ::fcntl(_fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    unixy::throw_system_error();
+}
+
+lanxc::linuxy::udp_endpoint::~udp_endpoint()
+{
+  set_events(0);
+}
+
+void lanxc::linuxy::udp_endpoint::update_events()
+{
+  set_events((_request ? readable : 0u)
+             | (_queued.empty() ? 0u : writable));
+}
+
+std::size_t
+lanxc::linuxy::udp_endpoint::receive(std::vector<datagram> &datagrams)
+{
+  for (std::size_t i = 0; i < _batch; i++)
+  {
+    auto &v = _vectors[i];
+    v.iov_base = _buffer.data() + i * _datagram_size;
+    v.iov_len = _datagram_size;
+    auto &h = _headers[i].msg_hdr;
+    h = msghdr{};
+    h.msg_name = _peers[i].storage;
+    h.msg_namelen = sizeof(_peers[i].storage);
+    h.msg_iov = &v;
+    h.msg_iovlen = 1;
+    h.msg_control = &_controls[i];
+    h.msg_controllen = sizeof(control);
+  }
+
+  int n;
+  do
+    n = ::recvmmsg(_fd, _headers.data(), static_cast<unsigned>(_batch),
+                   MSG_DONTWAIT, nullptr);
+  while (n == -1 && errno == EINTR);
+  _statistics.syscalls++;
+  if (n <= 0)
+  {
+    if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+      unixy::throw_system_error();
+    return 0;
+  }
+
+  std::size_t used = 0;
+  for (std::size_t i = 0; i < std::size_t(n); i++)
+    if (!(_headers[i].msg_hdr.msg_flags & MSG_TRUNC))
+      used += _headers[i].msg_len;
+
+  // Datagrams of this batch share a buffer. A batch filling most of the
+  // buffer takes it, and the next batch is received into a new one, while
+  // the rest are copied into a buffer of their size, and the buffer is
+  // kept for the next batch, e.g. a few datagrams in slots of 64KiB for
+  // receive offload.
+  buffer_slice whole;
+  bool compact = used * copy_ratio <= _batch * _datagram_size;
+  if (!compact)
+  {
+    whole = buffer_slice(readable_buffer(std::move(_buffer)));
+    _buffer = writable_buffer(_bm, _batch * _datagram_size);
+  }
+  else if (used != 0)
+  {
+    writable_buffer b(_bm, used);
+    std::size_t position = 0;
+    for (std::size_t i = 0; i < std::size_t(n); i++)
+      if (!(_headers[i].msg_hdr.msg_flags & MSG_TRUNC))
+      {
+        std::memcpy(b.data() + position, _buffer.data() + i * _datagram_size,
+                    _headers[i].msg_len);
+        position += _headers[i].msg_len;
+      }
+    whole = buffer_slice(readable_buffer(std::move(b)));
+  }
+
+  std::size_t count = 0;
+  std::size_t position = 0;
+  for (std::size_t i = 0; i < std::size_t(n); i++)
+  {
+    auto &h = _headers[i];
+    if (h.msg_hdr.msg_flags & MSG_TRUNC)
+    {
+      _statistics.dropped++;
+      continue;
+    }
+    auto &peer = _peers[i];
+    peer.length = h.msg_hdr.msg_namelen;
+
+    // Datagrams coalesced by GRO are of the same size except the last one
+    std::size_t segment = h.msg_len;
+    for (auto c = CMSG_FIRSTHDR(&h.msg_hdr); c != nullptr;
+         c = CMSG_NXTHDR(&h.msg_hdr, c))
+      if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO)
+      {
+        int size;
+        std::memcpy(&size, CMSG_DATA(c), sizeof(size));
+        if (size > 0)
+          segment = std::size_t(size);
+      }
+
+    auto payload = whole.slice(compact ? position : i * _datagram_size,
+                               h.msg_len);
+    position += h.msg_len;
+    std::size_t offset = 0;
+    do
+    {
+      datagrams.push_back(datagram{payload.slice(offset, segment), peer, 0});
+      offset += segment;
+      count++;
+    }
+    while (offset < payload.size());
+  }
+  _statistics.received += count;
+  return count;
+}
+
+lanxc::future<std::vector<lanxc::datagram>>
+lanxc::linuxy::udp_endpoint::receive()
+{
+  return future<std::vector<datagram>>(
+      [this](promise<std::vector<datagram>> p)
+      {
+        if (_request)
+        {
+          // Only one receiving may be outstanding
+          p.reject(std::logic_error("udp_endpoint: receive is pending"));
+          return;
+        }
+        _request.reset(new promise<std::vector<datagram>>(std::move(p)));
+        update_events();
+      });
+}
+
+void lanxc::linuxy::udp_endpoint::on_readable()
+{
+  std::vector<datagram> datagrams;
+  try
+  {
+    if (receive(datagrams) == 0)
+      return;
+    _request->fulfill(std::move(datagrams));
+  }
+  catch (...)
+  {
+    _request->reject_by_exception_ptr(std::current_exception());
+  }
+  // Results are delivered once the promise is destroyed
+  _request.reset();
+  update_events();
+}
+
+void lanxc::linuxy::udp_endpoint::enqueue(datagram d)
+{
+  std::size_t size = d.payload.size();
+  std::size_t segment = d.segment_size;
+  if (segment == 0 || size <= segment)
+  {
+    d.segment_size = 0;
+    _queued.push_back(std::move(d));
+    return;
+  }
+  // Split into pieces the system accepts at once, or into datagrams if
+  // the system doesn't split them
+  std::size_t piece = segment;
+  if (_segmentation)
+    piece *= std::max<std::size_t>(
+        1, std::min(max_segments, max_payload / segment));
+  for (std::size_t offset = 0; offset < size; offset += piece)
+  {
+    auto p = d.payload.slice(offset, piece);
+    auto s = static_cast<std::uint16_t>(p.size() > segment ? segment : 0);
+    _queued.push_back(datagram{std::move(p), d.peer, s});
+  }
+}
+
+std::size_t lanxc::linuxy::udp_endpoint::transmit()
+{
+  std::size_t total = 0;
+  while (!_queued.empty())
+  {
+    std::size_t count = std::min(_batch, _queued.size());
+    for (std::size_t i = 0; i < count; i++)
+    {
+      auto &d = _queued[i];
+      auto &v = _vectors[i];
+      v.iov_base = const_cast<std::uint8_t *>(d.payload.data());
+      v.iov_len = d.payload.size();
+      auto &h = _headers[i].msg_hdr;
+      h = msghdr{};
+      if (d.peer.length != 0)
+      {
+        h.msg_name = d.peer.storage;
+        h.msg_namelen = d.peer.length;
+      }
+      h.msg_iov = &v;
+      h.msg_iovlen = 1;
+      if (d.segment_size != 0)
+      {
+        h.msg_control = &_controls[i];
+        h.msg_controllen = CMSG_SPACE(sizeof(d.segment_size));
+        auto c = CMSG_FIRSTHDR(&h);
+        c->cmsg_level = SOL_UDP;
+        c->cmsg_type = UDP_SEGMENT;
+        c->cmsg_len = CMSG_LEN(sizeof(d.segment_size));
+        std::memcpy(CMSG_DATA(c), &d.segment_size, sizeof(d.segment_size));
+      }
+    }
+    int n = ::sendmmsg(_fd, _headers.data(), static_cast<unsigned>(count),
+                       MSG_DONTWAIT | MSG_NOSIGNAL);
+    _statistics.syscalls++;
+    if (n >= 0)
+    {
+      auto end = _queued.begin() + n;
+      for (auto i = _queued.begin(); i != end; ++i)
+        total += segments(*i);
+      _queued.erase(_queued.begin(), end);
+      continue;
+    }
+    if (errno == EINTR)
+      continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      break;
+    if (_queued.front().segment_size != 0
+        && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT))
+    {
+      // Segmentation is not supported, e.g. by a device without checksum
+      // offload, so split payloads queued into datagrams
+      _segmentation = false;
+      auto queued = std::move(_queued);
+      _queued.clear();
+      for (auto &d : queued)
+        enqueue(std::move(d));
+      continue;
+    }
+    // The datagram in front is rejected, e.g. too large or refused by the
+    // connected peer, while the rest may still be sent
+    _statistics.dropped += segments(_queued.front());
+    _queued.pop_front();
+  }
+  _statistics.sent += total;
+  return total;
+}
+
+std::size_t lanxc::linuxy::udp_endpoint::send(std::vector<datagram> datagrams)
+{
+  for (auto &d : datagrams)
+    enqueue(std::move(d));
+  std::size_t sent = transmit();
+  reply_flushers();
+  update_events();
+  return sent;
+}
+
+void lanxc::linuxy::udp_endpoint::reply_flushers()
+{
+  if (!_queued.empty())
+    return;
+  auto flushers = std::move(_flushers);
+  _flushers.clear();
+  for (auto &f : flushers)
+    f.fulfill();
+}
+
+void lanxc::linuxy::udp_endpoint::on_writable()
+{
+  transmit();
+  reply_flushers();
+  update_events();
+}
+
+lanxc::future<> lanxc::linuxy::udp_endpoint::flush()
+{
+  return future<>([this](promise<> p)
+                  {
+                    _flushers.push_back(std::move(p));
+                    reply_flushers();
+                  });
+}
+
+lanxc::datagram_address
+lanxc::linuxy::udp_endpoint::resolve(std::string address,
+                                     std::uint16_t port) const
+{
+  sockaddr_storage s;
+  socklen_t length = parse_socket_address(address, port, s);
+  if (length == 0)
+    unixy::throw_system_error(EINVAL);
+  datagram_address a;
+  a.length = length;
+  std::memcpy(a.storage, &s, length);
+  return a;
+}
+
+lanxc::linuxy::udp_endpoint_builder::
+udp_endpoint_builder(event_loop &loop, buffer_manager &bm) noexcept
+  : _loop(loop)
+  , _bm(bm)
+  , _source{}
+  , _source_length{0}
+  , _peer{}
+  , _peer_length{0}
+  , _batch{64}
+  , _datagram_size{2048}
+  , _receive_offload{false}
+{ }
+
+lanxc::linuxy::udp_endpoint_builder::~udp_endpoint_builder() = default;
+
+std::shared_ptr<lanxc::datagram_endpoint_builder>
+lanxc::linuxy::udp_endpoint_builder::bind(std::string address,
+                                          std::uint16_t port)
+{
+  _source_length = parse_socket_address(address, port, _source);
+  if (_source_length == 0)
+    unixy::throw_system_error(EINVAL);
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::datagram_endpoint_builder>
+lanxc::linuxy::udp_endpoint_builder::connect(std::string address,
+                                             std::uint16_t port)
+{
+  _peer_length = parse_socket_address(address, port, _peer);
+  if (_peer_length == 0)
+    unixy::throw_system_error(EINVAL);
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::datagram_endpoint_builder>
+lanxc::linuxy::udp_endpoint_builder::set_batch_size(std::size_t datagrams)
+{
+  if (datagrams == 0)
+    throw std::invalid_argument("batch size must not be 0");
+  _batch = datagrams;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::datagram_endpoint_builder>
+lanxc::linuxy::udp_endpoint_builder::set_datagram_size(std::size_t bytes)
+{
+  if (bytes == 0)
+    throw std::invalid_argument("datagram size must not be 0");
+  _datagram_size = bytes;
+  return shared_from_this();
+}
+
+std::shared_ptr<lanxc::datagram_endpoint_builder>
+lanxc::linuxy::udp_endpoint_builder::set_receive_offload(bool enabled)
+{
+  _receive_offload = enabled;
+  return shared_from_this();
+}
+
+lanxc::datagram_endpoint::pointer
+lanxc::linuxy::udp_endpoint_builder::build()
+{
+  int family = _source_length != 0 ? _source.ss_family
+             : _peer_length != 0 ? _peer.ss_family
+             : AF_INET;
+  unixy::file_descriptor fd {
+      ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)
+  };
+  if (!fd)
+    unixy::throw_system_error();
+  if (_source_length != 0
+      && ::bind(fd, reinterpret_cast<sockaddr *>(&_source),
+                _source_length) == -1)
+    unixy::throw_system_error();
+  if (_peer_length != 0
+      && ::connect(fd, reinterpret_cast<sockaddr *>(&_peer),
+                   _peer_length) == -1)
+    unixy::throw_system_error();
+  std::size_t datagram_size = _datagram_size;
+  if (_receive_offload)
+  {
+    // Kernels without GRO for UDP just leave datagrams as they are
+    int enabled = 1;
+    ::setsockopt(fd, SOL_UDP, UDP_GRO, &enabled, sizeof(enabled));
+    datagram_size = 65536;
+  }
+  return std::make_shared<udp_endpoint>(_loop, std::move(fd), _bm, _batch,
+                                        datagram_size);
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/zerocopy_stream.hpp>
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <vector>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+constexpr std::size_t lanxc::linuxy::zerocopy_stream::default_threshold;
+
+lanxc::linuxy::zerocopy_stream::zerocopy_stream(unixy::file_descriptor fd,
+                                                buffer_manager &bm,
+                                                std::size_t threshold,
+                                                std::chrono::milliseconds
+                                                    linger)
+  : unixy::stream(std::move(fd), bm)
+  , _pending{}
+  , _threshold{threshold}
+  , _linger{linger}
+  , _next_id{0}
+  , _copied{0}
+  , _enabled{false}
+{
+  int one = 1;
+  _enabled = ::setsockopt(native_handle(), SOL_SOCKET, SO_ZEROCOPY,
+                          &one, sizeof(one)) == 0;
+}
+
+lanxc::linuxy::zerocopy_stream::~zerocopy_stream()
+{
+  // The kernel may still read from the buffers, don't release them early,
+  // but don't wait for a stalled peer for long either
+  auto deadline = std::chrono::steady_clock::now() + _linger;
+  try
+  {
+    while (!_pending.empty())
+    {
+      if (reap())
+        continue;
+      auto now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+        break;
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - now);
+      // Completions are reported as an error, which poll always waits for
+      struct pollfd p = { native_handle(), 0, 0 };
+      ::poll(&p, 1, static_cast<int>(left.count()) + 1);
+    }
+  }
+  catch (...)
+  { }
+  if (!_pending.empty())
+    reset();
+}
+
+void lanxc::linuxy::zerocopy_stream::reset() noexcept
+{
+  // Disconnecting a TCP socket resets the connection and purges its queues,
+  // which drops references of the kernel to pages of buffers
+  struct sockaddr unspecified{};
+  unspecified.sa_family = AF_UNSPEC;
+  ::connect(native_handle(), &unspecified, sizeof(unspecified));
+  try
+  {
+    reap();
+  }
+  catch (...)
+  { }
+}
+
+bool lanxc::linuxy::zerocopy_stream::reap()
+{
+  bool reaped = false;
+  for (;;)
+  {
+    char control[128];
+    struct msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        return reaped;
+      unixy::throw_system_error();
+    }
+    for (auto *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+    {
+      if (!((c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR)
+            || (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR)))
+        continue;
+      auto *e = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(c));
+      if (e->ee_errno != 0 || e->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+      if (e->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        _copied += e->ee_data - e->ee_info + 1;
+      // Completions of TCP are reported in order, as ranges of ids
+      while (!_pending.empty()
+             && static_cast<std::int32_t>(_pending.front().id - e->ee_data)
+                <= 0)
+        _pending.pop_front();
+      reaped = true;
+    }
+  }
+}
+
+std::size_t lanxc::linuxy::zerocopy_stream::send(buffer_chain chain)
+{
+  std::vector<struct iovec> iov;
+  chain.for_each([&](const std::uint8_t *data, std::size_t size)
+                 {
+                   struct iovec v;
+                   v.iov_base = const_cast<std::uint8_t *>(data);
+                   v.iov_len = size;
+                   iov.push_back(v);
+                 });
+
+  // Bytes sent are not consumed from the chain, which must stay intact
+  // until the kernel completes them
+  std::size_t index = 0, written = 0;
+  bool sent = false;
+  try
+  {
+    while (index != iov.size())
+    {
+      struct msghdr msg{};
+      msg.msg_iov = &iov[index];
+      msg.msg_iovlen = std::min<std::size_t>(iov.size() - index, IOV_MAX);
+      ssize_t n = ::sendmsg(native_handle(), &msg,
+                            MSG_ZEROCOPY | MSG_NOSIGNAL);
+      if (n == -1)
+      {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+          if (!reap())
+            wait(POLLOUT);
+          continue;
+        }
+        if (errno == ENOBUFS && (sent || !_pending.empty()))
+        {
+          // Out of memory to pin pages, wait for some completions
+          if (!reap())
+            wait(0);
+          continue;
+        }
+        if (errno != EINTR)
+          unixy::throw_system_error();
+        continue;
+      }
+      _next_id++;
+      sent = true;
+      written += static_cast<std::size_t>(n);
+      for (auto left = static_cast<std::size_t>(n); left != 0; )
+      {
+        auto &v = iov[index];
+        if (left < v.iov_len)
+        {
+          v.iov_base = static_cast<std::uint8_t *>(v.iov_base) + left;
+          v.iov_len -= left;
+          break;
+        }
+        left -= v.iov_len;
+        index++;
+      }
+      while (index != iov.size() && iov[index].iov_len == 0)
+        index++;
+    }
+  }
+  catch (...)
+  {
+    if (sent)
+      _pending.push_back(pending_chain{std::move(chain), _next_id - 1});
+    throw;
+  }
+  if (sent)
+    _pending.push_back(pending_chain{std::move(chain), _next_id - 1});
+  reap();
+  return written;
+}
+
+std::size_t lanxc::linuxy::zerocopy_stream::write(writable_buffer b)
+{
+  buffer_chain chain;
+  chain.push_back(std::move(b));
+  return write(std::move(chain));
+}
+
+std::size_t lanxc::linuxy::zerocopy_stream::write(buffer_chain chain)
+{
+  if (!_enabled || chain.size() < _threshold)
+  {
+    if (!_pending.empty())
+      reap();
+    return unixy::stream::write(std::move(chain));
+  }
+  if (closed())
+    throw stream_closed_exception();
+  return send(std::move(chain));
+}
+
+lanxc::future<> lanxc::linuxy::zerocopy_stream::flush()
+{
+  return future<>([this](promise<> p)
+                  {
+                    try
+                    {
+                      while (!_pending.empty())
+                        if (!reap())
+                          wait(0);
+                    }
+                    catch (...)
+                    {
+                      p.reject_by_exception_ptr(std::current_exception());
+                      return;
+                    }
+                    p.fulfill();
+                  });
+}
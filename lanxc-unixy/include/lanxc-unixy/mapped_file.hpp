@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc/core/buffer.hpp>
+#include <lanxc-unixy/config.hpp>
+#include <lanxc-unixy/unixy.hpp>
+
+#include <cstdint>
+
+namespace lanxc
+{
+  namespace unixy
+  {
+
+    /**
+     * @brief A readable stream of a regular file, handing out buffers
+     * pointing straight into a mapping of the file rather than copies
+     *
+     * The file is mapped window by window, so address space used stays
+     * bounded for huge files. Each window is unmapped once the stream has
+     * moved past it and every buffer pointing into it has been released,
+     * buffers may even outlive the stream. Windows are advised to be read
+     * sequentially, and bytes ahead of the reading position are advised to
+     * be read ahead.
+     *
+     * A buffer never crosses windows, so `read(size, watermark)` maps a new
+     * window starting near the reading position when the current one can't
+     * satisfy the watermark.
+     */
+    class LANXC_UNIXY_EXPORT mapped_file_stream : public readable_stream
+    {
+    public:
+      /**
+       * @param fd A regular file opened for reading, read from its start
+       * @param window Bytes mapped at most at once, rounded up to pages
+       * @param readahead Bytes ahead of the reading position advised to be
+       *                  read ahead, or 0 to leave it to the kernel
+       * @throws std::system_error if the file can't be examined
+       */
+      explicit mapped_file_stream(file_descriptor fd,
+                                  std::size_t window = 64 << 20,
+                                  std::size_t readahead = 4 << 20);
+
+      ~mapped_file_stream() override;
+
+      mapped_file_stream(const mapped_file_stream &) = delete;
+      mapped_file_stream &operator = (const mapped_file_stream &) = delete;
+
+      /**
+       * @brief Read at most @p size bytes of the file without copying
+       * @note @p watermark is capped by bytes of a window
+       */
+      future<size_t, readable_buffer>
+      read(std::size_t size, std::size_t watermark) override;
+
+      /** @brief Copy bytes of the file into @p chain */
+      future<std::size_t, buffer_chain> read(buffer_chain chain) override;
+
+      void discard() override;
+
+      /** @brief Bytes of the file */
+      std::uint64_t size() const noexcept
+      { return _size; }
+
+      /** @brief Bytes of the file read so far */
+      std::uint64_t position() const noexcept
+      { return _position; }
+
+      /** @brief Windows mapped, including those kept by buffers */
+      std::size_t mapped() const noexcept;
+
+    private:
+      class windows;
+
+      /**
+       * @brief Make sure at least @p bytes from the reading position are
+       * mapped, as far as the window and the file allow
+       * @returns Bytes mapped from the reading position
+       */
+      std::size_t map(std::size_t bytes);
+
+      void advise();
+
+      file_descriptor _fd;
+      std::uint64_t _size;
+      std::uint64_t _position;
+      const std::size_t _window;
+      const std::size_t _readahead;
+      /** @brief The reading position has been advised to read ahead to */
+      std::uint64_t _advised;
+      windows *_windows;
+      /** @brief The current window */
+      const std::uint8_t *_base;
+      std::uint64_t _offset;
+      std::size_t _length;
+      bool _discarded;
+    };
+
+  }
+}
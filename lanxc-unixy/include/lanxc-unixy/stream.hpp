@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include <lanxc-unixy/unixy.hpp>
+#include <lanxc/core/buffer.hpp>
+
+namespace lanxc
+{
+  namespace unixy
+  {
+
+    /**
+     * @brief A stream over a file descriptor, e.g. a pipe or a socket
+     *
+     * Buffer chains are gathered into a single `writev` call, or `sendmsg`
+     * for sockets so that a peer closed raises an error rather than
+     * SIGPIPE, and scattered from a single `readv` call. A descriptor in
+     * non-blocking mode is waited with `poll` when it would block.
+     */
+    class LANXC_UNIXY_EXPORT stream
+        : public readable_stream
+        , public writable_stream
+    {
+    public:
+      stream(file_descriptor fd, buffer_manager &bm);
+
+      ~stream() override;
+
+      int native_handle() const noexcept
+      { return _fd; }
+
+      future<size_t, readable_buffer>
+      read(std::size_t size, std::size_t watermark) override;
+
+      future<std::size_t, buffer_chain> read(buffer_chain chain) override;
+
+      void discard() override;
+
+      writable_buffer allocate_buffer(std::size_t size) override;
+
+      std::size_t write(writable_buffer b) override;
+
+      std::size_t write(buffer_chain chain) override;
+
+      void close() override;
+
+      future<> flush() override;
+
+    protected:
+      /** @brief Wait for @p events of `poll` on the descriptor */
+      void wait(short events);
+
+      bool closed() const noexcept
+      { return _closed; }
+
+    private:
+      std::size_t gather(buffer_chain &chain);
+      std::size_t scatter(buffer_chain &chain);
+
+      file_descriptor _fd;
+      buffer_manager &_bm;
+      bool _socket;
+      bool _discarded;
+      bool _closed;
+    };
+  }
+}
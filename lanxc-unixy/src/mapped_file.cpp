@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-unixy/mapped_file.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief Mappings of a file, reference counted by buffers pointing into
+ * them, which outlives the stream until the last buffer is released
+ */
+class lanxc::unixy::mapped_file_stream::windows : public buffer_manager
+{
+  struct window
+  {
+    std::size_t length;
+    std::size_t references;
+  };
+
+public:
+  windows() noexcept
+    : _mutex{}
+    , _windows{}
+    , _current{}
+    , _cursor{}
+    , _detached{false}
+  { }
+
+  /** @brief Map @p length bytes of @p fd from @p offset as current */
+  std::uint8_t *map(int fd, std::uint64_t offset, std::size_t length)
+  {
+    void *p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd,
+                     static_cast<off_t>(offset));
+    if (p == MAP_FAILED)
+      throw_system_error();
+    // Let the kernel read ahead aggressively and drop pages behind
+    ::madvise(p, length, MADV_SEQUENTIAL);
+    auto base = static_cast<std::uint8_t *>(p);
+    std::lock_guard<std::mutex> guard(_mutex);
+    retire();
+    _current = _windows.emplace(base, window{length, 0}).first->first;
+    return base;
+  }
+
+  /** @brief Point the next buffer acquired to @p cursor */
+  void point(const std::uint8_t *cursor) noexcept
+  { _cursor = const_cast<std::uint8_t *>(cursor); }
+
+  std::uint8_t *acquire(std::size_t size) override
+  {
+    if (size == 0)
+      return nullptr;
+    std::lock_guard<std::mutex> guard(_mutex);
+    _windows[_current].references++;
+    return _cursor;
+  }
+
+  void release(std::uint8_t *data, std::size_t) noexcept override
+  {
+    std::unique_lock<std::mutex> guard(_mutex);
+    auto i = std::prev(_windows.upper_bound(data));
+    if (--i->second.references == 0 && i->first != _current)
+      unmap(i);
+    if (_detached && _windows.empty())
+    {
+      guard.unlock();
+      delete this;
+    }
+  }
+
+  /** @brief Unmap the current window unless referenced */
+  void retire_current() noexcept
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    retire();
+  }
+
+  /** @brief Called by the stream destroyed, to delete once unreferenced */
+  void detach() noexcept
+  {
+    std::unique_lock<std::mutex> guard(_mutex);
+    retire();
+    _detached = true;
+    if (_windows.empty())
+    {
+      guard.unlock();
+      delete this;
+    }
+  }
+
+  std::size_t count() const noexcept
+  {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _windows.size();
+  }
+
+private:
+  ~windows() override = default;
+
+  void retire() noexcept
+  {
+    if (!_current)
+      return;
+    auto i = _windows.find(_current);
+    _current = nullptr;
+    if (i->second.references == 0)
+      unmap(i);
+  }
+
+  void unmap(std::map<std::uint8_t *, window>::iterator i) noexcept
+  {
+    ::munmap(i->first, i->second.length);
+    _windows.erase(i);
+  }
+
+  mutable std::mutex _mutex;
+  std::map<std::uint8_t *, window> _windows;
+  std::uint8_t *_current;
+  std::uint8_t *_cursor;
+  bool _detached;
+};
+
+namespace
+{
+  std::size_t page_size() noexcept
+  { return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)); }
+
+  /** @brief Round @p window up to pages, and to 2 pages at least */
+  std::size_t window_size(std::size_t window) noexcept
+  {
+    std::size_t page = page_size();
+    return (std::max(window, 2 * page) + page - 1) / page * page;
+  }
+}
+
+lanxc::unixy::mapped_file_stream::mapped_file_stream(file_descriptor fd,
+                                                     std::size_t window,
+                                                     std::size_t readahead)
+  : _fd(std::move(fd))
+  , _size{0}
+  , _position{0}
+  , _window{window_size(window)}
+  , _readahead{readahead}
+  , _advised{0}
+  , _windows{}
+  , _base{}
+  , _offset{0}
+  , _length{0}
+  , _discarded{false}
+{
+  struct stat st;
+  if (::fstat(_fd, &st) == -1)
+    throw_system_error();
+  if (!S_ISREG(st.st_mode))
+    throw_system_error(EINVAL);
+  _size = static_cast<std::uint64_t>(st.st_size);
+  _windows = new windows();
+}
+
+lanxc::unixy::mapped_file_stream::~mapped_file_stream()
+{
+  _windows->detach();
+}
+
+std::size_t lanxc::unixy::mapped_file_stream::mapped() const noexcept
+{
+  return _windows->count();
+}
+
+std::size_t lanxc::unixy::mapped_file_stream::map(std::size_t bytes)
+{
+  std::uint64_t remaining = _size - _position;
+  if (remaining < bytes)
+    bytes = static_cast<std::size_t>(remaining);
+  if (_base && _position - _offset + bytes <= _length)
+    return static_cast<std::size_t>(_offset + _length - _position);
+  if (remaining == 0)
+    return 0;
+  // Slide the window to the page of the reading position
+  std::uint64_t offset = _position - _position % page_size();
+  std::size_t length = static_cast<std::size_t>(
+      std::min<std::uint64_t>(_window, _size - offset));
+  _base = _windows->map(_fd, offset, length);
+  _offset = offset;
+  _length = length;
+  return static_cast<std::size_t>(_offset + _length - _position);
+}
+
+void lanxc::unixy::mapped_file_stream::advise()
+{
+  // Advise in steps of half of readahead rather than on every read
+  if (_readahead == 0 || _advised >= _position + _readahead / 2)
+    return;
+  std::uint64_t from = std::max(_advised, _position);
+  std::uint64_t to = std::min(_position + _readahead, _offset + _length);
+  if (to <= from)
+    return;
+  std::size_t skip = static_cast<std::size_t>(from - _offset);
+  skip -= skip % page_size();
+  ::madvise(const_cast<std::uint8_t *>(_base) + skip,
+            static_cast<std::size_t>(to - _offset) - skip, MADV_WILLNEED);
+  _advised = to;
+}
+
+lanxc::future<size_t, lanxc::readable_buffer>
+lanxc::unixy::mapped_file_stream::read(std::size_t size, std::size_t watermark)
+{
+  return future<size_t, readable_buffer>(
+      [this, size, watermark](promise<size_t, readable_buffer> p)
+      {
+        if (_discarded)
+        {
+          p.reject(stream_discarded_exception());
+          return;
+        }
+        std::size_t low = std::max<std::size_t>(1, std::min(size, watermark));
+        std::size_t n = std::min(size, map(low));
+        if (n != 0)
+          _windows->point(_base + (_position - _offset));
+        writable_buffer b(*_windows, n);
+        _position += n;
+        advise();
+        p.fulfill(n, readable_buffer(std::move(b)));
+      });
+}
+
+lanxc::future<std::size_t, lanxc::buffer_chain>
+lanxc::unixy::mapped_file_stream::read(buffer_chain chain)
+{
+  auto c = std::make_shared<buffer_chain>(std::move(chain));
+  return future<std::size_t, buffer_chain>(
+      [this, c](promise<std::size_t, buffer_chain> p)
+      {
+        if (_discarded)
+        {
+          p.reject(stream_discarded_exception());
+          return;
+        }
+        std::size_t n = 0;
+        try
+        {
+          c->for_each_capacity([&](std::uint8_t *room, std::size_t size)
+          {
+            std::size_t done = 0;
+            std::size_t available;
+            while (done < size && (available = map(size - done)) != 0)
+            {
+              std::size_t copy = std::min(available, size - done);
+              std::memcpy(room + done, _base + (_position - _offset), copy);
+              _position += copy;
+              done += copy;
+            }
+            n += done;
+          });
+        }
+        catch (...)
+        {
+          p.reject_by_exception_ptr(std::current_exception());
+          return;
+        }
+        c->fill(n);
+        advise();
+        p.fulfill(n, std::move(*c));
+      });
+}
+
+void lanxc::unixy::mapped_file_stream::discard()
+{
+  _discarded = true;
+  _windows->retire_current();
+  _base = nullptr;
+}
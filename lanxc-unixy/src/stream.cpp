@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-unixy/stream.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+lanxc::unixy::stream::stream(file_descriptor fd, buffer_manager &bm)
+  : _fd(std::move(fd))
+  , _bm(bm)
+  , _socket{false}
+  , _discarded{false}
+  , _closed{false}
+{
+  struct stat st;
+  if (::fstat(_fd, &st) == -1)
+    throw_system_error();
+  _socket = S_ISSOCK(st.st_mode);
+}
+
+lanxc::unixy::stream::~stream() = default;
+
+void lanxc::unixy::stream::wait(short events)
+{
+  struct pollfd p;
+  p.fd = _fd;
+  p.events = events;
+  p.revents = 0;
+  while (::poll(&p, 1, -1) == -1)
+    if (errno != EINTR)
+      throw_system_error();
+}
+
+std::size_t lanxc::unixy::stream::gather(buffer_chain &chain)
+{
+  struct iovec iov[IOV_MAX];
+  int count = 0;
+  chain.for_each([&](const std::uint8_t *data, std::size_t size)
+                 {
+                   if (count == IOV_MAX)
+                     return;
+                   iov[count].iov_base = const_cast<std::uint8_t *>(data);
+                   iov[count].iov_len = size;
+                   count++;
+                 });
+  if (count == 0)
+    return 0;
+
+  for (;;)
+  {
+    ssize_t n;
+    if (_socket)
+    {
+      struct msghdr msg{};
+      msg.msg_iov = iov;
+      msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(count);
+      n = ::sendmsg(_fd, &msg, MSG_NOSIGNAL);
+    }
+    else
+      n = ::writev(_fd, iov, count);
+    if (n >= 0)
+      return static_cast<std::size_t>(n);
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      wait(POLLOUT);
+    else if (errno != EINTR)
+      throw_system_error();
+  }
+}
+
+std::size_t lanxc::unixy::stream::write(buffer_chain chain)
+{
+  if (_closed)
+    throw stream_closed_exception();
+  std::size_t written = 0;
+  while (chain.size() != 0)
+  {
+    std::size_t n = gather(chain);
+    chain.consume(n);
+    written += n;
+  }
+  return written;
+}
+
+std::size_t lanxc::unixy::stream::write(writable_buffer b)
+{
+  buffer_chain chain;
+  chain.push_back(std::move(b));
+  return write(std::move(chain));
+}
+
+lanxc::writable_buffer lanxc::unixy::stream::allocate_buffer(std::size_t size)
+{
+  return writable_buffer(_bm, size);
+}
+
+std::size_t lanxc::unixy::stream::scatter(buffer_chain &chain)
+{
+  struct iovec iov[IOV_MAX];
+  int count = 0;
+  chain.for_each_capacity([&](std::uint8_t *data, std::size_t size)
+                          {
+                            if (count == IOV_MAX)
+                              return;
+                            iov[count].iov_base = data;
+                            iov[count].iov_len = size;
+                            count++;
+                          });
+  if (count == 0)
+    return 0;
+  for (;;)
+  {
+    ssize_t n = ::readv(_fd, iov, count);
+    if (n >= 0)
+    {
+      chain.fill(static_cast<std::size_t>(n));
+      return static_cast<std::size_t>(n);
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      wait(POLLIN);
+    else if (errno != EINTR)
+      throw_system_error();
+  }
+}
+
+lanxc::future<size_t, lanxc::readable_buffer>
+lanxc::unixy::stream::read(std::size_t size, std::size_t watermark)
+{
+  return future<size_t, readable_buffer>(
+      [this, size, watermark](promise<size_t, readable_buffer> p)
+      {
+        if (_discarded)
+        {
+          p.reject(stream_discarded_exception());
+          return;
+        }
+        writable_buffer b(_bm, size);
+        b.resize(0);
+        buffer_chain chain;
+        chain.push_back(std::move(b));
+        std::size_t n = 0;
+        try
+        {
+          while (n < watermark && n < size)
+          {
+            std::size_t r = scatter(chain);
+            if (r == 0)
+              break;
+            n += r;
+          }
+        }
+        catch (...)
+        {
+          p.reject_by_exception_ptr(std::current_exception());
+          return;
+        }
+        p.fulfill(n, readable_buffer(chain.pop_front()));
+      });
+}
+
+lanxc::future<std::size_t, lanxc::buffer_chain>
+lanxc::unixy::stream::read(buffer_chain chain)
+{
+  auto c = std::make_shared<buffer_chain>(std::move(chain));
+  return future<std::size_t, buffer_chain>(
+      [this, c](promise<std::size_t, buffer_chain> p)
+      {
+        if (_discarded)
+        {
+          p.reject(stream_discarded_exception());
+          return;
+        }
+        std::size_t n;
+        try
+        {
+          n = scatter(*c);
+        }
+        catch (...)
+        {
+          p.reject_by_exception_ptr(std::current_exception());
+          return;
+        }
+        p.fulfill(n, std::move(*c));
+      });
+}
+
+void lanxc::unixy::stream::discard()
+{
+  _discarded = true;
+}
+
+void lanxc::unixy::stream::close()
+{
+  if (_closed)
+    return;
+  _closed = true;
+  if (_socket && ::shutdown(_fd, SHUT_WR) == -1 && errno != ENOTCONN)
+    throw_system_error();
+}
+
+lanxc::future<> lanxc::unixy::stream::flush()
+{
+  return future<>::resolve();
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/link/art.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lanxc::link;
+
+template<typename Key>
+class node : public art_node<Key, node<Key>>
+{
+public:
+  node(Key k = Key())
+      : art_node<Key, node<Key>>(k)
+  { }
+};
+
+template<typename Key>
+using tree = art<Key, node<Key>>;
+
+template<typename Key>
+void check_order(tree<Key> &t, const std::map<Key, node<Key> *> &expected)
+{
+  assert(t.size() == expected.size());
+  assert(t.empty() == expected.empty());
+  auto i = expected.begin();
+  t.for_each([&](node<Key> &n)
+  {
+    assert(i != expected.end());
+    assert(i->second == &n);
+    ++i;
+  });
+  assert(i == expected.end());
+}
+
+template<typename Key, typename Generator>
+void test_random(Generator generate)
+{
+  constexpr std::size_t N = 3000;
+  std::mt19937 engine;
+  std::vector<node<Key>> nodes;
+  nodes.reserve(N);
+  for (std::size_t i = 0; i < N; i++)
+    nodes.emplace_back(generate(engine));
+
+  tree<Key> t;
+  std::map<Key, node<Key> *> expected;
+  for (auto &n : nodes)
+  {
+    auto *r = t.insert(n, index_policy::conflict());
+    auto ins = expected.emplace(n.get_key(), &n);
+    assert(r == ins.first->second);
+    assert(n.is_linked() == ins.second);
+  }
+  check_order(t, expected);
+
+  for (auto &n : nodes)
+    assert(t.find(n.get_key()) == expected[n.get_key()]);
+
+  // Erase randomly and compare with std::map
+  for (std::size_t i = 0; i < N; i += 2)
+  {
+    auto &n = nodes[engine() % N];
+    bool linked = n.is_linked();
+    assert(n.unlink() == linked);
+    if (linked)
+      expected.erase(n.get_key());
+    auto found = expected.find(n.get_key());
+    assert(t.find(n.get_key())
+           == (found == expected.end() ? nullptr : found->second));
+  }
+  check_order(t, expected);
+  for (auto &p : expected)
+    assert(t.find(p.first) == p.second);
+
+  // Reinsert with unique policy, replacing nodes of the same key
+  for (auto &n : nodes)
+  {
+    assert(t.insert(n, index_policy::unique()) == &n);
+    expected[n.get_key()] = &n;
+  }
+  check_order(t, expected);
+
+  t.clear();
+  assert(t.empty());
+  for (auto &n : nodes)
+    assert(!n.is_linked());
+}
+
+void test_integers()
+{
+  test_random<std::uint64_t>([](std::mt19937 &e)
+  { return (std::uint64_t(e()) << 32 | e()) >> (e() % 64); });
+  test_random<int>([](std::mt19937 &e)
+  { return int(e() % 2000) - 1000; });
+  test_random<std::uint8_t>([](std::mt19937 &e)
+  { return std::uint8_t(e()); });
+
+  // Lookup with integers of other types
+  node<std::uint64_t> a(5);
+  tree<std::uint64_t> t;
+  t.insert(a);
+  assert(t.find(5) == &a);
+  assert(t.find(short(5)) == &a);
+  assert(t.find(6u) == nullptr);
+}
+
+void test_strings()
+{
+  // Short strings over a small alphabet, so that many keys are prefixes of
+  // others, and paths longer than stored in nodes are compressed
+  test_random<std::string>([](std::mt19937 &e)
+  {
+    std::string s(e() % 3 ? 0 : 20, 'x');
+    auto len = e() % 6;
+    for (std::size_t i = 0; i < len; i++)
+      s.push_back(char('a' + e() % 3));
+    return s;
+  });
+
+  node<std::string> empty(""), a("a"), ab("ab"), abc("abc");
+  tree<std::string> t;
+  t.insert(abc);
+  t.insert(a);
+  t.insert(empty);
+  t.insert(ab);
+  assert(t.size() == 4);
+  assert(t.find("") == &empty);
+  assert(t.find("ab") == &ab);
+  assert(t.find(std::string("abc")) == &abc);
+  assert(t.find("abcd") == nullptr);
+  assert(t.find("b") == nullptr);
+  assert(t.longest_prefix_match("abd") == &ab);
+  assert(t.longest_prefix_match("abcd") == &abc);
+  assert(t.longest_prefix_match("b") == &empty);
+  ab.unlink();
+  assert(t.longest_prefix_match("abd") == &a);
+  assert(t.erase("a"));
+  assert(!t.erase("a"));
+  t.erase(empty);
+  assert(t.size() == 1);
+  assert(t.longest_prefix_match("abd") == nullptr);
+}
+
+void test_growth()
+{
+  // Fill a node up to 256 children and empty it again, through all types
+  std::vector<node<std::uint16_t>> nodes;
+  nodes.reserve(256);
+  tree<std::uint16_t> t;
+  for (unsigned i = 0; i < 256; i++)
+  {
+    nodes.emplace_back(std::uint16_t(0x1200 + (i * 37) % 256));
+    t.insert(nodes.back());
+    for (unsigned j = 0; j <= i; j++)
+      assert(t.find(nodes[j].get_key()) == &nodes[j]);
+  }
+  std::uint16_t last = 0;
+  t.for_each([&](node<std::uint16_t> &n)
+  {
+    assert(n.get_key() >= last);
+    last = n.get_key();
+  });
+  for (unsigned i = 0; i < 256; i++)
+  {
+    nodes[i].unlink();
+    assert(t.size() == 255 - i);
+    for (unsigned j = i + 1; j < 256; j++)
+      assert(t.find(nodes[j].get_key()) == &nodes[j]);
+  }
+  assert(t.empty());
+}
+
+void test_prefix()
+{
+  using route = art_prefix<4>;
+  auto make = [](unsigned a, unsigned b, unsigned c, unsigned d,
+                 std::size_t len)
+  {
+    route r = {{std::uint8_t(a), std::uint8_t(b), std::uint8_t(c),
+                std::uint8_t(d)}, len};
+    return r;
+  };
+
+  node<route> any(make(0, 0, 0, 0, 0));
+  node<route> ten(make(10, 0, 0, 0, 8));
+  node<route> ten_1(make(10, 1, 0, 0, 16));
+  node<route> ten_1_16(make(10, 1, 16, 0, 20));
+  node<route> ten_1_17(make(10, 1, 17, 0, 24));
+  node<route> host(make(10, 1, 17, 5, 32));
+  node<route> other(make(192, 168, 1, 0, 24));
+
+  tree<route> t;
+  for (auto *n : {&host, &ten_1_17, &other, &ten, &ten_1_16, &ten_1})
+    t.insert(*n);
+
+  auto lookup = [&t](std::uint32_t address) { return t.longest_prefix_match(address); };
+
+  assert(lookup(0x0a011105) == &host);
+  assert(lookup(0x0a011106) == &ten_1_17);
+  assert(lookup(0x0a0112ff) == &ten_1_16);
+  assert(lookup(0x0a0120ff) == &ten_1);
+  assert(lookup(0x0a020000) == &ten);
+  assert(lookup(0xc0a80101) == &other);
+  assert(lookup(0x0b000000) == nullptr);
+  t.insert(any);
+  assert(lookup(0x0b000000) == &any);
+
+  // Bits beyond the length are ignored
+  assert(t.find(make(10, 1, 31, 99, 20)) == &ten_1_16);
+  assert(t.find(make(10, 1, 0, 0, 17)) == nullptr);
+
+  ten_1_16.unlink();
+  assert(lookup(0x0a0112ff) == &ten_1);
+  ten_1.unlink();
+  ten.unlink();
+  assert(lookup(0x0a0112ff) == &any);
+  assert(lookup(0x0a011105) == &host);
+  assert(t.size() == 4);
+}
+
+void test_chain()
+{
+  // All 255 prefixes of the second byte under 10.0.0.0/8, i.e. 10.x/9
+  // to 10.x/15, plus /16 routes of even bytes, checked against brute force
+  using route = art_prefix<4>;
+  std::vector<node<route>> nodes;
+  nodes.reserve(512);
+  for (std::size_t len = 9; len <= 16; len++)
+    for (unsigned b = 0; b < 256u; b += 1u << (16 - len))
+      if (len < 16 || b % 2 == 0)
+        nodes.emplace_back(route {{10, std::uint8_t(b), 0, 0}, len});
+
+  std::mt19937 engine;
+  std::shuffle(nodes.begin(), nodes.end(), engine);
+  // Shuffle moves nodes around, so insert them afterwards
+  tree<route> t;
+  for (auto &n : nodes)
+    t.insert(n);
+  assert(t.size() == nodes.size());
+
+  auto check = [&]
+  {
+    for (unsigned b = 0; b < 256; b++)
+    {
+      std::uint32_t address = 0x0a000000u | b << 16 | 0x1234u;
+      node<route> *best = nullptr;
+      for (auto &n : nodes)
+      {
+        auto &r = n.get_key();
+        unsigned mask = 0xffu << (16 - r.length) & 0xffu;
+        if (n.is_linked() && (b & mask) == r.address[1]
+            && (best == nullptr || best->get_key().length < r.length))
+          best = &n;
+      }
+      assert(t.longest_prefix_match(address) == best);
+    }
+  };
+
+  check();
+  for (std::size_t i = 0; i < nodes.size(); i++)
+  {
+    nodes[i].unlink();
+    if (i % 16 == 0)
+      check();
+  }
+  assert(t.empty());
+}
+
+void test_move()
+{
+  tree<int> t;
+  node<int> a(1), b(2);
+  t.insert(a);
+  t.insert(b);
+
+  node<int> c(std::move(a));
+  assert(!a.is_linked());
+  assert(t.find(1) == &c);
+
+  node<int> d(1);
+  assert(t.insert(d, index_policy::conflict()) == &c);
+  assert(!d.is_linked());
+  assert(t.insert(d, index_policy::unique()) == &d);
+  assert(!c.is_linked());
+
+  tree<int> u(std::move(t));
+  assert(t.empty());
+  assert(u.size() == 2);
+  assert(u.find(2) == &b);
+  {
+    node<int> e(3);
+    u.insert(e);
+    assert(u.size() == 3);
+  }
+  assert(u.size() == 2);
+  d.unlink();
+  b.unlink();
+  assert(u.empty());
+}
+
+int main()
+{
+  test_integers();
+  test_strings();
+  test_growth();
+  test_prefix();
+  test_chain();
+  test_move();
+}
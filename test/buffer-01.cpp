@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/slab_buffer_manager.hpp>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using lanxc::slab_buffer_manager;
+
+void test_classes()
+{
+  slab_buffer_manager bm(1 << 20, 4096);
+  assert(bm.block_size(0) == 64);
+  assert(bm.block_size(64) == 64);
+  assert(bm.block_size(65) == 128);
+  assert(bm.block_size(4096) == 4096);
+  assert(bm.block_size(4097) == 4097);
+
+  // A released buffer is reused by the same thread
+  auto *a = bm.acquire(100);
+  std::memset(a, 0xa5, bm.block_size(100));
+  bm.release(a, 100);
+  assert(bm.acquire(128) == a);
+  bm.release(a, 128);
+
+  auto *big = bm.acquire(10000);
+  std::memset(big, 0, 10000);
+  bm.release(big, 10000);
+  bm.release(nullptr, 0);
+}
+
+void test_watermark()
+{
+  // Magazines of 4KiB, so that most of released buffers go to depot
+  slab_buffer_manager bm(64 << 10, 1 << 16, 4 << 10);
+  std::vector<std::uint8_t *> buffers;
+  for (int i = 0; i < 100; i++)
+    buffers.push_back(bm.acquire(4096));
+  for (auto *b : buffers)
+    bm.release(b, 4096);
+  assert(bm.cached_bytes() > 0);
+  assert(bm.cached_bytes() <= 64 << 10);
+
+  bm.trim();
+  assert(bm.cached_bytes() == 0);
+  assert(bm.mapped_bytes() == 0);
+
+  // Buffers larger than magazines are cached in depot only
+  buffers.clear();
+  for (int i = 0; i < 4; i++)
+    buffers.push_back(bm.acquire(16384));
+  for (auto *b : buffers)
+    bm.release(b, 16384);
+  assert(bm.cached_bytes() == 4 * 16384);
+
+  bm.trim();
+  assert(bm.cached_bytes() == 0);
+  assert(bm.mapped_bytes() == 0);
+}
+
+void test_slabs()
+{
+  // 64 buffers of 1KiB share a slab of 64KiB, which stays mapped until the
+  // last of them is released
+  slab_buffer_manager bm(0, 1 << 16, 0);
+  std::vector<std::uint8_t *> buffers;
+  for (int i = 0; i < 64; i++)
+    buffers.push_back(bm.acquire(1024));
+  assert(bm.mapped_bytes() == 64 << 10);
+  auto base = reinterpret_cast<std::uintptr_t>(buffers[0]) & ~std::uintptr_t(0xffff);
+  for (auto *b : buffers)
+    assert((reinterpret_cast<std::uintptr_t>(b) & ~std::uintptr_t(0xffff)) == base);
+
+  for (int i = 0; i < 63; i++)
+    bm.release(buffers[i], 1024);
+  assert(bm.mapped_bytes() == 64 << 10);
+  assert(bm.cached_bytes() == 63 << 10);
+
+  // Above the watermark of zero, the empty slab is unmapped at once
+  bm.release(buffers[63], 1024);
+  assert(bm.mapped_bytes() == 0);
+  assert(bm.cached_bytes() == 0);
+
+  // A buffer of another class is carved from a slab of its own
+  auto *b = bm.acquire(2048);
+  assert(bm.mapped_bytes() == 64 << 10);
+  bm.release(b, 2048);
+  assert(bm.mapped_bytes() == 0);
+}
+
+void test_threads()
+{
+  slab_buffer_manager bm;
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; t++)
+  {
+    threads.emplace_back([&bm, t]
+    {
+      std::mt19937 engine(t);
+      std::vector<std::pair<std::uint8_t *, std::size_t>> held;
+      for (int i = 0; i < 20000; i++)
+      {
+        if (held.size() < 64 && engine() % 2 == 0)
+        {
+          std::size_t size = 1 + engine() % 20000;
+          auto *b = bm.acquire(size);
+          // Tag buffer with its owner to detect sharing among threads
+          std::memset(b, int(t), size);
+          held.emplace_back(b, size);
+        }
+        else if (!held.empty())
+        {
+          auto p = held.back();
+          held.pop_back();
+          for (std::size_t j = 0; j < p.second; j += 997)
+            assert(p.first[j] == t);
+          bm.release(p.first, p.second);
+        }
+      }
+      for (auto &p : held)
+        bm.release(p.first, p.second);
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+  assert(bm.cached_bytes() > 0);
+}
+
+void test_lifetime()
+{
+  // A thread outliving the manager drops its cache for it lazily
+  std::unique_ptr<slab_buffer_manager> first(new slab_buffer_manager);
+  first->release(first->acquire(100), 100);
+  first.reset();
+
+  slab_buffer_manager second;
+  auto *b = second.acquire(100);
+  second.release(b, 100);
+  assert(second.acquire(100) == b);
+  second.release(b, 100);
+}
+
+int main()
+{
+  test_classes();
+  test_watermark();
+  test_slabs();
+  test_threads();
+  test_lifetime();
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+#include <lanxc/core/task_context.hpp>
+#include <lanxc-unixy/stream.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+
+using lanxc::buffer_chain;
+using lanxc::slab_buffer_manager;
+using lanxc::writable_buffer;
+
+namespace
+{
+  class inline_deferred : public lanxc::deferred
+  {
+  public:
+    explicit inline_deferred(lanxc::function<void()> f)
+      : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  /** @brief Run deferred routines in order on the calling thread */
+  class inline_executor : public lanxc::task_context
+  {
+    std::deque<std::shared_ptr<inline_deferred>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<inline_deferred>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+
+  inline_executor executor;
+
+  writable_buffer make(lanxc::buffer_manager &bm, const char *s)
+  {
+    writable_buffer b(bm, std::strlen(s));
+    std::memcpy(b.data(), s, b.size());
+    return b;
+  }
+
+  std::string content(const buffer_chain &chain)
+  {
+    std::string s;
+    chain.for_each([&](const std::uint8_t *data, std::size_t size)
+                   { s.append(reinterpret_cast<const char *>(data), size); });
+    return s;
+  }
+}
+
+void test_chain()
+{
+  slab_buffer_manager bm;
+  buffer_chain chain;
+  chain.push_back(make(bm, "world"));
+  chain.push_front(make(bm, "hello, "));
+  chain.push_back(make(bm, "!"));
+  assert(chain.segments() == 3);
+  assert(chain.size() == 13);
+  assert(content(chain) == "hello, world!");
+
+  chain.consume(3);
+  assert(content(chain) == "lo, world!");
+  assert(chain.segments() == 3);
+  chain.consume(4);
+  assert(content(chain) == "world!");
+  assert(chain.segments() == 2);
+
+  auto b = chain.pop_front();
+  assert(std::string(reinterpret_cast<char *>(b.data()), b.size()) == "world");
+  assert(chain.size() == 1);
+
+  buffer_chain moved(std::move(chain));
+  assert(chain.empty() && chain.size() == 0);
+  assert(content(moved) == "!");
+  moved.consume(1);
+  assert(moved.empty());
+
+  // Scatter 10 bytes into free capacity of two segments
+  writable_buffer x(bm, 4), y(bm, 8);
+  x.resize(0);
+  y.resize(0);
+  chain.push_back(std::move(x));
+  chain.push_back(std::move(y));
+  std::size_t room = 0;
+  chain.for_each_capacity([&](std::uint8_t *data, std::size_t size)
+                          {
+                            std::memset(data, 'a' + int(room), size);
+                            room += size;
+                          });
+  assert(room == 12);
+  chain.fill(10);
+  assert(chain.size() == 10);
+  assert(content(chain) == "aaaaeeeeee");
+}
+
+void test_stream(int domain)
+{
+  slab_buffer_manager bm;
+  int fds[2];
+  if (domain == AF_UNIX)
+    assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  else
+    assert(::pipe(fds) == 0);
+  lanxc::unixy::stream reader({fds[0]}, bm), writer({fds[1]}, bm);
+
+  std::string expected;
+  for (int i = 0; i < 2000; i++)
+    expected += std::to_string(i) + ",";
+
+  std::thread t([&]
+  {
+    buffer_chain chain;
+    for (int i = 0; i < 2000; i++)
+      chain.push_back(make(bm, (std::to_string(i) + ",").c_str()));
+    assert(writer.write(std::move(chain)) == expected.size());
+    writer.write(make(bm, "."));
+    writer.close();
+  });
+
+  std::string received;
+  for (;;)
+  {
+    buffer_chain chain;
+    writable_buffer a(bm, 100), b(bm, 1000);
+    a.resize(0);
+    b.resize(0);
+    chain.push_back(std::move(a));
+    chain.push_back(std::move(b));
+    auto task = reader.read(std::move(chain))
+        .then([&](std::size_t n, buffer_chain c)
+              {
+                assert(n == c.size());
+                received += content(c);
+              })
+        .start(executor);
+    executor.run();
+    if (!received.empty() && received.back() == '.')
+      break;
+  }
+  t.join();
+  assert(received == expected + ".");
+
+  writer.close();
+  try
+  {
+    writer.write(make(bm, "x"));
+    assert(false);
+  }
+  catch (lanxc::stream_closed_exception &)
+  { }
+}
+
+int main()
+{
+  test_chain();
+  test_stream(AF_UNIX);
+  test_stream(0);
+}
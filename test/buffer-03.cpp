@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/buffer_slice.hpp>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using lanxc::buffer_slice;
+
+namespace
+{
+  struct counting_buffer_manager : lanxc::buffer_manager
+  {
+    std::size_t outstanding = 0;
+
+    std::uint8_t *acquire(std::size_t size) override
+    {
+      outstanding++;
+      return static_cast<std::uint8_t *>(std::malloc(size));
+    }
+
+    void release(std::uint8_t *data, std::size_t) noexcept override
+    {
+      outstanding--;
+      std::free(data);
+    }
+  };
+
+  buffer_slice make(lanxc::buffer_manager &bm, const char *s)
+  {
+    lanxc::writable_buffer b(bm, 64);
+    std::size_t n = std::strlen(s);
+    std::memcpy(b.data(), s, n);
+    b.resize(n);
+    return buffer_slice(lanxc::readable_buffer(std::move(b)));
+  }
+
+  bool equals(const buffer_slice &s, const char *expected)
+  {
+    return s.size() == std::strlen(expected)
+           && std::memcmp(s.data(), expected, s.size()) == 0;
+  }
+}
+
+void test_slice()
+{
+  counting_buffer_manager bm;
+  {
+    buffer_slice all = make(bm, "GET /index.html HTTP/1.1");
+    assert(bm.outstanding == 1);
+    assert(all.use_count() == 1);
+
+    buffer_slice method = all.slice(0, 3);
+    buffer_slice path = all.slice(4, 11);
+    buffer_slice version = all.slice(16);
+    assert(equals(method, "GET"));
+    assert(equals(path, "/index.html"));
+    assert(equals(version, "HTTP/1.1"));
+    assert(all.use_count() == 4);
+
+    buffer_slice name = path.slice(1);
+    name.remove_suffix(5);
+    assert(equals(name, "index"));
+    assert(name[0] == 'i');
+
+    all = buffer_slice();
+    assert(all.empty() && all.use_count() == 0);
+    method = std::move(version);
+    assert(equals(method, "HTTP/1.1"));
+    assert(version.use_count() == 0);
+    assert(bm.outstanding == 1);
+  }
+  assert(bm.outstanding == 0);
+
+  lanxc::readable_buffer empty(lanxc::writable_buffer(bm, 0));
+  buffer_slice s(std::move(empty));
+  assert(s.empty());
+}
+
+void test_threads()
+{
+  counting_buffer_manager bm;
+  std::vector<std::thread> threads;
+  {
+    buffer_slice s = make(bm, "0123456789");
+    for (unsigned t = 0; t < 4; t++)
+      threads.emplace_back([s, t]
+      {
+        for (int i = 0; i < 10000; i++)
+        {
+          buffer_slice sub = s.slice(t, 2);
+          assert(sub[0] == '0' + int(t));
+        }
+      });
+  }
+  for (auto &t : threads)
+    t.join();
+  assert(bm.outstanding == 0);
+}
+
+int main()
+{
+  test_slice();
+  test_threads();
+}
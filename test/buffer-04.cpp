@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/buffer_reader.hpp>
+#include <lanxc/core/buffer_writer.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  /** @brief Bytes written, appended to a string */
+  class string_stream : public lanxc::writable_stream
+  {
+  public:
+    lanxc::writable_buffer allocate_buffer(std::size_t size) override
+    {
+      allocated++;
+      return lanxc::writable_buffer(bm, size);
+    }
+
+    std::size_t write(lanxc::writable_buffer b) override
+    {
+      writes++;
+      content.append(reinterpret_cast<const char *>(b.data()), b.size());
+      return b.size();
+    }
+
+    std::size_t write(lanxc::buffer_chain chain) override
+    {
+      writes++;
+      segments += chain.segments();
+      chain.for_each([this](const std::uint8_t *data, std::size_t size)
+                     {
+                       content.append(reinterpret_cast<const char *>(data),
+                                      size);
+                     });
+      return chain.size();
+    }
+
+    void close() override
+    { }
+
+    lanxc::future<> flush() override
+    { return lanxc::future<>::resolve(); }
+
+    std::string content;
+    std::size_t allocated = 0;
+    std::size_t writes = 0;
+    std::size_t segments = 0;
+  };
+
+  lanxc::buffer_slice slice(const std::string &s)
+  {
+    lanxc::writable_buffer b(bm, s.size());
+    std::memcpy(b.data(), s.data(), s.size());
+    return lanxc::buffer_slice(lanxc::readable_buffer(std::move(b)));
+  }
+
+  const std::vector<std::uint64_t> unsigned_values = {
+    0, 1, 127, 128, 300, 16383, 16384, (1ull << 35) - 1, 1ull << 35,
+    (1ull << 63) - 1, 1ull << 63, std::numeric_limits<std::uint64_t>::max()
+  };
+
+  const std::vector<std::int64_t> signed_values = {
+    0, -1, 1, -64, 64, -65, std::numeric_limits<std::int64_t>::min(),
+    std::numeric_limits<std::int64_t>::max()
+  };
+}
+
+void test_varint()
+{
+  for (auto v : unsigned_values)
+  {
+    std::uint8_t bytes[lanxc::varint::max_size];
+    std::uint8_t *end = lanxc::varint::encode(bytes, v);
+    std::size_t n = std::size_t(end - bytes);
+    assert(n == lanxc::varint::size(v));
+    for (std::size_t i = 0; i < n; i++)
+      assert((bytes[i] >= 0x80) == (i + 1 < n));
+    std::uint64_t decoded;
+    assert(lanxc::varint::decode(bytes, n, decoded) == end);
+    assert(decoded == v);
+    // Incomplete
+    assert(lanxc::varint::decode(bytes, n - 1, decoded) == nullptr);
+  }
+  assert(lanxc::varint::size(0) == 1);
+  assert(lanxc::varint::size(127) == 1);
+  assert(lanxc::varint::size(128) == 2);
+  assert(lanxc::varint::size(std::numeric_limits<std::uint64_t>::max())
+         == 10);
+
+  // Malformed, beyond 10 bytes or 64 bits
+  std::uint8_t overlong[11];
+  std::memset(overlong, 0x80, sizeof(overlong));
+  std::uint64_t v;
+  assert(lanxc::varint::decode(overlong, sizeof(overlong), v) == nullptr);
+  overlong[9] = 2;
+  assert(lanxc::varint::decode(overlong, sizeof(overlong), v) == nullptr);
+
+  for (auto s : signed_values)
+    assert(lanxc::varint::unzigzag(lanxc::varint::zigzag(s)) == s);
+  assert(lanxc::varint::zigzag(0) == 0);
+  assert(lanxc::varint::zigzag(-1) == 1);
+  assert(lanxc::varint::zigzag(1) == 2);
+  assert(lanxc::varint::zigzag(-64) == 127);
+}
+
+void test_writer()
+{
+  string_stream out;
+  {
+    lanxc::buffer_writer w(out, 16);
+    w.put_u8(0xab);
+    w.put_little_endian<std::uint32_t>(0x01020304);
+    w.put_big_endian<std::uint32_t>(0x01020304);
+    w.put_big_endian<std::int16_t>(-2);
+    assert(w.size() == 11);
+    assert(out.content.empty());
+    assert(w.commit() == 11);
+    assert(out.content == std::string("\xab\x04\x03\x02\x01\x01\x02\x03\x04"
+                                      "\xff\xfe", 11));
+  }
+  out.content.clear();
+  out.allocated = out.writes = out.segments = 0;
+
+  // Bytes put are spread among buffers, all written at once
+  lanxc::buffer_writer w(out, 16);
+  std::string text(100, 'x');
+  for (auto v : unsigned_values)
+    w.put_varint(v);
+  for (auto s : signed_values)
+    w.put_zigzag(s);
+  w.put_string(text.data(), text.size());
+  w.put_little_endian<std::uint64_t>(42);
+  std::size_t size = w.size();
+  assert(w.commit() == size);
+  assert(out.writes == 1);
+  assert(out.allocated > 1 && out.segments == out.allocated);
+  assert(out.content.size() == size);
+  assert(w.commit() == 0);
+
+  lanxc::buffer_reader r(slice(out.content));
+  for (auto v : unsigned_values)
+    assert(r.get_varint() == v);
+  for (auto s : signed_values)
+    assert(r.get_zigzag() == s);
+  auto bytes = r.get_string();
+  assert(std::string(reinterpret_cast<const char *>(bytes.data()),
+                     bytes.size()) == text);
+  assert(r.get_little_endian<std::uint64_t>() == 42);
+  assert(r.remaining() == 0);
+}
+
+void test_reader()
+{
+  auto s = slice(std::string("\x05hello\x0a" "abc\x02\x03\xfe\xff", 14));
+  lanxc::buffer_reader r(s);
+  auto hello = r.get_string();
+  // Bytes are slices of the same buffer
+  assert(hello.data() == s.data() + 1 && hello.size() == 5);
+
+  // A string longer than bytes remaining consumes nothing
+  bool thrown = false;
+  try
+  {
+    r.get_string();
+  }
+  catch (lanxc::buffer_underflow_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown && r.remaining() == 8);
+  r.get_bytes(4);
+  assert(r.get_big_endian<std::uint16_t>() == 0x0203);
+  assert(r.get_little_endian<std::int16_t>() == -2);
+  thrown = false;
+  try
+  {
+    r.get_u8();
+  }
+  catch (lanxc::buffer_underflow_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // So does a string whose size is truncated
+  lanxc::buffer_reader truncated(slice(std::string("\x80\x80", 2)));
+  thrown = false;
+  try
+  {
+    truncated.get_string();
+  }
+  catch (lanxc::buffer_underflow_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown && truncated.remaining() == 2);
+}
+
+int main()
+{
+  test_varint();
+  test_writer();
+  test_reader();
+}
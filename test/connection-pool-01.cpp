@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/connection_pool.hpp>
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc-linux/network_context.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+using lanxc::connection_endpoint;
+using lanxc::connection_pool;
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::network_context;
+using lanxc::linuxy::socket_listener;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  /** @brief A server on loopback keeping connections accepted */
+  struct server
+  {
+    std::vector<connection_endpoint::pointer> accepted;
+    std::shared_ptr<lanxc::connection_listener> listener;
+    std::uint16_t port;
+
+    explicit server(event_loop &loop)
+      : accepted{}
+      , listener{network_context(loop, bm).build_connection_listener()
+                     ->bind("127.0.0.1", 0)
+                     ->build([this](connection_endpoint::pointer e)
+                             { accepted.push_back(std::move(e)); })}
+      , port{0}
+    {
+      sockaddr_in in{};
+      socklen_t length = sizeof(in);
+      int fd = std::dynamic_pointer_cast<socket_listener>(listener)
+          ->native_handle();
+      assert(::getsockname(fd, reinterpret_cast<sockaddr *>(&in),
+                           &length) == 0);
+      port = ntohs(in.sin_port);
+    }
+  };
+
+  /** @brief Run the loop for a while, as connections keep it running */
+  void run_for(event_loop &loop, milliseconds duration)
+  {
+    auto stop = loop.schedule(steady_clock::now() + duration,
+                              [&loop] { loop.stop(); });
+    loop.run();
+  }
+
+  std::shared_ptr<connection_pool>
+  make_pool(event_loop &loop, std::size_t limit,
+            milliseconds idle_timeout = milliseconds(1000))
+  {
+    return std::make_shared<connection_pool>(
+        loop, network_context(loop, bm).build_connection_endpoint(), limit,
+        idle_timeout);
+  }
+
+  /** @brief Builder failing to connect with something not an exception */
+  struct throwing_builder
+      : lanxc::connection_endpoint_builder
+      , std::enable_shared_from_this<throwing_builder>
+  {
+    std::shared_ptr<connection_endpoint_builder>
+    bind(std::string, std::uint16_t) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_connect_timeout(std::chrono::nanoseconds) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_no_delay(bool) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_send_buffer_size(std::size_t) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_receive_buffer_size(std::size_t) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_fast_open(bool) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_busy_poll(std::chrono::microseconds) override
+    { return shared_from_this(); }
+
+    std::shared_ptr<connection_endpoint_builder>
+    set_user_timeout(std::chrono::milliseconds) override
+    { return shared_from_this(); }
+
+    lanxc::future<connection_endpoint::pointer>
+    connect(std::string, std::uint16_t) override
+    {
+      return lanxc::future<connection_endpoint::pointer>(
+          [](lanxc::promise<connection_endpoint::pointer> p)
+          { p.reject(42); });
+    }
+  };
+
+  std::shared_ptr<lanxc::deferred>
+  acquire(connection_pool &pool, std::uint16_t port, event_loop &loop,
+          connection_endpoint::pointer &out)
+  {
+    return pool.acquire("127.0.0.1", port)
+        .then([&out](connection_endpoint::pointer e) { out = std::move(e); })
+        .start(loop);
+  }
+}
+
+void test_reuse()
+{
+  event_loop loop;
+  server s(loop);
+  auto pool = make_pool(loop, 4);
+
+  connection_endpoint::pointer first, second;
+  auto a = acquire(*pool, s.port, loop, first);
+  run_for(loop, milliseconds(20));
+  assert(first);
+  pool->release(first);
+  assert(pool->idle() == 1);
+
+  auto b = acquire(*pool, s.port, loop, second);
+  run_for(loop, milliseconds(20));
+  assert(second == first);
+  assert(pool->idle() == 0);
+  assert(s.accepted.size() == 1);
+  assert(pool->statistics().created == 1);
+  assert(pool->statistics().reused == 1);
+
+  // Not reused if told so
+  pool->release(second, false);
+  assert(pool->idle() == 0);
+}
+
+void test_limit()
+{
+  event_loop loop;
+  server s(loop);
+  auto pool = make_pool(loop, 2);
+
+  std::vector<connection_endpoint::pointer> endpoints(3);
+  std::vector<std::shared_ptr<lanxc::deferred>> tasks;
+  for (auto &e : endpoints)
+    tasks.push_back(acquire(*pool, s.port, loop, e));
+  run_for(loop, milliseconds(20));
+  assert(endpoints[0] && endpoints[1] && !endpoints[2]);
+  assert(s.accepted.size() == 2);
+
+  // The one waiting takes the connection released
+  pool->release(endpoints[1]);
+  run_for(loop, milliseconds(20));
+  assert(endpoints[2] == endpoints[1]);
+  assert(pool->idle() == 0);
+  assert(pool->statistics().created == 2);
+}
+
+void test_expiry()
+{
+  event_loop loop;
+  server s(loop);
+  auto pool = make_pool(loop, 2, milliseconds(30));
+
+  connection_endpoint::pointer e;
+  auto a = acquire(*pool, s.port, loop, e);
+  run_for(loop, milliseconds(20));
+  pool->release(e);
+  e = nullptr;
+  assert(pool->idle() == 1);
+  run_for(loop, milliseconds(60));
+  assert(pool->idle() == 0);
+  assert(pool->statistics().expired == 1);
+}
+
+void test_health_check()
+{
+  event_loop loop;
+  server s(loop);
+  auto pool = make_pool(loop, 2);
+
+  connection_endpoint::pointer first, second;
+  auto a = acquire(*pool, s.port, loop, first);
+  run_for(loop, milliseconds(20));
+  pool->release(first);
+
+  // Closed by the peer while being idle
+  s.accepted.clear();
+  run_for(loop, milliseconds(20));
+  assert(!first->is_healthy());
+
+  auto b = acquire(*pool, s.port, loop, second);
+  run_for(loop, milliseconds(20));
+  assert(second && second != first);
+  assert(second->is_healthy());
+  assert(pool->statistics().unhealthy == 1);
+  assert(pool->statistics().created == 2);
+}
+
+void test_refused()
+{
+  event_loop loop;
+  std::uint16_t port;
+  {
+    server s(loop);
+    port = s.port;
+  }
+  auto pool = make_pool(loop, 1);
+
+  int error = 0;
+  auto a = pool->acquire("127.0.0.1", port)
+      .then([](connection_endpoint::pointer) { assert(false); })
+      .caught<std::system_error>([&](std::system_error &e)
+                                 { error = e.code().value(); })
+      .start(loop);
+  run_for(loop, milliseconds(20));
+  assert(error == ECONNREFUSED);
+
+  // The slot is released for the next one
+  error = 0;
+  auto b = pool->acquire("127.0.0.1", port)
+      .then([](connection_endpoint::pointer) { assert(false); })
+      .caught<std::system_error>([&](std::system_error &e)
+                                 { error = e.code().value(); })
+      .start(loop);
+  run_for(loop, milliseconds(20));
+  assert(error == ECONNREFUSED);
+}
+
+void test_foreign_exception()
+{
+  event_loop loop;
+  auto pool = std::make_shared<connection_pool>(
+      loop, std::make_shared<throwing_builder>(), 1, milliseconds(1000));
+
+  // The second waits for the slot of the first, which is released
+  // whatever the first fails with
+  int failed = 0;
+  std::vector<std::shared_ptr<lanxc::deferred>> tasks;
+  for (int i = 0; i < 2; i++)
+    tasks.push_back(pool->acquire("127.0.0.1", 1)
+        .then([](connection_endpoint::pointer) { assert(false); })
+        .caught<int>([&](int &e)
+                     {
+                       assert(e == 42);
+                       failed++;
+                     })
+        .start(loop));
+  run_for(loop, milliseconds(20));
+  assert(failed == 2);
+}
+
+int main()
+{
+  test_reuse();
+  test_limit();
+  test_expiry();
+  test_health_check();
+  test_refused();
+  test_foreign_exception();
+  return 0;
+}
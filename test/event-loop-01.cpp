@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/event_loop.hpp>
+
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <string>
+
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::event_channel;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+void test_tasks()
+{
+  event_loop loop;
+  std::string trace;
+  auto a = loop.defer([&]
+                      {
+                        trace += "a";
+                        loop.defer([&] { trace += "c"; });
+                      });
+  auto b = loop.defer([&] { trace += "b"; });
+  auto d = loop.defer([&] { trace += "d"; });
+  d->cancel();
+  loop.run();
+  assert(trace == "abc");
+}
+
+void test_alarms()
+{
+  event_loop loop;
+  std::string trace;
+  auto now = steady_clock::now();
+  loop.schedule(now + milliseconds(30), [&] { trace += "3"; });
+  loop.schedule(now + milliseconds(10), [&] { trace += "1"; });
+  auto cancelled = loop.schedule(now + milliseconds(15),
+                                 [&] { trace += "x"; });
+  loop.schedule(now + milliseconds(20), [&] { trace += "2"; });
+  cancelled->cancel();
+  loop.run();
+  assert(trace == "123");
+  assert(steady_clock::now() - now >= milliseconds(30));
+}
+
+void test_overdue_alarm()
+{
+  event_loop loop;
+  bool fired = false;
+  loop.schedule(steady_clock::now() + milliseconds(1),
+                [&] { fired = true; });
+  auto t = loop.defer([] { ::usleep(5000); });
+  loop.run();
+  assert(fired);
+}
+
+namespace
+{
+  struct pipe_reader : event_channel
+  {
+    pipe_reader(event_loop &loop, int fd)
+      : event_channel(loop, fd), fd(fd)
+    { set_events(readable); }
+
+    void on_readable() override
+    {
+      char buffer[64];
+      ssize_t n = ::read(fd, buffer, sizeof(buffer));
+      assert(n >= 0);
+      if (n == 0)
+        set_events(0);
+      else
+        content.append(buffer, std::size_t(n));
+    }
+
+    void on_writable() override
+    { assert(false); }
+
+    int fd;
+    std::string content;
+  };
+}
+
+void test_channel()
+{
+  int fds[2];
+  assert(::pipe(fds) == 0);
+  event_loop loop;
+  pipe_reader r(loop, fds[0]);
+  loop.schedule(steady_clock::now() + milliseconds(5), [&]
+  {
+    assert(::write(fds[1], "hello", 5) == 5);
+    ::close(fds[1]);
+  });
+  // Returns once the channel is interested in nothing at the end of pipe
+  loop.run();
+  assert(r.content == "hello");
+  ::close(fds[0]);
+}
+
+void test_stop()
+{
+  int fds[2];
+  assert(::pipe(fds) == 0);
+  event_loop loop;
+  {
+    pipe_reader r(loop, fds[0]);
+    loop.schedule(steady_clock::now() + milliseconds(5), [&] { loop.stop(); });
+    loop.run();
+    assert(r.content.empty());
+  }
+  // Channel destroyed, nothing to wait for any more
+  loop.run();
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+int main()
+{
+  test_tasks();
+  test_alarms();
+  test_overdue_alarm();
+  test_channel();
+  test_stop();
+}
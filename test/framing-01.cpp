@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/framing.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <lanxc/core/task_context.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace
+{
+  class inline_deferred : public lanxc::deferred
+  {
+  public:
+    explicit inline_deferred(lanxc::function<void()> f)
+      : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  /** @brief Run deferred routines in order on the calling thread */
+  class inline_executor : public lanxc::task_context
+  {
+    std::deque<std::shared_ptr<inline_deferred>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<inline_deferred>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+
+  lanxc::slab_buffer_manager bm;
+
+  lanxc::readable_buffer buffer(const std::string &s)
+  {
+    lanxc::writable_buffer b(bm, s.size());
+    std::memcpy(b.data(), s.data(), s.size());
+    return lanxc::readable_buffer(std::move(b));
+  }
+
+  /** @brief A stream reading pieces of a string in turn */
+  class pieces_stream : public lanxc::readable_stream
+  {
+  public:
+    explicit pieces_stream(std::vector<std::string> pieces)
+      : _pieces(pieces.begin(), pieces.end())
+    { }
+
+    lanxc::future<size_t, lanxc::readable_buffer>
+    read(std::size_t, std::size_t) override
+    {
+      return lanxc::future<size_t, lanxc::readable_buffer>(
+          [this](lanxc::promise<size_t, lanxc::readable_buffer> p)
+          {
+            std::string s;
+            if (!_pieces.empty())
+            {
+              s = _pieces.front();
+              _pieces.pop_front();
+            }
+            p.fulfill(s.size(), buffer(s));
+          });
+    }
+
+    lanxc::future<std::size_t, lanxc::buffer_chain>
+    read(lanxc::buffer_chain chain) override
+    {
+      return lanxc::future<std::size_t, lanxc::buffer_chain>::resolve(
+          0, std::move(chain));
+    }
+
+    void discard() override
+    { }
+
+  private:
+    std::deque<std::string> _pieces;
+  };
+
+  std::string text(const lanxc::buffer_slice &s)
+  { return std::string(reinterpret_cast<const char *>(s.data()), s.size()); }
+
+  std::vector<std::string> frames(lanxc::delimited_framer &f)
+  {
+    std::vector<std::string> result;
+    lanxc::buffer_slice frame;
+    while (f.next(frame))
+      result.push_back(text(frame));
+    return result;
+  }
+}
+
+void test_find_byte()
+{
+  std::vector<std::uint8_t> data(300);
+  for (std::size_t i = 0; i < data.size(); i++)
+    data[i] = std::uint8_t(i % 7);
+  for (std::size_t offset = 0; offset < 33; offset++)
+    for (std::size_t size = 0; offset + size <= 200; size++)
+      for (std::size_t at = 0; at <= size; at++)
+      {
+        // at == size places the needle right after the range
+        data[offset + at] = '\n';
+        auto p = lanxc::find_byte(data.data() + offset, size, '\n');
+        assert(at < size ? p == data.data() + offset + at : p == nullptr);
+        data[offset + at] = std::uint8_t((offset + at) % 7);
+      }
+}
+
+void test_lines()
+{
+  lanxc::delimited_framer f(bm);
+  auto b = buffer("alpha\n\nbeta\ngam");
+  const std::uint8_t *base = b.data();
+  f.feed(std::move(b));
+  lanxc::buffer_slice frame;
+  assert(f.next(frame) && text(frame) == "alpha");
+  // Frames within a buffer are views into it
+  assert(frame.data() == base);
+  assert(f.next(frame) && frame.empty());
+  assert(f.next(frame) && text(frame) == "beta");
+  assert(frame.data() == base + 7);
+  assert(!f.next(frame));
+  assert(f.buffered() == 3);
+
+  f.feed(buffer("ma\ndel"));
+  f.feed(buffer("ta"));
+  assert(frames(f) == std::vector<std::string>({ "gamma" }));
+  f.finish();
+  assert(frames(f) == std::vector<std::string>({ "delta" }));
+  assert(f.buffered() == 0);
+}
+
+void test_crlf()
+{
+  lanxc::delimited_framer f(bm, "\r\n");
+  f.feed(buffer("GET / HTTP/1.1\r\nHost: a\rb\r"));
+  f.feed(buffer("\nAccept: */*\r"));
+  f.feed(buffer("\r"));
+  f.feed(buffer("\n\r"));
+  f.feed(buffer("\n"));
+  assert(frames(f) == std::vector<std::string>(
+      { "GET / HTTP/1.1", "Host: a\rb", "Accept: */*\r", "" }));
+  assert(f.buffered() == 0);
+}
+
+void test_max_length()
+{
+  lanxc::delimited_framer f(bm, "\r\n", 5);
+  f.feed(buffer("12345\r\n1234"));
+  f.feed(buffer("5\r"));
+  f.feed(buffer("\n1234567"));
+  lanxc::buffer_slice frame;
+  assert(f.next(frame) && text(frame) == "12345");
+  assert(f.next(frame) && text(frame) == "12345");
+  bool thrown = false;
+  try
+  {
+    f.next(frame);
+  }
+  catch (lanxc::frame_length_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  thrown = false;
+  try
+  {
+    f.feed(buffer("\r\n"));
+    f.next(frame);
+  }
+  catch (lanxc::frame_length_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_reader()
+{
+  pieces_stream in({ "one\ntw", "o\n", "three" });
+  inline_executor executor;
+  lanxc::frame_reader reader(in, bm);
+  std::vector<std::string> received;
+  for (bool done = false; !done; )
+  {
+    auto task = reader.read()
+        .then([&](bool ok, lanxc::buffer_slice frame)
+              {
+                if (ok)
+                  received.push_back(text(frame));
+                done = !ok;
+              })
+        .start(executor);
+    executor.run();
+  }
+  assert(received == std::vector<std::string>({ "one", "two", "three" }));
+
+  pieces_stream long_line({ "0123456789" });
+  lanxc::frame_reader short_reader(long_line, bm, "\n", 4);
+  bool rejected = false;
+  auto task = short_reader.read()
+      .then([](bool, lanxc::buffer_slice) { assert(false); })
+      .caught<lanxc::frame_length_exception>(
+          [&](lanxc::frame_length_exception &) { rejected = true; })
+      .start(executor);
+  executor.run();
+  assert(rejected);
+}
+
+int main()
+{
+  test_find_byte();
+  test_lines();
+  test_crlf();
+  test_max_length();
+  test_reader();
+}
@@ -1,6 +1,10 @@
 
 
+#include <cassert>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <memory>
 #include <lanxc/core/future.hpp>
 #include <lanxc/link.hpp>
 #include <list>
@@ -89,8 +93,110 @@ public:
 };
 
 
+/** @brief Executor keeping deferred routines until they're run */
+class queue_executor : public lanxc::task_context
+{
+  struct queued : lanxc::deferred
+  {
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+    explicit queued(lanxc::function<void()> f)
+        : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  std::deque<std::shared_ptr<queued>> _queue;
+public:
+  std::shared_ptr<lanxc::deferred>
+  defer(lanxc::function<void()> routine) override
+  {
+    auto p = std::make_shared<queued>(std::move(routine));
+    _queue.push_back(p);
+    return p;
+  }
+
+  std::shared_ptr<lanxc::alarm>
+  schedule(time_point, lanxc::function<void()>) override
+  { return nullptr; }
+
+  void run() override
+  {
+    while (!_queue.empty())
+    {
+      auto p = std::move(_queue.front());
+      _queue.pop_front();
+      if (!p->cancelled)
+        p->routine();
+    }
+  }
+};
+
+void test_dropped_chain()
+{
+  // A promise outliving the task started, whose result is delivered once
+  // the chain of futures is gone, so the delivery must not run
+  queue_executor qe;
+  bool called = false;
+  std::unique_ptr<lanxc::promise<int>> kept;
+  {
+    auto task = lanxc::future<int>(
+        [&](lanxc::promise<int> p)
+        { kept.reset(new lanxc::promise<int>(std::move(p))); })
+        .then([&](int) { called = true; })
+        .start(qe);
+    qe.run();
+  }
+  assert(kept);
+  kept->fulfill(1);
+  kept.reset();
+  qe.run();
+  assert(!called);
+}
+
+void test_catch_all()
+{
+  mock_executor me;
+  int caught = 0;
+  // Neither derived from std::exception, nor of a type known here
+  auto d = lanxc::future<int>([](lanxc::promise<int> p) { p.reject(42); })
+      .then([](int) { assert(false); })
+      .caught<std::exception_ptr>(
+          [&](std::exception_ptr &e)
+          {
+            try
+            {
+              std::rethrow_exception(e);
+            }
+            catch (int x)
+            {
+              caught = x;
+            }
+          })
+      .start(me);
+  me.run();
+  assert(caught == 42);
+
+  int value = 0;
+  auto v = lanxc::future<int>([](lanxc::promise<int> p) { p.reject(1.0f); })
+      .caught<std::exception_ptr>([](std::exception_ptr &) { return 7; })
+      .then([&](int x) { value = x; })
+      .start(me);
+  me.run();
+  assert(value == 7);
+}
+
 int main()
 {
+  test_catch_all();
+  test_dropped_chain();
   mock_executor me;
   lanxc::future<int> f ([](lanxc::promise<int> p) {
     p.fulfill(0);
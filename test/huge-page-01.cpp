@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/huge_page_buffer_manager.hpp>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+using lanxc::linuxy::huge_page_buffer_manager;
+using page_mode = huge_page_buffer_manager::page_mode;
+
+constexpr std::size_t MiB = 1 << 20;
+
+void test_mode(page_mode preferred)
+{
+  huge_page_buffer_manager bm(4 * MiB, preferred);
+  // Falls back only towards normal pages
+  assert(static_cast<int>(bm.mode()) >= static_cast<int>(preferred));
+  assert(bm.mapped_bytes() == 4 * MiB);
+  assert(huge_page_buffer_manager::to_string(bm.mode()) != nullptr);
+}
+
+void test_carve()
+{
+  huge_page_buffer_manager bm(4 * MiB, page_mode::normal);
+  assert(bm.mode() == page_mode::normal);
+
+  // Fill the arena with buffers of mixed sizes and check they don't overlap
+  std::vector<std::pair<std::uint8_t *, std::size_t>> buffers;
+  std::size_t sizes[] = { 1, 100000, 64 << 10, 1 * MiB };
+  std::size_t used = 0;
+  for (std::size_t i = 0; used + 1 * MiB <= 4 * MiB; i++)
+  {
+    std::size_t size = sizes[i % 4];
+    auto *p = bm.acquire(size);
+    std::memset(p, int(buffers.size()), size);
+    buffers.emplace_back(p, size);
+    used += (size + (64 << 10) - 1) / (64 << 10) * (64 << 10);
+  }
+  for (std::size_t i = 0; i < buffers.size(); i++)
+    for (std::size_t j = 0; j < buffers[i].second; j += 4096)
+      assert(buffers[i].first[j] == std::uint8_t(i));
+  assert(bm.mapped_bytes() == 4 * MiB);
+
+  // Released neighbours form a buffer as large as the whole arena
+  for (auto &b : buffers)
+    bm.release(b.first, b.second);
+  auto *whole = bm.acquire(4 * MiB);
+  assert(bm.mapped_bytes() == 4 * MiB);
+  bm.release(whole, 4 * MiB);
+
+  // Another arena is mapped when the first one is full
+  auto *a = bm.acquire(3 * MiB);
+  auto *b = bm.acquire(3 * MiB);
+  assert(bm.mapped_bytes() == 8 * MiB);
+  bm.release(a, 3 * MiB);
+  bm.release(b, 3 * MiB);
+
+  // A buffer larger than an arena gets its own mapping until released
+  auto *big = bm.acquire(9 * MiB);
+  std::memset(big, 1, 9 * MiB);
+  assert(bm.mapped_bytes() == 18 * MiB);
+  bm.release(big, 9 * MiB);
+  assert(bm.mapped_bytes() == 8 * MiB);
+
+  bm.release(nullptr, 0);
+}
+
+int main()
+{
+  test_mode(page_mode::huge_tlb);
+  test_mode(page_mode::transparent);
+  test_mode(page_mode::normal);
+  test_carve();
+}
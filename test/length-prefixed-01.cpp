@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/core/length_prefixed.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <lanxc/core/task_context.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace
+{
+  class inline_deferred : public lanxc::deferred
+  {
+  public:
+    explicit inline_deferred(lanxc::function<void()> f)
+      : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  /** @brief Run deferred routines in order on the calling thread */
+  class inline_executor : public lanxc::task_context
+  {
+    std::deque<std::shared_ptr<inline_deferred>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<inline_deferred>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+
+  lanxc::slab_buffer_manager bm;
+
+  lanxc::readable_buffer buffer(const std::string &s)
+  {
+    lanxc::writable_buffer b(bm, s.size());
+    std::memcpy(b.data(), s.data(), s.size());
+    return lanxc::readable_buffer(std::move(b));
+  }
+
+  /** @brief Bytes written, appended to a string */
+  class string_stream : public lanxc::writable_stream
+  {
+  public:
+    lanxc::writable_buffer allocate_buffer(std::size_t size) override
+    { return lanxc::writable_buffer(bm, size); }
+
+    std::size_t write(lanxc::writable_buffer b) override
+    {
+      writes++;
+      content.append(reinterpret_cast<const char *>(b.data()), b.size());
+      return b.size();
+    }
+
+    void close() override
+    { }
+
+    lanxc::future<> flush() override
+    { return lanxc::future<>::resolve(); }
+
+    std::string content;
+    std::size_t writes = 0;
+  };
+
+  /** @brief A stream reading pieces of a string in turn */
+  class pieces_stream : public lanxc::readable_stream
+  {
+  public:
+    explicit pieces_stream(std::vector<std::string> pieces)
+      : _pieces(pieces.begin(), pieces.end())
+    { }
+
+    lanxc::future<size_t, lanxc::readable_buffer>
+    read(std::size_t, std::size_t) override
+    {
+      return lanxc::future<size_t, lanxc::readable_buffer>(
+          [this](lanxc::promise<size_t, lanxc::readable_buffer> p)
+          {
+            std::string s;
+            reads++;
+            if (!_pieces.empty())
+            {
+              s = _pieces.front();
+              _pieces.pop_front();
+            }
+            p.fulfill(s.size(), buffer(s));
+          });
+    }
+
+    lanxc::future<std::size_t, lanxc::buffer_chain>
+    read(lanxc::buffer_chain chain) override
+    {
+      return lanxc::future<std::size_t, lanxc::buffer_chain>::resolve(
+          0, std::move(chain));
+    }
+
+    void discard() override
+    { }
+
+    std::size_t reads = 0;
+
+  private:
+    std::deque<std::string> _pieces;
+  };
+
+  std::string text(const lanxc::buffer_slice &s)
+  { return std::string(reinterpret_cast<const char *>(s.data()), s.size()); }
+
+  std::vector<std::string> texts(const std::vector<lanxc::buffer_slice> &v)
+  {
+    std::vector<std::string> result;
+    for (auto &s : v)
+      result.push_back(text(s));
+    return result;
+  }
+
+  const std::vector<std::string> payloads = {
+    "hello", "", std::string(300, 'x'), "world"
+  };
+
+  std::string encode(lanxc::length_prefix prefix)
+  {
+    string_stream out;
+    lanxc::length_prefixed_writer w(out, prefix);
+    for (auto &p : payloads)
+      w.write(p.data(), p.size());
+    assert(out.writes == payloads.size());
+    return out.content;
+  }
+}
+
+void test_encoding()
+{
+  std::string fixed16 = encode(lanxc::length_prefix::fixed16);
+  assert(fixed16.substr(0, 11) == std::string("\0\5hello\0\0\1\x2c", 11));
+  std::string fixed32 = encode(lanxc::length_prefix::fixed32);
+  assert(fixed32.substr(0, 9) == std::string("\0\0\0\5hello", 9));
+  std::string varint = encode(lanxc::length_prefix::varint);
+  assert(varint.substr(0, 7) == std::string("\5hello\0", 7));
+  assert(varint.substr(7, 2) == "\xac\x02");
+
+  // The payload is written in place, with the prefix padded
+  string_stream out;
+  lanxc::length_prefixed_writer w(out, lanxc::length_prefix::varint);
+  auto f = w.allocate(1000);
+  assert(f.capacity() == 1000);
+  std::memcpy(f.data(), "abc", 3);
+  assert(w.write(std::move(f), 3) == 5);
+  assert(out.content == std::string("\x83\x00" "abc", 5));
+
+  bool thrown = false;
+  try
+  {
+    lanxc::length_prefixed_writer(out, lanxc::length_prefix::fixed16)
+        .allocate(1 << 16);
+  }
+  catch (lanxc::frame_length_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_batch()
+{
+  for (auto prefix : { lanxc::length_prefix::fixed16,
+                       lanxc::length_prefix::fixed32,
+                       lanxc::length_prefix::varint })
+  {
+    std::string bytes = encode(prefix);
+    // All frames in one buffer are decoded in one pass without copying
+    lanxc::length_prefixed_decoder d(bm, prefix);
+    auto b = buffer(bytes);
+    const std::uint8_t *base = b.data();
+    const std::uint8_t *end = base + b.size();
+    d.feed(std::move(b));
+    std::vector<lanxc::buffer_slice> batch;
+    assert(d.decode(batch) == payloads.size());
+    assert(texts(batch) == payloads);
+    for (auto &s : batch)
+      assert(s.empty() || (s.data() >= base && s.data() < end));
+    assert(d.buffered() == 0);
+
+    // Byte by byte, including prefixes spanning buffers
+    lanxc::length_prefixed_decoder e(bm, prefix);
+    batch.clear();
+    for (char c : bytes)
+    {
+      e.feed(buffer(std::string(1, c)));
+      e.decode(batch);
+    }
+    assert(texts(batch) == payloads);
+    assert(e.buffered() == 0);
+  }
+
+  // A padded varint
+  lanxc::length_prefixed_decoder d(bm, lanxc::length_prefix::varint);
+  d.feed(buffer(std::string("\x83\x80\x00" "abc", 6)));
+  std::vector<lanxc::buffer_slice> batch;
+  assert(d.decode(batch) == 1 && text(batch[0]) == "abc");
+}
+
+void test_max_length()
+{
+  lanxc::length_prefixed_decoder d(bm, lanxc::length_prefix::fixed32, 5);
+  d.feed(buffer(std::string("\0\0\0\5hello\0\0\0\6", 13)));
+  std::vector<lanxc::buffer_slice> batch;
+  bool thrown = false;
+  try
+  {
+    d.decode(batch);
+  }
+  catch (lanxc::frame_length_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  assert(texts(batch) == std::vector<std::string>({ "hello" }));
+
+  // Varints beyond 10 bytes are malformed
+  lanxc::length_prefixed_decoder v(bm, lanxc::length_prefix::varint);
+  v.feed(buffer(std::string(11, '\x80')));
+  thrown = false;
+  try
+  {
+    v.decode(batch);
+  }
+  catch (lanxc::frame_length_exception &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_reader()
+{
+  std::string bytes = encode(lanxc::length_prefix::varint);
+  pieces_stream in({ bytes.substr(0, 100), bytes.substr(100) });
+  inline_executor executor;
+  lanxc::length_prefixed_reader reader(in, bm, lanxc::length_prefix::varint);
+  std::vector<std::string> received;
+  std::size_t batches = 0;
+  for (bool done = false; !done; )
+  {
+    auto task = reader.read()
+        .then([&](std::vector<lanxc::buffer_slice> batch)
+              {
+                for (auto &s : batch)
+                  received.push_back(text(s));
+                batches++;
+                done = batch.empty();
+              })
+        .start(executor);
+    executor.run();
+  }
+  assert(received == payloads);
+  // Two frames from the first read, two from the second, then the end
+  assert(batches == 3);
+  assert(in.reads == 3);
+
+  pieces_stream truncated({ bytes.substr(0, 100) });
+  lanxc::length_prefixed_reader r(truncated, bm,
+                                  lanxc::length_prefix::varint);
+  std::size_t frames = 0;
+  bool rejected = false;
+  auto first = r.read()
+      .then([&](std::vector<lanxc::buffer_slice> batch)
+            { frames = batch.size(); })
+      .start(executor);
+  executor.run();
+  auto second = r.read()
+      .then([](std::vector<lanxc::buffer_slice>) { assert(false); })
+      .caught<lanxc::frame_truncated_exception>(
+          [&](lanxc::frame_truncated_exception &) { rejected = true; })
+      .start(executor);
+  executor.run();
+  assert(frames == 2 && rejected);
+}
+
+int main()
+{
+  test_encoding();
+  test_batch();
+  test_max_length();
+  test_reader();
+}
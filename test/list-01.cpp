@@ -126,3 +126,9 @@ void test_list()
 }
 
 
+
+int main()
+{
+  test_list<X>();
+  test_list<Y>();
+}
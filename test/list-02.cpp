@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <lanxc/link.hpp>
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+struct counted;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<>
+    class list_config<counted> : public list_config<void>
+    {
+    public:
+      static constexpr bool allow_constant_time_unlink = false;
+    };
+  }
+}
+
+template<typename Tag>
+struct node : lanxc::link::list_node<node<Tag>, Tag>
+{
+  unsigned key;
+  std::size_t order;
+  node(unsigned key = 0, std::size_t order = 0)
+      : key(key), order(order)
+  { }
+};
+
+struct by_key
+{
+  template<typename T>
+  bool operator () (const T &l, const T &r) const noexcept
+  { return l.key < r.key; }
+};
+
+template<typename Tag>
+using list_type = lanxc::link::list<node<Tag>, Tag>;
+
+/** Check the list is sorted stably and intact in both directions */
+template<typename Tag>
+void check(list_type<Tag> &l, std::size_t n)
+{
+  assert(l.size() == n);
+  assert(std::is_sorted(l.begin(), l.end(),
+                        [](const node<Tag> &x, const node<Tag> &y)
+                        {
+                          return x.key < y.key
+                              || (x.key == y.key && x.order < y.order);
+                        }));
+  assert(std::size_t(std::distance(l.begin(), l.end())) == n);
+  assert(std::size_t(std::distance(l.rbegin(), l.rend())) == n);
+}
+
+template<typename Tag>
+void test_sort(std::size_t n, unsigned range)
+{
+  std::mt19937 engine(static_cast<unsigned>(n));
+  std::vector<node<Tag>> nodes;
+  nodes.reserve(n);
+  for (std::size_t i = 0; i < n; i++)
+    nodes.emplace_back(unsigned(engine() % range), i);
+
+  list_type<Tag> l;
+  for (auto &x : nodes)
+    l.push_back(x);
+
+  l.sort(by_key());
+  check(l, n);
+
+  // Sorting a sorted list keeps it as is
+  l.sort(by_key());
+  check(l, n);
+  l.clear();
+}
+
+template<typename Tag>
+void test_variant()
+{
+  const std::size_t sizes[] = { 0, 1, 2, 3, 7, 8, 9, 1000, 4097 };
+  for (auto n : sizes)
+  {
+    test_sort<Tag>(n, 1u << 30);
+    test_sort<Tag>(n, 4);
+  }
+}
+
+struct failure : std::runtime_error
+{
+  failure() : std::runtime_error("comparator failed") {}
+};
+
+template<typename Tag>
+void test_throw()
+{
+  std::vector<node<Tag>> nodes;
+  for (unsigned i = 0; i < 100; i++)
+    nodes.emplace_back(100 - i, i);
+  list_type<Tag> l;
+  for (auto &x : nodes)
+    l.push_back(x);
+
+  int budget = 300;
+  try
+  {
+    l.sort([&budget](const node<Tag> &x, const node<Tag> &y)
+           {
+             if (--budget == 0) throw failure();
+             return x.key < y.key;
+           });
+    assert(false);
+  }
+  catch (failure &)
+  { }
+
+  // Nodes are still in the list
+  assert(std::distance(l.begin(), l.end()) == 100);
+  assert(std::distance(l.rbegin(), l.rend()) == 100);
+  for (auto &x : nodes)
+    assert(x.is_linked());
+  l.sort(by_key());
+  check(l, 100);
+  l.clear();
+}
+
+int main()
+{
+  test_variant<void>();
+  test_variant<counted>();
+  test_throw<void>();
+  test_throw<counted>();
+}
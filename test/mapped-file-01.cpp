@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-unixy/mapped_file.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <lanxc/core/task_context.hpp>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+using lanxc::unixy::mapped_file_stream;
+
+namespace
+{
+  class inline_deferred : public lanxc::deferred
+  {
+  public:
+    explicit inline_deferred(lanxc::function<void()> f)
+      : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  /** @brief Run deferred routines in order on the calling thread */
+  class inline_executor : public lanxc::task_context
+  {
+    std::deque<std::shared_ptr<inline_deferred>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<inline_deferred>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+
+  inline_executor executor;
+
+  /** @brief A temporary file of @p content, opened for reading */
+  lanxc::unixy::file_descriptor temporary(const std::string &content)
+  {
+    char path[] = "/tmp/lanxc-mapped-file-XXXXXX";
+    int fd = ::mkstemp(path);
+    assert(fd != -1);
+    ::unlink(path);
+    assert(::write(fd, content.data(), content.size())
+           == ssize_t(content.size()));
+    return {fd};
+  }
+
+  std::string pattern(std::size_t size)
+  {
+    std::string s(size, '\0');
+    for (std::size_t i = 0; i < size; i++)
+      s[i] = char(i * 131 + i / 4093);
+    return s;
+  }
+
+  lanxc::readable_buffer read(mapped_file_stream &s, std::size_t size,
+                              std::size_t watermark)
+  {
+    lanxc::slab_buffer_manager bm;
+    lanxc::readable_buffer result(lanxc::writable_buffer(bm, 0));
+    auto task = s.read(size, watermark)
+        .then([&](std::size_t n, lanxc::readable_buffer b)
+              {
+                assert(n == b.size());
+                result = std::move(b);
+              })
+        .start(executor);
+    executor.run();
+    return result;
+  }
+}
+
+void test_sequential()
+{
+  std::string content = pattern((1 << 20) + 123);
+  mapped_file_stream s(temporary(content), 64 << 10, 16 << 10);
+  assert(s.size() == content.size());
+  std::string received;
+  for (;;)
+  {
+    auto b = read(s, 10000, 1);
+    if (b.size() == 0)
+      break;
+    received.append(reinterpret_cast<const char *>(b.data()), b.size());
+    // Windows passed are unmapped once buffers are released
+    assert(s.mapped() <= 2);
+  }
+  assert(received == content);
+  assert(s.position() == content.size());
+}
+
+void test_buffers_outlive_stream()
+{
+  std::string content = pattern(300 << 10);
+  std::vector<lanxc::readable_buffer> buffers;
+  {
+    mapped_file_stream s(temporary(content), 64 << 10);
+    for (;;)
+    {
+      auto b = read(s, 50000, 1);
+      if (b.size() == 0)
+        break;
+      buffers.push_back(std::move(b));
+    }
+    // Every window is kept by buffers pointing into it
+    assert(s.mapped() >= 5);
+  }
+  std::string received;
+  for (auto &b : buffers)
+    received.append(reinterpret_cast<const char *>(b.data()), b.size());
+  assert(received == content);
+}
+
+void test_watermark()
+{
+  long page = ::sysconf(_SC_PAGESIZE);
+  std::string content = pattern(std::size_t(page) * 40);
+  mapped_file_stream s(temporary(content), std::size_t(page) * 4);
+
+  // The rest of the first window
+  auto a = read(s, std::size_t(page) * 4 - 100, 1);
+  assert(a.size() == std::size_t(page) * 4 - 100);
+  auto b = read(s, 1000, 1);
+  assert(b.size() == 100);
+
+  // A new window starting at the page of the reading position
+  auto c = read(s, std::size_t(page) * 2, 100);
+  assert(c.size() == std::size_t(page) * 2);
+  auto d = read(s, std::size_t(page) * 3, std::size_t(page) * 3 - 100);
+  assert(d.size() == std::size_t(page) * 3);
+  assert(std::memcmp(d.data(), content.data() + page * 6, d.size()) == 0);
+}
+
+void test_chain_and_discard()
+{
+  std::string content = pattern(100 << 10);
+  mapped_file_stream s(temporary(content), 16 << 10);
+  lanxc::slab_buffer_manager bm;
+  lanxc::buffer_chain chain;
+  for (std::size_t size : { 30000, 40000 })
+  {
+    lanxc::writable_buffer room(bm, size);
+    room.resize(0);
+    chain.push_back(std::move(room));
+  }
+  std::string received;
+  auto read_chain = s.read(std::move(chain))
+      .then([&](std::size_t n, lanxc::buffer_chain c)
+            {
+              assert(n == 70000);
+              c.for_each([&](const std::uint8_t *data, std::size_t size)
+                         {
+                           received.append(
+                               reinterpret_cast<const char *>(data), size);
+                         });
+            })
+      .start(executor);
+  executor.run();
+  assert(received == content.substr(0, 70000));
+
+  s.discard();
+  bool rejected = false;
+  auto task = s.read(100, 1)
+      .then([](std::size_t, lanxc::readable_buffer) { assert(false); })
+      .caught<lanxc::stream_discarded_exception>(
+          [&](lanxc::stream_discarded_exception &) { rejected = true; })
+      .start(executor);
+  executor.run();
+  assert(rejected);
+}
+
+void test_empty()
+{
+  mapped_file_stream s(temporary(""));
+  assert(read(s, 100, 1).size() == 0);
+}
+
+int main()
+{
+  test_sequential();
+  test_buffers_outlive_stream();
+  test_watermark();
+  test_chain_and_discard();
+  test_empty();
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/mirrored_ring.hpp>
+#include <lanxc/core/buffer_chain.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <lanxc/core/task_context.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+
+using lanxc::linuxy::mirrored_ring;
+
+namespace
+{
+  class inline_deferred : public lanxc::deferred
+  {
+  public:
+    explicit inline_deferred(lanxc::function<void()> f)
+      : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  /** @brief Run deferred routines in order on the calling thread */
+  class inline_executor : public lanxc::task_context
+  {
+    std::deque<std::shared_ptr<inline_deferred>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<inline_deferred>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+}
+
+void test_mirror()
+{
+  mirrored_ring ring(5000);
+  std::size_t capacity = ring.capacity();
+  assert(capacity >= 5000);
+  assert((capacity & (capacity - 1)) == 0);
+  assert(ring.readable() == 0 && ring.writable() == capacity);
+
+  // Move the ring close to its end, then write across the end
+  ring.commit(capacity - 3);
+  ring.consume(capacity - 3);
+  assert(ring.writable() == capacity);
+  std::uint8_t *w = ring.write_region();
+  std::memcpy(w, "wrapped", 7);
+  ring.commit(7);
+  assert(std::memcmp(ring.read_region(), "wrapped", 7) == 0);
+
+  // The same bytes are visible at the beginning of the other mapping
+  assert(std::memcmp(w + 3 - capacity, "pped", 4) == 0);
+  ring.consume(7);
+  assert(ring.readable() == 0);
+}
+
+void test_streams()
+{
+  mirrored_ring ring(4096);
+  lanxc::slab_buffer_manager bm;
+  std::string expected;
+  for (int i = 0; i < 5000; i++)
+    expected += std::to_string(i) + ",";
+
+  std::thread producer([&]
+  {
+    auto &out = ring.output();
+    std::size_t i = 0;
+    while (i < expected.size())
+    {
+      // Alternate buffers in place of ring and buffers copied in
+      std::size_t n = std::min<std::size_t>(expected.size() - i, 1000);
+      lanxc::writable_buffer b = (i / 1000) % 2 ? out.allocate_buffer(n)
+                                                : lanxc::writable_buffer(bm, n);
+      std::memcpy(b.data(), expected.data() + i, n);
+      assert(out.write(std::move(b)) == n);
+      i += n;
+    }
+    out.close();
+  });
+
+  std::string received;
+  inline_executor executor;
+  for (bool done = false; !done; )
+  {
+    auto task = ring.input().read(3000, 100)
+        .then([&](std::size_t n, lanxc::readable_buffer b)
+              {
+                assert(n == b.size());
+                received.append(reinterpret_cast<const char *>(b.data()), n);
+                done = n == 0;
+              })
+        .start(executor);
+    executor.run();
+  }
+  producer.join();
+  assert(received == expected);
+}
+
+void test_chain_and_discard()
+{
+  mirrored_ring ring(4096);
+  lanxc::slab_buffer_manager bm;
+  lanxc::buffer_chain chain;
+  lanxc::writable_buffer b(bm, 5);
+  std::memcpy(b.data(), "hello", 5);
+  chain.push_back(std::move(b));
+  assert(ring.output().write(std::move(chain)) == 5);
+
+  lanxc::writable_buffer room(bm, 3);
+  room.resize(0);
+  chain.push_back(std::move(room));
+  std::string received;
+  inline_executor executor;
+  auto task = ring.input().read(std::move(chain))
+      .then([&](std::size_t n, lanxc::buffer_chain c)
+            {
+              assert(n == 3);
+              c.for_each([&](const std::uint8_t *data, std::size_t size)
+                         {
+                           received.append(
+                               reinterpret_cast<const char *>(data), size);
+                         });
+            })
+      .start(executor);
+  executor.run();
+  assert(received == "hel");
+  assert(ring.readable() == 2);
+
+  ring.input().discard();
+  assert(ring.readable() == 0);
+  try
+  {
+    ring.output().allocate_buffer(10);
+    assert(false);
+  }
+  catch (lanxc::stream_discarded_exception &)
+  { }
+}
+
+int main()
+{
+  test_mirror();
+  test_streams();
+  test_chain_and_discard();
+}
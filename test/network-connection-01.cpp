@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+using lanxc::connection_endpoint;
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::socket_endpoint;
+using lanxc::linuxy::socket_endpoint_builder;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  /** @brief A listening socket on a port of loopback chosen by the system */
+  int listen_loopback(std::uint16_t &port, int backlog)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd != -1);
+    sockaddr_in in{};
+    in.sin_family = AF_INET;
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(::bind(fd, reinterpret_cast<sockaddr *>(&in), sizeof(in)) == 0);
+    assert(::listen(fd, backlog) == 0);
+    socklen_t length = sizeof(in);
+    assert(::getsockname(fd, reinterpret_cast<sockaddr *>(&in), &length) == 0);
+    port = ntohs(in.sin_port);
+    return fd;
+  }
+
+  /** @brief Outcome of a connect */
+  struct outcome
+  {
+    connection_endpoint::pointer endpoint;
+    int error;
+    bool done;
+  };
+
+  /**
+   * @brief Connect and stop @p loop once nothing is @p pending, as
+   * endpoints connected keep the loop running
+   */
+  std::shared_ptr<lanxc::deferred>
+  connect(std::shared_ptr<lanxc::connection_endpoint_builder> b,
+          std::uint16_t port, outcome &o, event_loop &loop,
+          std::size_t &pending)
+  {
+    auto settle = [&o, &loop, &pending]
+    {
+      o.done = true;
+      if (--pending == 0)
+        loop.stop();
+    };
+    return b->connect("127.0.0.1", port)
+        .then([&o, settle](connection_endpoint::pointer ep)
+              {
+                o.endpoint = std::move(ep);
+                settle();
+              })
+        .caught<std::system_error>([&o, settle](std::system_error &e)
+                                   {
+                                     o.error = e.code().value();
+                                     settle();
+                                   })
+        .start(loop);
+  }
+}
+
+void test_connect()
+{
+  std::uint16_t port;
+  int listener = listen_loopback(port, 16);
+  event_loop loop;
+  auto builder = std::make_shared<socket_endpoint_builder>(loop, bm);
+
+  outcome o{nullptr, 0, false};
+  std::size_t pending = 1;
+  auto task = connect(builder, port, o, loop, pending);
+  loop.run();
+  assert(o.done);
+  assert(o.error == 0);
+  auto s = std::dynamic_pointer_cast<socket_endpoint>(o.endpoint);
+  assert(s);
+
+  int peer = ::accept(listener, nullptr, nullptr);
+  assert(peer != -1);
+  lanxc::writable_buffer b(bm, 5);
+  std::memcpy(b.data(), "hello", 5);
+  s->write(std::move(b));
+  auto flushed = s->flush().then([&] { loop.stop(); }).start(loop);
+  loop.run();
+  char received[5];
+  assert(::read(peer, received, sizeof(received)) == 5);
+  assert(std::memcmp(received, "hello", 5) == 0);
+
+  ::close(peer);
+  ::close(listener);
+}
+
+void test_refused()
+{
+  std::uint16_t port;
+  ::close(listen_loopback(port, 1));
+  event_loop loop;
+  auto builder = std::make_shared<socket_endpoint_builder>(loop, bm);
+
+  outcome o{nullptr, 0, false};
+  std::size_t pending = 1;
+  auto task = connect(builder, port, o, loop, pending);
+  loop.run();
+  assert(o.done);
+  assert(!o.endpoint);
+  assert(o.error == ECONNREFUSED);
+}
+
+void test_timeout()
+{
+  // SYNs beyond a full accept queue are dropped, so some of these
+  // connections are never established
+  std::uint16_t port;
+  int listener = listen_loopback(port, 0);
+  event_loop loop;
+  auto builder = std::make_shared<socket_endpoint_builder>(loop, bm);
+  builder->set_connect_timeout(milliseconds(100));
+
+  std::vector<outcome> outcomes(4, outcome{nullptr, 0, false});
+  std::vector<std::shared_ptr<lanxc::deferred>> tasks;
+  std::size_t pending = outcomes.size();
+  for (auto &o : outcomes)
+    tasks.push_back(connect(builder, port, o, loop, pending));
+  auto start = steady_clock::now();
+  loop.run();
+  auto elapsed = steady_clock::now() - start;
+
+  // All of them wait together rather than one after another
+  assert(elapsed >= milliseconds(100));
+  assert(elapsed < milliseconds(350));
+  std::size_t timed_out = 0;
+  for (auto &o : outcomes)
+  {
+    assert(o.done);
+    if (o.error == ETIMEDOUT)
+      timed_out++;
+    else
+      assert(o.error == 0 && o.endpoint);
+  }
+  assert(timed_out != 0);
+  ::close(listener);
+}
+
+void test_invalid_address()
+{
+  event_loop loop;
+  auto builder = std::make_shared<socket_endpoint_builder>(loop, bm);
+  bool rejected = false;
+  auto task = builder->connect("not an address", 80)
+      .then([](connection_endpoint::pointer) { assert(false); })
+      .caught<std::system_error>([&](std::system_error &e)
+                                 {
+                                   rejected = e.code().value() == EINVAL;
+                                 })
+      .start(loop);
+  loop.run();
+  assert(rejected);
+}
+
+int main()
+{
+  test_connect();
+  test_refused();
+  test_timeout();
+  test_invalid_address();
+  return 0;
+}
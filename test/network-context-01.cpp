@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/network_context.hpp>
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc-linux/udp_endpoint.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using lanxc::connection_endpoint;
+using lanxc::datagram;
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::network_context;
+using lanxc::linuxy::socket_endpoint;
+using lanxc::linuxy::socket_listener;
+using lanxc::linuxy::udp_endpoint;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+}
+
+void test_connection()
+{
+  event_loop loop;
+  network_context context(loop, bm);
+  lanxc::network_connection_context &c = context;
+
+  connection_endpoint::pointer accepted, connected;
+  auto settle = [&]
+  {
+    if (accepted && connected)
+      loop.stop();
+  };
+  auto listener = c.build_connection_listener()
+      ->bind("127.0.0.1", 0)
+      ->build([&](connection_endpoint::pointer e)
+              {
+                accepted = std::move(e);
+                settle();
+              });
+  auto l = std::dynamic_pointer_cast<socket_listener>(listener);
+  assert(l);
+  sockaddr_in in{};
+  socklen_t length = sizeof(in);
+  assert(::getsockname(l->native_handle(),
+                       reinterpret_cast<sockaddr *>(&in), &length) == 0);
+
+  auto task = c.build_connection_endpoint()
+      ->set_no_delay(true)
+      ->connect("127.0.0.1", ntohs(in.sin_port))
+      .then([&](connection_endpoint::pointer e)
+            {
+              connected = std::move(e);
+              settle();
+            })
+      .start(loop);
+  loop.run();
+  assert(std::dynamic_pointer_cast<socket_endpoint>(connected));
+  assert(std::dynamic_pointer_cast<socket_endpoint>(accepted));
+}
+
+void test_datagram()
+{
+  event_loop loop;
+  network_context context(loop, bm);
+  lanxc::network_datagram_context &c = context;
+
+  auto receiver = c.create_datagram_endpoint()
+      ->bind("127.0.0.1", 0)
+      ->build();
+  auto u = std::dynamic_pointer_cast<udp_endpoint>(receiver);
+  assert(u);
+  sockaddr_in in{};
+  socklen_t length = sizeof(in);
+  assert(::getsockname(u->native_handle(),
+                       reinterpret_cast<sockaddr *>(&in), &length) == 0);
+  auto sender = c.create_datagram_endpoint()
+      ->connect("127.0.0.1", ntohs(in.sin_port))
+      ->build();
+
+  lanxc::writable_buffer b(bm, 4);
+  std::memcpy(b.data(), "ping", 4);
+  std::vector<datagram> out;
+  out.push_back(datagram{
+      lanxc::buffer_slice(lanxc::readable_buffer(std::move(b))),
+      lanxc::datagram_address{0, {}}, 0});
+  assert(sender->send(std::move(out)) == 1);
+
+  std::vector<datagram> received;
+  assert(receiver->receive(received) == 1);
+  assert(std::string(reinterpret_cast<const char *>(
+                         received[0].payload.data()),
+                     received[0].payload.size()) == "ping");
+}
+
+int main()
+{
+  test_connection();
+  test_datagram();
+}
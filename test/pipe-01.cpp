@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/pipe.hpp>
+#include <lanxc-linux/mirrored_ring.hpp>
+#include <lanxc-unixy/stream.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+#include <lanxc/core/task_context.hpp>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using lanxc::unixy::stream;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  class inline_deferred : public lanxc::deferred
+  {
+  public:
+    explicit inline_deferred(lanxc::function<void()> f)
+      : routine(std::move(f))
+    { }
+
+    void cancel() override
+    { cancelled = true; }
+
+    lanxc::function<void()> routine;
+    bool cancelled = false;
+
+  private:
+    void execute() override
+    { routine(); }
+  };
+
+  /** @brief Run deferred routines in order on the calling thread */
+  class inline_executor : public lanxc::task_context
+  {
+    std::deque<std::shared_ptr<inline_deferred>> _queue;
+  public:
+    std::shared_ptr<lanxc::deferred>
+    defer(lanxc::function<void()> routine) override
+    {
+      auto p = std::make_shared<inline_deferred>(std::move(routine));
+      _queue.push_back(p);
+      return p;
+    }
+
+    std::shared_ptr<lanxc::alarm>
+    schedule(time_point, lanxc::function<void()>) override
+    { return nullptr; }
+
+    void run() override
+    {
+      while (!_queue.empty())
+      {
+        auto p = std::move(_queue.front());
+        _queue.pop_front();
+        if (!p->cancelled)
+          p->routine();
+      }
+    }
+  };
+
+  inline_executor executor;
+
+  std::string payload()
+  {
+    std::string s;
+    for (int i = 0; s.size() < (1 << 20); i++)
+      s += std::to_string(i) + "\n";
+    return s;
+  }
+
+  /** @brief Read @p s to the end */
+  std::string drain(stream &s)
+  {
+    // Futures of the draining thread run on an executor of its own
+    inline_executor executor;
+    std::string received;
+    bool end = false;
+    while (!end)
+    {
+      lanxc::buffer_chain chain;
+      lanxc::writable_buffer b(bm, 65536);
+      b.resize(0);
+      chain.push_back(std::move(b));
+      auto task = s.read(std::move(chain))
+          .then([&](std::size_t n, lanxc::buffer_chain c)
+                {
+                  end = n == 0;
+                  c.for_each([&](const std::uint8_t *data, std::size_t size)
+                             {
+                               received.append(
+                                   reinterpret_cast<const char *>(data),
+                                   size);
+                             });
+                })
+          .start(executor);
+      executor.run();
+    }
+    return received;
+  }
+
+  void feed(lanxc::writable_stream &s, const std::string &content)
+  {
+    for (std::size_t i = 0; i < content.size(); i += 10000)
+    {
+      std::size_t n = std::min<std::size_t>(10000, content.size() - i);
+      lanxc::writable_buffer b(bm, n);
+      std::memcpy(b.data(), content.data() + i, n);
+      s.write(std::move(b));
+    }
+    s.close();
+  }
+
+  /** @brief Stream of @p left bytes, read one byte at a time */
+  class trickle : public lanxc::readable_stream
+  {
+  public:
+    explicit trickle(std::size_t left)
+      : left(left)
+    { }
+
+    lanxc::future<std::size_t, lanxc::readable_buffer>
+    read(std::size_t, std::size_t) override
+    { throw std::logic_error("unused"); }
+
+    lanxc::future<std::size_t, lanxc::buffer_chain>
+    read(lanxc::buffer_chain chain) override
+    {
+      auto c = std::make_shared<lanxc::buffer_chain>(std::move(chain));
+      return lanxc::future<std::size_t, lanxc::buffer_chain>(
+          [this, c](lanxc::promise<std::size_t, lanxc::buffer_chain> p)
+          {
+            std::size_t n = left == 0 ? 0 : 1;
+            c->for_each_capacity([&](std::uint8_t *room, std::size_t size)
+                                 {
+                                   if (size)
+                                     std::memset(room, 'x', n);
+                                 });
+            c->fill(n);
+            left -= n;
+            p.fulfill(n, std::move(*c));
+          });
+    }
+
+    void discard() override
+    { }
+
+    std::size_t left;
+  };
+
+  /** @brief Stream counting bytes written */
+  class counter : public lanxc::writable_stream
+  {
+  public:
+    lanxc::writable_buffer allocate_buffer(std::size_t size) override
+    { return lanxc::writable_buffer(bm, size); }
+
+    std::size_t write(lanxc::writable_buffer b) override
+    {
+      count += b.size();
+      return b.size();
+    }
+
+    void close() override
+    { }
+
+    lanxc::future<> flush() override
+    { return lanxc::future<>::resolve(); }
+
+    std::size_t count = 0;
+  };
+
+  /** @brief Pipe @p source into a socket pair and check what comes out */
+  void check(lanxc::readable_stream &source, const std::string &expected)
+  {
+    int out[2];
+    assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, out) == 0);
+    stream sink({out[0]}, bm);
+    std::string received;
+    std::thread t([&] { received = drain(sink); });
+    {
+      stream to({out[1]}, bm);
+      std::size_t moved = 0;
+      auto task = lanxc::linuxy::pipe(source, to, 16384)
+          .then([&](std::size_t n) { moved = n; })
+          .start(executor);
+      executor.run();
+      assert(moved == expected.size());
+    }
+    t.join();
+    assert(received == expected);
+  }
+}
+
+void test_socket()
+{
+  std::string content = payload();
+  int in[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, in) == 0);
+  stream source({in[0]}, bm), writer({in[1]}, bm);
+  std::thread t([&] { feed(writer, content); });
+  check(source, content);
+  t.join();
+}
+
+void test_pipe()
+{
+  std::string content = payload();
+  int in[2];
+  assert(::pipe(in) == 0);
+  stream source({in[0]}, bm);
+  std::thread t([&]
+  {
+    stream writer({in[1]}, bm);
+    feed(writer, content);
+  });
+  check(source, content);
+  t.join();
+}
+
+void test_file()
+{
+  std::string content = payload();
+  std::FILE *f = std::tmpfile();
+  assert(f);
+  assert(std::fwrite(content.data(), 1, content.size(), f) == content.size());
+  std::fflush(f);
+  int fd = ::dup(fileno(f));
+  std::fclose(f);
+  assert(::lseek(fd, 0, SEEK_SET) == 0);
+  stream source({fd}, bm);
+  check(source, content);
+}
+
+void test_fallback()
+{
+  std::string content = payload();
+  lanxc::linuxy::mirrored_ring ring(65536);
+  std::thread t([&] { feed(ring.output(), content); });
+  check(ring.input(), content);
+  t.join();
+}
+
+void test_waiting()
+{
+  // Both ends would block, the input until the writer starts, and the
+  // output until the reader starts, while the transfer waits without
+  // spinning
+  std::string content = payload();
+  int in[2], out[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, in) == 0);
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, out) == 0);
+  ::fcntl(in[0], F_SETFL, O_NONBLOCK);
+  ::fcntl(out[1], F_SETFL, O_NONBLOCK);
+  stream source({in[0]}, bm), sink({out[0]}, bm);
+  std::thread writer([&]
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    stream s({in[1]}, bm);
+    feed(s, content);
+  });
+  std::string received;
+  std::thread reader([&]
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    received = drain(sink);
+  });
+
+  struct timespec before, after;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &before);
+  std::size_t moved = 0;
+  {
+    stream to({out[1]}, bm);
+    auto task = lanxc::linuxy::pipe(source, to, 16384)
+        .then([&](std::size_t n) { moved = n; })
+        .start(executor);
+    executor.run();
+  }
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &after);
+  writer.join();
+  reader.join();
+  assert(moved == content.size());
+  assert(received == content);
+  auto ns = (after.tv_sec - before.tv_sec) * 1000000000L
+            + (after.tv_nsec - before.tv_nsec);
+  assert(ns < 100000000L);
+}
+
+void test_many_chunks()
+{
+  // Each chunk is a round of the same state, so neither memory nor the
+  // stack grows with chunks copied
+  const std::size_t chunks = 1 << 16;
+  trickle source(chunks);
+  counter sink;
+  std::size_t moved = 0;
+  {
+    auto task = lanxc::pipe(source, sink, 16)
+        .then([&](std::size_t n) { moved = n; })
+        .start(executor);
+    executor.run();
+  }
+  assert(moved == chunks);
+  assert(sink.count == chunks);
+}
+
+int main()
+{
+  test_socket();
+  test_pipe();
+  test_file();
+  test_fallback();
+  test_waiting();
+  test_many_chunks();
+}
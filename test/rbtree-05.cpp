@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/link/rbtree.hpp>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct transparent;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<>
+    struct rbtree_config<transparent> : rbtree_config<void>
+    {
+      template<typename T> using comparator = less<>;
+    };
+  }
+}
+
+using namespace lanxc::link;
+
+/** A key type that is comparable with, but not convertible to std::string */
+struct key_view
+{
+  const char *data;
+  std::size_t size;
+
+  int compare(const std::string &s) const noexcept
+  {
+    auto n = std::min(size, s.size());
+    int ret = std::memcmp(data, s.data(), n);
+    if (ret != 0) return ret;
+    return size < s.size() ? -1 : size > s.size() ? 1 : 0;
+  }
+
+  friend bool operator < (const key_view &l, const std::string &r) noexcept
+  { return l.compare(r) < 0; }
+
+  friend bool operator < (const std::string &l, const key_view &r) noexcept
+  { return r.compare(l) > 0; }
+};
+
+class node : public rbtree_node<std::string, node, transparent>
+{
+public:
+  node(std::string s)
+      : rbtree_node(std::move(s))
+  { }
+};
+
+class plain_node : public rbtree_node<std::string, plain_node>
+{
+public:
+  plain_node(std::string s)
+      : rbtree_node(std::move(s))
+  { }
+};
+
+static_assert(!std::is_convertible<key_view, std::string>::value, "");
+
+int main()
+{
+  const char *words[] = { "alpha", "bravo", "charlie", "delta", "echo" };
+  std::vector<node> nodes;
+  nodes.reserve(10);
+  for (auto w : words)
+  {
+    nodes.emplace_back(w);
+    nodes.emplace_back(w);
+  }
+
+  rbtree<std::string, node, transparent> tree;
+  for (auto &n : nodes)
+    tree.insert(n, index_policy::back());
+  assert(tree.size() == 10);
+
+  const char buffer[] = "xxcharliexx";
+  key_view charlie { buffer + 2, 7 };
+
+  auto i = tree.find(charlie);
+  assert(i != tree.end());
+  assert(i->get_index() == "charlie");
+
+  auto f = tree.find(charlie, index_policy::front());
+  auto b = tree.find(charlie, index_policy::back());
+  assert(f != b);
+  assert(std::next(f) == b);
+
+  auto r = tree.equals_range(charlie);
+  assert(r.first == f);
+  assert(std::next(b) == r.second);
+  assert(tree.count(charlie) == 2);
+
+  assert(tree.lower_bound(key_view{ "c", 1 })->get_index() == "charlie");
+  assert(tree.upper_bound(key_view{ "d", 1 })->get_index() == "delta");
+  assert(tree.find(key_view{ "charl", 5 }) == tree.end());
+
+  const auto &const_tree = tree;
+  assert(const_tree.find("echo") != const_tree.cend());
+  assert(const_tree.count("bravo") == 2);
+
+  tree.erase(charlie);
+  assert(tree.size() == 8);
+  assert(tree.find("charlie") == tree.end());
+
+  // Tree with a non-transparent comparator still accepts any key convertible
+  // to its index
+  std::vector<plain_node> plain_nodes(std::begin(words), std::end(words));
+  rbtree<std::string, plain_node> plain_tree;
+  for (auto &n : plain_nodes)
+    plain_tree.insert(n);
+  assert(plain_tree.find("delta")->get_index() == "delta");
+  assert(plain_tree.count("delta") == 1);
+  assert(plain_tree.lower_bound("d")->get_index() == "delta");
+  plain_tree.erase("delta");
+  assert(plain_tree.size() == 4);
+}
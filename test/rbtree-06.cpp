@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc/link/rbtree.hpp>
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <vector>
+
+struct from_back;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<>
+    struct rbtree_config<from_back> : rbtree_config<void>
+    {
+      static constexpr bool insert_from_back = true;
+    };
+  }
+}
+
+using namespace lanxc::link;
+
+class node : public rbtree_node<int, node, from_back>
+{
+public:
+  node(int x = 0)
+      : rbtree_node(x)
+  { }
+
+  friend bool operator < (const node &lhs, const node &rhs)
+  { return lhs.get_index() < rhs.get_index(); }
+};
+
+constexpr int N = 1000;
+
+template<typename Policy>
+void test_policy(const std::vector<int> &indexes, std::size_t expected_size)
+{
+  std::vector<node> nodes(indexes.begin(), indexes.end());
+  rbtree<int, node, from_back> tree;
+  for (auto &n : nodes)
+    tree.insert(n, Policy());
+
+  assert(tree.size() == expected_size);
+  assert(std::is_sorted(tree.begin(), tree.end()));
+  assert(std::is_sorted(tree.rbegin(), tree.rend(),
+                        [](const node &l, const node &r) { return r < l; }));
+}
+
+void test_indexes(const std::vector<int> &indexes)
+{
+  std::vector<int> unique = indexes;
+  std::sort(unique.begin(), unique.end());
+  auto distinct = std::size_t(
+      std::unique(unique.begin(), unique.end()) - unique.begin());
+
+  test_policy<index_policy::back>(indexes, indexes.size());
+  test_policy<index_policy::front>(indexes, indexes.size());
+  test_policy<index_policy::nearest>(indexes, indexes.size());
+  test_policy<index_policy::unique>(indexes, distinct);
+  test_policy<index_policy::conflict>(indexes, distinct);
+}
+
+int main()
+{
+  std::mt19937 engine;
+  std::vector<int> monotonic, mostly_monotonic, random;
+
+  for (int i = 0; i < N; i++)
+  {
+    monotonic.push_back(i / 3);
+    mostly_monotonic.push_back(i % 10 == 0 ? i - int(engine() % 50) : i);
+    random.push_back(int(engine() % N));
+  }
+
+  test_indexes(monotonic);
+  test_indexes(mostly_monotonic);
+  test_indexes(random);
+
+  // Equivalent nodes are still ordered as policy requires
+  node a(1), b(1), c(1);
+  rbtree<int, node, from_back> tree;
+  tree.insert(a, index_policy::back());
+  tree.insert(b, index_policy::back());
+  tree.insert(c, index_policy::front());
+  assert(&tree.front() == &c);
+  assert(&tree.back() == &b);
+}
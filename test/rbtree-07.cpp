@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include <lanxc/link/rbtree.hpp>
+#include <algorithm>
+#include <cassert>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+template<std::size_t Size>
+struct prefixed;
+
+template<std::size_t Size>
+struct transparent_prefixed;
+
+namespace lanxc
+{
+  namespace link
+  {
+    template<std::size_t Size>
+    struct rbtree_config<prefixed<Size>> : rbtree_config<void>
+    {
+      static constexpr std::size_t index_prefix_size = Size;
+    };
+
+    template<std::size_t Size>
+    struct rbtree_config<transparent_prefixed<Size>> : rbtree_config<void>
+    {
+      template<typename T> using comparator = less<>;
+      static constexpr std::size_t index_prefix_size = Size;
+    };
+  }
+}
+
+using namespace lanxc::link;
+
+template<typename Tag>
+class node : public rbtree_node<std::string, node<Tag>, Tag>
+{
+public:
+  node(std::string s = std::string())
+      : rbtree_node<std::string, node<Tag>, Tag>(std::move(s))
+  { }
+};
+
+template<typename Tag>
+using tree_type = rbtree<std::string, node<Tag>, Tag>;
+
+template<typename Tag>
+void check(const tree_type<Tag> &tree, const std::multiset<std::string> &s)
+{
+  assert(tree.size() == s.size());
+  assert(std::equal(s.begin(), s.end(), tree.begin(),
+                    [](const std::string &l, const node<Tag> &r)
+                    { return l == r.get_index(); }));
+}
+
+/** Keys sharing long prefixes, with embedded and trailing zero bytes */
+std::vector<std::string> make_keys()
+{
+  std::mt19937 engine;
+  const std::string stems[] = {
+    "", "a", "http://", "http://example.com/",
+    "http://example.com/index", std::string("ab\0\0", 4),
+    std::string("ab\0", 3), "ab", "\xff\xfe", "\x7f",
+  };
+  std::vector<std::string> keys;
+  for (auto &stem : stems)
+  {
+    keys.push_back(stem);
+    for (int i = 0; i < 20; i++)
+    {
+      std::string s = stem;
+      auto n = engine() % 20;
+      for (std::size_t j = 0; j < n; j++)
+        s.push_back(static_cast<char>(engine() % 4 == 0 ? 0 : engine()));
+      keys.push_back(s);
+    }
+  }
+  std::shuffle(keys.begin(), keys.end(), engine);
+  return keys;
+}
+
+template<typename Tag, typename Policy>
+void test_insert(const std::vector<std::string> &keys)
+{
+  std::vector<node<Tag>> nodes(keys.begin(), keys.end());
+  tree_type<Tag> tree;
+  std::multiset<std::string> expected;
+  for (auto &n : nodes)
+  {
+    tree.insert(n, Policy());
+    expected.insert(n.get_index());
+  }
+  assert(std::is_sorted(tree.begin(), tree.end(),
+                        [](const node<Tag> &l, const node<Tag> &r)
+                        { return l.get_index() < r.get_index(); }));
+  check(tree, expected);
+
+  for (auto &k : keys)
+  {
+    assert(tree.count(k) == expected.count(k));
+    assert(tree.find(k)->get_index() == k);
+    auto l = tree.lower_bound(k);
+    auto e = expected.lower_bound(k);
+    assert(l->get_index() == *e);
+    auto u = tree.upper_bound(k);
+    e = expected.upper_bound(k);
+    assert(u == tree.end() ? e == expected.end() : u->get_index() == *e);
+  }
+  assert(tree.find(std::string("absent")) == tree.end());
+
+  // Erase half of nodes, whose position may be swapped with others
+  for (std::size_t i = 0; i < nodes.size(); i += 2)
+  {
+    expected.erase(expected.find(nodes[i].get_index()));
+    nodes[i].unlink();
+  }
+  check(tree, expected);
+
+  // Change index of the rest, the prefix has to follow
+  for (std::size_t i = 1; i < nodes.size(); i += 2)
+  {
+    expected.erase(expected.find(nodes[i].get_index()));
+    std::string s = nodes[i].get_index();
+    s.insert(0, 1, static_cast<char>(i % 3));
+    nodes[i].template set_index_explicit<index_policy::back>(s);
+    expected.insert(s);
+  }
+  check(tree, expected);
+
+  // Moved nodes carry the prefix of their index
+  std::vector<node<Tag>> moved;
+  moved.reserve(nodes.size());
+  for (auto &n : nodes)
+    moved.push_back(std::move(n));
+  check(tree, expected);
+  for (auto &k : expected)
+    assert(tree.find(k)->get_index() == k);
+}
+
+template<typename Tag>
+void test_tag(const std::vector<std::string> &keys)
+{
+  test_insert<Tag, index_policy::back>(keys);
+  test_insert<Tag, index_policy::front>(keys);
+  test_insert<Tag, index_policy::nearest>(keys);
+}
+
+template<std::size_t Size>
+void test_transparent()
+{
+  using tag = transparent_prefixed<Size>;
+  node<tag> a("http://example.com/a"), b("http://example.com/b"),
+            c("http://example.org/");
+  tree_type<tag> tree;
+  tree.insert(a);
+  tree.insert(b);
+  tree.insert(c);
+  assert(&*tree.find("http://example.com/a") == &a);
+  assert(&*tree.find("http://example.com/b") == &b);
+  assert(&*tree.find("http://example.org/") == &c);
+  assert(tree.find("http://example.com/") == tree.end());
+  assert(&*tree.lower_bound("http://example.com/") == &a);
+  assert(&*tree.upper_bound("http://example.com/b") == &c);
+}
+
+int main()
+{
+  auto keys = make_keys();
+  test_tag<void>(keys);
+  test_tag<prefixed<8>>(keys);
+  test_tag<prefixed<16>>(keys);
+  test_transparent<8>();
+  test_transparent<16>();
+
+  // Without prefix the node is not enlarged
+  static_assert(sizeof(node<prefixed<0>>) == sizeof(node<void>), "");
+  static_assert(sizeof(node<prefixed<8>>) >= sizeof(node<void>) + 8, "");
+}
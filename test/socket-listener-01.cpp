@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using lanxc::connection_endpoint;
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::socket_endpoint;
+using lanxc::linuxy::socket_listener;
+using lanxc::linuxy::socket_listener_builder;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  std::uint16_t port_of(const socket_listener &l)
+  {
+    sockaddr_in in{};
+    socklen_t length = sizeof(in);
+    assert(::getsockname(l.native_handle(),
+                         reinterpret_cast<sockaddr *>(&in), &length) == 0);
+    return ntohs(in.sin_port);
+  }
+
+  /** @brief Connect to loopback, established once it returns */
+  int connect_loopback(std::uint16_t port)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd != -1);
+    sockaddr_in in{};
+    in.sin_family = AF_INET;
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    in.sin_port = htons(port);
+    assert(::connect(fd, reinterpret_cast<sockaddr *>(&in),
+                     sizeof(in)) == 0);
+    return fd;
+  }
+}
+
+void test_accept()
+{
+  event_loop loop;
+  std::vector<connection_endpoint::pointer> accepted;
+  auto listener = std::dynamic_pointer_cast<socket_listener>(
+      std::make_shared<socket_listener_builder>(loop, bm)
+          ->bind("127.0.0.1", 0)
+          ->build([&](connection_endpoint::pointer e)
+                  {
+                    accepted.push_back(std::move(e));
+                    if (accepted.size() == 3)
+                      loop.stop();
+                  }));
+  assert(listener);
+
+  std::vector<int> clients;
+  for (int i = 0; i < 3; i++)
+    clients.push_back(connect_loopback(port_of(*listener)));
+  loop.run();
+  assert(accepted.size() == 3);
+  assert(listener->statistics().accepted == 3);
+
+  // Accepted in non-blocking mode without further system calls
+  auto s = std::dynamic_pointer_cast<socket_endpoint>(accepted[0]);
+  assert(s);
+  assert(::fcntl(s->native_handle(), F_GETFL) & O_NONBLOCK);
+  assert(::fcntl(s->native_handle(), F_GETFD) & FD_CLOEXEC);
+  assert(::send(clients[0], "ping", 4, 0) == 4);
+  auto task = s->read(4, 4)
+      .then([&](std::size_t size, lanxc::readable_buffer b)
+            {
+              assert(size == 4);
+              assert(std::memcmp(b.data(), "ping", 4) == 0);
+              loop.stop();
+            })
+      .start(loop);
+  loop.run();
+
+  for (int c : clients)
+    ::close(c);
+}
+
+void test_budget()
+{
+  event_loop loop;
+  std::size_t accepted = 0;
+  auto builder = std::make_shared<socket_listener_builder>(loop, bm);
+  builder->set_accept_budget(2);
+  auto listener = std::dynamic_pointer_cast<socket_listener>(
+      builder->bind("127.0.0.1", 0)
+          ->build([&](connection_endpoint::pointer) { accepted++; }));
+
+  std::vector<int> clients;
+  for (int i = 0; i < 7; i++)
+    clients.push_back(connect_loopback(port_of(*listener)));
+
+  // A task deferred again and again notes connections accepted before
+  // each round of the loop
+  std::vector<std::size_t> rounds;
+  std::function<void()> tick = [&]
+  {
+    rounds.push_back(accepted);
+    if (accepted < clients.size())
+      loop.defer([&] { tick(); });
+    else
+      loop.stop();
+  };
+  auto task = loop.defer([&] { tick(); });
+  loop.run();
+
+  assert(accepted == clients.size());
+  assert(rounds.size() == 5);
+  for (std::size_t i = 1; i < rounds.size(); i++)
+    assert(rounds[i] - rounds[i - 1] <= 2);
+
+  for (int c : clients)
+    ::close(c);
+}
+
+void test_descriptors_exhausted()
+{
+  event_loop loop;
+  std::size_t accepted = 0;
+  auto listener = std::dynamic_pointer_cast<socket_listener>(
+      std::make_shared<socket_listener_builder>(loop, bm)
+          ->bind("127.0.0.1", 0)
+          ->build([&](connection_endpoint::pointer) { accepted++; }));
+
+  std::vector<int> clients;
+  for (int i = 0; i < 4; i++)
+    clients.push_back(connect_loopback(port_of(*listener)));
+
+  // Allow no more descriptors than those opened
+  rlimit original;
+  assert(::getrlimit(RLIMIT_NOFILE, &original) == 0);
+  int lowest = ::dup(0);
+  assert(lowest != -1);
+  ::close(lowest);
+  rlimit limit = original;
+  limit.rlim_cur = static_cast<rlim_t>(lowest);
+  assert(::setrlimit(RLIMIT_NOFILE, &limit) == 0);
+
+  auto stop = loop.schedule(steady_clock::now() + milliseconds(50),
+                            [&] { loop.stop(); });
+  loop.run();
+  assert(::setrlimit(RLIMIT_NOFILE, &original) == 0);
+
+  // Connections are closed instead of being left in the backlog
+  assert(accepted == 0);
+  assert(listener->statistics().rejected == clients.size());
+  for (int c : clients)
+  {
+    char b;
+    assert(::recv(c, &b, 1, 0) <= 0);
+    ::close(c);
+  }
+
+  // And accepted again once descriptors are available
+  int client = connect_loopback(port_of(*listener));
+  stop = loop.schedule(steady_clock::now() + milliseconds(50),
+                       [&] { loop.stop(); });
+  loop.run();
+  assert(accepted == 1);
+  ::close(client);
+}
+
+void test_back_off()
+{
+  // A listening socket made by hand, as the listener built under the limit
+  // gets no spare descriptor, and can't reject connections either
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  assert(fd != -1);
+  sockaddr_in in{};
+  in.sin_family = AF_INET;
+  in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  assert(::bind(fd, reinterpret_cast<sockaddr *>(&in), sizeof(in)) == 0);
+  assert(::listen(fd, 16) == 0);
+  socklen_t length = sizeof(in);
+  assert(::getsockname(fd, reinterpret_cast<sockaddr *>(&in), &length) == 0);
+  int client = connect_loopback(ntohs(in.sin_port));
+
+  event_loop loop;
+  rlimit original;
+  assert(::getrlimit(RLIMIT_NOFILE, &original) == 0);
+  int lowest = ::dup(0);
+  assert(lowest != -1);
+  ::close(lowest);
+  rlimit limit = original;
+  limit.rlim_cur = static_cast<rlim_t>(lowest);
+  assert(::setrlimit(RLIMIT_NOFILE, &limit) == 0);
+
+  std::size_t accepted = 0;
+  socket_listener listener(loop, lanxc::unixy::file_descriptor{fd}, bm);
+  listener.listen([&](connection_endpoint::pointer) { accepted++; });
+
+  // The socket stays readable, but it's not polled over and over
+  struct timespec before, after;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &before);
+  auto stop = loop.schedule(steady_clock::now() + milliseconds(100),
+                            [&] { loop.stop(); });
+  loop.run();
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &after);
+  assert(::setrlimit(RLIMIT_NOFILE, &original) == 0);
+  assert(accepted == 0);
+  auto ns = (after.tv_sec - before.tv_sec) * 1000000000L
+            + (after.tv_nsec - before.tv_nsec);
+  assert(ns < 50000000L);
+
+  // Polling resumes after a while, accepting once descriptors are back
+  stop = loop.schedule(steady_clock::now() + milliseconds(500),
+                       [&] { loop.stop(); });
+  loop.run();
+  assert(accepted == 1);
+  ::close(client);
+}
+
+void test_unix_path()
+{
+  event_loop loop;
+  std::string path = std::string(1, '\0') + "lanxc-socket-listener-"
+                     + std::to_string(::getpid());
+  std::vector<connection_endpoint::pointer> accepted;
+  auto listener = std::make_shared<socket_listener_builder>(loop, bm)
+      ->bind(path)
+      ->build([&](connection_endpoint::pointer e)
+              {
+                accepted.push_back(std::move(e));
+                loop.stop();
+              });
+
+  int client = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_un un{};
+  un.sun_family = AF_UNIX;
+  std::memcpy(un.sun_path, path.data(), path.size());
+  assert(::connect(client, reinterpret_cast<sockaddr *>(&un),
+                   static_cast<socklen_t>(offsetof(sockaddr_un, sun_path)
+                                          + path.size())) == 0);
+  loop.run();
+  assert(accepted.size() == 1);
+  ::close(client);
+}
+
+int main()
+{
+  test_accept();
+  test_budget();
+  test_descriptors_exhausted();
+  test_back_off();
+  test_unix_path();
+  return 0;
+}
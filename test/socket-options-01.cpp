@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/network_connection.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using lanxc::connection_endpoint;
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::socket_endpoint;
+using lanxc::linuxy::socket_endpoint_builder;
+using lanxc::linuxy::socket_listener;
+using lanxc::linuxy::socket_listener_builder;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  int get_option(int fd, int level, int name)
+  {
+    int value = 0;
+    socklen_t length = sizeof(value);
+    assert(::getsockopt(fd, level, name, &value, &length) == 0);
+    return value;
+  }
+
+  std::uint16_t port_of(const std::shared_ptr<lanxc::connection_listener> &l)
+  {
+    sockaddr_in in{};
+    socklen_t length = sizeof(in);
+    int fd = std::dynamic_pointer_cast<socket_listener>(l)->native_handle();
+    assert(::getsockname(fd, reinterpret_cast<sockaddr *>(&in),
+                         &length) == 0);
+    return ntohs(in.sin_port);
+  }
+
+  int connect_loopback(std::uint16_t port)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd != -1);
+    sockaddr_in in{};
+    in.sin_family = AF_INET;
+    in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    in.sin_port = htons(port);
+    assert(::connect(fd, reinterpret_cast<sockaddr *>(&in),
+                     sizeof(in)) == 0);
+    return fd;
+  }
+
+  void run_for(event_loop &loop, milliseconds duration)
+  {
+    auto stop = loop.schedule(steady_clock::now() + duration,
+                              [&loop] { loop.stop(); });
+    loop.run();
+  }
+}
+
+void test_listener()
+{
+  event_loop loop;
+  std::vector<connection_endpoint::pointer> accepted;
+  auto listener = std::make_shared<socket_listener_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->set_no_delay(true)
+      ->set_receive_buffer_size(128 << 10)
+      ->set_user_timeout(milliseconds(5000))
+      ->set_fast_open(16)
+      ->set_defer_accept(std::chrono::seconds(1))
+      ->set_backlog(8)
+      ->build([&](connection_endpoint::pointer e)
+              { accepted.push_back(std::move(e)); });
+  int fd = std::dynamic_pointer_cast<socket_listener>(listener)
+      ->native_handle();
+  assert(get_option(fd, IPPROTO_TCP, TCP_FASTOPEN) == 16);
+  assert(get_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT) != 0);
+
+  // Not accepted until the first bytes arrive
+  int client = connect_loopback(port_of(listener));
+  run_for(loop, milliseconds(30));
+  assert(accepted.empty());
+  assert(::send(client, "x", 1, 0) == 1);
+  run_for(loop, milliseconds(30));
+  assert(accepted.size() == 1);
+
+  // Options are inherited by the connection accepted
+  auto s = std::dynamic_pointer_cast<socket_endpoint>(accepted[0]);
+  int a = s->native_handle();
+  assert(get_option(a, IPPROTO_TCP, TCP_NODELAY) != 0);
+  assert(get_option(a, IPPROTO_TCP, TCP_USER_TIMEOUT) == 5000);
+  // The system doubles it for bookkeeping
+  assert(get_option(a, SOL_SOCKET, SO_RCVBUF) >= 128 << 10);
+  ::close(client);
+}
+
+void test_endpoint()
+{
+  event_loop loop;
+  std::vector<connection_endpoint::pointer> accepted;
+  auto listener = std::make_shared<socket_listener_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->build([&](connection_endpoint::pointer e)
+              { accepted.push_back(std::move(e)); });
+
+  auto builder = std::make_shared<socket_endpoint_builder>(loop, bm);
+  builder->set_no_delay(true)
+      ->set_send_buffer_size(64 << 10)
+      ->set_user_timeout(milliseconds(3000))
+      ->set_fast_open(true);
+
+  std::shared_ptr<socket_endpoint> s;
+  auto task = builder->connect("127.0.0.1", port_of(listener))
+      .then([&](connection_endpoint::pointer e)
+            {
+              s = std::dynamic_pointer_cast<socket_endpoint>(e);
+            })
+      .start(loop);
+  run_for(loop, milliseconds(20));
+  assert(s);
+  int fd = s->native_handle();
+  assert(get_option(fd, IPPROTO_TCP, TCP_NODELAY) != 0);
+  assert(get_option(fd, IPPROTO_TCP, TCP_USER_TIMEOUT) == 3000);
+  assert(get_option(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT) != 0);
+  assert(get_option(fd, SOL_SOCKET, SO_SNDBUF) >= 64 << 10);
+
+  // Bytes written first go along with the handshake, or right after it
+  // without a cookie
+  lanxc::writable_buffer b(bm, 5);
+  std::memcpy(b.data(), "hello", 5);
+  s->write(std::move(b));
+  run_for(loop, milliseconds(30));
+  assert(s->is_open());
+  assert(accepted.size() == 1);
+  auto peer = std::dynamic_pointer_cast<socket_endpoint>(accepted[0]);
+  assert(peer->buffered() == 5);
+}
+
+int main()
+{
+  test_listener();
+  test_endpoint();
+  return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/socket_stream.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::socket_stream;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  /** @brief Read from @p s until the end, one future after another */
+  struct drainer
+  {
+    socket_stream &s;
+    event_loop &loop;
+    std::size_t total;
+    std::size_t max_buffered;
+    std::vector<std::shared_ptr<lanxc::deferred>> tasks;
+
+    void next()
+    {
+      tasks.push_back(s.read(100000, 1)
+          .then([this](std::size_t n, lanxc::readable_buffer b)
+                {
+                  assert(n == b.size());
+                  total += n;
+                  max_buffered = std::max(max_buffered, s.buffered());
+                  if (n != 0)
+                    loop.defer([this] { next(); });
+                })
+          .start(loop));
+    }
+  };
+}
+
+void test_receiving()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream s(loop, {fds[0]}, bm, {16 << 10, 64 << 10},
+                  {16 << 10, 64 << 10}, 4096);
+
+  // Fill the socket buffer of the peer
+  ::fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  std::uint8_t data[4096] = {};
+  std::size_t written = 0;
+  ssize_t n;
+  while ((n = ::write(fds[1], data, sizeof(data))) > 0)
+    written += std::size_t(n);
+  assert(written > 64 << 10);
+
+  // Nobody reads, so receiving stops above the high watermark
+  loop.schedule(steady_clock::now() + milliseconds(20), [&] { loop.stop(); });
+  loop.run();
+  assert(!s.receiving());
+  assert(s.buffered() >= 64 << 10);
+  assert(s.buffered() < (64 << 10) + 4096);
+
+  // Consuming resumes receiving until the end
+  ::close(fds[1]);
+  drainer d{s, loop, 0, 0, {}};
+  d.next();
+  loop.run();
+  assert(d.total == written);
+}
+
+void test_sending()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream s(loop, {fds[0]}, bm, {16 << 10, 64 << 10},
+                  {32 << 10, 128 << 10});
+
+  // Nobody reads, so bytes are queued once the socket buffer is full
+  std::size_t written = 0;
+  while (s.queued() <= 128 << 10)
+  {
+    lanxc::writable_buffer b(bm, 16 << 10);
+    std::memset(b.data(), int(written >> 14), b.size());
+    written += s.write(std::move(b));
+  }
+
+  std::size_t received = 0;
+  std::thread peer([&]
+  {
+    std::uint8_t buffer[65536];
+    ssize_t n;
+    while ((n = ::read(fds[1], buffer, sizeof(buffer))) > 0)
+      received += std::size_t(n);
+    ::close(fds[1]);
+  });
+
+  bool drained = false;
+  auto d = s.drain()
+      .then([&]
+            {
+              assert(s.queued() < 32 << 10);
+              drained = true;
+              s.close();
+            })
+      .start(loop);
+  bool flushed = false;
+  auto f = s.flush()
+      .then([&]
+            {
+              assert(s.queued() == 0);
+              flushed = true;
+              loop.stop();
+            })
+      .start(loop);
+  loop.run();
+  assert(drained && flushed);
+  peer.join();
+  assert(received == written);
+}
+
+std::size_t receive_all(int fd)
+{
+  std::uint8_t buffer[65536];
+  std::size_t total = 0;
+  ssize_t n;
+  while ((n = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+    total += std::size_t(n);
+  return total;
+}
+
+void test_coalescing()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream s(loop, {fds[0]}, bm);
+  auto message = [&]
+  {
+    lanxc::writable_buffer b(bm, 100);
+    std::memset(b.data(), 'x', b.size());
+    s.write(std::move(b));
+  };
+
+  // Writes of an iteration are sent together at the end of it
+  s.coalesce({64 << 10, std::chrono::nanoseconds::zero()});
+  for (int i = 0; i < 100; i++)
+    message();
+  assert(s.queued() == 10000);
+  assert(s.statistics().syscalls == 0);
+  auto t = loop.defer([&] { loop.stop(); });
+  loop.run();
+  assert(s.queued() == 0);
+  assert(s.statistics().messages == 100);
+  assert(s.statistics().syscalls == 1);
+  assert(receive_all(fds[1]) == 10000);
+
+  // Bytes held are sent once exceeding the threshold
+  s.coalesce({1000, std::chrono::nanoseconds::zero()});
+  for (int i = 0; i < 95; i++)
+    message();
+  assert(s.statistics().syscalls == 10);
+  assert(s.queued() == 500);
+
+  // Or once flushed
+  bool flushed = false;
+  auto f = s.flush()
+      .then([&]
+            {
+              flushed = true;
+              loop.stop();
+            })
+      .start(loop);
+  loop.run();
+  assert(flushed);
+  assert(s.queued() == 0);
+  assert(s.statistics().syscalls == 11);
+  assert(receive_all(fds[1]) == 9500);
+
+  // Or after a delay
+  auto start = steady_clock::now();
+  s.coalesce({64 << 10, milliseconds(20)});
+  message();
+  loop.defer([&] { message(); });
+  loop.schedule(start + milliseconds(10), [&]
+  {
+    assert(s.queued() == 200);
+  });
+  loop.schedule(start + milliseconds(30), [&] { loop.stop(); });
+  loop.run();
+  assert(s.queued() == 0);
+  assert(s.statistics().syscalls == 12);
+  assert(s.statistics().messages == 197);
+  assert(s.statistics().bytes == 19700);
+
+  // Disabling sends bytes being held right away
+  message();
+  s.coalesce({0, std::chrono::nanoseconds::zero()});
+  assert(s.queued() == 0);
+  message();
+  assert(s.statistics().syscalls == 14);
+  assert(receive_all(fds[1]) == 400);
+  ::close(fds[1]);
+}
+
+void test_chain()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream s(loop, {fds[0]}, bm);
+  auto room = []
+  {
+    lanxc::buffer_chain chain;
+    for (std::size_t size : { 4, 8 })
+    {
+      lanxc::writable_buffer b(bm, size);
+      b.resize(0);
+      chain.push_back(std::move(b));
+    }
+    return chain;
+  };
+
+  // The loop keeps running while a read is waiting for bytes
+  std::string received;
+  bool ticked = false;
+  auto read = s.read(room())
+      .then([&](std::size_t n, lanxc::buffer_chain c)
+            {
+              assert(ticked);
+              assert(n == c.size());
+              c.for_each([&](const std::uint8_t *data, std::size_t size)
+                         {
+                           received.append(
+                               reinterpret_cast<const char *>(data), size);
+                         });
+              loop.stop();
+            })
+      .start(loop);
+  auto tick = loop.schedule(steady_clock::now() + milliseconds(10), [&]
+  {
+    ticked = true;
+    assert(::write(fds[1], "hello, world!", 13) == 13);
+  });
+  loop.run();
+  assert(received == "hello, world");
+
+  // The rest, then the end of stream
+  ::close(fds[1]);
+  std::size_t last = 1;
+  read = s.read(room())
+      .then([&](std::size_t n, lanxc::buffer_chain c)
+            {
+              assert(n == 1 && c.size() == 1);
+              return s.read(room());
+            })
+      .then([&](std::size_t n, lanxc::buffer_chain)
+            {
+              last = n;
+              loop.stop();
+            })
+      .start(loop);
+  loop.run();
+  assert(last == 0);
+}
+
+int main()
+{
+  test_receiving();
+  test_sending();
+  test_coalescing();
+  test_chain();
+}
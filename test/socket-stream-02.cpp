@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/socket_stream.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <string>
+#include <vector>
+
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::socket_stream;
+using lanxc::unixy::file_descriptor;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  lanxc::buffer_chain chain_of(const std::string &content)
+  {
+    lanxc::writable_buffer b(bm, content.size());
+    std::memcpy(b.data(), content.data(), content.size());
+    lanxc::buffer_chain chain;
+    chain.push_back(std::move(b));
+    return chain;
+  }
+
+  /** @brief Read @p size bytes from @p s by the event loop */
+  std::string read_all(socket_stream &s, event_loop &loop, std::size_t size)
+  {
+    std::string content;
+    std::vector<std::shared_ptr<lanxc::deferred>> tasks;
+    lanxc::function<void()> next = [&]
+    {
+      tasks.push_back(s.read(size - content.size(), size - content.size())
+          .then([&](std::size_t n, lanxc::readable_buffer b)
+                {
+                  content.append(reinterpret_cast<const char *>(b.data()), n);
+                  if (content.size() < size && n != 0)
+                    loop.defer([&] { next(); });
+                  else
+                    loop.stop();
+                })
+          .start(loop));
+    };
+    next();
+    loop.run();
+    return content;
+  }
+}
+
+void test_memfd()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream a(loop, {fds[0]}, bm);
+  socket_stream b(loop, {fds[1]}, bm);
+
+  // Hand over a large payload in a memfd rather than the bytes
+  std::string payload(1 << 20, 'p');
+  file_descriptor memfd { ::memfd_create("payload", MFD_CLOEXEC) };
+  assert(memfd);
+  assert(::write(memfd, payload.data(), payload.size())
+         == ssize_t(payload.size()));
+  int pipes[2];
+  assert(::pipe(pipes) == 0);
+  file_descriptor reading { pipes[0] };
+  file_descriptor writing { pipes[1] };
+
+  std::vector<file_descriptor> descriptors;
+  descriptors.push_back(std::move(memfd));
+  descriptors.push_back(std::move(reading));
+  a.write(chain_of("first"), std::move(descriptors));
+  a.write(chain_of("second"));
+
+  assert(read_all(b, loop, 11) == "firstsecond");
+  auto attachments = b.take_descriptors();
+  assert(attachments.size() == 1);
+  assert(attachments[0].offset == 0);
+  auto &received = attachments[0].descriptors;
+  assert(received.size() == 2);
+  assert(b.take_descriptors().empty());
+
+  // The memfd is shared rather than copied
+  auto p = static_cast<const char *>(
+      ::mmap(nullptr, payload.size(), PROT_READ, MAP_SHARED, received[0], 0));
+  assert(p != MAP_FAILED);
+  assert(std::memcmp(p, payload.data(), payload.size()) == 0);
+  ::munmap(const_cast<char *>(p), payload.size());
+
+  // So is the pipe
+  assert(::write(writing, "x", 1) == 1);
+  char c;
+  assert(::read(received[1], &c, 1) == 1 && c == 'x');
+}
+
+void test_many_descriptors()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream a(loop, {fds[0]}, bm);
+  socket_stream b(loop, {fds[1]}, bm);
+
+  // More than a single message passes, and two batches back to back
+  std::vector<file_descriptor> descriptors;
+  for (std::size_t i = 0; i < 300; i++)
+    descriptors.emplace_back(::dup(0));
+  bool thrown = false;
+  try
+  {
+    a.write(chain_of("x"), std::move(descriptors));
+  }
+  catch (std::invalid_argument &)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+
+  descriptors.clear();
+  for (std::size_t i = 0; i < 300; i++)
+    descriptors.emplace_back(::dup(0));
+  a.write(chain_of("xy"), std::move(descriptors));
+  descriptors.clear();
+  for (std::size_t i = 0; i < 3; i++)
+    descriptors.emplace_back(::dup(0));
+  a.write(chain_of("z"), std::move(descriptors));
+
+  assert(read_all(b, loop, 3) == "xyz");
+  auto received = b.take_descriptors();
+  assert(received.size() == 3);
+  assert(received[0].offset == 0 && received[0].descriptors.size() == 253);
+  assert(received[1].offset == 1 && received[1].descriptors.size() == 47);
+  assert(received[2].offset == 2 && received[2].descriptors.size() == 3);
+  for (auto &a : received)
+    for (auto &fd : a.descriptors)
+      assert(fd);
+}
+
+void test_offsets()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream a(loop, {fds[0]}, bm);
+  socket_stream b(loop, {fds[1]}, bm);
+
+  // Descriptors in the middle of bytes written together are told apart
+  // from the bytes before and after them
+  a.write(chain_of("head"));
+  std::vector<file_descriptor> descriptors;
+  descriptors.emplace_back(::dup(0));
+  a.write(chain_of("body"), std::move(descriptors));
+  descriptors.clear();
+  descriptors.emplace_back(::dup(0));
+  descriptors.emplace_back(::dup(0));
+  a.write(chain_of("tail"), std::move(descriptors));
+
+  assert(read_all(b, loop, 12) == "headbodytail");
+  auto received = b.take_descriptors();
+  assert(received.size() == 2);
+  assert(received[0].offset == 4 && received[0].descriptors.size() == 1);
+  assert(received[1].offset == 8 && received[1].descriptors.size() == 2);
+}
+
+void test_truncated()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream a(loop, {fds[0]}, bm);
+  socket_stream b(loop, {fds[1]}, bm);
+
+  std::vector<file_descriptor> descriptors;
+  for (std::size_t i = 0; i < 4; i++)
+    descriptors.emplace_back(::dup(0));
+  a.write(chain_of("x"), std::move(descriptors));
+
+  // No room for descriptors received, so the system discards them
+  file_descriptor probe { ::dup(0) };
+  int highest = probe;
+  probe = file_descriptor{};
+  struct rlimit saved;
+  assert(::getrlimit(RLIMIT_NOFILE, &saved) == 0);
+  struct rlimit limited = saved;
+  limited.rlim_cur = rlim_t(highest);
+  assert(::setrlimit(RLIMIT_NOFILE, &limited) == 0);
+
+  int error = 0;
+  auto task = b.read(1, 1)
+      .then([&](std::size_t, lanxc::readable_buffer) { loop.stop(); })
+      .caught<std::system_error>([&](std::system_error &e)
+                                 {
+                                   error = e.code().value();
+                                   loop.stop();
+                                 })
+      .start(loop);
+  loop.run();
+  assert(::setrlimit(RLIMIT_NOFILE, &saved) == 0);
+  assert(error == EMSGSIZE);
+  assert(!b.is_open());
+  assert(b.take_descriptors().empty());
+}
+
+void test_credentials()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  event_loop loop;
+  socket_stream a(loop, {fds[0]}, bm);
+  socket_stream b(loop, {fds[1]}, bm);
+  auto c = a.peer_credentials();
+  assert(c.pid == ::getpid());
+  assert(c.uid == ::getuid());
+  assert(c.gid == ::getgid());
+}
+
+int main()
+{
+  test_memfd();
+  test_many_descriptors();
+  test_offsets();
+  test_truncated();
+  test_credentials();
+  return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/udp_endpoint.hpp>
+#include <lanxc/core/slab_buffer_manager.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using lanxc::datagram;
+using lanxc::linuxy::event_loop;
+using lanxc::linuxy::udp_endpoint;
+using lanxc::linuxy::udp_endpoint_builder;
+
+namespace
+{
+  lanxc::slab_buffer_manager bm;
+
+  /** @brief Count bytes of buffers not released yet */
+  struct counting_buffer_manager : lanxc::buffer_manager
+  {
+    std::size_t outstanding = 0;
+
+    std::uint8_t *acquire(std::size_t size) override
+    {
+      outstanding += size;
+      return static_cast<std::uint8_t *>(std::malloc(size));
+    }
+
+    void release(std::uint8_t *data, std::size_t size) noexcept override
+    {
+      outstanding -= size;
+      std::free(data);
+    }
+  };
+
+  std::uint16_t local_port(const lanxc::datagram_endpoint::pointer &e)
+  {
+    auto u = std::dynamic_pointer_cast<udp_endpoint>(e);
+    assert(u);
+    sockaddr_in in{};
+    socklen_t length = sizeof(in);
+    assert(::getsockname(u->native_handle(),
+                         reinterpret_cast<sockaddr *>(&in), &length) == 0);
+    return ntohs(in.sin_port);
+  }
+
+  datagram make_datagram(const std::string &content,
+                         lanxc::datagram_address peer)
+  {
+    lanxc::writable_buffer b(bm, content.size());
+    std::memcpy(b.data(), content.data(), content.size());
+    return datagram{lanxc::buffer_slice(lanxc::readable_buffer(std::move(b))),
+                    peer, 0};
+  }
+
+  std::string content_of(const datagram &d)
+  {
+    return std::string(reinterpret_cast<const char *>(d.payload.data()),
+                       d.payload.size());
+  }
+}
+
+void test_batches()
+{
+  event_loop loop;
+  auto receiver = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->set_batch_size(16)
+      ->set_datagram_size(256)
+      ->build();
+  auto sender = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->connect("127.0.0.1", local_port(receiver))
+      ->set_batch_size(16)
+      ->build();
+
+  std::vector<datagram> out;
+  for (std::size_t i = 0; i < 100; i++)
+    out.push_back(make_datagram(std::string(i + 1, char('a' + i % 26)),
+                                lanxc::datagram_address{0, {}}));
+  assert(sender->send(std::move(out)) == 100);
+  assert(sender->queued() == 0);
+
+  std::vector<datagram> in;
+  while (in.size() < 100)
+    assert(receiver->receive(in) != 0);
+  assert(receiver->receive(in) == 0);
+  for (std::size_t i = 0; i < 100; i++)
+  {
+    assert(content_of(in[i]) == std::string(i + 1, char('a' + i % 26)));
+    assert(in[i].peer.length == sizeof(sockaddr_in));
+  }
+
+  auto &rs = std::dynamic_pointer_cast<udp_endpoint>(receiver)->statistics();
+  auto &ss = std::dynamic_pointer_cast<udp_endpoint>(sender)->statistics();
+  assert(rs.received == 100);
+  assert(ss.sent == 100);
+  // One syscall per full batch, plus the last one would block
+  assert(ss.syscalls == 7);
+  assert(rs.syscalls == 8);
+}
+
+void test_future()
+{
+  event_loop loop;
+  auto receiver = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->build();
+  auto sender = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->build();
+
+  std::vector<datagram> received;
+  auto task = receiver->receive()
+      .then([&](std::vector<datagram> d) { received = std::move(d); })
+      .start(loop);
+  loop.defer([&]
+             {
+               std::vector<datagram> out;
+               out.push_back(make_datagram(
+                   "ping", sender->resolve("127.0.0.1",
+                                           local_port(receiver))));
+               sender->send(std::move(out));
+             });
+  loop.run();
+  assert(received.size() == 1);
+  assert(content_of(received[0]) == "ping");
+
+  // Reply to the peer where the datagram comes from
+  std::vector<datagram> reply;
+  reply.push_back(make_datagram("pong", received[0].peer));
+  receiver->send(std::move(reply));
+  auto flushed = receiver->flush().start(loop);
+  loop.run();
+  std::vector<datagram> in;
+  assert(sender->receive(in) == 1);
+  assert(content_of(in[0]) == "pong");
+}
+
+void test_oversized()
+{
+  event_loop loop;
+  auto receiver = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->set_datagram_size(8)
+      ->build();
+  auto sender = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->connect("127.0.0.1", local_port(receiver))
+      ->build();
+
+  std::vector<datagram> out;
+  out.push_back(make_datagram("small", lanxc::datagram_address{0, {}}));
+  out.push_back(make_datagram("far too large",
+                              lanxc::datagram_address{0, {}}));
+  out.push_back(make_datagram("tiny", lanxc::datagram_address{0, {}}));
+  sender->send(std::move(out));
+
+  std::vector<datagram> in;
+  assert(receiver->receive(in) == 2);
+  assert(content_of(in[0]) == "small");
+  assert(content_of(in[1]) == "tiny");
+  auto u = std::dynamic_pointer_cast<udp_endpoint>(receiver);
+  assert(u->statistics().dropped == 1);
+  // Datagrams of a batch share the buffer
+  assert(in[0].payload.use_count() == 2);
+}
+
+void test_offload()
+{
+  event_loop loop;
+  auto receiver = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->bind("127.0.0.1", 0)
+      ->set_batch_size(4)
+      ->set_receive_offload(true)
+      ->build();
+  auto sender = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->connect("127.0.0.1", local_port(receiver))
+      ->build();
+
+  // 200 segments of 100 bytes and one of 50, more than the system splits
+  // at once
+  std::string content;
+  for (std::size_t i = 0; i < 201; i++)
+    content.append(i < 200 ? 100 : 50, char('a' + i % 26));
+  auto d = make_datagram(content, lanxc::datagram_address{0, {}});
+  d.segment_size = 100;
+  std::vector<datagram> out;
+  out.push_back(std::move(d));
+  assert(sender->send(std::move(out)) == 201);
+  auto u = std::dynamic_pointer_cast<udp_endpoint>(sender);
+  if (u->segmentation())
+    assert(u->statistics().syscalls == 1);
+
+  std::vector<datagram> in;
+  while (in.size() < 201)
+    assert(receiver->receive(in) != 0);
+  for (std::size_t i = 0; i < 201; i++)
+    assert(content_of(in[i])
+           == std::string(i < 200 ? 100 : 50, char('a' + i % 26)));
+  auto r = std::dynamic_pointer_cast<udp_endpoint>(receiver);
+  assert(r->statistics().received == 201);
+}
+
+void test_small_batch()
+{
+  // A datagram kept from a small batch doesn't pin the buffer of 64KiB
+  // slots received into, which is reused for the next batch instead
+  counting_buffer_manager counting;
+  event_loop loop;
+  auto receiver = std::make_shared<udp_endpoint_builder>(loop, counting)
+      ->bind("127.0.0.1", 0)
+      ->set_batch_size(32)
+      ->set_receive_offload(true)
+      ->build();
+  auto sender = std::make_shared<udp_endpoint_builder>(loop, bm)
+      ->connect("127.0.0.1", local_port(receiver))
+      ->build();
+  std::size_t slots = counting.outstanding;
+  assert(slots == 32 * 65536);
+
+  std::vector<datagram> kept;
+  for (int i = 0; i < 3; i++)
+  {
+    std::vector<datagram> out;
+    out.push_back(make_datagram("ping", lanxc::datagram_address{0, {}}));
+    out.push_back(make_datagram("pong", lanxc::datagram_address{0, {}}));
+    assert(sender->send(std::move(out)) == 2);
+    std::vector<datagram> in;
+    while (in.size() < 2)
+      assert(receiver->receive(in) != 0);
+    assert(content_of(in[0]) == "ping");
+    assert(content_of(in[1]) == "pong");
+    kept.push_back(std::move(in[0]));
+  }
+  // Only buffers of the size of batches received are kept
+  assert(counting.outstanding <= slots + 3 * 8);
+  kept.clear();
+  assert(counting.outstanding == slots);
+}
+
+int main()
+{
+  test_batches();
+  test_future();
+  test_oversized();
+  test_offload();
+  test_small_batch();
+  return 0;
+}
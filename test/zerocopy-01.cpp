@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2017 LAN Xingcan
+ * All right reserved
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <lanxc-linux/zerocopy_stream.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using lanxc::linuxy::zerocopy_stream;
+
+namespace
+{
+  struct counting_buffer_manager : lanxc::buffer_manager
+  {
+    std::size_t outstanding = 0;
+
+    std::uint8_t *acquire(std::size_t size) override
+    {
+      outstanding++;
+      return static_cast<std::uint8_t *>(std::malloc(size));
+    }
+
+    void release(std::uint8_t *data, std::size_t) noexcept override
+    {
+      outstanding--;
+      std::free(data);
+    }
+  };
+
+  void tcp_pair(int fds[2])
+  {
+    int l = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    assert(::bind(l, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    assert(::listen(l, 1) == 0);
+    assert(::getsockname(l, reinterpret_cast<sockaddr *>(&addr), &len) == 0);
+    fds[0] = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(::connect(fds[0], reinterpret_cast<sockaddr *>(&addr), len) == 0);
+    fds[1] = ::accept(l, nullptr, nullptr);
+    ::close(l);
+  }
+
+  std::string receive(int fd)
+  {
+    std::string s;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0)
+      s.append(buffer, std::size_t(n));
+    ::close(fd);
+    return s;
+  }
+
+  /** @brief Send buffers of @p sizes and check they arrive and are freed */
+  void exchange(int fds[2], const std::size_t *sizes, std::size_t count)
+  {
+    counting_buffer_manager bm;
+    std::string expected, received;
+    std::thread t([&] { received = receive(fds[1]); });
+    {
+      zerocopy_stream s({fds[0]}, bm, 16 << 10);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        lanxc::writable_buffer b(bm, sizes[i]);
+        for (std::size_t j = 0; j < sizes[i]; j++)
+          b.data()[j] = static_cast<std::uint8_t>('a' + (i + j) % 26);
+        expected.append(reinterpret_cast<char *>(b.data()), sizes[i]);
+        assert(s.write(std::move(b)) == sizes[i]);
+      }
+      assert(s.pending() <= count);
+      // Buffers are all released once the stream is destroyed
+      s.close();
+    }
+    t.join();
+    assert(bm.outstanding == 0);
+    assert(received == expected);
+  }
+}
+
+void test_tcp()
+{
+  int fds[2];
+  tcp_pair(fds);
+  std::size_t sizes[] = { 100, 1 << 20, 20000, 1000, 300000, 16384 };
+  exchange(fds, sizes, 6);
+}
+
+void test_unsupported()
+{
+  int fds[2];
+  assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  {
+    counting_buffer_manager bm;
+    zerocopy_stream s({::dup(fds[0])}, bm);
+    assert(!s.enabled());
+  }
+  std::size_t sizes[] = { 1 << 16, 10 };
+  exchange(fds, sizes, 2);
+}
+
+void test_stalled_peer()
+{
+  int fds[2];
+  tcp_pair(fds);
+  // The peer never reads, so its window closes and most bytes are kept
+  // in the queue of the socket, along with the buffer holding them
+  int small = 4096, large = 1 << 20;
+  ::setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+  ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &large, sizeof(large));
+  counting_buffer_manager bm;
+  auto before = std::chrono::steady_clock::now();
+  {
+    zerocopy_stream s({fds[0]}, bm, 16 << 10, std::chrono::milliseconds(100));
+    assert(s.enabled());
+    lanxc::writable_buffer b(bm, 256 << 10);
+    std::memset(b.data(), 'x', b.size());
+    assert(s.write(std::move(b)) == 256 << 10);
+    assert(s.pending() == 1);
+    before = std::chrono::steady_clock::now();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - before;
+  assert(elapsed >= std::chrono::milliseconds(100));
+  assert(elapsed < std::chrono::seconds(1));
+  assert(bm.outstanding == 0);
+
+  // The connection is reset rather than closed
+  char buffer[65536];
+  ssize_t n;
+  while ((n = ::read(fds[1], buffer, sizeof(buffer))) > 0)
+    ;
+  assert(n == -1 && errno == ECONNRESET);
+  ::close(fds[1]);
+}
+
+int main()
+{
+  test_tcp();
+  test_unsupported();
+  test_stalled_peer();
+}